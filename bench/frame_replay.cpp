@@ -0,0 +1,255 @@
+/**
+ * StreamLumo Frame Replay
+ *
+ * Feeds a recording made with STREAMLUMO_RECORD (see frame_recording.h)
+ * through FrameWriter::processFrame() into a shared-memory channel, with a
+ * consumer reading it on another thread, and reports throughput and the
+ * per-stage latency of conversion and transport. The same recording gives
+ * the same work on every run, so results can be compared across builds.
+ *
+ * Usage: streamlumo-replay <recording> [--max-rate] [--loops N] [--format F] [--width N] [--height N]
+ *                          [--ring N] [--threads N] [--native-size]
+ * Frames are fed at their recorded pace unless --max-rate is given.
+ * --format picks the channel format (rgba, bgra, rgbx, premultiplied, nv12,
+ * i420; default rgba) and --width/--height its size (default: the first
+ * recorded frame). --ring N creates an N-slot ring channel and holds each
+ * frame back (up to 100 ms) until the ring has room, so a lossless channel
+ * runs at the consumer's pace; --threads N converts in N band workers plus
+ * the feeding thread.
+ * Exits non-zero if the recording can't be read or a frame failed to convert.
+ *
+ * Needs libobs (FrameWriter logs through it) but not a running OBS.
+ *
+ * @license GPL-2.0
+ */
+
+#include "../include/shared_buffer.h"
+#include "../src/frame_writer.h"
+#include "../src/frame_recording.h"
+#include "../src/latency_histogram.h"
+
+#ifdef _WIN32
+#include "../src/shm_win32.h"
+#include <process.h>
+using ShmImpl = StreamLumo::ShmWin32;
+#define getpid _getpid
+#else
+#include "../src/shm_posix.h"
+#include <unistd.h>
+using ShmImpl = StreamLumo::ShmPosix;
+#endif
+
+#include <util/platform.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string path;
+    bool maxRate = false;
+    uint32_t loops = 1;
+    uint32_t format = FORMAT_RGBA;
+    uint32_t width = 0;         // 0 = first recorded frame
+    uint32_t height = 0;
+    uint32_t ringSlots = 0;     // 0 = latest-frame mode
+    uint32_t threads = 0;
+    bool nativeSize = false;
+};
+
+struct ConsumerResult {
+    std::atomic<uint64_t> frames{0};
+};
+
+bool parseFormat(const std::string &name, uint32_t &format)
+{
+    if (name == "rgba") format = FORMAT_RGBA;
+    else if (name == "bgra") format = FORMAT_BGRA;
+    else if (name == "rgbx") format = FORMAT_RGBX;
+    else if (name == "premultiplied") format = FORMAT_RGBA_PREMULTIPLIED;
+    else if (name == "nv12") format = FORMAT_NV12;
+    else if (name == "i420") format = FORMAT_I420;
+    else return false;
+    return true;
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--max-rate") options.maxRate = true;
+        else if (arg == "--loops" && hasValue) options.loops = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--format" && hasValue) { if (!parseFormat(argv[++i], options.format)) return false; }
+        else if (arg == "--width" && hasValue) options.width = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--height" && hasValue) options.height = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--ring" && hasValue) options.ringSlots = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) options.threads = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--native-size") options.nativeSize = true;
+        else if (options.path.empty() && arg[0] != '-') options.path = arg;
+        else return false;
+    }
+    return !options.path.empty() && options.loops > 0;
+}
+
+void runConsumer(ShmImpl &shm, const std::atomic<bool> &done, ConsumerResult &result)
+{
+    std::vector<unsigned char> frame(shm.getBuffer()->slot_size);
+
+    while (!done.load(std::memory_order_acquire)) {
+        if (!shm.waitForFrame(100)) continue;
+
+        // One wake can cover several ring frames
+        StreamLumo::FrameMetadata metadata;
+        while (shm.readFrame(frame.data(), frame.size(), &metadata)) {
+            result.frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void printLatency(const char *stage, const StreamLumo::LatencySummary &latency)
+{
+    printf("[Replay]   %-8s p50/p95/p99/max (ms): %.3f/%.3f/%.3f/%.3f\n",
+           stage, latency.p50Ms, latency.p95Ms, latency.p99Ms, latency.maxMs);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s <recording> [--max-rate] [--loops N] [--format rgba|bgra|rgbx|premultiplied|nv12|i420]\n"
+                        "       [--width N] [--height N] [--ring N] [--threads N] [--native-size]\n", argv[0]);
+        return 2;
+    }
+
+    StreamLumo::FrameRecording recording;
+    if (!recording.open(options.path)) return 2;
+    if (recording.frameCount() == 0) {
+        fprintf(stderr, "[Replay] %s holds no frames\n", options.path.c_str());
+        return 2;
+    }
+    const StreamLumo::RecordedFrame &first = recording.frame(0);
+    const uint32_t width = options.width ? options.width : first.width;
+    const uint32_t height = options.height ? options.height : first.height;
+
+    // The channel as the Electron app would create it, and a registered reader
+    const std::string channel = "replay-" + std::to_string(static_cast<long>(getpid()));
+    ShmImpl owner(channel);
+    const uint32_t flags = (options.ringSlots > 0 ? SL_FLAG_RING_MODE : 0) | (options.nativeSize ? SL_FLAG_ACCEPT_NATIVE_SIZE : 0);
+    if (!owner.create(width, height, options.format, flags, options.ringSlots > 0 ? options.ringSlots : NUM_BUFFERS)) {
+        fprintf(stderr, "[Replay] Failed to create channel %s\n", channel.c_str());
+        return 2;
+    }
+    ShmImpl consumer(channel);
+    if (!consumer.connect()) {
+        fprintf(stderr, "[Replay] Failed to connect a consumer to channel %s\n", channel.c_str());
+        owner.destroy();
+        return 2;
+    }
+
+    StreamLumo::FrameWriter writer(channel, StreamLumo::FrameWriter::MODE_GLOBAL_OUTPUT);
+    if (options.threads > 0) writer.setConversionThreads(options.threads);
+    if (!writer.connect()) {
+        fprintf(stderr, "[Replay] FrameWriter could not connect to channel %s\n", channel.c_str());
+        consumer.disconnect();
+        owner.destroy();
+        return 2;
+    }
+
+    printf("[Replay] %s: %zu frame(s) of %ux%u (recorded on '%s') -> %ux%u format %u%s, %s, %u loop(s)\n",
+           options.path.c_str(), recording.frameCount(), first.width, first.height, recording.channel().c_str(),
+           width, height, options.format, options.ringSlots > 0 ? (", " + std::to_string(options.ringSlots) + "-slot ring").c_str() : "",
+           options.maxRate ? "max rate" : "recorded pace", options.loops);
+
+    std::atomic<bool> done(false);
+    ConsumerResult consumed;
+    std::thread consumerThread(runConsumer, std::ref(consumer), std::cref(done), std::ref(consumed));
+
+    // The writer only converts while the channel has demand: wait for the first read
+    for (int i = 0; i < 100 && !owner.hasConsumerDemand(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Frames are re-stamped on arrival (os_gettime_ns) so callback and total
+    // latency measure this process, not the gap since the recording was made
+    const uint64_t start = os_gettime_ns();
+    uint64_t fed = 0;
+    uint64_t lateFrames = 0;
+    StreamLumo::LatencyHistogram processTime;
+    const bool ring = options.ringSlots > 0;
+    const SharedFrameBuffer *header = owner.getBuffer();
+    for (uint32_t loop = 0; loop < options.loops; loop++) {
+        const uint64_t loopStart = os_gettime_ns();
+        const uint64_t firstTimestamp = recording.frame(0).timestampNs;
+        for (size_t i = 0; i < recording.frameCount(); i++) {
+            const StreamLumo::RecordedFrame &frame = recording.frame(i);
+            if (!options.maxRate && frame.timestampNs > firstTimestamp) {
+                const uint64_t due = loopStart + (frame.timestampNs - firstTimestamp);
+                const uint64_t now = os_gettime_ns();
+                if (now < due) {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                } else if (now - due > 1000000) {
+                    lateFrames++;
+                }
+            }
+
+            if (ring) {
+                const uint64_t deadline = os_gettime_ns() + 100000000ULL;
+                while (header->ring_write_cursor.load(std::memory_order_acquire) - consumed.frames.load(std::memory_order_relaxed) >= header->slot_count
+                       && os_gettime_ns() < deadline) {
+                    std::this_thread::yield();
+                }
+            }
+
+            const uint8_t *planes[MAX_PLANES];
+            recording.planes(i, planes);
+            const uint64_t feedStart = os_gettime_ns();
+            writer.processFrame(planes, frame.linesize, frame.width, frame.height,
+                                static_cast<enum video_format>(frame.format), feedStart,
+                                static_cast<enum video_colorspace>(frame.colorspace),
+                                static_cast<enum video_range_type>(frame.range));
+            processTime.record(os_gettime_ns() - feedStart);
+            fed++;
+        }
+    }
+    const double elapsedS = (os_gettime_ns() - start) / 1000000000.0;
+
+    // Let the consumer pick up the last frame before stopping it
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done.store(true, std::memory_order_release);
+    consumerThread.join();
+
+    const StreamLumo::FrameStatistics stats = writer.getStatistics();
+    StreamLumo::FrameMetadata metadata;
+    owner.getMetadata(metadata);
+    // A full ring or every free slot being read is the channel's doing; any other drop failed to convert
+    const uint64_t channelSkipped = metadata.ringFullFrames + metadata.slotBusyFrames + stats.contendedFrames;
+    const uint64_t failed = stats.droppedFrames > channelSkipped ? stats.droppedFrames - channelSkipped : 0;
+    printf("[Replay] Fed %llu frame(s) in %.2f s (%.1f fps), %llu late\n",
+           (unsigned long long)fed, elapsedS, fed / elapsedS, (unsigned long long)lateFrames);
+    printf("[Replay] Written %llu, %llu ring-full, %llu slot-busy, %llu idle, %llu failed; consumer read %llu\n",
+           (unsigned long long)stats.writtenFrames, (unsigned long long)metadata.ringFullFrames,
+           (unsigned long long)metadata.slotBusyFrames, (unsigned long long)stats.idleFrames,
+           (unsigned long long)failed, (unsigned long long)consumed.frames.load());
+    printLatency("process", processTime.summary());
+    printLatency("convert", stats.conversionLatency);
+    printLatency("write", stats.writeLatency);
+    printLatency("pickup", stats.pickupLatency);
+    printLatency("total", stats.totalLatency);
+
+    consumer.disconnect();
+    owner.destroy();
+
+    const bool ok = stats.writtenFrames > 0 && failed == 0;
+    printf("[Replay] %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,567 @@
+/**
+ * StreamLumo Benchmark Suite (Google Benchmark)
+ *
+ * Measures the OBS-independent core (streamlumo-core) without running OBS:
+ * - BM_ConvertToRgba: per-format RGBA conversion at 720p/1080p/4K, unscaled,
+ *   scaled to 2/3 size and halved (one thread, i.e. a single band)
+ * - BM_ConvertToPacked: NV12 (BT.709 limited) and BGRA 1080p into each packed
+ *   channel layout (RGBA, BGRA, RGBX, premultiplied RGBA), unscaled and scaled
+ * - BM_ConvertToPlanar: NV12/I420/RGBA/BGRA into an NV12 channel slot
+ * - BM_ScaleRgba: each scale filter on RGBA input, 4K -> 1080p (2:1) and
+ *   1080p -> 720p
+ * - BM_ShmWriteFrame: writeFrame() copy + publish with no consumer attached
+ * - BM_ShmRoundTrip: writeFrame -> readFrame in a second process, which
+ *   acknowledges each frame on a small reply channel (two transport hops)
+ * - BM_ShmContention: unpaced 1080p writes while 1-3 consumer threads read
+ *   the same channel, in latest-frame and ring mode
+ *
+ * Usage: streamlumo-bench [Google Benchmark flags]
+ * For results that can be tracked over time:
+ *   streamlumo-bench --benchmark_out=results.json --benchmark_out_format=json
+ *
+ * @license GPL-2.0
+ */
+
+#include "../include/shared_buffer.h"
+#include "../src/frame_convert.h"
+#include "../src/pixel_convert.h"
+
+#ifdef _WIN32
+#include "../src/shm_win32.h"
+#include <process.h>
+using ShmImpl = StreamLumo::ShmWin32;
+#define getpid _getpid
+#else
+#include "../src/shm_posix.h"
+#include <sys/wait.h>
+#include <unistd.h>
+using ShmImpl = StreamLumo::ShmPosix;
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using StreamLumo::SourceFormat;
+
+struct Resolution {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+};
+
+const Resolution RESOLUTIONS[] = {
+    { "720p", 1280, 720 },
+    { "1080p", 1920, 1080 },
+    { "4K", 3840, 2160 },
+};
+
+struct FormatInfo {
+    const char *name;
+    SourceFormat format;
+};
+
+const FormatInfo FORMATS[] = {
+    { "NV12", StreamLumo::SOURCE_FORMAT_NV12 },
+    { "I420", StreamLumo::SOURCE_FORMAT_I420 },
+    { "YUY2", StreamLumo::SOURCE_FORMAT_YUY2 },
+    { "UYVY", StreamLumo::SOURCE_FORMAT_UYVY },
+    { "Y800", StreamLumo::SOURCE_FORMAT_Y800 },
+    { "RGBA", StreamLumo::SOURCE_FORMAT_RGBA },
+    { "BGRA", StreamLumo::SOURCE_FORMAT_BGRA },
+};
+
+// Second process of BM_ShmRoundTrip: streamlumo-bench --echo <frames> <acks>
+const char *ECHO_FLAG = "--echo";
+const uint64_t STOP_TOKEN = ~0ULL;
+const int ECHO_IDLE_LIMIT = 50;         // x 100 ms without a frame before the echo gives up
+const char *g_selfPath = nullptr;
+
+/**
+ * Source frame with deterministic noise in every plane
+ */
+class TestFrame {
+public:
+    TestFrame(SourceFormat format, uint32_t width, uint32_t height)
+    {
+        const uint32_t chromaWidth = (width + 1) / 2;
+        const uint32_t chromaHeight = (height + 1) / 2;
+        switch (format) {
+            case StreamLumo::SOURCE_FORMAT_NV12:
+                addPlane(width, height);
+                addPlane(chromaWidth * 2, chromaHeight);
+                break;
+            case StreamLumo::SOURCE_FORMAT_I420:
+                addPlane(width, height);
+                addPlane(chromaWidth, chromaHeight);
+                addPlane(chromaWidth, chromaHeight);
+                break;
+            case StreamLumo::SOURCE_FORMAT_YUY2:
+            case StreamLumo::SOURCE_FORMAT_UYVY:
+                addPlane(chromaWidth * 4, height);
+                break;
+            case StreamLumo::SOURCE_FORMAT_Y800:
+                addPlane(width, height);
+                break;
+            default:
+                addPlane(width * 4, height);
+                break;
+        }
+
+        for (size_t i = 0; i < m_planes.size(); i++) {
+            m_data[i] = m_planes[i].data();
+        }
+        m_frame.data = m_data;
+        m_frame.linesize = m_linesize;
+        m_frame.width = width;
+        m_frame.height = height;
+        m_frame.format = format;
+        m_frame.matrix = nullptr;
+    }
+
+    const StreamLumo::SourceFrame &frame() const { return m_frame; }
+
+private:
+    void addPlane(uint32_t linesize, uint32_t rows)
+    {
+        std::vector<uint8_t> plane((size_t)linesize * rows);
+        uint32_t state = 0x12345678u + (uint32_t)m_planes.size();
+        for (uint8_t &value : plane) {
+            state = state * 1664525u + 1013904223u;
+            value = (uint8_t)(state >> 24);
+        }
+        m_linesize[m_planes.size()] = linesize;
+        m_planes.push_back(std::move(plane));
+    }
+
+    std::vector<std::vector<uint8_t>> m_planes;
+    const uint8_t *m_data[3] = {};
+    uint32_t m_linesize[3] = {};
+    StreamLumo::SourceFrame m_frame;
+};
+
+// Scale arg: 0 = unscaled, 1 = 2/3 size (1080p -> 720p), 2 = half size (the 2:1 fast path)
+uint32_t scaledSize(uint32_t size, int64_t scale)
+{
+    if (scale == 1) return (size * 2 / 3) & ~1u;
+    if (scale == 2) return size / 2;
+    return size;
+}
+
+const char *scaleLabel(int64_t scale)
+{
+    return scale == 1 ? " scaled 2/3" : scale == 2 ? " scaled 1/2" : "";
+}
+
+void setFrameCounters(benchmark::State &state, uint64_t bytesPerFrame)
+{
+    state.SetBytesProcessed((int64_t)(state.iterations() * bytesPerFrame));
+    state.counters["fps"] = benchmark::Counter((double)state.iterations(), benchmark::Counter::kIsRate);
+}
+
+std::string channelName(const char *prefix)
+{
+    static uint32_t counter = 0;
+    return std::string(prefix) + "-" + std::to_string((long)getpid()) + "-" + std::to_string(counter++);
+}
+
+/**
+ * Args: format index, resolution index, scale (0-2)
+ */
+void BM_ConvertToRgba(benchmark::State &state)
+{
+    const FormatInfo &format = FORMATS[state.range(0)];
+    const Resolution &resolution = RESOLUTIONS[state.range(1)];
+    const int64_t scale = state.range(2);
+    const uint32_t dstWidth = scaledSize(resolution.width, scale);
+    const uint32_t dstHeight = scaledSize(resolution.height, scale);
+
+    TestFrame source(format.format, resolution.width, resolution.height);
+    std::vector<uint8_t> dst((size_t)dstWidth * dstHeight * 4);
+    StreamLumo::ScalePlan plan;
+    plan.configure(resolution.width, resolution.height, dstWidth, dstHeight, StreamLumo::SCALE_FILTER_AREA);
+
+    for (auto _ : state) {
+        StreamLumo::convertRowsToRgba(source.frame(), plan, dst.data(), dstWidth, dstHeight, 0, dstHeight);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    setFrameCounters(state, dst.size());
+    state.SetLabel(std::string(format.name) + " " + resolution.name + scaleLabel(scale) +
+                   " (" + StreamLumo::GetConvertKernels().name + ")");
+}
+BENCHMARK(BM_ConvertToRgba)
+    ->ArgNames({ "format", "res", "scale" })
+    ->ArgsProduct({ benchmark::CreateDenseRange(0, 6, 1), { 0, 1, 2 }, { 0, 1, 2 } })
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Args: format index (NV12, BGRA), destination layout (PackedFormat), scale (0-2)
+ */
+void BM_ConvertToPacked(benchmark::State &state)
+{
+    static const int PACKED_SOURCES[] = { 0, 6 };
+    static const char *const PACKED_NAMES[] = { "RGBA", "BGRA", "RGBX", "premultiplied RGBA" };
+    const FormatInfo &format = FORMATS[PACKED_SOURCES[state.range(0)]];
+    const StreamLumo::PackedFormat packed = static_cast<StreamLumo::PackedFormat>(state.range(1));
+    const Resolution &resolution = RESOLUTIONS[1];
+    const int64_t scale = state.range(2);
+    const uint32_t dstWidth = scaledSize(resolution.width, scale);
+    const uint32_t dstHeight = scaledSize(resolution.height, scale);
+
+    TestFrame source(format.format, resolution.width, resolution.height);
+    StreamLumo::SourceFrame frame = source.frame();
+    frame.matrix = &StreamLumo::GetYuvMatrix(StreamLumo::COLOR_MATRIX_BT709, StreamLumo::COLOR_RANGE_LIMITED);
+    std::vector<uint8_t> dst((size_t)dstWidth * dstHeight * 4);
+    StreamLumo::ScalePlan plan;
+    plan.configure(resolution.width, resolution.height, dstWidth, dstHeight, StreamLumo::SCALE_FILTER_AREA);
+    const StreamLumo::PackedConverter convert = StreamLumo::selectPackedConverter(format.format, packed, scale != 0);
+
+    for (auto _ : state) {
+        convert(frame, plan, dst.data(), dstWidth, dstHeight, 0, dstHeight);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    setFrameCounters(state, dst.size());
+    state.SetLabel(std::string(format.name) + " -> " + PACKED_NAMES[packed] + " " + resolution.name + scaleLabel(scale));
+}
+BENCHMARK(BM_ConvertToPacked)
+    ->ArgNames({ "format", "dst", "scale" })
+    ->ArgsProduct({ { 0, 1 }, { 0, 1, 2, 3 }, { 0, 2 } })
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Args: format index (NV12, I420, RGBA, BGRA), resolution index, scale (0-2)
+ */
+void BM_ConvertToPlanar(benchmark::State &state)
+{
+    static const int PLANAR_SOURCES[] = { 0, 1, 5, 6 };
+    const FormatInfo &format = FORMATS[PLANAR_SOURCES[state.range(0)]];
+    const Resolution &resolution = RESOLUTIONS[state.range(1)];
+    const int64_t scale = state.range(2);
+
+    StreamLumo::PlanarFrame planes;
+    planes.width = scaledSize(resolution.width, scale);
+    planes.height = scaledSize(resolution.height, scale);
+    planes.nv12 = true;
+    planes.yStride = planes.width;
+    planes.uvStride = planes.width;
+
+    TestFrame source(format.format, resolution.width, resolution.height);
+    std::vector<uint8_t> dst((size_t)planes.width * planes.height * 3 / 2);
+    StreamLumo::ScaleScratch scratch;
+    StreamLumo::ScalePlan plan;
+    plan.configure(resolution.width, resolution.height, planes.width, planes.height, StreamLumo::SCALE_FILTER_AREA);
+    planes.y = dst.data();
+    planes.u = dst.data() + (size_t)planes.width * planes.height;
+    planes.v = planes.u + 1;
+
+    for (auto _ : state) {
+        StreamLumo::convertFrameToPlanar(source.frame(), plan, planes, scratch);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    setFrameCounters(state, dst.size());
+    state.SetLabel(std::string(format.name) + " -> NV12 " + resolution.name + scaleLabel(scale));
+}
+BENCHMARK(BM_ConvertToPlanar)
+    ->ArgNames({ "format", "res", "scale" })
+    ->ArgsProduct({ { 0, 1, 2, 3 }, { 0, 1, 2 }, { 0, 1, 2 } })
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Args: filter (nearest, bilinear, area), geometry (0 = 4K -> 1080p, 1 = 1080p -> 720p)
+ */
+void BM_ScaleRgba(benchmark::State &state)
+{
+    const StreamLumo::ScaleFilter filter = static_cast<StreamLumo::ScaleFilter>(state.range(0));
+    const Resolution &resolution = RESOLUTIONS[state.range(1) == 0 ? 2 : 1];
+    const Resolution &target = RESOLUTIONS[state.range(1) == 0 ? 1 : 0];
+
+    TestFrame source(StreamLumo::SOURCE_FORMAT_RGBA, resolution.width, resolution.height);
+    std::vector<uint8_t> dst((size_t)target.width * target.height * 4);
+    StreamLumo::ScalePlan plan;
+    plan.configure(resolution.width, resolution.height, target.width, target.height, filter);
+
+    for (auto _ : state) {
+        StreamLumo::convertRowsToRgba(source.frame(), plan, dst.data(), target.width, target.height, 0, target.height);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    setFrameCounters(state, dst.size());
+    state.SetLabel(std::string(resolution.name) + " -> " + target.name + " " + StreamLumo::scaleFilterName(filter) +
+                   (plan.image.horizontal().halve && plan.image.vertical().halve ? " (2:1 fast path)" : ""));
+}
+BENCHMARK(BM_ScaleRgba)
+    ->ArgNames({ "filter", "geometry" })
+    ->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Args: resolution index
+ */
+void BM_ShmWriteFrame(benchmark::State &state)
+{
+    const Resolution &resolution = RESOLUTIONS[state.range(0)];
+    const std::string channel = channelName("bench-write");
+    ShmImpl producer(channel);
+    if (!producer.create(resolution.width, resolution.height, FORMAT_RGBA)) {
+        state.SkipWithError("failed to create channel");
+        return;
+    }
+
+    std::vector<unsigned char> frame((size_t)resolution.width * resolution.height * 4, 0x80);
+    uint64_t failed = 0;
+    for (auto _ : state) {
+        if (!producer.writeFrame(frame.data(), frame.size())) failed++;
+    }
+
+    setFrameCounters(state, frame.size());
+    state.counters["failed"] = (double)failed;
+    state.SetLabel(resolution.name);
+    producer.destroy();
+}
+BENCHMARK(BM_ShmWriteFrame)->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Second process of BM_ShmRoundTrip: read every frame and acknowledge it with
+ * the token in its first 8 bytes
+ */
+int runEcho(const char *framesChannel, const char *acksChannel)
+{
+    ShmImpl frames(framesChannel);
+    ShmImpl acks(acksChannel);
+    if (!frames.connect() || !acks.connect(false)) return 1;
+
+    std::vector<unsigned char> frame(frames.getBuffer()->slot_size);
+    int idle = 0;
+    while (idle < ECHO_IDLE_LIMIT) {
+        if (!frames.waitForFrame(100)) {
+            idle++;
+            continue;
+        }
+        idle = 0;
+
+        StreamLumo::FrameMetadata metadata;
+        while (frames.readFrame(frame.data(), frame.size(), &metadata)) {
+            uint64_t token = 0;
+            std::memcpy(&token, frame.data(), sizeof(token));
+            if (token == STOP_TOKEN) return 0;
+            acks.writeFrame(frame.data(), sizeof(token));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Start the echo process on the two channels
+ */
+bool spawnEcho(const std::string &frames, const std::string &acks, intptr_t &child)
+{
+#ifdef _WIN32
+    child = _spawnl(_P_NOWAIT, g_selfPath, g_selfPath, ECHO_FLAG, frames.c_str(), acks.c_str(), nullptr);
+    return child != -1;
+#else
+    fflush(nullptr);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        _exit(runEcho(frames.c_str(), acks.c_str()));
+    }
+    child = pid;
+    return pid > 0;
+#endif
+}
+
+void waitForEcho(intptr_t child)
+{
+#ifdef _WIN32
+    int status = 0;
+    _cwait(&status, child, _WAIT_CHILD);
+#else
+    int status = 0;
+    waitpid(static_cast<pid_t>(child), &status, 0);
+#endif
+}
+
+/**
+ * Publish `token` and wait for the echo; false after ~1 s without it
+ */
+bool exchange(ShmImpl &frames, ShmImpl &acks, std::vector<unsigned char> &payload, uint64_t token)
+{
+    std::memcpy(payload.data(), &token, sizeof(token));
+    if (!frames.writeFrame(payload.data(), payload.size())) return false;
+
+    unsigned char ack[64] = {};
+    for (int attempt = 0; attempt < 10; attempt++) {
+        acks.waitForFrame(100);
+        while (acks.readFrame(ack, sizeof(ack))) {
+            uint64_t received = 0;
+            std::memcpy(&received, ack, sizeof(received));
+            if (received == token) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Args: resolution index
+ */
+void BM_ShmRoundTrip(benchmark::State &state)
+{
+    const Resolution &resolution = RESOLUTIONS[state.range(0)];
+    const std::string framesChannel = channelName("bench-frames");
+    const std::string acksChannel = channelName("bench-acks");
+
+    ShmImpl frames(framesChannel);
+    ShmImpl acksOwner(acksChannel);
+    ShmImpl acks(acksChannel);
+    if (!frames.create(resolution.width, resolution.height, FORMAT_RGBA) ||
+        !acksOwner.create(4, 4, FORMAT_RGBA) || !acks.connect()) {
+        state.SkipWithError("failed to create channels");
+        frames.destroy();
+        acksOwner.destroy();
+        return;
+    }
+
+    intptr_t child = 0;
+    if (!spawnEcho(framesChannel, acksChannel, child)) {
+        state.SkipWithError("failed to start the echo process");
+        frames.destroy();
+        acksOwner.destroy();
+        return;
+    }
+
+    // Until the echo process has connected, frames go unanswered
+    std::vector<unsigned char> payload((size_t)resolution.width * resolution.height * 4, 0x80);
+    uint64_t token = 1;
+    bool ready = false;
+    for (int attempt = 0; attempt < 5 && !ready; attempt++) {
+        ready = exchange(frames, acks, payload, token++);
+    }
+
+    if (ready) {
+        for (auto _ : state) {
+            if (!exchange(frames, acks, payload, token++)) {
+                state.SkipWithError("echo process stopped answering");
+                break;
+            }
+        }
+        setFrameCounters(state, payload.size());
+    } else {
+        state.SkipWithError("echo process did not connect");
+    }
+
+    std::memcpy(payload.data(), &STOP_TOKEN, sizeof(STOP_TOKEN));
+    frames.writeFrame(payload.data(), payload.size());
+    waitForEcho(child);
+
+    state.SetLabel(std::string(resolution.name) + " frame + ack, two processes");
+    acks.disconnect();
+    frames.destroy();
+    acksOwner.destroy();
+}
+BENCHMARK(BM_ShmRoundTrip)->DenseRange(0, 2)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/**
+ * Args: consumer threads, ring slots (0 = latest-frame mode)
+ */
+void BM_ShmContention(benchmark::State &state)
+{
+    const Resolution &resolution = RESOLUTIONS[1];
+    const uint32_t consumerCount = (uint32_t)state.range(0);
+    const uint32_t ringSlots = (uint32_t)state.range(1);
+    const std::string channel = channelName("bench-contention");
+
+    ShmImpl producer(channel);
+    if (!producer.create(resolution.width, resolution.height, FORMAT_RGBA,
+                         ringSlots ? SL_FLAG_RING_MODE : 0, ringSlots)) {
+        state.SkipWithError("failed to create channel");
+        return;
+    }
+
+    std::vector<std::unique_ptr<ShmImpl>> consumers;
+    for (uint32_t i = 0; i < consumerCount; i++) {
+        consumers.emplace_back(new ShmImpl(channel));
+        if (!consumers.back()->connect()) {
+            state.SkipWithError("failed to connect consumer");
+            consumers.clear();
+            producer.destroy();
+            return;
+        }
+    }
+
+    const size_t frameSize = (size_t)resolution.width * resolution.height * 4;
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> failedReads(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < consumerCount; i++) {
+        threads.emplace_back([&, i]() {
+            std::vector<unsigned char> frame(frameSize);
+            while (!done.load(std::memory_order_acquire)) {
+                if (!consumers[i]->waitForFrame(10)) continue;
+                if (consumers[i]->readFrame(frame.data(), frame.size())) {
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    failedReads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    std::vector<unsigned char> frame(frameSize, 0x80);
+    uint64_t skipped = 0;
+    for (auto _ : state) {
+        if (!producer.writeFrame(frame.data(), frame.size())) skipped++;
+    }
+
+    done.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) thread.join();
+
+    StreamLumo::FrameMetadata metadata;
+    producer.getMetadata(metadata);
+    setFrameCounters(state, frameSize);
+    state.counters["skipped_writes"] = (double)skipped;
+    state.counters["slot_busy"] = (double)metadata.slotBusyFrames;
+    state.counters["ring_full"] = (double)metadata.ringFullFrames;
+    state.counters["reads"] = benchmark::Counter((double)reads.load(), benchmark::Counter::kIsRate);
+    state.counters["failed_reads"] = (double)failedReads.load();
+    state.SetLabel(std::to_string(consumerCount) + " consumer(s), " +
+                   (ringSlots ? std::to_string(ringSlots) + "-slot ring" : std::string("latest frame")));
+
+    for (auto &consumer : consumers) consumer->disconnect();
+    producer.destroy();
+}
+BENCHMARK(BM_ShmContention)
+    ->ArgNames({ "consumers", "ring" })
+    ->ArgsProduct({ { 1, 2, 3 }, { 0, 4 } })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && std::strcmp(argv[1], ECHO_FLAG) == 0) {
+        return runEcho(argv[2], argv[3]);
+    }
+    g_selfPath = argv[0];
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,274 @@
+/**
+ * StreamLumo Triple Buffer Stress Benchmark
+ *
+ * Runs a producer and one or more consumers on one shared-memory channel
+ * (separate transport instances, as in the plugin and the Electron app) and
+ * checks every frame each consumer receives for tearing. Each frame is filled with
+ * its frame number; one word per cache line is verified on read.
+ *
+ * Usage: streamlumo-stress [--fps N] [--seconds N] [--width N] [--height N] [--unpaced] [--ring N] [--consumers N]
+ *                          [--huge-pages]
+ * --ring N uses an N-slot ring channel instead of the latest-frame triple
+ * buffer; every consumer must then see every published frame.
+ * --consumers N reads the channel from N registered consumers at once.
+ * --huge-pages creates the channel with SL_FLAG_HUGE_PAGES and reports the
+ * page size each side got.
+ * Exits non-zero if any frame was torn, arrived out of order, could not be
+ * written (latest-frame mode) or was lost (ring mode).
+ *
+ * @license GPL-2.0
+ */
+
+#include "../include/shared_buffer.h"
+#include "../src/latency_histogram.h"
+
+#ifdef _WIN32
+#include "../src/shm_win32.h"
+#include <process.h>
+using ShmImpl = StreamLumo::ShmWin32;
+#define getpid _getpid
+#else
+#include "../src/shm_posix.h"
+#include <unistd.h>
+using ShmImpl = StreamLumo::ShmPosix;
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint32_t fps = 240;
+    uint32_t seconds = 10;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    bool paced = true;
+    uint32_t ringSlots = 0;     // 0 = latest-frame mode
+    uint32_t consumers = 1;
+    bool hugePages = false;
+};
+
+struct ConsumerResult {
+    uint64_t frames = 0;
+    uint64_t torn = 0;
+    uint64_t outOfOrder = 0;
+    uint64_t skipped = 0;
+};
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--fps" && hasValue) options.fps = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--seconds" && hasValue) options.seconds = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--width" && hasValue) options.width = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--height" && hasValue) options.height = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--unpaced") options.paced = false;
+        else if (arg == "--ring" && hasValue) options.ringSlots = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--consumers" && hasValue) options.consumers = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (arg == "--huge-pages") options.hugePages = true;
+        else return false;
+    }
+    return options.fps > 0 && options.seconds > 0 && options.width > 0 && options.height > 0
+        && options.consumers > 0 && options.consumers <= SL_MAX_CONSUMERS;
+}
+
+// Fill a frame with its number so any mix of two frames is detectable
+void fillFrame(unsigned char *slot, size_t size, uint64_t token)
+{
+    uint64_t *words = reinterpret_cast<uint64_t *>(slot);
+    const size_t count = size / sizeof(uint64_t);
+    for (size_t i = 0; i < count; i++) words[i] = token;
+}
+
+bool checkFrame(const unsigned char *frame, size_t size, uint64_t token)
+{
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(frame);
+    const size_t count = size / sizeof(uint64_t);
+    const size_t step = SL_CACHE_LINE_SIZE / sizeof(uint64_t);
+    for (size_t i = 0; i < count; i += step) {
+        if (words[i] != token) return false;
+    }
+    return count == 0 || words[count - 1] == token;
+}
+
+void checkReceived(const std::vector<unsigned char> &frame, const StreamLumo::FrameMetadata &metadata,
+                   uint64_t &lastFrame, ConsumerResult &result, StreamLumo::LatencyHistogram &pickup)
+{
+    const uint64_t received = nowNs();
+    result.frames++;
+    if (metadata.captureTimeNs != 0 && received >= metadata.captureTimeNs) {
+        pickup.record(received - metadata.captureTimeNs);
+    }
+    if (!checkFrame(frame.data(), metadata.frameSize, metadata.frameNumber)) {
+        result.torn++;
+    }
+    if (metadata.frameNumber <= lastFrame) {
+        result.outOfOrder++;
+    } else if (lastFrame != 0) {
+        result.skipped += metadata.frameNumber - lastFrame - 1;
+    }
+    lastFrame = metadata.frameNumber;
+}
+
+void runConsumer(ShmImpl &shm, size_t frameSize, const std::atomic<bool> &done,
+                 ConsumerResult &result, StreamLumo::LatencyHistogram &pickup)
+{
+    std::vector<unsigned char> frame(frameSize);
+    uint64_t lastFrame = 0;
+
+    while (!done.load(std::memory_order_acquire)) {
+        if (!shm.waitForFrame(100)) continue;
+
+        // One wake can cover several ring frames
+        StreamLumo::FrameMetadata metadata;
+        while (shm.readFrame(frame.data(), frame.size(), &metadata)) {
+            checkReceived(frame, metadata, lastFrame, result, pickup);
+        }
+    }
+
+    // Ring mode: everything published before `done` must still arrive
+    StreamLumo::FrameMetadata metadata;
+    while (shm.readFrame(frame.data(), frame.size(), &metadata)) {
+        checkReceived(frame, metadata, lastFrame, result, pickup);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--fps N] [--seconds N] [--width N] [--height N] [--unpaced] [--ring N] [--consumers N] [--huge-pages]\n", argv[0]);
+        return 2;
+    }
+
+    const std::string channel = "stress-" + std::to_string(static_cast<long>(getpid()));
+    ShmImpl producer(channel);
+    const bool ring = options.ringSlots > 0;
+    const uint32_t flags = (ring ? SL_FLAG_RING_MODE : 0) | (options.hugePages ? SL_FLAG_HUGE_PAGES : 0);
+    if (!producer.create(options.width, options.height, FORMAT_RGBA, flags, options.ringSlots)) {
+        fprintf(stderr, "[Stress] Failed to create channel %s\n", channel.c_str());
+        return 2;
+    }
+    std::vector<std::unique_ptr<ShmImpl>> consumers;
+    for (uint32_t i = 0; i < options.consumers; i++) {
+        consumers.emplace_back(new ShmImpl(channel));
+        if (!consumers.back()->connect()) {
+            fprintf(stderr, "[Stress] Failed to connect consumer %u to channel %s\n", i, channel.c_str());
+            consumers.clear();
+            producer.destroy();
+            return 2;
+        }
+    }
+
+    const size_t frameSize = static_cast<size_t>(StreamLumo::frameSizeFor(options.width, options.height, FORMAT_RGBA));
+    printf("[Stress] %ux%u RGBA (%.1f MB/frame), %s%u fps for %u s, %s, %u consumer(s)\n",
+           options.width, options.height, frameSize / (1024.0 * 1024.0),
+           options.paced ? "" : "unpaced, target ", options.fps, options.seconds,
+           ring ? (std::to_string(producer.getBuffer()->slot_count) + "-slot ring").c_str() : "latest frame",
+           options.consumers);
+    if (options.hugePages) {
+        printf("[Stress] Page size: producer %u KB, consumer %u KB\n",
+               producer.pageSize() / 1024, consumers.front()->pageSize() / 1024);
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<ConsumerResult> consumed(options.consumers);
+    std::vector<StreamLumo::LatencyHistogram> pickup(options.consumers);
+    std::vector<std::thread> consumerThreads;
+    for (uint32_t i = 0; i < options.consumers; i++) {
+        consumerThreads.emplace_back(runConsumer, std::ref(*consumers[i]), frameSize, std::cref(done),
+                                     std::ref(consumed[i]), std::ref(pickup[i]));
+    }
+
+    // Producer: fill the owned slot with the number the commit will assign
+    const uint64_t intervalNs = 1000000000ULL / options.fps;
+    const uint64_t start = nowNs();
+    const uint64_t end = start + options.seconds * 1000000000ULL;
+    uint64_t published = 0;
+    uint64_t failedWrites = 0;
+    uint64_t backpressured = 0;
+    uint64_t lateFrames = 0;
+    StreamLumo::LatencyHistogram writeTime;
+
+    for (uint64_t next = start; ; next += intervalNs) {
+        const uint64_t now = nowNs();
+        if (now >= end || (options.paced && next >= end)) break;
+        
+        if (options.paced) {
+            if (now < next) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+            } else if (now - next > intervalNs) {
+                lateFrames++;
+            }
+        }
+
+        const uint64_t writeStart = nowNs();
+        unsigned char *slot = producer.beginWrite();
+        if (!slot) {
+            // A full ring (or every free slot being read) is backpressure, not a failure
+            backpressured++;
+            continue;
+        }
+        fillFrame(slot, frameSize, published + 1);
+        if (!producer.commitWrite(0, writeStart)) {
+            failedWrites++;
+            continue;
+        }
+        published++;
+        writeTime.record(nowNs() - writeStart);
+    }
+    const double elapsedS = (nowNs() - start) / 1000000000.0;
+
+    StreamLumo::FrameMetadata metadata;
+    producer.getMetadata(metadata);
+    done.store(true, std::memory_order_release);
+    for (std::thread &thread : consumerThreads) thread.join();
+
+    const StreamLumo::LatencySummary write = writeTime.summary();
+
+    printf("[Stress] Published %llu frames (%.1f fps), %llu failed writes, %llu late\n",
+           (unsigned long long)published, published / elapsedS,
+           (unsigned long long)failedWrites, (unsigned long long)lateFrames);
+    printf("[Stress] %u active consumer(s), %llu superseded unread, %llu ring-full, %llu slot-busy\n",
+           metadata.activeConsumers, (unsigned long long)metadata.droppedFrames,
+           (unsigned long long)metadata.ringFullFrames, (unsigned long long)metadata.slotBusyFrames);
+    printf("[Stress] Write p50/p99/max (ms): %.2f/%.2f/%.2f\n", write.p50Ms, write.p99Ms, write.maxMs);
+
+    // Ring mode is lossless for every frame that was published
+    bool ok = failedWrites == 0 && metadata.activeConsumers == options.consumers;
+    for (uint32_t i = 0; i < options.consumers; i++) {
+        const ConsumerResult &result = consumed[i];
+        const StreamLumo::LatencySummary latency = pickup[i].summary();
+        printf("[Stress] Consumer %u: %llu frames, %llu skipped, %llu torn, %llu out of order, pickup p50/p99/max (ms): %.2f/%.2f/%.2f\n",
+               i, (unsigned long long)result.frames, (unsigned long long)result.skipped,
+               (unsigned long long)result.torn, (unsigned long long)result.outOfOrder,
+               latency.p50Ms, latency.p99Ms, latency.maxMs);
+        ok = ok && result.torn == 0 && result.outOfOrder == 0 && result.frames > 0;
+        if (ring) {
+            ok = ok && result.frames == published && result.skipped == 0;
+        }
+        consumers[i]->disconnect();
+    }
+    producer.destroy();
+    ok = ok && backpressured == (ring ? metadata.ringFullFrames : metadata.slotBusyFrames);
+    printf("[Stress] %s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -16,6 +16,8 @@
 #define STREAMLUMO_SHARED_BUFFER_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 #include <atomic>
 
 // Cross-platform alignment macro
@@ -28,74 +30,348 @@
 // Shared memory name for POSIX/Win32
 #define SHM_NAME "/streamlumo_frames"
 #define SHM_NAME_WIN32 "Local\\StreamLumoFrames"
-#define SEM_NAME "/streamlumo_sem"
+#define SHM_DIRECTORY_NAME "/streamlumo_channels"
+#define SHM_DIRECTORY_NAME_WIN32 "Local\\StreamLumoChannels"
+#define SHM_METRICS_NAME "/streamlumo_metrics"             // + "_" + channel
+#define SHM_METRICS_NAME_WIN32 "Local\\StreamLumoMetrics"  // + "_" + channel
+#define SHM_PACKET_NAME "/streamlumo_packets"              // + "_" + channel
+#define SHM_PACKET_NAME_WIN32 "Local\\StreamLumoPackets"   // + "_" + channel
 
-// Video format constants
+// Default video format (used when the consumer does not negotiate one)
+// The actual geometry of a region lives in its header (width/height/format).
 #define FRAME_WIDTH 1920
 #define FRAME_HEIGHT 1080
 #define FRAME_CHANNELS 4  // RGBA
 #define FRAME_SIZE (FRAME_WIDTH * FRAME_HEIGHT * FRAME_CHANNELS)  // 8,294,400 bytes (~7.9 MB)
-#define NUM_BUFFERS 3     // Triple buffering
+#define NUM_BUFFERS 3     // Triple buffering (latest-frame mode, the default)
+#define SL_MAX_SLOTS 16   // Upper bound on slot_count (ring mode)
+
+// Packed latest_frame word: (frame_number << SL_LATEST_SLOT_BITS) | slot
+#define SL_LATEST_SLOT_BITS 4
+#define SL_LATEST_SLOT_MASK 0xFu
+
+// Consumer registrations (one per reader process or thread)
+#define SL_MAX_CONSUMERS 8
+#define SL_NO_SLOT 0xFFFFFFFFu                  // held_slot when the consumer is not copying
+#define SL_CONSUMER_TIMEOUT_NS 2000000000ull    // Registrations without a heartbeat for this long are ignored
+#define SL_DEMAND_TIMEOUT_NS 1000000000ull      // Producers suspend capture when no reader asked for a frame for this long
+
+// Channel directory (per-source channels requested by consumers)
+#define SL_MAX_CHANNEL_REQUESTS 64
+#define SL_CHANNEL_NAME_SIZE 64             // Including the terminating NUL
+#define SL_SOURCE_NAME_SIZE 192
+#define SL_DIRECTORY_VERSION 1
+
+// Channel metrics page (see ChannelMetrics)
+#define SL_METRICS_VERSION 1
+#define SL_METRICS_BUCKETS 32               // Power-of-two microsecond buckets per histogram
+
+// Encoded packet channels (see PacketRingBuffer)
+#define SL_PACKET_LAYOUT_MAGIC 0x4B504C53u      // "SLPK" in memory on little-endian hosts
+#define SL_PACKET_LAYOUT_VERSION 1
+#define SL_PACKET_INDEX_SIZE 1024               // Packet descriptors (power of two)
+#define SL_PACKET_EXTRA_DATA_SIZE 1024          // Codec headers (SPS/PPS/VPS or AV1 sequence header)
+#define SL_PACKET_DEFAULT_DATA_SIZE (16u * 1024u * 1024u)   // ~20 s at 6 Mbit/s
+#define SL_PACKET_KEYFRAME 0x1                  // PacketDescriptor.flags
+
+// Header layout identity (checked by both sides before trusting the region)
+#define SL_LAYOUT_MAGIC 0x42464C53u     // "SLFB" in memory on little-endian hosts
+#define SL_LAYOUT_VERSION 13            // 13: held_texture, three shared textures
+
+// Producer and consumer fields never share a line of this size
+#define SL_CACHE_LINE_SIZE 64
+
+// Alignment of the first frame slot and of each slot's stride (one page)
+#define FRAME_SLOT_ALIGNMENT 4096
+
+// Alignment of each plane inside a slot
+#define FRAME_PLANE_ALIGNMENT 64
+
+// Huge page the region is rounded up to with SL_FLAG_HUGE_PAGES on POSIX (PMD size)
+#define SL_HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+
+// Region flags (set by the consumer at create time)
+#define SL_FLAG_ACCEPT_NATIVE_SIZE 0x1  // Producer may publish frames at the source size if they fit a slot
+#define SL_FLAG_RING_MODE 0x2           // slot_count-deep FIFO: every frame is kept until the consumer reads it
+#define SL_FLAG_SHARED_TEXTURE 0x4      // Consumer can open a shared GPU texture (see TextureDescriptor)
+#define SL_FLAG_HUGE_PAGES 0x8          // Back the region with huge / large pages where the OS allows (see page_size)
+
+// Shared GPU textures published by one producer
+#define SL_MAX_SHARED_TEXTURES 3
 
 // Pixel format
 enum PixelFormat {
     FORMAT_RGBA = 0,
     FORMAT_BGRA = 1,
     FORMAT_RGB = 2,
-    FORMAT_BGR = 3
+    FORMAT_BGR = 3,
+    FORMAT_NV12 = 4,    // Y plane + interleaved UV plane (4:2:0)
+    FORMAT_I420 = 5,    // Y plane + U plane + V plane (4:2:0)
+    FORMAT_RGBX = 6,    // RGBA with alpha forced to 255
+    FORMAT_RGBA_PREMULTIPLIED = 7   // RGBA with R/G/B multiplied by alpha
+};
+
+#define MAX_PLANES 3
+
+// YUV colorimetry of a planar frame (SlotDescriptor color_matrix / color_range)
+enum ColorMatrixId {
+    SL_COLOR_MATRIX_BT601 = 0,
+    SL_COLOR_MATRIX_BT709 = 1
+};
+
+enum ColorRangeId {
+    SL_COLOR_RANGE_FULL = 0,        // Y and UV use 0..255
+    SL_COLOR_RANGE_LIMITED = 1      // Y uses 16..235, UV 16..240
+};
+
+// Dirty tiles: the frame is split into an SL_DIRTY_GRID x SL_DIRTY_GRID grid
+// (tile x covers columns [x * width / SL_DIRTY_GRID, (x + 1) * width / SL_DIRTY_GRID))
+#define SL_DIRTY_GRID 16
+#define SL_DIRTY_WORDS ((SL_DIRTY_GRID * SL_DIRTY_GRID + 63) / 64)
+
+/**
+ * Per-slot frame descriptor
+ * 
+ * Written by the producer together with the slot it describes. `sequence`
+ * is a seqlock: odd while the slot is being written, even once the frame
+ * data and the fields below are complete. A consumer reads it before and
+ * after copying the slot; an odd or changed value means the copy is torn.
+ * 
+ * Timestamps are on the producer's monotonic clock (os_gettime_ns():
+ * CLOCK_MONOTONIC on Linux, mach_absolute_time on macOS, QPC on Windows).
+ * 
+ * If dirty_base_frame is non-zero, tiles whose bit is clear in dirty_tiles
+ * (bit y * SL_DIRTY_GRID + x) are unchanged since frame dirty_base_frame, so
+ * a consumer still showing that frame only needs to re-upload the dirty
+ * tiles (plus a one-pixel border when the producer scales). Otherwise the
+ * whole frame must be treated as new.
+ * 
+ * color_matrix and color_range give the YUV -> RGB conversion of an NV12 or
+ * I420 frame: the source's own for copied YUV planes, the one the producer
+ * encoded with for RGB sources. They are 0 (BT.601 full) for packed frames.
+ */
+struct SL_ALIGNED(64) SlotDescriptor {
+    std::atomic<uint32_t> sequence;         // Seqlock counter (odd = write in progress)
+    uint32_t format;                        // Pixel format of this frame (PixelFormat enum)
+    uint32_t width;                         // Frame width of this frame
+    uint32_t height;                        // Frame height of this frame
+    uint32_t stride[MAX_PLANES];            // Bytes per row of each plane (0 if unused)
+    uint16_t color_matrix;                  // YUV matrix of a planar frame (ColorMatrixId enum)
+    uint16_t color_range;                   // YUV range of a planar frame (ColorRangeId enum)
+    uint64_t frame_number;                  // Value of frame_counter for this frame (1-based)
+    uint64_t obs_timestamp_ns;              // OBS video timestamp (video_data::timestamp)
+    uint64_t capture_time_ns;               // When the producer received the frame
+    uint64_t dirty_base_frame;              // Frame the dirty bitmap is relative to (0 = all dirty)
+    uint64_t dirty_tiles[SL_DIRTY_WORDS];   // Tiles changed since dirty_base_frame
+};
+
+/**
+ * Shared GPU texture APIs
+ */
+enum SharedTextureApi {
+    SL_TEXTURE_API_NONE = 0,        // No shared texture: frames arrive in the shm slots
+    SL_TEXTURE_API_DXGI = 1,        // D3D11 legacy shared handle with an IDXGIKeyedMutex
+    SL_TEXTURE_API_IOSURFACE = 2    // Global IOSurfaceID (IOSurfaceLookup)
+};
+
+/**
+ * Shared GPU texture descriptor
+ * 
+ * With SL_FLAG_SHARED_TEXTURE a producer that can export its render
+ * textures publishes them here instead of reading frames back into the
+ * slots; api stays SL_TEXTURE_API_NONE (and the slots are used) otherwise.
+ * The handle fields are guarded by the `sequence` seqlock and only change
+ * when the textures are recreated (e.g. the source was resized).
+ * 
+ * `latest` works like latest_frame: frame number (shared with the slot
+ * frames) and the texture it was rendered into. Synchronization:
+ * - DXGI: one texture; both sides acquire and release the keyed mutex with
+ *   key sync_key around each access. The producer never waits for it and
+ *   skips the frame if the consumer holds it.
+ * - IOSurface: three textures. The consumer publishes the one it took in
+ *   its registration's held_texture until releaseSharedTexture() or its next
+ *   acquire; the producer renders only into a texture that is neither the
+ *   latest nor held by an active reader (skipping the frame if every one
+ *   is), and flushes the GPU before publishing.
+ */
+struct SL_ALIGNED(64) TextureDescriptor {
+    std::atomic<uint32_t> sequence;         // Seqlock counter (odd = handles being replaced)
+    uint32_t api;                           // SharedTextureApi
+    uint32_t count;                         // Textures in handles[]
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;                        // Pixel format of the textures (PixelFormat enum)
+    uint32_t sync_key;                      // DXGI: keyed mutex key used by both sides
+    uint32_t reserved0;
+    uint64_t handles[SL_MAX_SHARED_TEXTURES];   // DXGI shared handle / IOSurfaceID of each texture
+    std::atomic<uint64_t> latest;           // frame_number << SL_LATEST_SLOT_BITS | texture (0 = none yet)
+    std::atomic<uint64_t> capture_time_ns;  // When the latest texture frame was rendered
+};
+
+/**
+ * Consumer registration
+ * 
+ * One cache line per reader, written only by that reader. `owner` is
+ * claimed with a CAS in connect(); the producer only honours entries whose
+ * heartbeat is younger than SL_CONSUMER_TIMEOUT_NS, so a crashed reader
+ * cannot pin a slot or stall a ring. Timestamps use the steady clock of the
+ * transports (std::chrono::steady_clock).
+ * 
+ * `demand_ns` is refreshed whenever the reader asks for a frame (read, wait
+ * or shared texture acquire) and cleared when it goes idle. A producer with
+ * no reader demanding frames for SL_DEMAND_TIMEOUT_NS stays connected but
+ * stops capturing and converting until the next request.
+ */
+struct SL_ALIGNED(64) ConsumerRegistration {
+    std::atomic<uint32_t> owner;            // 0 = free, otherwise the reader's token
+    std::atomic<uint32_t> held_slot;        // Slot being copied right now (SL_NO_SLOT if none)
+    std::atomic<uint64_t> heartbeat_ns;     // Last sign of life (0 while registering)
+    std::atomic<uint64_t> read_frame;       // Read cursor: frame_number of the last frame read
+    std::atomic<uint64_t> read_timestamp_ns;    // When it was read (same clock as capture_time_ns)
+    uint32_t process_id;                    // Reader's process, for diagnostics
+    std::atomic<uint32_t> held_texture;     // Shared texture in use (SL_NO_SLOT if none)
+    std::atomic<uint64_t> demand_ns;        // Last frame request (0 = idle)
 };
 
 /**
  * Shared Frame Buffer Structure
  * 
- * Layout:
- * - Control metadata (64 bytes, cache-aligned)
- * - Triple-buffered frame data (3 × 7.9 MB = ~23.7 MB)
+ * Layout, one group per cache line so the producer's per-frame stores
+ * never invalidate a line the consumer writes (and vice versa):
+ * - Identity and region geometry (written once by create())
+ * - Frame metadata (written by the producer only when the geometry changes)
+ * - The latest_frame word (written by the producer, polled by every reader)
+ * - Producer-owned control words (written on every publish)
+ * - Shared consumer control (wakeup and pause requests)
+ * - SL_MAX_CONSUMERS ConsumerRegistration lines (one per reader)
+ * - The shared GPU texture descriptor (producer, see TextureDescriptor)
+ * - SL_MAX_SLOTS SlotDescriptor blocks of two lines (the first slot_count are used)
+ * - slot_count page-aligned frame slots of slot_size bytes, starting at data_offset
+ * 
+ * Total size: total_size (~23.7 MB for the 1920x1080 RGBA default)
  * 
- * Total size: ~23.7 MB
+ * Synchronization (latest frame, see acquireLatestSlot()):
+ * - latest_frame: newest published frame number and its slot
+ * - held_slot: hazard published by each reader for the duration of its copy
+ * The producer writes any slot that is neither the latest nor held by an
+ * active reader, so one published frame fans out to every reader without
+ * copies. Readers only hold a slot while copying, so with NUM_BUFFERS slots
+ * the producer finds a free one unless two readers are copying two
+ * different older frames at once; that frame is skipped and counted in
+ * slot_busy_frames.
  * 
- * Synchronization:
- * - write_index: Atomic index of buffer being written (0-2)
- * - read_index: Atomic index of buffer last read (0-2)
- * - Use memory_order_acquire/release for proper memory barriers
+ * Ring mode (SL_FLAG_RING_MODE, for recording consumers that must not lose
+ * frames) replaces this with a FIFO over slot_count slots:
+ * - ring_write_cursor: frames published (producer); slot = cursor % slot_count
+ * - read_frame of each active reader: frames it has consumed
+ * When the slowest active reader is slot_count frames behind the producer
+ * skips the frame and counts it in ring_full_frames instead of overwriting.
+ * 
+ * The frame metadata (width/height/frame_size/format) describes the frames
+ * currently being published. The consumer sets it at create(); with
+ * SL_FLAG_ACCEPT_NATIVE_SIZE the producer may update width/height/frame_size
+ * to the source size, always before publishing the first frame of that size.
+ * Each frame also carries its own geometry in the descriptor of its slot
+ * (slots[i] for slot i), which is what a reader should trust for that frame.
+ * 
+ * Reconfigure (see requestReconfigure()): a consumer changes the size or
+ * format of a live channel by storing requested_geometry and bumping
+ * config_generation. The producer switches at its next frame boundary,
+ * inside the slots the region already has, and acknowledges with
+ * applied_generation; neither side blocks and nothing is remapped. Pause
+ * (pause_requested / producer_paused) holds frames the same way, without
+ * the producer leaving the OBS pipeline.
+ * 
+ * Page backing: each side prefaults its mapping so the first frames don't
+ * page-fault. With SL_FLAG_HUGE_PAGES the creator asks for huge pages
+ * (transparent huge pages on Linux shmem, SEC_LARGE_PAGES on Windows) and
+ * falls back to normal pages; page_size records what it got.
  */
 struct SharedFrameBuffer {
-    // === Control Metadata (64 bytes, cache-aligned) ===
+    // === Identity and Region Geometry (written once by create()) ===
+    
+    uint32_t magic;                         // SL_LAYOUT_MAGIC
+    uint32_t layout_version;                // SL_LAYOUT_VERSION of the creator
+    uint32_t header_size;                   // sizeof(SharedFrameBuffer) of the creator
+    uint32_t flags;                         // SL_FLAG_* negotiated by the consumer
+    uint64_t total_size;                    // Bytes in the whole region (header + slots)
+    uint32_t data_offset;                   // Offset of slot 0 from the start of the region
+    uint32_t slot_size;                     // Bytes reserved per slot (>= frame_size)
+    uint32_t plane_count;                   // 1 for packed formats, 2 for NV12, 3 for I420
+    
+    // Plane layout inside each slot (bytes from the slot start / bytes per row)
+    // Planar formats: plane 0 is Y; NV12 plane 1 is UV, I420 planes 1/2 are U/V
+    uint32_t plane_offset[MAX_PLANES];
+    uint32_t plane_stride[MAX_PLANES];
+    uint32_t slot_count;                    // Frame slots in the region (NUM_BUFFERS unless ring mode)
+    
+    // === Frame Metadata (read-mostly, see setFrameGeometry()) ===
     
-    // Atomic indices for lock-free triple buffering
-    std::atomic<uint64_t> write_index;      // Current write position (0-2)
-    std::atomic<uint64_t> read_index;       // Current read position (0-2)
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint32_t> width;  // Frame width (default: 1920)
+    std::atomic<uint32_t> height;           // Frame height (default: 1080)
+    std::atomic<uint32_t> frame_size;       // Bytes per frame (8,294,400)
+    std::atomic<uint32_t> format;           // Pixel format (PixelFormat enum)
+    std::atomic<uint32_t> applied_generation;   // config_generation the geometry above answers (0 = create())
+    uint32_t page_size;                     // Bytes per page backing the creator's mapping, set by create() (views are rounded to it)
     
-    // Frame metadata
-    uint32_t width;                         // Frame width (default: 1920)
-    uint32_t height;                        // Frame height (default: 1080)
-    uint32_t frame_size;                    // Bytes per frame (8,294,400)
-    uint32_t format;                        // Pixel format (PixelFormat enum)
+    // === Latest Frame (written by the producer, read by every consumer) ===
     
-    // Statistics (atomic for thread-safe access)
-    std::atomic<uint64_t> frame_counter;    // Total frames written since startup
-    std::atomic<uint64_t> dropped_frames;   // Frames dropped by producer
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint64_t> latest_frame;  // frame_number << 4 | slot (0 = none yet)
     
-    // Timing info (for latency measurement)
+    // === Producer-Owned Control (written by OBS) ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint64_t> frame_counter;  // Total frames written since startup
+    std::atomic<uint64_t> dropped_frames;   // Frames replaced by a newer one before any consumer took them
+    std::atomic<uint64_t> slot_busy_frames; // Frames skipped because every free slot was being read
     std::atomic<uint64_t> last_write_timestamp_ns;  // Nanosecond timestamp of last write
+    std::atomic<uint32_t> frame_signal;     // Bumped on every publish; consumers wait for it to change (futex / __ulock word)
+    std::atomic<uint8_t> producer_paused;   // Producer confirms it has paused
+    std::atomic<uint64_t> ring_write_cursor;    // Ring mode: frames published
+    std::atomic<uint64_t> ring_full_frames;     // Ring mode: frames skipped because the ring was full
+    std::atomic<uint32_t> capture_fps_num;      // Source capture: effective rate (canvas fps / divisor), 0 = every frame
+    std::atomic<uint32_t> capture_fps_den;
     
-    // Control flags (for bidirectional signaling)
+    // === Shared Consumer Control (written by Electron) ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint32_t> wake_waiters;  // Consumers currently blocked waiting for a frame
     std::atomic<uint8_t> pause_requested;   // Consumer requests producer to pause (for settings changes)
-    std::atomic<uint8_t> producer_paused;   // Producer confirms it has paused
+    std::atomic<uint32_t> requested_capture_fps;    // Source capture rate wanted by the consumer (0 = producer default)
+    std::atomic<uint32_t> config_generation;        // Bumped by every reconfigure request
+    std::atomic<uint64_t> requested_geometry;       // Latest request: width << 40 | height << 16 | format
+    
+    // === Consumer Registrations (one line per reader, see ConsumerRegistration) ===
+    
+    ConsumerRegistration consumers[SL_MAX_CONSUMERS];
+    
+    // === Shared GPU Texture (written by OBS, see TextureDescriptor) ===
     
-    // Reserved for future use (padding to 64 bytes)
-    uint8_t reserved[6];
+    TextureDescriptor texture;
     
-    // === Frame Data (23.7 MB) ===
+    // === Slot Descriptors (one block per frame slot, see SlotDescriptor) ===
     
-    // Triple-buffered frame data
+    SlotDescriptor slots[SL_MAX_SLOTS];
+    
+    // === Frame Data ===
+    
+    // Triple-buffered frame data follows at data_offset (see frameSlot())
     // Buffer 0: Producer writing OR ready for consumer
     // Buffer 1: Consumer reading OR ready for producer
     // Buffer 2: Ready for next operation
-    unsigned char frames[NUM_BUFFERS][FRAME_SIZE];
-    
 };
 
+// Each ownership group starts its own cache line
+static_assert(offsetof(SharedFrameBuffer, width) == SL_CACHE_LINE_SIZE, "identity and geometry must fit in one cache line");
+static_assert(offsetof(SharedFrameBuffer, latest_frame) % SL_CACHE_LINE_SIZE == 0, "latest frame must start a cache line");
+static_assert(offsetof(SharedFrameBuffer, frame_counter) - offsetof(SharedFrameBuffer, latest_frame) == SL_CACHE_LINE_SIZE,
+              "latest frame must have its cache line to itself");
+static_assert(offsetof(SharedFrameBuffer, wake_waiters) - offsetof(SharedFrameBuffer, frame_counter) == SL_CACHE_LINE_SIZE,
+              "producer control must fit in one cache line");
+static_assert(offsetof(SharedFrameBuffer, consumers) - offsetof(SharedFrameBuffer, wake_waiters) == SL_CACHE_LINE_SIZE,
+              "shared consumer control must fit in one cache line");
+static_assert(sizeof(ConsumerRegistration) == SL_CACHE_LINE_SIZE, "each consumer registration must have its own cache line");
+static_assert(sizeof(TextureDescriptor) % SL_CACHE_LINE_SIZE == 0, "texture descriptor must have its own cache lines");
+static_assert(SL_MAX_SLOTS <= SL_LATEST_SLOT_MASK + 1, "slot index must fit in latest_frame");
+
 // Apply alignment to the struct (MSVC requires it before the struct)
 #ifdef _MSC_VER
 // For MSVC, we use #pragma pack or ensure proper alignment in usage
@@ -105,8 +381,256 @@ struct SharedFrameBuffer {
 typedef struct SharedFrameBuffer SharedFrameBufferAligned __attribute__((aligned(64)));
 #endif
 
-// Calculate total shared memory size
-static constexpr size_t SHARED_BUFFER_SIZE = sizeof(SharedFrameBuffer);
+/**
+ * Channel request states
+ */
+enum ChannelRequestState {
+    SL_REQUEST_FREE = 0,
+    SL_REQUEST_WRITING = 1,     // Claimed by a consumer that is still filling in the names
+    SL_REQUEST_ACTIVE = 2
+};
+
+/**
+ * Channel request
+ * 
+ * A consumer that wants the frames of one OBS source creates the frame
+ * channel (SHM_NAME "_" channel) as usual, then claims a free request with a
+ * CAS on `state`, fills in both names and publishes it as ACTIVE. The names
+ * are not modified while the request is active. `serial` changes on every
+ * claim, so the producer can tell a re-used entry from the one it already
+ * serves. Requests without a heartbeat for SL_CONSUMER_TIMEOUT_NS are
+ * reclaimed by the producer (same steady clock as ConsumerRegistration).
+ */
+struct SL_ALIGNED(64) ChannelRequest {
+    std::atomic<uint32_t> state;            // ChannelRequestState
+    std::atomic<uint32_t> serial;           // Bumped by every claim
+    std::atomic<uint64_t> heartbeat_ns;     // Last sign of life of the requesting consumer
+    uint32_t process_id;                    // Requesting process, for diagnostics
+    uint32_t reserved0;
+    char channel[SL_CHANNEL_NAME_SIZE];     // Frame channel name (NUL-terminated)
+    char source[SL_SOURCE_NAME_SIZE];       // OBS source name (NUL-terminated)
+};
+
+/**
+ * Channel Directory Structure
+ * 
+ * Small region, separate from the frame channels, that either side may
+ * create. A zero-filled region is a valid empty directory; `version` is set
+ * by the first opener. Several requests may name the same channel (one per
+ * consumer); the producer serves each channel once and keeps it while any
+ * request for it is active. `generation` is bumped on every claim and
+ * release so the producer only rescans when something changed.
+ * 
+ * `channel_epoch` is the startup handshake for every frame channel: the
+ * creator bumps it once the region's header is complete, and a producer
+ * that sees it change connects (or, if the channel was re-created,
+ * reconnects) right away instead of waiting for its next retry. A
+ * directory written before the field existed reads it as zero.
+ */
+struct ChannelDirectory {
+    std::atomic<uint32_t> version;          // SL_DIRECTORY_VERSION (0 until first opened)
+    std::atomic<uint32_t> generation;       // Bumped on every change to a request
+    std::atomic<uint32_t> channel_epoch;    // Bumped after every frame channel create()
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) ChannelRequest requests[SL_MAX_CHANNEL_REQUESTS];
+};
+
+static_assert(offsetof(ChannelDirectory, requests) == SL_CACHE_LINE_SIZE, "directory header must fit in one cache line");
+static_assert(sizeof(ChannelRequest) % SL_CACHE_LINE_SIZE == 0, "channel requests must not share cache lines");
+
+/**
+ * Latency histogram of the metrics page
+ * Bucket i counts samples of [2^i, 2^(i+1)) microseconds; bucket 0 also
+ * takes samples under 1 us, the last bucket everything longer.
+ */
+struct SL_ALIGNED(64) MetricsHistogram {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> max_ns;           // Longest sample since the page was created
+    std::atomic<uint64_t> buckets[SL_METRICS_BUCKETS];
+};
+
+/**
+ * Channel Metrics Page
+ * 
+ * Small region per frame channel (SHM_METRICS_NAME "_" channel) written by
+ * the producer and readable by any process without registering or locking:
+ * the producer updates it with relaxed atomics as frames go by, and every
+ * counter only increases for the life of the page (writer restarts don't
+ * reset it), so a monitor samples it at any rate and takes differences
+ * between snapshots. A zero-filled page is valid; `version` is set by the
+ * first opener and must match SL_METRICS_VERSION before anything else is
+ * read. Fields are only ever appended, with a version bump.
+ * 
+ * The counters follow FrameStatistics: frames_in counts every frame offered
+ * to the writer, frames_dropped includes skipped_contended, and the other
+ * skipped_* counters are frames deliberately not written.
+ */
+struct ChannelMetrics {
+    std::atomic<uint32_t> version;          // SL_METRICS_VERSION (0 until first opened)
+    std::atomic<uint32_t> process_id;       // Producer process that last opened the page
+    std::atomic<uint64_t> updated_ns;       // Producer's os_gettime_ns() at the last frame (monotonic clock)
+    
+    // === Frame Counters ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint64_t> frames_in;  // Frames offered to the writer
+    std::atomic<uint64_t> frames_written;       // Frames published to the channel
+    std::atomic<uint64_t> frames_dropped;       // Frames lost (write failed, slot busy, contended)
+    std::atomic<uint64_t> skipped_unchanged;    // Change detection: identical to the last frame
+    std::atomic<uint64_t> skipped_ring_full;    // Ring mode: the slowest consumer was behind
+    std::atomic<uint64_t> skipped_contended;    // Another producer held the channel
+    std::atomic<uint64_t> skipped_idle;         // No consumer asked for frames, or paused
+    std::atomic<uint64_t> format_changes;       // Geometry changes published (reconfigure, native size)
+    
+    // === Latency Histograms ===
+    
+    MetricsHistogram conversion_ns;         // Conversion into the shared memory slot
+    MetricsHistogram readback_stall_ns;     // Time gs_stagesurface_map() blocked (source capture)
+    MetricsHistogram consumer_lag_ns;       // Capture -> consumer read
+    MetricsHistogram frame_latency_ns;      // OBS timestamp -> frame published
+};
+
+static_assert(offsetof(ChannelMetrics, frames_in) == SL_CACHE_LINE_SIZE, "metrics header must fit in one cache line");
+static_assert(sizeof(ChannelMetrics) <= 4096, "the metrics page must stay one page");
+
+/**
+ * Codec of an encoded packet channel
+ */
+enum PacketCodec {
+    SL_CODEC_ANY = 0,                       // Requested: whatever the producer's encoder makes
+    SL_CODEC_H264 = 1,
+    SL_CODEC_HEVC = 2,
+    SL_CODEC_AV1 = 3
+};
+
+/**
+ * One encoded packet in the ring
+ * `sequence` is the packet number (1-based) once the descriptor is complete
+ * and 0 while the producer rewrites it, so readers copy it seqlock-style.
+ */
+struct SL_ALIGNED(64) PacketDescriptor {
+    std::atomic<uint64_t> sequence;
+    uint64_t position;                      // Stream byte position of the data (offset = position % data_size)
+    uint32_t size;
+    uint32_t flags;                         // SL_PACKET_*
+    int64_t pts;                            // In the stream's timebase
+    int64_t dts;
+    uint64_t capture_time_ns;               // Producer's os_gettime_ns() of the frame (monotonic clock)
+};
+
+/**
+ * Encoded Packet Channel Structure
+ * 
+ * Compressed companion of a frame channel for consumers that forward video
+ * off the machine. The consumer creates the region (SHM_PACKET_NAME "_"
+ * channel) with the stream it wants and announces it like a frame channel;
+ * the producer feeds the frames OBS renders into a hardware encoder
+ * (software as a fallback) and appends every packet:
+ * - Packet bytes go to a data_size byte ring at monotonically increasing
+ *   stream positions; a packet never wraps (the producer skips the tail).
+ * - reserve_position is moved past a packet before its bytes are written,
+ *   so a reader that copied a packet knows it is intact if reserve_position
+ *   is still within data_size of the packet's start afterwards.
+ * - Descriptor (sequence % SL_PACKET_INDEX_SIZE) then describes it and
+ *   write_sequence is bumped. keyframe_sequence names the newest keyframe,
+ *   where a new or overrun reader starts.
+ * 
+ * Stream info (size, timebase, codec headers) is published under the
+ * stream_sequence seqlock before the first packet of each encoder session;
+ * stream_generation tells decoders to reinitialise. Consumers bump
+ * keyframe_requests to have the producer start a new group of pictures and
+ * keep consumer_heartbeat_ns fresh while they read: nothing is encoded
+ * while no consumer is alive.
+ */
+struct PacketRingBuffer {
+    // === Identity and Request (written once by create()) ===
+    
+    uint32_t magic;                         // SL_PACKET_LAYOUT_MAGIC
+    uint32_t layout_version;                // SL_PACKET_LAYOUT_VERSION of the creator
+    uint32_t header_size;                   // sizeof(PacketRingBuffer) of the creator
+    uint32_t data_offset;                   // Offset of the packet data ring from the start of the region
+    uint64_t total_size;                    // Bytes in the whole region
+    uint32_t data_size;                     // Bytes in the packet data ring
+    uint32_t requested_codec;               // PacketCodec (SL_CODEC_ANY = producer's choice)
+    uint32_t requested_width;               // 0 = OBS output size
+    uint32_t requested_height;
+    uint32_t requested_bitrate_kbps;        // 0 = producer default
+    uint32_t requested_keyint_ms;           // Keyframe interval, 0 = producer default
+    
+    // === Stream Info (producer, under stream_sequence) ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint32_t> stream_sequence;  // Odd while being rewritten
+    uint32_t stream_generation;             // Bumped for every encoder session
+    uint32_t codec;                         // PacketCodec of the packets
+    uint32_t width;
+    uint32_t height;
+    uint32_t fps_num;
+    uint32_t fps_den;
+    int32_t timebase_num;                   // pts/dts unit
+    int32_t timebase_den;
+    uint32_t extra_data_size;
+    
+    // === Producer Control ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint64_t> write_sequence;  // Packets published (newest packet number)
+    std::atomic<uint64_t> reserve_position;     // Stream bytes handed out to packets so far
+    std::atomic<uint64_t> keyframe_sequence;    // Packet number of the newest keyframe (0 = none yet)
+    std::atomic<uint64_t> oversized_packets;    // Packets larger than the data ring, not published
+    std::atomic<uint32_t> keyframes_served;     // keyframe_requests value answered by the producer
+    std::atomic<uint32_t> packet_signal;        // Bumped on every publish (futex / __ulock word)
+    
+    // === Consumer Control ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) std::atomic<uint32_t> keyframe_requests;  // Bumped to ask for a keyframe
+    std::atomic<uint32_t> packet_waiters;           // Consumers blocked in waitForPacket()
+    std::atomic<uint64_t> consumer_heartbeat_ns;    // Steady clock of the last read (0 = no reader)
+    
+    // === Codec Headers and Packet Descriptors ===
+    
+    SL_ALIGNED(SL_CACHE_LINE_SIZE) uint8_t extra_data[SL_PACKET_EXTRA_DATA_SIZE];
+    PacketDescriptor packets[SL_PACKET_INDEX_SIZE];
+};
+
+static_assert(offsetof(PacketRingBuffer, stream_sequence) == SL_CACHE_LINE_SIZE, "packet identity must fit in one cache line");
+static_assert((SL_PACKET_INDEX_SIZE & (SL_PACKET_INDEX_SIZE - 1)) == 0, "the packet index must be a power of two");
+
+/**
+ * Stream info snapshot (see readStreamInfo())
+ */
+struct PacketStreamInfo {
+    uint32_t generation;
+    uint32_t codec;
+    uint32_t width;
+    uint32_t height;
+    uint32_t fpsNum;
+    uint32_t fpsDen;
+    int32_t timebaseNum;
+    int32_t timebaseDen;
+    uint32_t extraDataSize;
+    uint8_t extraData[SL_PACKET_EXTRA_DATA_SIZE];
+};
+
+/**
+ * Descriptor of a packet returned by readPacket()
+ */
+struct PacketInfo {
+    uint64_t sequence;
+    uint32_t size;
+    uint32_t flags;                         // SL_PACKET_*
+    int64_t pts;
+    int64_t dts;
+    uint64_t captureTimeNs;
+};
+
+/**
+ * Result of readPacket()
+ */
+enum PacketReadResult {
+    SL_PACKET_NONE = 0,                     // No packet newer than the cursor yet
+    SL_PACKET_READ = 1,                     // Copied; the cursor moved past it
+    SL_PACKET_SKIPPED = 2,                  // The reader fell behind: the cursor jumped to the newest keyframe
+    SL_PACKET_TOO_LARGE = 3                 // The packet does not fit the caller's buffer (cursor unchanged)
+};
 
 /**
  * Helper functions for buffer management
@@ -114,34 +638,1045 @@ static constexpr size_t SHARED_BUFFER_SIZE = sizeof(SharedFrameBuffer);
 namespace StreamLumo {
     
     /**
-     * Get next buffer index in circular fashion
+     * Round up to a multiple of `alignment` (power of two)
+     */
+    constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+    
+    /**
+     * Check for the planar YUV formats
+     */
+    constexpr bool isPlanarFormat(uint32_t format) {
+        return format == FORMAT_NV12 || format == FORMAT_I420;
+    }
+    
+    /**
+     * Check for the 4-byte packed formats a producer converts into
+     */
+    constexpr bool isPackedRgbaFormat(uint32_t format) {
+        return format == FORMAT_RGBA || format == FORMAT_BGRA || format == FORMAT_RGBX ||
+               format == FORMAT_RGBA_PREMULTIPLIED;
+    }
+    
+    /**
+     * Bytes per pixel for the packed formats
+     */
+    constexpr uint32_t bytesPerPixel(uint32_t format) {
+        return (format == FORMAT_RGB || format == FORMAT_BGR) ? 3 : 4;
+    }
+    
+    /**
+     * Plane layout of one frame
+     * Rows are tightly packed; each plane starts FRAME_PLANE_ALIGNMENT-aligned.
+     */
+    struct PlaneLayout {
+        uint32_t count;
+        uint32_t offset[MAX_PLANES];
+        uint32_t stride[MAX_PLANES];
+        uint32_t rows[MAX_PLANES];
+        uint64_t size;
+    };
+    
+    constexpr PlaneLayout planeLayoutFor(uint32_t width, uint32_t height, uint32_t format) {
+        PlaneLayout layout = {};
+        const uint32_t chromaWidth = (width + 1) / 2;
+        const uint32_t chromaHeight = (height + 1) / 2;
+        
+        if (format == FORMAT_NV12) {
+            layout.count = 2;
+            layout.stride[0] = width;
+            layout.rows[0] = height;
+            layout.stride[1] = chromaWidth * 2;
+            layout.rows[1] = chromaHeight;
+        } else if (format == FORMAT_I420) {
+            layout.count = 3;
+            layout.stride[0] = width;
+            layout.rows[0] = height;
+            layout.stride[1] = layout.stride[2] = chromaWidth;
+            layout.rows[1] = layout.rows[2] = chromaHeight;
+        } else {
+            layout.count = 1;
+            layout.stride[0] = width * bytesPerPixel(format);
+            layout.rows[0] = height;
+        }
+        
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < layout.count; i++) {
+            offset = alignUp(offset, FRAME_PLANE_ALIGNMENT);
+            layout.offset[i] = static_cast<uint32_t>(offset);
+            offset += static_cast<uint64_t>(layout.stride[i]) * layout.rows[i];
+        }
+        layout.size = offset;
+        return layout;
+    }
+    
+    /**
+     * Bytes needed for one frame of the given geometry
+     */
+    constexpr uint64_t frameSizeFor(uint32_t width, uint32_t height, uint32_t format) {
+        return planeLayoutFor(width, height, format).size;
+    }
+    
+    /**
+     * Offset of the first frame slot (page-aligned, like every slot after it)
+     */
+    constexpr uint32_t dataOffset() {
+        return static_cast<uint32_t>(alignUp(sizeof(SharedFrameBuffer), FRAME_SLOT_ALIGNMENT));
+    }
+    
+    /**
+     * Bytes reserved per slot for frames of `frameSize` bytes
+     */
+    constexpr uint64_t slotSizeFor(uint64_t frameSize) {
+        return alignUp(frameSize, FRAME_SLOT_ALIGNMENT);
+    }
+    
+    /**
+     * Total region size for `slotCount` slots of `slotSize` bytes
+     */
+    constexpr uint64_t regionSizeFor(uint64_t slotSize, uint32_t slotCount = NUM_BUFFERS) {
+        return dataOffset() + slotSize * slotCount;
+    }
+    
+    /**
+     * Slot count a region is created with for the given flags
+     * Latest-frame mode is always a triple buffer; rings hold 2..SL_MAX_SLOTS.
+     */
+    constexpr uint32_t slotCountFor(uint32_t flags, uint32_t requested) {
+        return (flags & SL_FLAG_RING_MODE) == 0 ? NUM_BUFFERS
+            : requested < 2 ? 2
+            : requested > SL_MAX_SLOTS ? SL_MAX_SLOTS
+            : requested;
+    }
+    
+    /**
+     * Pointer to frame slot `index` inside a mapped region
+     */
+    inline unsigned char* frameSlot(SharedFrameBuffer* buffer, uint64_t index) {
+        return reinterpret_cast<unsigned char*>(buffer) + buffer->data_offset + index * buffer->slot_size;
+    }
+    
+    inline const unsigned char* frameSlot(const SharedFrameBuffer* buffer, uint64_t index) {
+        return reinterpret_cast<const unsigned char*>(buffer) + buffer->data_offset + index * buffer->slot_size;
+    }
+    
+    /**
+     * Check that a mapped header was written with this layout
+     */
+    inline bool isLayoutCompatible(const SharedFrameBuffer* buffer) {
+        return buffer->magic == SL_LAYOUT_MAGIC
+            && buffer->layout_version == SL_LAYOUT_VERSION
+            && buffer->header_size == sizeof(SharedFrameBuffer);
+    }
+    
+    /**
+     * Check that a mapped header describes a region of at most `mappedSize` bytes
+     */
+    inline bool isGeometryValid(const SharedFrameBuffer* buffer, uint64_t mappedSize) {
+        return buffer->total_size != 0
+            && buffer->total_size <= mappedSize
+            && buffer->data_offset >= sizeof(SharedFrameBuffer)
+            && buffer->frame_size.load(std::memory_order_relaxed) <= buffer->slot_size
+            && buffer->slot_count == slotCountFor(buffer->flags, buffer->slot_count)
+            && buffer->data_offset + static_cast<uint64_t>(buffer->slot_size) * buffer->slot_count <= buffer->total_size;
+    }
+    
+    /**
+     * Publish the geometry of the frames that follow (size, format, planes)
+     * The caller must ensure the frame fits in slot_size.
+     */
+    inline void setFrameGeometry(SharedFrameBuffer* buffer, uint32_t width, uint32_t height, uint32_t format) {
+        const PlaneLayout layout = planeLayoutFor(width, height, format);
+        buffer->plane_count = layout.count;
+        for (uint32_t i = 0; i < MAX_PLANES; i++) {
+            buffer->plane_offset[i] = i < layout.count ? layout.offset[i] : 0;
+            buffer->plane_stride[i] = i < layout.count ? layout.stride[i] : 0;
+        }
+        buffer->width.store(width, std::memory_order_relaxed);
+        buffer->height.store(height, std::memory_order_relaxed);
+        buffer->format.store(format, std::memory_order_relaxed);
+        buffer->frame_size.store(static_cast<uint32_t>(layout.size), std::memory_order_release);
+    }
+    
+    /**
+     * Mark slot `index` as being written (seqlock odd)
+     * Must be called before the producer touches the slot's frame data.
+     */
+    inline void beginSlotWrite(SharedFrameBuffer* buffer, uint64_t index) {
+        SlotDescriptor& slot = buffer->slots[index];
+        const uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+        if ((seq & 1) == 0) {
+            slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.dirty_base_frame = 0;
+        slot.color_matrix = SL_COLOR_MATRIX_BT601;
+        slot.color_range = SL_COLOR_RANGE_FULL;
+    }
+    
+    /**
+     * Describe which tiles of the frame being written to slot `index` changed
+     * since frame `baseFrame` (producer, between beginSlotWrite() and publish)
+     */
+    inline void setSlotDirtyTiles(SharedFrameBuffer* buffer, uint64_t index, uint64_t baseFrame,
+                                  const uint64_t tiles[SL_DIRTY_WORDS]) {
+        SlotDescriptor& slot = buffer->slots[index];
+        for (uint32_t i = 0; i < SL_DIRTY_WORDS; i++) {
+            slot.dirty_tiles[i] = tiles[i];
+        }
+        slot.dirty_base_frame = baseFrame;
+    }
+    
+    /**
+     * Record the YUV matrix and range of the planar frame being written to
+     * slot `index` (producer, between beginSlotWrite() and publish)
+     */
+    inline void setSlotColorimetry(SharedFrameBuffer* buffer, uint64_t index, uint32_t matrix, uint32_t range) {
+        SlotDescriptor& slot = buffer->slots[index];
+        slot.color_matrix = static_cast<uint16_t>(matrix);
+        slot.color_range = static_cast<uint16_t>(range);
+    }
+    
+    /**
+     * Close the write on slot `index` (seqlock even) without describing a frame
+     * Used when a write is aborted; the slot is never published in that case.
+     */
+    inline void endSlotWrite(SharedFrameBuffer* buffer, uint64_t index) {
+        SlotDescriptor& slot = buffer->slots[index];
+        const uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store((seq | 1) + 1, std::memory_order_release);
+    }
+    
+    /**
+     * Describe the frame just written to slot `index` and close the write
+     * Geometry is taken from the header, which always describes the frames
+     * being published.
+     */
+    inline void publishSlotDescriptor(SharedFrameBuffer* buffer, uint64_t index, uint64_t frameNumber,
+                                      uint64_t obsTimestampNs, uint64_t captureTimeNs) {
+        SlotDescriptor& slot = buffer->slots[index];
+        slot.format = buffer->format.load(std::memory_order_relaxed);
+        slot.width = buffer->width.load(std::memory_order_relaxed);
+        slot.height = buffer->height.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < MAX_PLANES; i++) {
+            slot.stride[i] = buffer->plane_stride[i];
+        }
+        slot.frame_number = frameNumber;
+        slot.obs_timestamp_ns = obsTimestampNs;
+        slot.capture_time_ns = captureTimeNs;
+        endSlotWrite(buffer, index);
+    }
+    
+    /**
+     * Start a consumer read of slot `index`
+     * Returns false if the producer is writing the slot right now.
+     */
+    inline bool beginSlotRead(const SharedFrameBuffer* buffer, uint64_t index, uint32_t& sequence) {
+        sequence = buffer->slots[index].sequence.load(std::memory_order_acquire);
+        return (sequence & 1) == 0;
+    }
+    
+    /**
+     * Finish a consumer read of slot `index`
+     * Returns true if nothing was written to the slot since beginSlotRead().
+     */
+    inline bool endSlotRead(const SharedFrameBuffer* buffer, uint64_t index, uint32_t sequence) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return buffer->slots[index].sequence.load(std::memory_order_relaxed) == sequence;
+    }
+    
+    /**
+     * Announce a newly published frame (producer, after latest_frame is stored)
+     * Returns true if a consumer is blocked and the platform wake must be issued.
+     * Only the latest value matters, so wake-ups never accumulate.
+     */
+    inline bool signalFrame(SharedFrameBuffer* buffer) {
+        buffer->frame_signal.fetch_add(1, std::memory_order_seq_cst);
+        return buffer->wake_waiters.load(std::memory_order_seq_cst) != 0;
+    }
+    
+    /**
+     * Reset slot descriptors, consumer feedback and wakeup state (region creation only)
+     */
+    inline void resetFrameState(SharedFrameBuffer* buffer) {
+        for (uint32_t i = 0; i < SL_MAX_SLOTS; i++) {
+            SlotDescriptor& slot = buffer->slots[i];
+            slot.sequence.store(0, std::memory_order_relaxed);
+            slot.format = slot.width = slot.height = 0;
+            slot.color_matrix = slot.color_range = 0;
+            for (uint32_t p = 0; p < MAX_PLANES; p++) slot.stride[p] = 0;
+            slot.frame_number = slot.obs_timestamp_ns = slot.capture_time_ns = 0;
+            slot.dirty_base_frame = 0;
+            for (uint32_t w = 0; w < SL_DIRTY_WORDS; w++) slot.dirty_tiles[w] = 0;
+        }
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            ConsumerRegistration& consumer = buffer->consumers[i];
+            consumer.owner.store(0, std::memory_order_relaxed);
+            consumer.held_slot.store(SL_NO_SLOT, std::memory_order_relaxed);
+            consumer.heartbeat_ns.store(0, std::memory_order_relaxed);
+            consumer.read_frame.store(0, std::memory_order_relaxed);
+            consumer.read_timestamp_ns.store(0, std::memory_order_relaxed);
+            consumer.process_id = 0;
+            consumer.held_texture.store(SL_NO_SLOT, std::memory_order_relaxed);
+            consumer.demand_ns.store(0, std::memory_order_relaxed);
+        }
+        buffer->texture.sequence.store(0, std::memory_order_relaxed);
+        buffer->texture.api = SL_TEXTURE_API_NONE;
+        buffer->texture.count = 0;
+        buffer->texture.latest.store(0, std::memory_order_relaxed);
+        buffer->texture.capture_time_ns.store(0, std::memory_order_relaxed);
+        buffer->frame_signal.store(0, std::memory_order_relaxed);
+        buffer->wake_waiters.store(0, std::memory_order_relaxed);
+        buffer->requested_capture_fps.store(0, std::memory_order_relaxed);
+        buffer->capture_fps_num.store(0, std::memory_order_relaxed);
+        buffer->capture_fps_den.store(0, std::memory_order_relaxed);
+        buffer->config_generation.store(0, std::memory_order_relaxed);
+        buffer->requested_geometry.store(0, std::memory_order_relaxed);
+        buffer->applied_generation.store(0, std::memory_order_relaxed);
+    }
+    
+    /**
+     * Initialize the region geometry for a newly created region
+     */
+    inline void initGeometry(SharedFrameBuffer* buffer, uint32_t width, uint32_t height, uint32_t format, uint32_t flags,
+                             uint32_t slotCount = NUM_BUFFERS) {
+        buffer->magic = SL_LAYOUT_MAGIC;
+        buffer->layout_version = SL_LAYOUT_VERSION;
+        buffer->header_size = sizeof(SharedFrameBuffer);
+        buffer->data_offset = dataOffset();
+        buffer->slot_size = static_cast<uint32_t>(slotSizeFor(frameSizeFor(width, height, format)));
+        buffer->flags = flags;
+        buffer->slot_count = slotCountFor(flags, slotCount);
+        buffer->total_size = regionSizeFor(buffer->slot_size, buffer->slot_count);
+        buffer->page_size = FRAME_SLOT_ALIGNMENT;
+        setFrameGeometry(buffer, width, height, format);
+    }
+    
+    /**
+     * Ask the producer to publish frames of a new size and/or format (consumer)
+     * The frames must fit the existing slots; returns the request's
+     * generation, or 0 if they don't. Frames of the new geometry follow once
+     * applied_generation reaches the returned value; a request the producer
+     * cannot serve (e.g. an unsupported format) is acknowledged without
+     * changing the geometry.
+     */
+    inline uint32_t requestReconfigure(SharedFrameBuffer* buffer, uint32_t width, uint32_t height, uint32_t format) {
+        if (width == 0 || height == 0 || width >= (1u << 24) || height >= (1u << 24) || format > 0xFFFFu
+            || frameSizeFor(width, height, format) > buffer->slot_size) {
+            return 0;
+        }
+        buffer->requested_geometry.store(static_cast<uint64_t>(width) << 40 | static_cast<uint64_t>(height) << 16 | format,
+                                         std::memory_order_relaxed);
+        return buffer->config_generation.fetch_add(1, std::memory_order_release) + 1;
+    }
+    
+    /**
+     * Latest reconfigure request not yet applied (producer, at a frame boundary)
+     * Returns false if the published geometry already answers the newest
+     * request. The caller publishes the geometry (if it can) and then stores
+     * `generation` in applied_generation.
+     */
+    inline bool pendingReconfigure(const SharedFrameBuffer* buffer, uint32_t& generation,
+                                   uint32_t& width, uint32_t& height, uint32_t& format) {
+        generation = buffer->config_generation.load(std::memory_order_acquire);
+        if (generation == buffer->applied_generation.load(std::memory_order_relaxed)) return false;
+        
+        const uint64_t geometry = buffer->requested_geometry.load(std::memory_order_relaxed);
+        width = static_cast<uint32_t>(geometry >> 40);
+        height = static_cast<uint32_t>(geometry >> 16) & 0xFFFFFFu;
+        format = static_cast<uint32_t>(geometry & 0xFFFFu);
+        return true;
+    }
+    
+    /**
+     * Check for the slot_count-deep FIFO mode
+     */
+    inline bool isRingMode(const SharedFrameBuffer* buffer) {
+        return (buffer->flags & SL_FLAG_RING_MODE) != 0;
+    }
+    
+    /**
+     * Reset the latest frame and the ring cursor (region creation only)
+     */
+    inline void resetSlotState(SharedFrameBuffer* buffer) {
+        buffer->latest_frame.store(0, std::memory_order_relaxed);
+        buffer->slot_busy_frames.store(0, std::memory_order_relaxed);
+        buffer->ring_write_cursor.store(0, std::memory_order_relaxed);
+        buffer->ring_full_frames.store(0, std::memory_order_release);
+    }
+    
+    /**
+     * Check whether a registration belongs to a live reader
+     * `nowNs` is on the transports' steady clock, like heartbeat_ns.
+     */
+    inline bool isHeartbeatFresh(uint64_t heartbeatNs, uint64_t nowNs) {
+        return heartbeatNs != 0 && (heartbeatNs >= nowNs || nowNs - heartbeatNs < SL_CONSUMER_TIMEOUT_NS);
+    }
+    
+    inline bool isConsumerActive(const ConsumerRegistration& consumer, uint64_t nowNs) {
+        return consumer.owner.load(std::memory_order_relaxed) != 0
+            && isHeartbeatFresh(consumer.heartbeat_ns.load(std::memory_order_acquire), nowNs);
+    }
+    
+    /**
+     * Number of live readers
+     */
+    inline uint32_t activeConsumerCount(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            if (isConsumerActive(buffer->consumers[i], nowNs)) count++;
+        }
+        return count;
+    }
+    
+    /**
+     * Claim a registration for a new reader (consumer)
+     * Takes a free entry, or one whose reader stopped sending heartbeats
+     * (an entry that is claimed but has no heartbeat yet is mid-registration).
+     * Latest-frame readers start with the current frame, ring readers with
+     * the next one published. Returns SL_MAX_CONSUMERS if the table is full.
+     */
+    inline uint32_t registerConsumer(SharedFrameBuffer* buffer, uint32_t token, uint32_t processId, uint64_t nowNs) {
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            ConsumerRegistration& consumer = buffer->consumers[i];
+            uint32_t owner = consumer.owner.load(std::memory_order_relaxed);
+            const uint64_t heartbeat = consumer.heartbeat_ns.load(std::memory_order_acquire);
+            if (owner != 0 && (heartbeat == 0 || isHeartbeatFresh(heartbeat, nowNs))) continue;
+            if (!consumer.owner.compare_exchange_strong(owner, token, std::memory_order_acq_rel)) continue;
+            
+            // Still invisible to the producer (no or stale heartbeat) until the heartbeat is stored
+            consumer.held_slot.store(SL_NO_SLOT, std::memory_order_relaxed);
+            consumer.read_frame.store(isRingMode(buffer) ? buffer->ring_write_cursor.load(std::memory_order_acquire) : 0,
+                                      std::memory_order_relaxed);
+            consumer.read_timestamp_ns.store(0, std::memory_order_relaxed);
+            consumer.process_id = processId;
+            consumer.held_texture.store(SL_NO_SLOT, std::memory_order_relaxed);
+            consumer.demand_ns.store(nowNs, std::memory_order_relaxed);
+            consumer.heartbeat_ns.store(nowNs, std::memory_order_seq_cst);
+            return i;
+        }
+        return SL_MAX_CONSUMERS;
+    }
+    
+    /**
+     * Release a registration claimed by registerConsumer() (consumer)
+     */
+    inline void unregisterConsumer(SharedFrameBuffer* buffer, uint32_t index, uint32_t token) {
+        ConsumerRegistration& consumer = buffer->consumers[index];
+        if (consumer.owner.load(std::memory_order_relaxed) != token) return;
+        consumer.held_slot.store(SL_NO_SLOT, std::memory_order_relaxed);
+        consumer.held_texture.store(SL_NO_SLOT, std::memory_order_relaxed);
+        consumer.demand_ns.store(0, std::memory_order_relaxed);
+        consumer.heartbeat_ns.store(0, std::memory_order_release);
+        consumer.owner.compare_exchange_strong(token, 0, std::memory_order_acq_rel);
+    }
+    
+    /**
+     * Refresh a reader's heartbeat (consumer)
+     * Returns false if the registration was reclaimed after the reader went
+     * silent; the reader must register again.
+     */
+    inline bool touchConsumer(SharedFrameBuffer* buffer, uint32_t index, uint32_t token, uint64_t nowNs) {
+        ConsumerRegistration& consumer = buffer->consumers[index];
+        if (consumer.owner.load(std::memory_order_relaxed) != token) return false;
+        consumer.heartbeat_ns.store(nowNs, std::memory_order_release);
+        return true;
+    }
+    
+    /**
+     * Record that a reader wants frames (consumer, on every frame request)
+     * `nowNs` = 0 marks the reader idle.
+     */
+    inline void setConsumerDemand(SharedFrameBuffer* buffer, uint32_t index, uint64_t nowNs) {
+        buffer->consumers[index].demand_ns.store(nowNs, std::memory_order_relaxed);
+    }
+    
+    /**
+     * Whether any live reader asked for a frame within SL_DEMAND_TIMEOUT_NS (producer)
+     */
+    inline bool hasConsumerDemand(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            const ConsumerRegistration& consumer = buffer->consumers[i];
+            const uint64_t demand = consumer.demand_ns.load(std::memory_order_relaxed);
+            if (demand == 0 || (demand < nowNs && nowNs - demand >= SL_DEMAND_TIMEOUT_NS)) continue;
+            if (isConsumerActive(consumer, nowNs)) return true;
+        }
+        return false;
+    }
+    
+    /**
+     * Record a frame read by a reader (consumer, after the copy)
+     * Advances its read cursor and drops its hazard on the slot. The producer
+     * matches read_frame against the slot descriptors to measure
+     * capture-to-pickup latency.
+     */
+    inline void recordConsumerRead(SharedFrameBuffer* buffer, uint32_t index, uint64_t frameNumber, uint64_t readTimestampNs) {
+        ConsumerRegistration& consumer = buffer->consumers[index];
+        consumer.read_timestamp_ns.store(readTimestampNs, std::memory_order_relaxed);
+        consumer.read_frame.store(frameNumber, std::memory_order_release);
+        consumer.held_slot.store(SL_NO_SLOT, std::memory_order_release);
+    }
+    
+    /**
+     * Drop a reader's hazard without advancing its cursor (consumer, failed copy)
+     */
+    inline void releaseConsumerSlot(SharedFrameBuffer* buffer, uint32_t index) {
+        buffer->consumers[index].held_slot.store(SL_NO_SLOT, std::memory_order_release);
+    }
+    
+    /**
+     * Pick a slot for the next latest-frame write (producer)
+     * Any slot other than the latest one that no active reader is copying.
+     * Returns slot_count if every candidate is being read.
+     */
+    inline uint32_t latestWriteSlot(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        const uint64_t latest = buffer->latest_frame.load(std::memory_order_relaxed);
+        uint32_t busy = latest != 0 ? 1u << (latest & SL_LATEST_SLOT_MASK) : 0;
+        
+        // Pairs with the reader's hazard store and re-check in acquireLatestSlot()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            const ConsumerRegistration& consumer = buffer->consumers[i];
+            const uint32_t held = consumer.held_slot.load(std::memory_order_seq_cst);
+            if (held < buffer->slot_count && isConsumerActive(consumer, nowNs)) busy |= 1u << held;
+        }
+        
+        for (uint32_t slot = 0; slot < buffer->slot_count; slot++) {
+            if ((busy & (1u << slot)) == 0) return slot;
+        }
+        return buffer->slot_count;
+    }
+    
+    /**
+     * Publish a frame written to `slot` as the latest one (producer)
+     * The store releases the frame data. Returns true if the frame it
+     * replaces was never read by any active reader.
+     */
+    inline bool publishLatestSlot(SharedFrameBuffer* buffer, uint32_t slot, uint64_t frameNumber, uint64_t nowNs) {
+        const uint64_t previous = buffer->latest_frame.exchange((frameNumber << SL_LATEST_SLOT_BITS) | slot,
+                                                                std::memory_order_seq_cst);
+        if (previous == 0) return false;
+        
+        const uint64_t previousFrame = previous >> SL_LATEST_SLOT_BITS;
+        const uint32_t previousSlot = static_cast<uint32_t>(previous & SL_LATEST_SLOT_MASK);
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            const ConsumerRegistration& consumer = buffer->consumers[i];
+            if (!isConsumerActive(consumer, nowNs)) continue;
+            if (consumer.read_frame.load(std::memory_order_relaxed) >= previousFrame
+                || consumer.held_slot.load(std::memory_order_relaxed) == previousSlot) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * Take the newest published frame (consumer `index`)
+     * Publishes a hazard on its slot so the producer leaves it alone until
+     * recordConsumerRead(). Returns false if this reader already has the
+     * newest frame.
+     */
+    inline bool acquireLatestSlot(SharedFrameBuffer* buffer, uint32_t index, uint32_t& slot) {
+        ConsumerRegistration& consumer = buffer->consumers[index];
+        const uint64_t lastRead = consumer.read_frame.load(std::memory_order_relaxed);
+        
+        uint64_t latest = buffer->latest_frame.load(std::memory_order_acquire);
+        for (;;) {
+            if (latest == 0 || (latest >> SL_LATEST_SLOT_BITS) <= lastRead) return false;
+            
+            // The hazard only counts if the slot was still the latest after it became visible
+            slot = static_cast<uint32_t>(latest & SL_LATEST_SLOT_MASK);
+            consumer.held_slot.store(slot, std::memory_order_seq_cst);
+            const uint64_t check = buffer->latest_frame.load(std::memory_order_seq_cst);
+            if (check == latest) return slot < buffer->slot_count;
+            latest = check;
+        }
+    }
+    
+    /**
+     * Read cursor of the slowest active ring reader
+     * With no active reader nothing is held back and the ring never fills.
+     */
+    inline uint64_t ringReadBound(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        uint64_t bound = buffer->ring_write_cursor.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            const ConsumerRegistration& consumer = buffer->consumers[i];
+            if (!isConsumerActive(consumer, nowNs)) continue;
+            const uint64_t read = consumer.read_frame.load(std::memory_order_acquire);
+            if (read < bound) bound = read;
+        }
+        return bound;
+    }
+    
+    /**
+     * Slot for the next ring frame (producer)
+     * Returns slot_count when the slowest reader is a full ring behind; the
+     * caller reports the frame in ring_full_frames and must not touch any slot.
+     */
+    inline uint32_t ringWriteSlot(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        const uint64_t write = buffer->ring_write_cursor.load(std::memory_order_relaxed);
+        if (write - ringReadBound(buffer, nowNs) >= buffer->slot_count) return buffer->slot_count;
+        return static_cast<uint32_t>(write % buffer->slot_count);
+    }
+    
+    /**
+     * Publish the slot returned by ringWriteSlot() (producer)
+     */
+    inline void publishRingSlot(SharedFrameBuffer* buffer) {
+        buffer->ring_write_cursor.fetch_add(1, std::memory_order_release);
+    }
+    
+    /**
+     * Oldest ring frame consumer `index` has not read
+     * Returns false if it is up to date. The slot stays reserved until
+     * recordConsumerRead() advances the reader's cursor. `frameNumber` is the
+     * frame expected in the slot; a reader that was lapped while inactive
+     * finds a newer one there and moves its cursor up to it.
+     */
+    inline bool acquireRingSlot(const SharedFrameBuffer* buffer, uint32_t index, uint32_t& slot, uint64_t& frameNumber) {
+        const uint64_t read = buffer->consumers[index].read_frame.load(std::memory_order_relaxed);
+        if (buffer->ring_write_cursor.load(std::memory_order_acquire) <= read) return false;
+        slot = static_cast<uint32_t>(read % buffer->slot_count);
+        frameNumber = read + 1;
+        return true;
+    }
+    
+    /**
+     * Shared texture state as seen by one consumer
+     */
+    struct SharedTextureInfo {
+        uint32_t api;                       // SharedTextureApi
+        uint32_t count;
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint32_t syncKey;
+        uint64_t handles[SL_MAX_SHARED_TEXTURES];
+        uint32_t index;                     // Texture holding frameNumber
+        uint64_t frameNumber;
+        uint64_t captureTimeNs;
+    };
+    
+    /**
+     * Replace the published textures (producer; api = SL_TEXTURE_API_NONE withdraws them)
+     */
+    inline void setTextureDescriptor(SharedFrameBuffer* buffer, uint32_t api, uint32_t count, const uint64_t handles[],
+                                     uint32_t width, uint32_t height, uint32_t format, uint32_t syncKey) {
+        TextureDescriptor& texture = buffer->texture;
+        const uint32_t sequence = texture.sequence.load(std::memory_order_relaxed);
+        texture.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        // Frames of the old textures must not be taken for the new ones
+        texture.latest.store(0, std::memory_order_relaxed);
+        texture.api = api;
+        texture.count = count < SL_MAX_SHARED_TEXTURES ? count : SL_MAX_SHARED_TEXTURES;
+        for (uint32_t i = 0; i < SL_MAX_SHARED_TEXTURES; i++) {
+            texture.handles[i] = (handles && i < texture.count) ? handles[i] : 0;
+        }
+        texture.width = width;
+        texture.height = height;
+        texture.format = format;
+        texture.sync_key = syncKey;
+        texture.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    
+    /**
+     * Make texture `index` the latest frame (producer)
+     */
+    inline void publishLatestTexture(SharedFrameBuffer* buffer, uint32_t index, uint64_t frameNumber, uint64_t captureTimeNs) {
+        buffer->texture.capture_time_ns.store(captureTimeNs, std::memory_order_relaxed);
+        buffer->texture.latest.store((frameNumber << SL_LATEST_SLOT_BITS) | index, std::memory_order_release);
+    }
+    
+    /**
+     * Shared textures the producer must not render into (producer)
+     * Bit i is set for the latest texture frame and for a texture an active
+     * reader holds.
+     */
+    inline uint32_t busyTextureMask(const SharedFrameBuffer* buffer, uint64_t nowNs) {
+        const uint64_t latest = buffer->texture.latest.load(std::memory_order_relaxed);
+        uint32_t busy = latest != 0 ? 1u << (latest & SL_LATEST_SLOT_MASK) : 0;
+        
+        // Pairs with the reader's hazard store and re-check in acquireLatestTexture()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+            const ConsumerRegistration& consumer = buffer->consumers[i];
+            const uint32_t held = consumer.held_texture.load(std::memory_order_seq_cst);
+            if (held < SL_MAX_SHARED_TEXTURES && isConsumerActive(consumer, nowNs)) busy |= 1u << held;
+        }
+        return busy;
+    }
+    
+    /**
+     * Snapshot of the published textures and the latest texture frame (consumer)
+     * Returns false if no texture is published or the handles were being replaced.
+     */
+    inline bool readTextureDescriptor(const SharedFrameBuffer* buffer, SharedTextureInfo& info) {
+        const TextureDescriptor& texture = buffer->texture;
+        const uint32_t sequence = texture.sequence.load(std::memory_order_acquire);
+        if (sequence & 1u) return false;
+        
+        info.api = texture.api;
+        info.count = texture.count;
+        info.width = texture.width;
+        info.height = texture.height;
+        info.format = texture.format;
+        info.syncKey = texture.sync_key;
+        for (uint32_t i = 0; i < SL_MAX_SHARED_TEXTURES; i++) info.handles[i] = texture.handles[i];
+        const uint64_t latest = texture.latest.load(std::memory_order_acquire);
+        info.index = static_cast<uint32_t>(latest & SL_LATEST_SLOT_MASK);
+        info.frameNumber = latest >> SL_LATEST_SLOT_BITS;
+        info.captureTimeNs = texture.capture_time_ns.load(std::memory_order_relaxed);
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return texture.sequence.load(std::memory_order_relaxed) == sequence
+            && info.api != SL_TEXTURE_API_NONE && info.index < info.count;
+    }
+    
+    /**
+     * Take the latest texture frame (consumer `index`, after readTextureDescriptor())
+     * Publishes a hazard on info.index so the producer leaves that texture
+     * alone until releaseTextureHazard() or the next acquire. Returns false
+     * if a newer frame was published meanwhile; read the descriptor again.
+     */
+    inline bool acquireLatestTexture(SharedFrameBuffer* buffer, uint32_t index, const SharedTextureInfo& info) {
+        buffer->consumers[index].held_texture.store(info.index, std::memory_order_seq_cst);
+        const uint64_t latest = buffer->texture.latest.load(std::memory_order_seq_cst);
+        return latest == ((info.frameNumber << SL_LATEST_SLOT_BITS) | info.index);
+    }
+    
+    /**
+     * Drop a reader's hazard on its shared texture (consumer)
+     */
+    inline void releaseTextureHazard(SharedFrameBuffer* buffer, uint32_t index) {
+        buffer->consumers[index].held_texture.store(SL_NO_SLOT, std::memory_order_release);
+    }
+    
+    /**
+     * Adopt a freshly mapped directory (either side may be first)
+     */
+    inline bool initDirectory(ChannelDirectory* directory) {
+        uint32_t expected = 0;
+        directory->version.compare_exchange_strong(expected, SL_DIRECTORY_VERSION, std::memory_order_acq_rel);
+        return directory->version.load(std::memory_order_acquire) == SL_DIRECTORY_VERSION;
+    }
+    
+    /**
+     * Adopt a freshly mapped metrics page (any opener may be first)
+     */
+    inline bool initMetrics(ChannelMetrics* metrics) {
+        uint32_t expected = 0;
+        metrics->version.compare_exchange_strong(expected, SL_METRICS_VERSION, std::memory_order_acq_rel);
+        return metrics->version.load(std::memory_order_acquire) == SL_METRICS_VERSION;
+    }
+    
+    /**
+     * Count one event in a metrics page counter (producer)
      */
-    inline uint64_t nextBufferIndex(uint64_t current) {
-        return (current + 1) % NUM_BUFFERS;
+    inline void countMetric(std::atomic<uint64_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
     }
     
     /**
-     * Calculate distance between write and read indices
-     * Returns number of buffers between them
+     * Record one sample in a metrics page histogram (producer)
      */
-    inline int bufferDistance(uint64_t writeIdx, uint64_t readIdx) {
-        return (writeIdx - readIdx + NUM_BUFFERS) % NUM_BUFFERS;
+    inline void recordMetric(MetricsHistogram& histogram, uint64_t ns) {
+        uint32_t bucket = 0;
+        for (uint64_t us = ns / 1000; us > 1 && bucket + 1 < SL_METRICS_BUCKETS; us >>= 1) bucket++;
+        histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        histogram.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        histogram.count.fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = histogram.max_ns.load(std::memory_order_relaxed);
+        while (ns > max && !histogram.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
     }
     
     /**
-     * Check if consumer is falling behind
-     * Returns true if more than 1 frame behind (should drop frames)
+     * Offset of the packet data ring (one page after the header)
      */
-    inline bool shouldDropFrames(uint64_t writeIdx, uint64_t readIdx) {
-        return bufferDistance(writeIdx, readIdx) > 1;
+    inline uint32_t packetDataOffset() {
+        return static_cast<uint32_t>(alignUp(sizeof(PacketRingBuffer), FRAME_SLOT_ALIGNMENT));
     }
     
     /**
-     * Get latest available frame index (for low-latency mode)
+     * Initialise a new packet channel (creator)
+     * The magic goes in last: producers ignore the region until it is there.
      */
-    inline uint64_t getLatestFrameIndex(uint64_t writeIdx) {
-        return (writeIdx - 1 + NUM_BUFFERS) % NUM_BUFFERS;
+    inline void initPacketRing(PacketRingBuffer* ring, uint32_t dataSize, uint32_t codec, uint32_t width, uint32_t height,
+                               uint32_t bitrateKbps, uint32_t keyintMs) {
+        ring->layout_version = SL_PACKET_LAYOUT_VERSION;
+        ring->header_size = sizeof(PacketRingBuffer);
+        ring->data_offset = packetDataOffset();
+        ring->data_size = dataSize;
+        ring->total_size = static_cast<uint64_t>(ring->data_offset) + dataSize;
+        ring->requested_codec = codec;
+        ring->requested_width = width;
+        ring->requested_height = height;
+        ring->requested_bitrate_kbps = bitrateKbps;
+        ring->requested_keyint_ms = keyintMs;
+        
+        ring->stream_sequence.store(0, std::memory_order_relaxed);
+        ring->stream_generation = 0;
+        ring->write_sequence.store(0, std::memory_order_relaxed);
+        ring->reserve_position.store(0, std::memory_order_relaxed);
+        ring->keyframe_sequence.store(0, std::memory_order_relaxed);
+        ring->oversized_packets.store(0, std::memory_order_relaxed);
+        ring->keyframes_served.store(0, std::memory_order_relaxed);
+        ring->keyframe_requests.store(0, std::memory_order_relaxed);
+        ring->packet_waiters.store(0, std::memory_order_relaxed);
+        ring->consumer_heartbeat_ns.store(0, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < SL_PACKET_INDEX_SIZE; i++) {
+            ring->packets[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        
+        std::atomic_thread_fence(std::memory_order_release);
+        ring->magic = SL_PACKET_LAYOUT_MAGIC;
+    }
+    
+    /**
+     * Check a mapped packet channel before trusting it (producer)
+     */
+    inline bool isPacketRingValid(const PacketRingBuffer* ring, uint64_t mappedSize) {
+        return ring->magic == SL_PACKET_LAYOUT_MAGIC
+            && ring->layout_version == SL_PACKET_LAYOUT_VERSION
+            && ring->header_size == sizeof(PacketRingBuffer)
+            && ring->data_offset >= sizeof(PacketRingBuffer)
+            && ring->data_size > 0
+            && ring->total_size <= mappedSize
+            && ring->data_offset + static_cast<uint64_t>(ring->data_size) <= ring->total_size;
+    }
+    
+    /**
+     * Publish the stream of a new encoder session (producer, before its first packet)
+     * Extra data beyond SL_PACKET_EXTRA_DATA_SIZE is truncated.
+     */
+    inline void publishStreamInfo(PacketRingBuffer* ring, uint32_t codec, uint32_t width, uint32_t height,
+                                  uint32_t fpsNum, uint32_t fpsDen, int32_t timebaseNum, int32_t timebaseDen,
+                                  const uint8_t* extraData, size_t extraDataSize) {
+        const uint32_t sequence = ring->stream_sequence.load(std::memory_order_relaxed);
+        ring->stream_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        ring->stream_generation++;
+        ring->codec = codec;
+        ring->width = width;
+        ring->height = height;
+        ring->fps_num = fpsNum;
+        ring->fps_den = fpsDen;
+        ring->timebase_num = timebaseNum;
+        ring->timebase_den = timebaseDen;
+        ring->extra_data_size = static_cast<uint32_t>(extraDataSize < SL_PACKET_EXTRA_DATA_SIZE ? extraDataSize
+                                                                                               : SL_PACKET_EXTRA_DATA_SIZE);
+        if (extraData && ring->extra_data_size > 0) {
+            memcpy(ring->extra_data, extraData, ring->extra_data_size);
+        }
+        
+        ring->stream_sequence.store(sequence + 2, std::memory_order_release);
+    }
+    
+    /**
+     * Snapshot the stream info (consumer)
+     * Returns false before the first session or if it changed while being read.
+     */
+    inline bool readStreamInfo(const PacketRingBuffer* ring, PacketStreamInfo& info) {
+        const uint32_t sequence = ring->stream_sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || (sequence & 1) != 0) return false;
+        
+        info.generation = ring->stream_generation;
+        info.codec = ring->codec;
+        info.width = ring->width;
+        info.height = ring->height;
+        info.fpsNum = ring->fps_num;
+        info.fpsDen = ring->fps_den;
+        info.timebaseNum = ring->timebase_num;
+        info.timebaseDen = ring->timebase_den;
+        info.extraDataSize = ring->extra_data_size < SL_PACKET_EXTRA_DATA_SIZE ? ring->extra_data_size
+                                                                              : SL_PACKET_EXTRA_DATA_SIZE;
+        memcpy(info.extraData, ring->extra_data, info.extraDataSize);
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return ring->stream_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+    
+    /**
+     * Append one encoded packet (producer)
+     * Returns false, counting it in oversized_packets, if it can never fit.
+     */
+    inline bool appendPacket(PacketRingBuffer* ring, const uint8_t* data, uint32_t size, int64_t pts, int64_t dts,
+                             bool keyframe, uint64_t captureTimeNs) {
+        if (size > ring->data_size) {
+            ring->oversized_packets.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        // Packets never wrap: skip the tail of the ring if this one doesn't fit it
+        uint64_t position = ring->reserve_position.load(std::memory_order_relaxed);
+        const uint64_t offset = position % ring->data_size;
+        if (offset + size > ring->data_size) position += ring->data_size - offset;
+        
+        // Reserve before overwriting, so a reader of the old bytes notices
+        ring->reserve_position.store(position + size, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(reinterpret_cast<uint8_t*>(ring) + ring->data_offset + position % ring->data_size, data, size);
+        
+        const uint64_t sequence = ring->write_sequence.load(std::memory_order_relaxed) + 1;
+        PacketDescriptor& packet = ring->packets[sequence & (SL_PACKET_INDEX_SIZE - 1)];
+        packet.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        packet.position = position;
+        packet.size = size;
+        packet.flags = keyframe ? SL_PACKET_KEYFRAME : 0;
+        packet.pts = pts;
+        packet.dts = dts;
+        packet.capture_time_ns = captureTimeNs;
+        packet.sequence.store(sequence, std::memory_order_release);
+        
+        if (keyframe) {
+            ring->keyframe_sequence.store(sequence, std::memory_order_release);
+        }
+        ring->write_sequence.store(sequence, std::memory_order_release);
+        ring->packet_signal.fetch_add(1, std::memory_order_seq_cst);
+        return true;
+    }
+    
+    /**
+     * Copy the packet after `cursor`, the number of the last packet read (consumer)
+     * A new reader (cursor 0) starts at the newest keyframe. A reader the
+     * producer has lapped gets SL_PACKET_SKIPPED with the cursor moved to just
+     * before the newest keyframe: packets were lost, the next call resumes there
+     * (or at the newest packet if that keyframe was overwritten too, in which
+     * case the consumer should request a keyframe).
+     */
+    inline PacketReadResult readPacket(const PacketRingBuffer* ring, uint64_t& cursor, uint8_t* dst, size_t dstSize,
+                                       PacketInfo* info) {
+        const uint64_t newest = ring->write_sequence.load(std::memory_order_acquire);
+        uint64_t next = cursor + 1;
+        if (cursor == 0 || cursor > newest) {
+            next = ring->keyframe_sequence.load(std::memory_order_acquire);
+            if (next == 0) return SL_PACKET_NONE;
+        } else if (next > newest) {
+            return SL_PACKET_NONE;
+        }
+        
+        const PacketDescriptor& packet = ring->packets[next & (SL_PACKET_INDEX_SIZE - 1)];
+        PacketInfo copy;
+        bool intact = packet.sequence.load(std::memory_order_acquire) == next;
+        if (intact) {
+            copy.sequence = next;
+            copy.size = packet.size;
+            copy.flags = packet.flags;
+            copy.pts = packet.pts;
+            copy.dts = packet.dts;
+            copy.captureTimeNs = packet.capture_time_ns;
+            const uint64_t position = packet.position;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            intact = packet.sequence.load(std::memory_order_relaxed) == next;
+            
+            if (intact && copy.size > dstSize) {
+                if (info) *info = copy;
+                return SL_PACKET_TOO_LARGE;
+            }
+            if (intact) {
+                memcpy(dst, reinterpret_cast<const uint8_t*>(ring) + ring->data_offset + position % ring->data_size, copy.size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                intact = ring->reserve_position.load(std::memory_order_relaxed) - position <= ring->data_size;
+            }
+        }
+        
+        if (!intact) {
+            const uint64_t keyframe = ring->keyframe_sequence.load(std::memory_order_acquire);
+            cursor = keyframe > next ? keyframe - 1 : ring->write_sequence.load(std::memory_order_acquire);
+            return SL_PACKET_SKIPPED;
+        }
+        
+        cursor = next;
+        if (info) *info = copy;
+        return SL_PACKET_READ;
+    }
+    
+    /**
+     * Whether a consumer has read within SL_CONSUMER_TIMEOUT_NS (producer)
+     */
+    inline bool hasPacketConsumer(const PacketRingBuffer* ring, uint64_t nowNs) {
+        const uint64_t heartbeat = ring->consumer_heartbeat_ns.load(std::memory_order_relaxed);
+        return heartbeat != 0 && nowNs < heartbeat + SL_CONSUMER_TIMEOUT_NS;
+    }
+    
+    /**
+     * Newest keyframe request not answered yet (producer)
+     */
+    inline bool pendingKeyframeRequest(const PacketRingBuffer* ring, uint32_t& request) {
+        request = ring->keyframe_requests.load(std::memory_order_acquire);
+        return request != ring->keyframes_served.load(std::memory_order_relaxed);
+    }
+    
+    /**
+     * Copy a name into a fixed-size request field, truncating and NUL-terminating
+     */
+    inline void copyRequestName(char* dst, size_t size, const char* src) {
+        size_t i = 0;
+        for (; src && src[i] != '\0' && i + 1 < size; i++) dst[i] = src[i];
+        for (; i < size; i++) dst[i] = '\0';
+    }
+    
+    /**
+     * Claim a free request and publish it (consumer)
+     * Returns the request index, SL_MAX_CHANNEL_REQUESTS if the directory is full.
+     */
+    inline uint32_t claimChannelRequest(ChannelDirectory* directory, const char* channel, const char* source,
+                                        uint32_t processId, uint64_t nowNs) {
+        for (uint32_t i = 0; i < SL_MAX_CHANNEL_REQUESTS; i++) {
+            ChannelRequest& request = directory->requests[i];
+            uint32_t expected = SL_REQUEST_FREE;
+            if (!request.state.compare_exchange_strong(expected, SL_REQUEST_WRITING, std::memory_order_acquire)) continue;
+            
+            request.serial.fetch_add(1, std::memory_order_relaxed);
+            request.process_id = processId;
+            copyRequestName(request.channel, SL_CHANNEL_NAME_SIZE, channel);
+            copyRequestName(request.source, SL_SOURCE_NAME_SIZE, source);
+            request.heartbeat_ns.store(nowNs, std::memory_order_relaxed);
+            request.state.store(SL_REQUEST_ACTIVE, std::memory_order_release);
+            directory->generation.fetch_add(1, std::memory_order_release);
+            return i;
+        }
+        return SL_MAX_CHANNEL_REQUESTS;
+    }
+    
+    /**
+     * Withdraw a request claimed with claimChannelRequest() (consumer)
+     */
+    inline void releaseChannelRequest(ChannelDirectory* directory, uint32_t index) {
+        if (index >= SL_MAX_CHANNEL_REQUESTS) return;
+        directory->requests[index].state.store(SL_REQUEST_FREE, std::memory_order_release);
+        directory->generation.fetch_add(1, std::memory_order_release);
+    }
+    
+    /**
+     * Whether request `index` is active with a fresh heartbeat
+     */
+    inline bool isChannelRequestLive(const ChannelDirectory* directory, uint32_t index, uint64_t nowNs) {
+        const ChannelRequest& request = directory->requests[index];
+        return request.state.load(std::memory_order_acquire) == SL_REQUEST_ACTIVE
+            && isHeartbeatFresh(request.heartbeat_ns.load(std::memory_order_relaxed), nowNs);
+    }
+    
+    /**
+     * Free an active request whose consumer stopped sending heartbeats (producer)
+     * Returns true if this call reclaimed it.
+     */
+    inline bool expireChannelRequest(ChannelDirectory* directory, uint32_t index, uint64_t nowNs) {
+        ChannelRequest& request = directory->requests[index];
+        uint32_t expected = SL_REQUEST_ACTIVE;
+        if (isHeartbeatFresh(request.heartbeat_ns.load(std::memory_order_relaxed), nowNs)) return false;
+        if (!request.state.compare_exchange_strong(expected, SL_REQUEST_FREE, std::memory_order_acq_rel)) return false;
+        directory->generation.fetch_add(1, std::memory_order_release);
+        return true;
     }
 }
 
+// Total shared memory size for the default 1920x1080 RGBA geometry
+static constexpr size_t SHARED_BUFFER_SIZE = StreamLumo::regionSizeFor(StreamLumo::slotSizeFor(FRAME_SIZE));
+
 #endif // STREAMLUMO_SHARED_BUFFER_H
@@ -0,0 +1,190 @@
+/**
+ * StreamLumo Band Worker Pool - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "band_pool.h"
+
+#include <obs.h>
+#include <util/threading.h>
+#include <algorithm>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+/**
+ * Pin the calling thread to `mask` and lower its scheduling class where the
+ * platform allows it, so OBS's render/encode threads win any contention
+ */
+void applyWorkerPlacement(uint32_t index, uint64_t mask)
+{
+#if defined(_WIN32)
+    if (mask != 0 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(mask)) == 0) {
+        blog(LOG_WARNING, "[BandPool] Worker %u: failed to set affinity mask 0x%llx", index, (unsigned long long)mask);
+    }
+#elif defined(__APPLE__)
+    // No hard affinity on macOS; a QoS below the render thread's keeps workers off its core
+    (void)index;
+    (void)mask;
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0);
+#elif defined(__linux__)
+    if (mask != 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t cpu = 0; cpu < 64; cpu++) {
+            if (mask & (1ull << cpu)) CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            blog(LOG_WARNING, "[BandPool] Worker %u: failed to set affinity mask 0x%llx", index, (unsigned long long)mask);
+        }
+    }
+#else
+    (void)index;
+    (void)mask;
+#endif
+}
+
+} // namespace
+
+BandPool::BandPool()
+    : m_affinityMask(0)
+    , m_job(nullptr)
+    , m_bands(0)
+    , m_generation(0)
+    , m_busy(0)
+    , m_stopping(false)
+    , m_nextBand(0)
+    , m_pending(0)
+{
+}
+
+BandPool::~BandPool()
+{
+    stop();
+}
+
+void BandPool::configure(uint32_t workers, uint64_t affinityMask)
+{
+    workers = std::min(workers, MAX_CONVERSION_THREADS);
+    if (workers == m_threads.size() && affinityMask == m_affinityMask) return;
+
+    stop();
+    m_affinityMask = affinityMask;
+    start(workers);
+
+    if (workers > 0 && affinityMask != 0) {
+        blog(LOG_INFO, "[BandPool] %u conversion worker(s), affinity mask 0x%llx", workers, (unsigned long long)affinityMask);
+    } else if (workers > 0) {
+        blog(LOG_INFO, "[BandPool] %u conversion worker(s), OS-managed placement", workers);
+    }
+}
+
+void BandPool::start(uint32_t workers)
+{
+    m_stopping = false;
+    for (uint32_t i = 0; i < workers; i++) {
+        m_threads.emplace_back(&BandPool::workerMain, this, i);
+    }
+}
+
+void BandPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void BandPool::run(uint32_t bands, const BandFunction &fn)
+{
+    if (bands == 0) return;
+
+    if (m_threads.empty() || bands == 1) {
+        for (uint32_t band = 0; band < bands; band++) fn(band);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &fn;
+        m_bands = bands;
+        m_nextBand.store(0, std::memory_order_relaxed);
+        m_pending.store(bands, std::memory_order_relaxed);
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runBands(fn, bands);
+
+    // Wait for the last band, and for every worker to let go of `fn`
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0 && m_busy == 0; });
+    m_job = nullptr;
+}
+
+void BandPool::runBands(const BandFunction &fn, uint32_t bands)
+{
+    for (;;) {
+        const uint32_t band = m_nextBand.fetch_add(1, std::memory_order_relaxed);
+        if (band >= bands) return;
+
+        fn(band);
+
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_one();
+        }
+    }
+}
+
+void BandPool::workerMain(uint32_t index)
+{
+    const std::string name = "sl-convert-" + std::to_string(index);
+    os_set_thread_name(name.c_str());
+    applyWorkerPlacement(index, m_affinityMask);
+
+    uint64_t seen = 0;
+    for (;;) {
+        const BandFunction *job = nullptr;
+        uint32_t bands = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+
+            seen = m_generation;
+            // Woke after run() already finished this generation
+            if (!m_job) continue;
+            job = m_job;
+            bands = m_bands;
+            m_busy++;
+        }
+
+        runBands(*job, bands);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy--;
+        m_done.notify_one();
+    }
+}
+
+} // namespace StreamLumo
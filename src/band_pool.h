@@ -0,0 +1,75 @@
+/**
+ * StreamLumo Band Worker Pool - Header
+ *
+ * Small persistent thread pool that runs one frame's conversion as
+ * horizontal bands. The calling thread (normally OBS's video thread) takes
+ * part in the work and returns once every band has finished, so the frame
+ * can be published right after run().
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_BAND_POOL_H
+#define STREAMLUMO_BAND_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace StreamLumo {
+
+static constexpr uint32_t MAX_CONVERSION_THREADS = 16;
+
+class BandPool {
+public:
+    using BandFunction = std::function<void(uint32_t band)>;
+
+    BandPool();
+    ~BandPool();
+
+    /**
+     * Set the number of worker threads (0 = convert on the calling thread only)
+     *
+     * `affinityMask` pins workers to the given CPUs (bit n = CPU n) so they can
+     * be kept off the cores running OBS's render and encoder threads; 0 leaves
+     * placement to the OS. Workers are restarted if either value changes.
+     */
+    void configure(uint32_t workers, uint64_t affinityMask = 0);
+
+    uint32_t workerCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+    /**
+     * Run fn(0) ... fn(bands - 1) across the workers and the calling thread
+     * Returns once all bands have completed. Not reentrant.
+     */
+    void run(uint32_t bands, const BandFunction &fn);
+
+private:
+    void start(uint32_t workers);
+    void stop();
+    void workerMain(uint32_t index);
+    void runBands(const BandFunction &fn, uint32_t bands);
+
+    std::vector<std::thread> m_threads;
+    uint64_t m_affinityMask;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;         // Workers wait for a new generation
+    std::condition_variable m_done;         // run() waits for bands and workers to finish
+    const BandFunction *m_job;
+    uint32_t m_bands;
+    uint64_t m_generation;
+    uint32_t m_busy;                        // Workers currently holding m_job
+    bool m_stopping;
+
+    std::atomic<uint32_t> m_nextBand;
+    std::atomic<uint32_t> m_pending;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_BAND_POOL_H
@@ -0,0 +1,163 @@
+/**
+ * StreamLumo Change Detector - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "change_detector.h"
+
+#include <cstring>
+
+namespace StreamLumo {
+
+namespace {
+
+/**
+ * One plane of a source frame, in `units` samples of `unitBytes` per row
+ */
+struct PlaneShape {
+    uint32_t units;
+    uint32_t unitBytes;
+    uint32_t rows;
+};
+
+// Fill the planes of `format`; returns the plane count (0 = not supported)
+uint32_t planeShapes(enum video_format format, uint32_t width, uint32_t height, PlaneShape planes[MAX_PLANES])
+{
+    const uint32_t chromaWidth = (width + 1) / 2;
+    const uint32_t chromaHeight = (height + 1) / 2;
+
+    switch (format) {
+    case VIDEO_FORMAT_NV12:
+        planes[0] = { width, 1, height };
+        planes[1] = { chromaWidth, 2, chromaHeight };
+        return 2;
+    case VIDEO_FORMAT_I420:
+        planes[0] = { width, 1, height };
+        planes[1] = planes[2] = { chromaWidth, 1, chromaHeight };
+        return 3;
+    case VIDEO_FORMAT_RGBA:
+    case VIDEO_FORMAT_BGRA:
+    case VIDEO_FORMAT_BGRX:
+        planes[0] = { width, 4, height };
+        return 1;
+    case VIDEO_FORMAT_UYVY:
+    case VIDEO_FORMAT_YUY2:
+        planes[0] = { chromaWidth, 4, height };
+        return 1;
+    case VIDEO_FORMAT_Y800:
+        planes[0] = { width, 1, height };
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+inline uint64_t mix(uint64_t hash, uint64_t word)
+{
+    hash ^= word;
+    hash *= 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+uint64_t hashBytes(uint64_t hash, const uint8_t *bytes, size_t size)
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = mix(hash, word);
+    }
+
+    uint64_t tail = 0;
+    for (uint32_t shift = 0; i < size; i++, shift += 8) {
+        tail |= static_cast<uint64_t>(bytes[i]) << shift;
+    }
+    return size % sizeof(uint64_t) ? mix(hash, tail) : hash;
+}
+
+} // namespace
+
+ChangeDetector::ChangeDetector()
+{
+    reset();
+}
+
+void ChangeDetector::reset()
+{
+    memset(m_reference, 0, sizeof(m_reference));
+    memset(m_pending, 0, sizeof(m_pending));
+    memset(m_dirty, 0, sizeof(m_dirty));
+    m_referenceKey = 0;
+    m_pendingKey = 0;
+    m_dirtyCount = 0;
+    m_hasReference = false;
+    m_pendingValid = false;
+    m_pendingCompared = false;
+}
+
+bool ChangeDetector::analyze(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height,
+                             enum video_format format, uint64_t outputKey)
+{
+    m_pendingValid = false;
+    m_pendingCompared = false;
+
+    PlaneShape planes[MAX_PLANES];
+    const uint32_t planeCount = planeShapes(format, width, height, planes);
+    if (planeCount == 0) return false;
+    for (uint32_t p = 0; p < planeCount; p++) {
+        if (!data[p]) return false;
+    }
+
+    for (uint32_t t = 0; t < TILE_COUNT; t++) {
+        m_pending[t] = t + 1;
+    }
+
+    for (uint32_t p = 0; p < planeCount; p++) {
+        const PlaneShape &plane = planes[p];
+
+        // Tile column boundaries in bytes (whole samples only)
+        size_t columns[SL_DIRTY_GRID + 1];
+        for (uint32_t x = 0; x <= SL_DIRTY_GRID; x++) {
+            columns[x] = static_cast<size_t>(static_cast<uint64_t>(x) * plane.units / SL_DIRTY_GRID) * plane.unitBytes;
+        }
+
+        for (uint32_t y = 0; y < plane.rows; y += SAMPLE_ROW_STEP) {
+            const uint8_t *row = data[p] + static_cast<size_t>(y) * linesize[p];
+            uint64_t *tiles = m_pending + (static_cast<uint64_t>(y) * SL_DIRTY_GRID / plane.rows) * SL_DIRTY_GRID;
+            for (uint32_t x = 0; x < SL_DIRTY_GRID; x++) {
+                tiles[x] = hashBytes(tiles[x], row + columns[x], columns[x + 1] - columns[x]);
+            }
+        }
+    }
+
+    m_pendingKey = mix(mix(outputKey, (static_cast<uint64_t>(width) << 32) | height), static_cast<uint64_t>(format));
+    m_pendingValid = true;
+
+    // Without a matching reference every tile is new
+    m_pendingCompared = m_hasReference && m_referenceKey == m_pendingKey;
+    memset(m_dirty, 0, sizeof(m_dirty));
+    m_dirtyCount = 0;
+    for (uint32_t t = 0; t < TILE_COUNT; t++) {
+        if (!m_pendingCompared || m_pending[t] != m_reference[t]) {
+            m_dirty[t / 64] |= 1ull << (t % 64);
+            m_dirtyCount++;
+        }
+    }
+    return true;
+}
+
+void ChangeDetector::commit()
+{
+    if (!m_pendingValid) {
+        // The published frame was not analysed: there is nothing to compare with
+        m_hasReference = false;
+        return;
+    }
+    memcpy(m_reference, m_pending, sizeof(m_reference));
+    m_referenceKey = m_pendingKey;
+    m_hasReference = true;
+    m_pendingValid = false;
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,77 @@
+/**
+ * StreamLumo Change Detector - Header
+ *
+ * Cheap unchanged-frame detection for mostly static output (slides, BRB
+ * screens, paused scenes). Each source plane is split into the
+ * SL_DIRTY_GRID x SL_DIRTY_GRID tile grid of the shared header and every
+ * SAMPLE_ROW_STEP-th row of each tile is hashed; a frame whose tile hashes
+ * all match the last published frame can skip conversion and the shm write.
+ *
+ * Sampling can miss a change confined to skipped rows, so callers should
+ * still publish a full frame periodically.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_CHANGE_DETECTOR_H
+#define STREAMLUMO_CHANGE_DETECTOR_H
+
+#include <obs.h>
+#include <cstdint>
+
+#include "../include/shared_buffer.h"
+
+namespace StreamLumo {
+
+class ChangeDetector {
+public:
+    static constexpr uint32_t TILE_COUNT = SL_DIRTY_GRID * SL_DIRTY_GRID;
+    static constexpr uint32_t SAMPLE_ROW_STEP = 2;
+
+    ChangeDetector();
+
+    /**
+     * Forget the reference frame (the next frame counts as fully dirty)
+     */
+    void reset();
+
+    /**
+     * Hash a source frame and compare it with the reference frame
+     * `outputKey` identifies the published geometry/format; a different key
+     * than the reference's means every tile is dirty. Returns false if the
+     * source format cannot be analysed.
+     */
+    bool analyze(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height,
+                 enum video_format format, uint64_t outputKey);
+
+    /**
+     * Whether the last analyze() had a reference frame to compare against
+     */
+    bool hasReference() const { return m_pendingCompared; }
+
+    /**
+     * Tiles that differ from the reference (valid if hasReference())
+     */
+    const uint64_t *dirtyTiles() const { return m_dirty; }
+    uint32_t dirtyCount() const { return m_dirtyCount; }
+
+    /**
+     * Make the last analyzed frame the reference (call once it is published)
+     */
+    void commit();
+
+private:
+    uint64_t m_reference[TILE_COUNT];
+    uint64_t m_pending[TILE_COUNT];
+    uint64_t m_dirty[SL_DIRTY_WORDS];
+    uint64_t m_referenceKey;
+    uint64_t m_pendingKey;
+    uint32_t m_dirtyCount;
+    bool m_hasReference;
+    bool m_pendingValid;
+    bool m_pendingCompared;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_CHANGE_DETECTOR_H
@@ -0,0 +1,213 @@
+/**
+ * StreamLumo Channel Registry - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "channel_registry.h"
+#include "../include/shared_buffer.h"
+
+#ifdef _WIN32
+#include "shm_win32.h"
+#else
+#include "shm_posix.h"
+#endif
+
+#include <vector>
+
+namespace StreamLumo {
+
+namespace {
+
+// Live directory request, as read in one scan
+struct LiveRequest {
+    uint32_t serial;
+    std::string channel;
+    std::string source;
+};
+
+} // namespace
+
+ChannelRegistry::ChannelRegistry(WriterFactory factory)
+    : m_factory(factory)
+    , m_directory(nullptr)
+    , m_directoryGeneration(0)
+    , m_channelEpoch(0)
+    , m_retryTimer(RETRY_INTERVAL_S)
+{
+    m_directory = new DirectoryImpl();
+}
+
+ChannelRegistry::~ChannelRegistry()
+{
+    for (auto &entry : m_channels) {
+        entry.second.writer->stop();
+        delete entry.second.writer;
+    }
+    m_channels.clear();
+    m_requests.clear();
+
+    delete m_directory;
+    m_directory = nullptr;
+}
+
+void ChannelRegistry::reserve(const std::string &channel)
+{
+    m_reserved.insert(channel);
+}
+
+bool ChannelRegistry::acquire(const std::string &channel, const std::string &sourceName)
+{
+    if (channel.empty() || m_reserved.count(channel)) {
+        blog(LOG_WARNING, "[ChannelRegistry] Channel name '%s' is not available", channel.c_str());
+        return false;
+    }
+
+    auto it = m_channels.find(channel);
+    if (it != m_channels.end()) {
+        if (it->second.sourceName != sourceName) {
+            blog(LOG_WARNING, "[ChannelRegistry] Channel %s already captures '%s' (requested '%s')",
+                 channel.c_str(), it->second.sourceName.c_str(), sourceName.c_str());
+            return false;
+        }
+        it->second.refs++;
+        return true;
+    }
+
+    Channel created;
+    created.writer = m_factory(channel.c_str(), FrameWriter::MODE_SOURCE_CAPTURE);
+    created.sourceName = sourceName;
+    created.refs = 1;
+    created.active = false;
+    m_channels[channel] = created;
+
+    blog(LOG_INFO, "[ChannelRegistry] Channel %s created for source '%s' (%zu channel(s))",
+         channel.c_str(), sourceName.c_str(), m_channels.size());
+
+    // Connect right away; the consumer created the frame channel before asking
+    updateChannel(channel, m_channels[channel], true);
+    return true;
+}
+
+void ChannelRegistry::release(const std::string &channel)
+{
+    auto it = m_channels.find(channel);
+    if (it == m_channels.end()) return;
+    if (--it->second.refs > 0) return;
+
+    it->second.writer->stop();
+    delete it->second.writer;
+    m_channels.erase(it);
+
+    blog(LOG_INFO, "[ChannelRegistry] Channel %s destroyed (%zu channel(s))", channel.c_str(), m_channels.size());
+}
+
+void ChannelRegistry::tick(float seconds)
+{
+    m_retryTimer += seconds;
+    const bool retry = m_retryTimer >= RETRY_INTERVAL_S;
+    if (retry) m_retryTimer = 0.0f;
+
+    bool announced = false;
+    if (m_directory->isOpen() || (retry && m_directory->open())) {
+        if (retry) m_directory->expireStale();
+        
+        // A consumer created a frame channel: connect now, not on the next retry
+        const uint32_t epoch = m_directory->channelEpoch();
+        announced = (epoch != m_channelEpoch);
+        m_channelEpoch = epoch;
+
+        const uint32_t generation = m_directory->generation();
+        if (retry || generation != m_directoryGeneration) {
+            m_directoryGeneration = generation;
+            syncDirectory();
+        }
+    }
+
+    for (auto &entry : m_channels) {
+        updateChannel(entry.first, entry.second, retry || announced);
+    }
+}
+
+void ChannelRegistry::syncDirectory()
+{
+    // Snapshot of the live requests
+    std::map<uint32_t, LiveRequest> live;
+    for (uint32_t i = 0; i < SL_MAX_CHANNEL_REQUESTS; i++) {
+        LiveRequest request;
+        if (m_directory->readRequest(i, request.serial, request.channel, request.source)) {
+            live[i] = request;
+        }
+    }
+
+    // Withdrawn, expired or re-used entries
+    std::vector<std::string> released;
+    for (auto it = m_requests.begin(); it != m_requests.end();) {
+        auto current = live.find(it->first);
+        if (current != live.end() && current->second.serial == it->second.serial) {
+            ++it;
+            continue;
+        }
+        if (it->second.held) released.push_back(it->second.channel);
+        it = m_requests.erase(it);
+    }
+    for (const std::string &channel : released) {
+        release(channel);
+    }
+
+    // New requests (a refused one is remembered so it is not retried every scan)
+    for (const auto &entry : live) {
+        if (m_requests.count(entry.first)) continue;
+
+        Request request;
+        request.serial = entry.second.serial;
+        request.channel = entry.second.channel;
+        request.held = acquire(entry.second.channel, entry.second.source);
+        m_requests[entry.first] = request;
+    }
+}
+
+void ChannelRegistry::updateChannel(const std::string &name, Channel &channel, bool connect)
+{
+    FrameWriter *writer = channel.writer;
+
+    // Pause and reconfigure requests are handled by the writer between frames
+    if (!connect) return;
+
+    if (channel.active && writer->isChannelReplaced()) {
+        blog(LOG_INFO, "[ChannelRegistry] Channel %s was re-created by the consumer - reconnecting", name.c_str());
+        writer->stop();
+        channel.active = false;
+    }
+
+    if (!channel.active && writer->connect() && writer->start()) {
+        channel.active = true;
+        blog(LOG_INFO, "[ChannelRegistry] Channel %s started", name.c_str());
+    }
+
+    if (channel.active) {
+        attachSource(channel);
+    }
+}
+
+void ChannelRegistry::attachSource(Channel &channel)
+{
+    // Sources may be created after the request, or removed and re-added
+    if (channel.writer->hasSource()) return;
+
+    obs_source_t *source = obs_get_source_by_name(channel.sourceName.c_str());
+    if (source) {
+        channel.writer->setSource(source);
+        obs_source_release(source); // setSource adds its own ref
+        return;
+    }
+
+    // Don't keep rendering a removed source until one with the name comes back
+    obs_source_t *current = channel.writer->getSourceRef();
+    if (current) {
+        obs_source_release(current);
+        channel.writer->setSource(nullptr);
+    }
+}
+
+} // namespace StreamLumo
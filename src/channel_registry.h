@@ -0,0 +1,118 @@
+/**
+ * StreamLumo Channel Registry - Header
+ *
+ * Source-capture channels created on demand, one per named channel, for
+ * per-source feeds (cameras, browser sources) next to the fixed program and
+ * preview channels. Consumers ask for them through the shared channel
+ * directory (ChannelDirectory in shared_buffer.h); each active request is one
+ * reference, and a channel's writer is stopped and destroyed with its last
+ * reference. All channels render through the shared SourceRenderer, so a
+ * source used by several channels is rendered once per tick.
+ *
+ * All methods must be called from the OBS tick thread (or after its tick
+ * callbacks were removed).
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_CHANNEL_REGISTRY_H
+#define STREAMLUMO_CHANNEL_REGISTRY_H
+
+#include <obs.h>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+#include "frame_writer.h"
+
+namespace StreamLumo {
+    class ShmPosixDirectory;
+    class ShmWin32Directory;
+}
+
+namespace StreamLumo {
+
+#ifdef _WIN32
+using DirectoryImpl = ShmWin32Directory;
+#else
+using DirectoryImpl = ShmPosixDirectory;
+#endif
+
+class ChannelRegistry {
+public:
+    /**
+     * Creates a configured (not yet connected) writer for a channel
+     */
+    typedef FrameWriter *(*WriterFactory)(const char *channel, FrameWriter::Mode mode);
+
+    // Directory rescans, stale request expiry and connection retries
+    static constexpr float RETRY_INTERVAL_S = 2.0f;
+
+    explicit ChannelRegistry(WriterFactory factory);
+    ~ChannelRegistry();
+
+    /**
+     * Keep a channel name for a writer owned elsewhere (program, preview)
+     */
+    void reserve(const std::string &channel);
+
+    /**
+     * Take a reference on channel `channel` capturing OBS source `sourceName`
+     * The first reference creates the writer. Fails if the name is reserved
+     * or the channel already captures a different source.
+     */
+    bool acquire(const std::string &channel, const std::string &sourceName);
+
+    /**
+     * Drop a reference taken with acquire()
+     */
+    void release(const std::string &channel);
+
+    /**
+     * Follow the directory and keep every channel connected and capturing
+     */
+    void tick(float seconds);
+
+    size_t channelCount() const { return m_channels.size(); }
+    
+    /**
+     * Directory channel_epoch as of the last tick (0 until the directory is open)
+     * Changes whenever a consumer creates a frame channel.
+     */
+    uint32_t channelEpoch() const { return m_channelEpoch; }
+
+private:
+    struct Channel {
+        FrameWriter *writer;
+        std::string sourceName;
+        uint32_t refs;
+        bool active;                // Connected and capturing
+    };
+
+    /**
+     * Directory request we have seen (held = we took a reference for it)
+     */
+    struct Request {
+        uint32_t serial;
+        std::string channel;
+        bool held;
+    };
+
+    void syncDirectory();
+    void updateChannel(const std::string &name, Channel &channel, bool connect);
+    void attachSource(Channel &channel);
+
+    WriterFactory m_factory;
+    DirectoryImpl *m_directory;
+    uint32_t m_directoryGeneration;
+    uint32_t m_channelEpoch;
+    float m_retryTimer;
+    std::map<std::string, Channel> m_channels;
+    std::map<uint32_t, Request> m_requests;     // By directory index
+    std::set<std::string> m_reserved;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_CHANNEL_REGISTRY_H
@@ -0,0 +1,377 @@
+/**
+ * StreamLumo Encoded Writer - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "encoded_writer.h"
+#include "../include/shared_buffer.h"
+#include <cstring>
+
+namespace {
+
+/**
+ * Output private data: the writer is attached right after obs_output_create()
+ */
+struct EncodedOutput {
+    obs_output_t *output;
+    StreamLumo::EncodedWriter *writer;
+};
+
+/**
+ * Encoders to try, hardware first, for each codec (see pickEncoder())
+ */
+const char *const kPreferredEncoders[] = {
+    "obs_nvenc_h264_tex", "jim_nvenc", "ffmpeg_nvenc",
+    "obs_nvenc_hevc_tex", "jim_hevc_nvenc", "ffmpeg_hevc_nvenc",
+    "obs_nvenc_av1_tex", "jim_av1_nvenc",
+    "obs_qsv11_v2", "obs_qsv11", "obs_qsv11_hevc", "obs_qsv11_av1",
+    "com.apple.videotoolbox.videoencoder.ave.avc", "com.apple.videotoolbox.videoencoder.ave.hevc",
+    "h264_texture_amf", "h265_texture_amf", "av1_texture_amf",
+    "obs_x264",
+};
+
+const uint32_t kDefaultBitrateKbps = 6000;
+
+/**
+ * OBS codec name of a PacketCodec (SL_CODEC_ANY is H.264, which every consumer decodes)
+ */
+const char *codecName(uint32_t codec)
+{
+    switch (codec) {
+        case SL_CODEC_HEVC: return "hevc";
+        case SL_CODEC_AV1: return "av1";
+        default: return "h264";
+    }
+}
+
+/**
+ * PacketCodec of an OBS codec name
+ */
+uint32_t toPacketCodec(const char *codec)
+{
+    if (!codec) return SL_CODEC_ANY;
+    if (strcmp(codec, "h264") == 0) return SL_CODEC_H264;
+    if (strcmp(codec, "hevc") == 0) return SL_CODEC_HEVC;
+    if (strcmp(codec, "av1") == 0) return SL_CODEC_AV1;
+    return SL_CODEC_ANY;
+}
+
+/**
+ * First available encoder for `codec`: the preferred list, then any
+ * non-internal video encoder OBS knows of. nullptr if there is none.
+ */
+const char *pickEncoder(uint32_t codec)
+{
+    const char *wanted = codecName(codec);
+    for (const char *id : kPreferredEncoders) {
+        const char *encoderCodec = obs_get_encoder_codec(id);
+        if (encoderCodec && strcmp(encoderCodec, wanted) == 0) return id;
+    }
+
+    const char *id = nullptr;
+    for (size_t i = 0; obs_enum_encoder_types(i, &id); i++) {
+        if (obs_get_encoder_type(id) != OBS_ENCODER_VIDEO) continue;
+        if (obs_get_encoder_caps(id) & OBS_ENCODER_CAP_INTERNAL) continue;
+        const char *encoderCodec = obs_get_encoder_codec(id);
+        if (encoderCodec && strcmp(encoderCodec, wanted) == 0) return id;
+    }
+    return nullptr;
+}
+
+const char *EncodedOutputGetName(void *type_data)
+{
+    UNUSED_PARAMETER(type_data);
+    return "StreamLumo Encoded Output";
+}
+
+void *EncodedOutputCreate(obs_data_t *settings, obs_output_t *output)
+{
+    UNUSED_PARAMETER(settings);
+    EncodedOutput *data = new EncodedOutput();
+    data->output = output;
+    data->writer = nullptr;
+    return data;
+}
+
+void EncodedOutputDestroy(void *data)
+{
+    delete static_cast<EncodedOutput *>(data);
+}
+
+bool EncodedOutputStart(void *data)
+{
+    EncodedOutput *output = static_cast<EncodedOutput *>(data);
+    if (!output->writer) return false;
+    if (!obs_output_can_begin_data_capture(output->output, 0)) return false;
+    if (!obs_output_initialize_encoders(output->output, 0)) return false;
+
+    output->writer->beginSession();
+    return obs_output_begin_data_capture(output->output, 0);
+}
+
+void EncodedOutputStop(void *data, uint64_t ts)
+{
+    UNUSED_PARAMETER(ts);
+    obs_output_end_data_capture(static_cast<EncodedOutput *>(data)->output);
+}
+
+void EncodedOutputPacket(void *data, struct encoder_packet *packet)
+{
+    EncodedOutput *output = static_cast<EncodedOutput *>(data);
+    // OBS passes nullptr when the encoder failed
+    if (output->writer && packet) {
+        output->writer->writePacket(packet);
+    }
+}
+
+struct obs_output_info encoded_output_info = {};
+
+} // namespace
+
+// Register the output
+void RegisterEncodedOutput()
+{
+    encoded_output_info.id = "streamlumo_encoded_output";
+    encoded_output_info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED;
+    encoded_output_info.encoded_video_codecs = "h264;hevc;av1";
+    encoded_output_info.get_name = EncodedOutputGetName;
+    encoded_output_info.create = EncodedOutputCreate;
+    encoded_output_info.destroy = EncodedOutputDestroy;
+    encoded_output_info.start = EncodedOutputStart;
+    encoded_output_info.stop = EncodedOutputStop;
+    encoded_output_info.encoded_packet = EncodedOutputPacket;
+
+    obs_register_output(&encoded_output_info);
+}
+
+namespace StreamLumo {
+
+EncodedWriter::EncodedWriter(const std::string &channelName, const std::string &encoderId)
+    : m_channelName(channelName)
+    , m_encoderId(encoderId)
+    , m_packets(nullptr)
+    , m_sessionPublished(false)
+    , m_encoder(nullptr)
+    , m_output(nullptr)
+    , m_sinceSessionStart(KEYFRAME_RESTART_INTERVAL_S)
+    , m_packetsWritten(0)
+    , m_packetsDropped(0)
+{
+    m_packets = new PacketsImpl(channelName);
+}
+
+EncodedWriter::~EncodedWriter()
+{
+    stop();
+    delete m_packets;
+}
+
+/**
+ * Map the packet channel, dropping one the consumer re-created
+ */
+bool EncodedWriter::connect()
+{
+    if (m_packets->isConnected() && m_packets->isReplaced()) {
+        blog(LOG_INFO, "[EncodedWriter] Packet channel '%s' was re-created by the consumer - reconnecting",
+             m_channelName.c_str());
+        stop();
+    }
+    if (m_packets->isConnected()) return true;
+
+    bool connected;
+    {
+        std::lock_guard<std::mutex> lock(m_packetMutex);
+        connected = m_packets->connect();
+    }
+    if (!connected) return false;
+
+    const PacketRingBuffer *ring = m_packets->getBuffer();
+    blog(LOG_INFO, "[EncodedWriter] Connected to packet channel '%s' (%u MB ring, %s %ux%u, %u kbps requested)",
+         m_channelName.c_str(), ring->data_size / 1024 / 1024, codecName(ring->requested_codec),
+         ring->requested_width, ring->requested_height, ring->requested_bitrate_kbps);
+    return true;
+}
+
+/**
+ * Create the encoder and output for the channel's request
+ */
+bool EncodedWriter::createEncoder()
+{
+    const PacketRingBuffer *ring = m_packets->getBuffer();
+    const char *id = m_encoderId.empty() ? pickEncoder(ring->requested_codec) : m_encoderId.c_str();
+    if (!id) {
+        blog(LOG_WARNING, "[EncodedWriter] No %s encoder available for '%s'",
+             codecName(ring->requested_codec), m_channelName.c_str());
+        return false;
+    }
+
+    // Low latency: constant bitrate, no B-frames, short GOP
+    const uint32_t keyintMs = ring->requested_keyint_ms;
+    obs_data_t *settings = obs_data_create();
+    obs_data_set_string(settings, "rate_control", "CBR");
+    obs_data_set_int(settings, "bitrate", ring->requested_bitrate_kbps ? ring->requested_bitrate_kbps : kDefaultBitrateKbps);
+    obs_data_set_int(settings, "keyint_sec", keyintMs ? (keyintMs + 999) / 1000 : 1);
+    obs_data_set_int(settings, "bf", 0);
+    obs_data_set_string(settings, "tune", "zerolatency");
+
+    const std::string name = "streamlumo_encoder_" + m_channelName;
+    m_encoder = obs_video_encoder_create(id, name.c_str(), settings, nullptr);
+    obs_data_release(settings);
+    if (!m_encoder) {
+        blog(LOG_WARNING, "[EncodedWriter] Failed to create encoder '%s' for '%s'", id, m_channelName.c_str());
+        return false;
+    }
+    obs_encoder_set_video(m_encoder, obs_get_video());
+    if (ring->requested_width && ring->requested_height) {
+        obs_encoder_set_scaled_size(m_encoder, ring->requested_width, ring->requested_height);
+    }
+
+    const std::string outputName = "streamlumo_encoded_" + m_channelName;
+    m_output = obs_output_create("streamlumo_encoded_output", outputName.c_str(), nullptr, nullptr);
+    if (!m_output) {
+        blog(LOG_WARNING, "[EncodedWriter] Failed to create output for '%s'", m_channelName.c_str());
+        releaseEncoder();
+        return false;
+    }
+    static_cast<EncodedOutput *>(obs_obj_get_data(m_output))->writer = this;
+    obs_output_set_video_encoder(m_output, m_encoder);
+
+    blog(LOG_INFO, "[EncodedWriter] Encoding '%s' with %s", m_channelName.c_str(), id);
+    return true;
+}
+
+/**
+ * Release the output (stopping it) and the encoder
+ */
+void EncodedWriter::releaseEncoder()
+{
+    if (m_output) {
+        if (obs_output_active(m_output)) {
+            obs_output_stop(m_output);
+        }
+        obs_output_release(m_output);
+        m_output = nullptr;
+    }
+    if (m_encoder) {
+        obs_encoder_release(m_encoder);
+        m_encoder = nullptr;
+    }
+}
+
+/**
+ * Start an encoder session; it opens with a keyframe, answering every request so far
+ */
+bool EncodedWriter::startSession()
+{
+    m_sinceSessionStart = 0.0f;
+
+    uint32_t request = 0;
+    const bool requested = m_packets->pendingKeyframeRequest(request);
+    if (!obs_output_start(m_output)) {
+        const char *error = obs_output_get_last_error(m_output);
+        blog(LOG_WARNING, "[EncodedWriter] Failed to start encoding '%s': %s", m_channelName.c_str(),
+             error ? error : "unknown error");
+        return false;
+    }
+    if (requested) {
+        m_packets->keyframeServed(request);
+    }
+    return true;
+}
+
+/**
+ * Follow the consumer: encode while it reads, restart for keyframe requests
+ */
+void EncodedWriter::tick(float seconds)
+{
+    if (!m_packets->isConnected()) return;
+    m_sinceSessionStart += seconds;
+
+    const bool active = m_output && obs_output_active(m_output);
+    if (!m_packets->hasConsumer()) {
+        if (active) {
+            blog(LOG_INFO, "[EncodedWriter] No reader on '%s' - encoder stopped", m_channelName.c_str());
+            obs_output_stop(m_output);
+        }
+        return;
+    }
+
+    // A stopped output stays active until OBS has drained it; start again after that
+    if (m_sinceSessionStart < KEYFRAME_RESTART_INTERVAL_S) return;
+
+    uint32_t request = 0;
+    if (active) {
+        if (m_packets->pendingKeyframeRequest(request)) {
+            obs_output_stop(m_output);
+        }
+        return;
+    }
+
+    if (!m_output && !createEncoder()) {
+        m_sinceSessionStart = 0.0f;
+        return;
+    }
+    startSession();
+}
+
+/**
+ * Stop encoding and unmap the channel
+ */
+void EncodedWriter::stop()
+{
+    releaseEncoder();
+
+    std::lock_guard<std::mutex> lock(m_packetMutex);
+    if (m_packets->isConnected()) {
+        blog(LOG_INFO, "[EncodedWriter] '%s': %llu packets written, %llu too large for the ring",
+             m_channelName.c_str(), (unsigned long long)m_packetsWritten, (unsigned long long)m_packetsDropped);
+    }
+    m_packets->disconnect();
+    m_packetsWritten = 0;
+    m_packetsDropped = 0;
+}
+
+/**
+ * The stream info goes out with the session's first packet
+ */
+void EncodedWriter::beginSession()
+{
+    std::lock_guard<std::mutex> lock(m_packetMutex);
+    m_sessionPublished = false;
+}
+
+/**
+ * Append a packet to the ring (output packet thread)
+ */
+void EncodedWriter::writePacket(struct encoder_packet *packet)
+{
+    if (packet->type != OBS_ENCODER_VIDEO) return;
+
+    std::lock_guard<std::mutex> lock(m_packetMutex);
+    if (!m_packets->isConnected()) return;
+
+    if (!m_sessionPublished) {
+        uint8_t *extraData = nullptr;
+        size_t extraDataSize = 0;
+        obs_encoder_get_extra_data(packet->encoder, &extraData, &extraDataSize);
+
+        struct obs_video_info ovi = {};
+        obs_get_video_info(&ovi);
+        m_packets->publishStreamInfo(toPacketCodec(obs_encoder_get_codec(packet->encoder)),
+                                     obs_encoder_get_width(packet->encoder), obs_encoder_get_height(packet->encoder),
+                                     ovi.fps_num, ovi.fps_den, packet->timebase_num, packet->timebase_den,
+                                     extraData, extraDataSize);
+        m_sessionPublished = true;
+    }
+
+    // sys_dts_usec is os_gettime_ns() of the frame, the clock capture times use
+    if (m_packets->writePacket(packet->data, packet->size, packet->pts, packet->dts, packet->keyframe,
+                               static_cast<uint64_t>(packet->sys_dts_usec) * 1000)) {
+        m_packetsWritten++;
+    } else {
+        m_packetsDropped++;
+    }
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,110 @@
+/**
+ * StreamLumo Encoded Writer - Header
+ *
+ * Compressed companion of a frame channel for consumers on another machine:
+ * the frames OBS renders for its output go through an OBS video encoder
+ * (NVENC, QSV, VideoToolbox or AMF, x264 as a fallback) and every packet is
+ * appended to the channel's packet ring (PacketRingBuffer in
+ * shared_buffer.h), from where a relay forwards it off the machine.
+ *
+ * The encoder only runs while the consumer keeps the ring's heartbeat fresh.
+ * OBS has no call to force a keyframe in a running encoder, so a consumer's
+ * keyframe request restarts the encoder session, which begins with one
+ * (at most once per KEYFRAME_RESTART_INTERVAL_S).
+ *
+ * connect(), tick() and stop() must be called from the OBS tick thread.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_ENCODED_WRITER_H
+#define STREAMLUMO_ENCODED_WRITER_H
+
+#include <obs.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include "shm_win32.h"
+#else
+#include "shm_posix.h"
+#endif
+
+/**
+ * Register the "streamlumo_encoded_output" output type (obs_module_load)
+ */
+void RegisterEncodedOutput();
+
+namespace StreamLumo {
+
+#ifdef _WIN32
+using PacketsImpl = ShmWin32Packets;
+#else
+using PacketsImpl = ShmPosixPackets;
+#endif
+
+class EncodedWriter {
+public:
+    // Minimum time between encoder sessions (keyframe requests and start retries)
+    static constexpr float KEYFRAME_RESTART_INTERVAL_S = 1.0f;
+
+    /**
+     * @param channelName Packet channel to feed (SHM_PACKET_NAME "_" channelName)
+     * @param encoderId OBS encoder to use; empty picks one for the requested codec
+     */
+    EncodedWriter(const std::string &channelName, const std::string &encoderId);
+    ~EncodedWriter();
+
+    /**
+     * Map the packet channel once the consumer created it
+     * Drops a mapping the consumer has since replaced; returns whether connected.
+     */
+    bool connect();
+
+    /**
+     * Start or stop encoding with the consumer's heartbeat and answer keyframe requests
+     */
+    void tick(float seconds);
+
+    /**
+     * Stop encoding and unmap the packet channel
+     */
+    void stop();
+
+    bool isConnected() const { return m_packets->isConnected(); }
+
+    /**
+     * A new encoder session begins (output start callback)
+     */
+    void beginSession();
+
+    /**
+     * Append one packet of the current session (output encoded_packet callback)
+     */
+    void writePacket(struct encoder_packet *packet);
+
+private:
+    // Create the encoder and output for the stream the channel asks for
+    bool createEncoder();
+    void releaseEncoder();
+
+    // Start a new encoder session; false (retried later) if OBS refused
+    bool startSession();
+
+    std::string m_channelName;
+    std::string m_encoderId;                 // Forced encoder, empty = by requested codec
+    PacketsImpl *m_packets;
+    std::mutex m_packetMutex;                // m_packets against the output's packet thread
+    bool m_sessionPublished;                 // Stream info of the current session was published
+
+    obs_encoder_t *m_encoder;
+    obs_output_t *m_output;
+    float m_sinceSessionStart;               // Seconds since the last start attempt
+    uint64_t m_packetsWritten;
+    uint64_t m_packetsDropped;               // Larger than the whole packet ring
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_ENCODED_WRITER_H
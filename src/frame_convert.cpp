@@ -0,0 +1,370 @@
+/**
+ * StreamLumo Frame Conversion - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "frame_convert.h"
+#include "pixel_convert.h"
+
+#include <cstring>
+
+namespace StreamLumo {
+
+namespace {
+
+/**
+ * Check that the planes source layout S reads are present
+ */
+template <SourceFormat S>
+bool hasPlanes(const SourceFrame &src)
+{
+    const uint8_t *const *data = src.data;
+    const uint32_t *linesize = src.linesize;
+    if constexpr (S == SOURCE_FORMAT_I420) {
+        return data[0] && data[1] && data[2] && linesize[0] && linesize[1] && linesize[2];
+    } else if constexpr (S == SOURCE_FORMAT_NV12) {
+        return data[0] && data[1] && linesize[0] && linesize[1];
+    } else {
+        return data[0] != nullptr;
+    }
+}
+
+/**
+ * Source rows that already are in the destination layout
+ */
+template <SourceFormat S, PackedFormat D>
+constexpr bool isPassthrough()
+{
+    return (S == SOURCE_FORMAT_RGBA && D == PACKED_FORMAT_RGBA) || (S == SOURCE_FORMAT_BGRA && D == PACKED_FORMAT_BGRA);
+}
+
+template <SourceFormat S>
+constexpr bool hasAlpha()
+{
+    return S == SOURCE_FORMAT_RGBA || S == SOURCE_FORMAT_BGRA;
+}
+
+/**
+ * Convert source row `y` into src.width pixels of layout D
+ * YUV rows decode to opaque RGBA, so RGBX and premultiplied RGBA need no
+ * extra pass for them.
+ */
+template <SourceFormat S, PackedFormat D>
+void convertSourceRow(const SourceFrame &src, const ConvertKernels &kernels, const YuvMatrix &matrix, uint32_t y,
+                      uint8_t *dst)
+{
+    const uint8_t *const *data = src.data;
+    const uint32_t *linesize = src.linesize;
+    const uint32_t width = src.width;
+    const uint8_t *row = data[0] + (size_t)y * linesize[0];
+    
+    if constexpr (hasAlpha<S>()) {
+        // RGBA <-> BGRA (the swap is symmetric), then the alpha pass on the result
+        constexpr bool swap = (S == SOURCE_FORMAT_BGRA) != (D == PACKED_FORMAT_BGRA);
+        if constexpr (swap) kernels.bgraToRgba(row, dst, width);
+        if constexpr (D == PACKED_FORMAT_RGBA_PREMULTIPLIED) {
+            kernels.premultiplyRgba(swap ? dst : row, dst, width);
+        } else if constexpr (D == PACKED_FORMAT_RGBX) {
+            kernels.opaqueRgba(swap ? dst : row, dst, width);
+        } else if constexpr (!swap) {
+            // Drop the row padding
+            std::memcpy(dst, row, (size_t)width * 4);
+        }
+    } else {
+        if constexpr (S == SOURCE_FORMAT_I420) {
+            kernels.i420ToRgba(row, data[1] + (size_t)(y / 2) * linesize[1], data[2] + (size_t)(y / 2) * linesize[2],
+                               dst, width, matrix);
+        } else if constexpr (S == SOURCE_FORMAT_NV12) {
+            kernels.nv12ToRgba(row, data[1] + (size_t)(y / 2) * linesize[1], dst, width, matrix);
+        } else if constexpr (S == SOURCE_FORMAT_UYVY) {
+            kernels.uyvyToRgba(row, dst, width, matrix);
+        } else if constexpr (S == SOURCE_FORMAT_YUY2) {
+            kernels.yuy2ToRgba(row, dst, width, matrix);
+        } else {
+            kernels.y800ToRgba(row, dst, width, matrix);
+        }
+        if constexpr (D == PACKED_FORMAT_BGRA) kernels.bgraToRgba(dst, dst, width);
+    }
+}
+
+/**
+ * Source row `y` in layout D for the scaler, converted at most once per band
+ * The rows of one filter window are consecutive, so with more slots than
+ * taps `y % slots` never evicts a row the current window still needs.
+ */
+template <SourceFormat S, PackedFormat D>
+const uint8_t *convertedRow(const SourceFrame &src, const ConvertKernels &kernels, const YuvMatrix &matrix, uint32_t y,
+                            ScaleScratch &scratch)
+{
+    if constexpr (isPassthrough<S, D>()) return src.data[0] + (size_t)y * src.linesize[0];
+
+    const size_t slot = y % scratch.convertedRow.size();
+    uint8_t *row = scratch.converted.data() + slot * src.width * 4;
+    if (scratch.convertedRow[slot] != (int64_t)y) {
+        convertSourceRow<S, D>(src, kernels, matrix, y, row);
+        scratch.convertedRow[slot] = y;
+    }
+    return row;
+}
+
+/**
+ * PackedConverter for source layout S, destination layout D, scaled or not
+ */
+template <SourceFormat S, PackedFormat D, bool Scaled>
+bool convertPackedRows(const SourceFrame &src, const ScalePlan &scale, uint8_t *dstBuffer, uint32_t dstWidth,
+                       uint32_t dstHeight, uint32_t rowBegin, uint32_t rowEnd)
+{
+    const uint32_t width = src.width;
+    const uint32_t height = src.height;
+    if (width == 0 || height == 0 || dstWidth == 0 || dstHeight == 0 || !hasPlanes<S>(src)) {
+        return false;
+    }
+    
+    const ConvertKernels &kernels = GetConvertKernels();
+    const YuvMatrix &matrix = src.matrix ? *src.matrix : GetYuvMatrix(COLOR_MATRIX_BT601, COLOR_RANGE_FULL);
+    const size_t dstStride = (size_t)dstWidth * 4;
+    
+    // Unscaled frames go straight through the row kernels (SIMD when available)
+    if constexpr (!Scaled) {
+        if (width != dstWidth || height != dstHeight) return false;
+        if (isPassthrough<S, D>() && src.linesize[0] == dstStride) {
+            // Fast memcpy - no conversion, no stride conversion needed
+            std::memcpy(dstBuffer + rowBegin * dstStride, src.data[0] + rowBegin * dstStride,
+                        dstStride * (rowEnd - rowBegin));
+            return true;
+        }
+        for (uint32_t y = rowBegin; y < rowEnd; y++) {
+            convertSourceRow<S, D>(src, kernels, matrix, y, dstBuffer + y * dstStride);
+        }
+        return true;
+    } else {
+        // Convert the source rows each destination row filters, then resample
+        if (!scale.image.matches(width, height, dstWidth, dstHeight)) return false;
+        
+        static thread_local ScaleScratch scratch;
+        const size_t slots = scale.image.vertical().taps + 2;
+        scratch.converted.resize(slots * width * 4);
+        scratch.convertedRow.assign(slots, -1);
+        
+        auto sourceRow = [&](uint32_t y) { return convertedRow<S, D>(src, kernels, matrix, y, scratch); };
+        for (uint32_t y = rowBegin; y < rowEnd; y++) {
+            scale.image.scaleRow(y, 4, sourceRow, dstBuffer + y * dstStride, scratch);
+        }
+        return true;
+    }
+}
+
+/**
+ * PackedConverter for SOURCE_FORMAT_UNKNOWN: fill with red to indicate the error
+ */
+template <PackedFormat D>
+bool fillUnknownRows(const SourceFrame &src, const ScalePlan &, uint8_t *dstBuffer, uint32_t dstWidth,
+                     uint32_t dstHeight, uint32_t rowBegin, uint32_t rowEnd)
+{
+    if (src.width == 0 || src.height == 0 || dstWidth == 0 || dstHeight == 0 || !src.data[0]) {
+        return false;
+    }
+    
+    const uint8_t red[4] = { D == PACKED_FORMAT_BGRA ? (uint8_t)0 : (uint8_t)255, 0,
+                             D == PACKED_FORMAT_BGRA ? (uint8_t)255 : (uint8_t)0, 255 };
+    const size_t dstStride = (size_t)dstWidth * 4;
+    for (uint32_t y = rowBegin; y < rowEnd; y++) {
+        uint8_t *dst_row = dstBuffer + y * dstStride;
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            std::memcpy(dst_row + x * 4, red, sizeof(red));
+        }
+    }
+    return false;
+}
+
+template <SourceFormat S, PackedFormat D>
+PackedConverter packedConverterFor(bool scaled)
+{
+    return scaled ? convertPackedRows<S, D, true> : convertPackedRows<S, D, false>;
+}
+
+template <SourceFormat S>
+PackedConverter packedConverterFor(PackedFormat dst, bool scaled)
+{
+    switch (dst) {
+        case PACKED_FORMAT_RGBA: return packedConverterFor<S, PACKED_FORMAT_RGBA>(scaled);
+        case PACKED_FORMAT_BGRA: return packedConverterFor<S, PACKED_FORMAT_BGRA>(scaled);
+        case PACKED_FORMAT_RGBX: return packedConverterFor<S, PACKED_FORMAT_RGBX>(scaled);
+        case PACKED_FORMAT_RGBA_PREMULTIPLIED: return packedConverterFor<S, PACKED_FORMAT_RGBA_PREMULTIPLIED>(scaled);
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void ScalePlan::configure(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter)
+{
+    image.configure(srcWidth, srcHeight, dstWidth, dstHeight, filter);
+    chroma.configure((srcWidth + 1) / 2, (srcHeight + 1) / 2, (dstWidth + 1) / 2, (dstHeight + 1) / 2, filter);
+}
+
+PackedConverter selectPackedConverter(SourceFormat source, PackedFormat dst, bool scaled)
+{
+    switch (source) {
+        case SOURCE_FORMAT_I420: return packedConverterFor<SOURCE_FORMAT_I420>(dst, scaled);
+        case SOURCE_FORMAT_NV12: return packedConverterFor<SOURCE_FORMAT_NV12>(dst, scaled);
+        case SOURCE_FORMAT_YUY2: return packedConverterFor<SOURCE_FORMAT_YUY2>(dst, scaled);
+        case SOURCE_FORMAT_UYVY: return packedConverterFor<SOURCE_FORMAT_UYVY>(dst, scaled);
+        case SOURCE_FORMAT_Y800: return packedConverterFor<SOURCE_FORMAT_Y800>(dst, scaled);
+        case SOURCE_FORMAT_RGBA: return packedConverterFor<SOURCE_FORMAT_RGBA>(dst, scaled);
+        case SOURCE_FORMAT_BGRA: return packedConverterFor<SOURCE_FORMAT_BGRA>(dst, scaled);
+        case SOURCE_FORMAT_UNKNOWN:
+            return dst == PACKED_FORMAT_BGRA ? fillUnknownRows<PACKED_FORMAT_BGRA> : fillUnknownRows<PACKED_FORMAT_RGBA>;
+    }
+    return nullptr;
+}
+
+bool convertRowsToRgba(const SourceFrame &src, const ScalePlan &scale, uint8_t *rgbaBuffer, uint32_t dstWidth,
+                       uint32_t dstHeight, uint32_t rowBegin, uint32_t rowEnd)
+{
+    const bool scaled = (src.width != dstWidth || src.height != dstHeight);
+    const PackedConverter convert = selectPackedConverter(src.format, PACKED_FORMAT_RGBA, scaled);
+    return convert(src, scale, rgbaBuffer, dstWidth, dstHeight, rowBegin, rowEnd);
+}
+
+bool convertFrameToPlanar(const SourceFrame &src, const ScalePlan &scale, const PlanarFrame &dst, ScaleScratch &scratch)
+{
+    const uint8_t *const *data = src.data;
+    const uint32_t *linesize = src.linesize;
+    const uint32_t width = src.width;
+    const uint32_t height = src.height;
+    const SourceFormat format = src.format;
+    const bool dstNV12 = dst.nv12;
+    const uint32_t dstWidth = dst.width;
+    const uint32_t dstHeight = dst.height;
+    if (width == 0 || height == 0 || dstWidth == 0 || dstHeight == 0 || !data[0]) {
+        return false;
+    }
+    
+    uint8_t *dstY = dst.y;
+    uint8_t *dstU = dst.u;
+    uint8_t *dstV = dst.v;
+    const uint32_t yStride = dst.yStride;
+    const uint32_t uvStride = dst.uvStride;
+    const uint32_t chromaStep = dstNV12 ? 2 : 1;
+    const uint32_t chromaWidth = (dstWidth + 1) / 2;
+    const uint32_t chromaHeight = (dstHeight + 1) / 2;
+    
+    const bool unscaled = (width == dstWidth && height == dstHeight);
+    const ConvertKernels &kernels = GetConvertKernels();
+    
+    switch (format) {
+        case SOURCE_FORMAT_NV12:
+        case SOURCE_FORMAT_I420:
+            {
+                const bool srcNV12 = (format == SOURCE_FORMAT_NV12);
+                const uint8_t *srcU = data[1];
+                const uint8_t *srcV = srcNV12 ? data[1] + 1 : data[2];
+                const uint32_t uLinesize = linesize[1];
+                const uint32_t vLinesize = srcNV12 ? linesize[1] : linesize[2];
+                if (!data[1] || (!srcNV12 && !data[2])) {
+                    return false;
+                }
+                
+                if (unscaled) {
+                    for (uint32_t y = 0; y < height; y++) {
+                        std::memcpy(dstY + (size_t)y * yStride, data[0] + (size_t)y * linesize[0], width);
+                    }
+                    
+                    for (uint32_t y = 0; y < chromaHeight; y++) {
+                        const uint8_t *uRow = srcU + (size_t)y * uLinesize;
+                        const uint8_t *vRow = srcV + (size_t)y * vLinesize;
+                        uint8_t *dstURow = dstU + (size_t)y * uvStride;
+                        uint8_t *dstVRow = dstV + (size_t)y * uvStride;
+                        
+                        if (srcNV12 && dstNV12) {
+                            std::memcpy(dstURow, uRow, chromaWidth * 2);
+                        } else if (srcNV12) {
+                            kernels.splitUv(uRow, dstURow, dstVRow, chromaWidth);
+                        } else if (dstNV12) {
+                            kernels.interleaveUv(uRow, vRow, dstURow, chromaWidth);
+                        } else {
+                            std::memcpy(dstURow, uRow, chromaWidth);
+                            std::memcpy(dstVRow, vRow, chromaWidth);
+                        }
+                    }
+                    break;
+                }
+                
+                // Luma and chroma planes are filtered separately
+                if (!scale.image.matches(width, height, dstWidth, dstHeight)) return false;
+                for (uint32_t y = 0; y < dstHeight; y++) {
+                    scale.image.scaleRow(y, 1, [&](uint32_t row) { return data[0] + (size_t)row * linesize[0]; },
+                                         dstY + (size_t)y * yStride, scratch);
+                }
+                
+                auto uRows = [&](uint32_t row) { return srcU + (size_t)row * uLinesize; };
+                auto vRows = [&](uint32_t row) { return srcV + (size_t)row * vLinesize; };
+                scratch.output.resize((size_t)chromaWidth * 2);
+                uint8_t *uv = scratch.output.data();
+                for (uint32_t y = 0; y < chromaHeight; y++) {
+                    uint8_t *dstURow = dstU + (size_t)y * uvStride;
+                    uint8_t *dstVRow = dstV + (size_t)y * uvStride;
+                    
+                    if (srcNV12 && dstNV12) {
+                        scale.chroma.scaleRow(y, 2, uRows, dstURow, scratch);
+                    } else if (srcNV12) {
+                        scale.chroma.scaleRow(y, 2, uRows, uv, scratch);
+                        kernels.splitUv(uv, dstURow, dstVRow, chromaWidth);
+                    } else if (dstNV12) {
+                        scale.chroma.scaleRow(y, 1, uRows, uv, scratch);
+                        scale.chroma.scaleRow(y, 1, vRows, uv + chromaWidth, scratch);
+                        kernels.interleaveUv(uv, uv + chromaWidth, dstURow, chromaWidth);
+                    } else {
+                        scale.chroma.scaleRow(y, 1, uRows, dstURow, scratch);
+                        scale.chroma.scaleRow(y, 1, vRows, dstVRow, scratch);
+                    }
+                }
+            }
+            break;
+            
+        case SOURCE_FORMAT_RGBA:
+        case SOURCE_FORMAT_BGRA:
+            {
+                const bool bgra = (format == SOURCE_FORMAT_BGRA);
+                const YuvMatrix &matrix = src.matrix ? *src.matrix : GetYuvMatrix(COLOR_MATRIX_BT601, COLOR_RANGE_FULL);
+                
+                // Scaled frames are resampled two rows at a time into scratch rows first
+                if (!unscaled) {
+                    if (!scale.image.matches(width, height, dstWidth, dstHeight)) return false;
+                    scratch.output.resize((size_t)dstWidth * 4 * 2);
+                }
+                
+                auto sourceRow = [&](uint32_t y, uint8_t *rows) -> const uint8_t * {
+                    if (unscaled) return data[0] + (size_t)y * linesize[0];
+                    
+                    scale.image.scaleRow(y, 4, [&](uint32_t row) { return data[0] + (size_t)row * linesize[0]; },
+                                         rows, scratch);
+                    return rows;
+                };
+                
+                for (uint32_t y = 0; y < dstHeight; y += 2) {
+                    const bool hasSecondRow = (y + 1 < dstHeight);
+                    uint8_t *rows = scratch.output.data();
+                    const uint8_t *row0 = sourceRow(y, rows);
+                    const uint8_t *row1 = hasSecondRow ? sourceRow(y + 1, rows + (size_t)dstWidth * 4) : nullptr;
+                    
+                    rgbaToYuv420Rows(row0, row1, bgra,
+                                     dstY + (size_t)y * yStride,
+                                     hasSecondRow ? dstY + (size_t)(y + 1) * yStride : nullptr,
+                                     dstU + (size_t)(y / 2) * uvStride,
+                                     dstV + (size_t)(y / 2) * uvStride,
+                                     chromaStep, dstWidth, matrix);
+                }
+            }
+            break;
+            
+        default:
+            return false;
+    }
+    
+    return true;
+}
+
+} // namespace StreamLumo
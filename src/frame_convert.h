@@ -0,0 +1,129 @@
+/**
+ * StreamLumo Frame Conversion - Header
+ *
+ * Whole-frame conversion of a source frame into a channel slot: packed
+ * RGBA/BGRA/RGBX/premultiplied RGBA (banded) or NV12/I420 planes, scaled
+ * with the tables in frame_scale.h.
+ * Built on the row kernels in pixel_convert.h and independent of libobs, so
+ * it can be linked into the benchmarks; FrameWriter maps OBS video formats
+ * onto SourceFormat and reports failures.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_FRAME_CONVERT_H
+#define STREAMLUMO_FRAME_CONVERT_H
+
+#include "frame_scale.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace StreamLumo {
+
+/**
+ * Pixel layouts a source frame can arrive in
+ */
+enum SourceFormat {
+    SOURCE_FORMAT_UNKNOWN,
+    SOURCE_FORMAT_I420,
+    SOURCE_FORMAT_NV12,
+    SOURCE_FORMAT_YUY2,
+    SOURCE_FORMAT_UYVY,
+    SOURCE_FORMAT_Y800,
+    SOURCE_FORMAT_RGBA,
+    SOURCE_FORMAT_BGRA
+};
+
+/**
+ * Packed 4-byte layouts a channel slot can take
+ */
+enum PackedFormat {
+    PACKED_FORMAT_RGBA,
+    PACKED_FORMAT_BGRA,
+    PACKED_FORMAT_RGBX,                 // RGBA with alpha forced to 255
+    PACKED_FORMAT_RGBA_PREMULTIPLIED    // RGB multiplied by alpha
+};
+
+struct YuvMatrix;
+
+/**
+ * A source frame: up to three planes with their strides
+ * YUV layouts are decoded, and RGB encoded to planar channels, with
+ * `matrix` (null = BT.601 full range).
+ */
+struct SourceFrame {
+    const uint8_t *const *data;
+    const uint32_t *linesize;
+    uint32_t width;
+    uint32_t height;
+    SourceFormat format;
+    const YuvMatrix *matrix;
+};
+
+/**
+ * Destination planes in a planar (NV12/I420) channel slot
+ * For NV12 `v` is `u + 1`; chroma samples are then 2 bytes apart.
+ */
+struct PlanarFrame {
+    uint8_t *y;
+    uint8_t *u;
+    uint8_t *v;
+    uint32_t yStride;
+    uint32_t uvStride;
+    uint32_t width;
+    uint32_t height;
+    bool nv12;
+};
+
+/**
+ * Scaling tables for one source -> channel geometry
+ * Configured once per geometry change and then only read, so every band
+ * of a frame shares it.
+ */
+struct ScalePlan {
+    FrameScaler image;          // Full-resolution planes (RGBA, luma)
+    FrameScaler chroma;         // 4:2:0 chroma planes
+
+    void configure(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter);
+};
+
+/**
+ * Convert destination rows [rowBegin, rowEnd) of `src` into a tightly packed
+ * dstWidth x dstHeight frame of one PackedFormat
+ * Scaled frames are converted at source size (alpha already premultiplied)
+ * and then filtered with `scale`, which must be configured for this
+ * geometry. Each destination row only reads source rows, so bands can run in
+ * parallel. Returns false (rows left untouched, or filled red for an unknown
+ * format) if the frame can't be converted.
+ */
+typedef bool (*PackedConverter)(const SourceFrame &src, const ScalePlan &scale, uint8_t *dst, uint32_t dstWidth,
+                                uint32_t dstHeight, uint32_t rowBegin, uint32_t rowEnd);
+
+/**
+ * Pick the converter specialised for one source layout, destination layout
+ * and scaling on/off
+ * Chosen once per frame geometry, so the row loops carry no format branches.
+ * An unscaled converter only accepts frames of the destination size.
+ */
+PackedConverter selectPackedConverter(SourceFormat source, PackedFormat dst, bool scaled);
+
+/**
+ * Convert rows of `src` into RGBA, selecting the converter for this call
+ */
+bool convertRowsToRgba(const SourceFrame &src, const ScalePlan &scale, uint8_t *dst, uint32_t dstWidth,
+                       uint32_t dstHeight, uint32_t rowBegin, uint32_t rowEnd);
+
+/**
+ * Write `src` into planar channel planes, scaling to dst.width x dst.height
+ * NV12 and I420 are copied plane by plane (repacking chroma if the layouts
+ * differ); RGBA/BGRA are encoded with `src.matrix`. Scaled frames are filtered
+ * with `scale`, using `scratch` for intermediate rows. Returns false for
+ * other formats or missing planes.
+ */
+bool convertFrameToPlanar(const SourceFrame &src, const ScalePlan &scale, const PlanarFrame &dst,
+                          ScaleScratch &scratch);
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_FRAME_CONVERT_H
@@ -0,0 +1,415 @@
+/**
+ * StreamLumo Frame Recording - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "frame_recording.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+uint64_t alignRecord(uint64_t bytes)
+{
+    return (bytes + RECORDING_ALIGNMENT - 1) & ~(RECORDING_ALIGNMENT - 1);
+}
+
+#ifndef _WIN32
+/**
+ * Allocate `size` bytes of disk for an empty file and extend it to that size
+ * Returns 0 or an errno value (ENOSPC on a full disk).
+ */
+int reserveFile(int fd, uint64_t size)
+{
+#ifdef __APPLE__
+    // No posix_fallocate on macOS: preallocate from the (empty) file's end
+    fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) return errno;
+    return ftruncate(fd, static_cast<off_t>(size)) == 0 ? 0 : errno;
+#else
+    return posix_fallocate(fd, 0, static_cast<off_t>(size));
+#endif
+}
+#endif
+
+#ifdef _WIN32
+DWORD highWord(uint64_t value) { return static_cast<DWORD>(value >> 32); }
+DWORD lowWord(uint64_t value) { return static_cast<DWORD>(value & 0xFFFFFFFFu); }
+#endif
+
+} // namespace
+
+uint32_t sourcePlaneRows(SourceFormat format, uint32_t plane, uint32_t height)
+{
+    switch (format) {
+    case SOURCE_FORMAT_I420:
+        return plane == 0 ? height : plane < 3 ? (height + 1) / 2 : 0;
+    case SOURCE_FORMAT_NV12:
+        return plane == 0 ? height : plane == 1 ? (height + 1) / 2 : 0;
+    case SOURCE_FORMAT_YUY2:
+    case SOURCE_FORMAT_UYVY:
+    case SOURCE_FORMAT_Y800:
+    case SOURCE_FORMAT_RGBA:
+    case SOURCE_FORMAT_BGRA:
+        return plane == 0 ? height : 0;
+    case SOURCE_FORMAT_UNKNOWN:
+    default:
+        return 0;
+    }
+}
+
+// =============================================================================
+// FrameRecorder
+// =============================================================================
+
+FrameRecorder::FrameRecorder()
+    : m_open(false)
+    , m_full(false)
+    , m_base(nullptr)
+    , m_mappedSize(0)
+    , m_used(0)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+#else
+    , m_fd(-1)
+#endif
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+bool FrameRecorder::open(const std::string &path, const std::string &channel, uint64_t capacity)
+{
+    close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const uint64_t mappedSize = sizeof(RecordingHeader) + alignRecord(capacity);
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                         CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        std::cerr << "[FrameRecorder] Failed to create " << path << ": error " << GetLastError() << std::endl;
+        return false;
+    }
+    // Reserve the whole capacity now: a full disk must fail here, not as a
+    // fault on the video thread writing through the mapping
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(mappedSize);
+    if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+        std::cerr << "[FrameRecorder] Failed to reserve " << mappedSize << " bytes for " << path
+                  << ": error " << GetLastError() << std::endl;
+        unmap();
+        DeleteFileA(path.c_str());
+        return false;
+    }
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, highWord(mappedSize), lowWord(mappedSize), nullptr);
+    if (m_mapping) {
+        m_base = static_cast<uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, mappedSize));
+    }
+    if (!m_base) {
+        std::cerr << "[FrameRecorder] Failed to map " << path << ": error " << GetLastError() << std::endl;
+        unmap();
+        return false;
+    }
+#else
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        std::cerr << "[FrameRecorder] Failed to create " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    // Reserve the whole capacity now: a full disk must fail here, not as a
+    // SIGBUS on the video thread writing through the mapping
+    const int reserved = reserveFile(m_fd, mappedSize);
+    if (reserved != 0) {
+        std::cerr << "[FrameRecorder] Failed to reserve " << mappedSize << " bytes for " << path
+                  << ": " << strerror(reserved) << std::endl;
+        unmap();
+        ::unlink(path.c_str());
+        return false;
+    }
+    void *base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "[FrameRecorder] Failed to map " << path << ": " << strerror(errno) << std::endl;
+        unmap();
+        return false;
+    }
+    m_base = static_cast<uint8_t *>(base);
+#endif
+
+    m_path = path;
+    m_mappedSize = mappedSize;
+    m_used = sizeof(RecordingHeader);
+
+    RecordingHeader *header = reinterpret_cast<RecordingHeader *>(m_base);
+    memset(header, 0, sizeof(RecordingHeader));
+    header->magic = SL_RECORDING_MAGIC;
+    header->version = SL_RECORDING_VERSION;
+    strncpy(header->channel, channel.c_str(), sizeof(header->channel) - 1);
+
+    m_full.store(false, std::memory_order_relaxed);
+    m_open.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameRecorder::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open.load(std::memory_order_relaxed)) return;
+    m_open.store(false, std::memory_order_relaxed);
+
+    const uint64_t used = m_used;
+#ifdef _WIN32
+    FlushViewOfFile(m_base, static_cast<SIZE_T>(used));
+    UnmapViewOfFile(m_base);
+    m_base = nullptr;
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+    // The file can only shrink once nothing maps it
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(used);
+    if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+        std::cerr << "[FrameRecorder] Failed to trim " << m_path << ": error " << GetLastError() << std::endl;
+    }
+#else
+    if (ftruncate(m_fd, static_cast<off_t>(used)) != 0) {
+        std::cerr << "[FrameRecorder] Failed to trim " << m_path << ": " << strerror(errno) << std::endl;
+    }
+#endif
+    unmap();
+}
+
+void FrameRecorder::unmap()
+{
+#ifdef _WIN32
+    if (m_base) UnmapViewOfFile(m_base);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_base) munmap(m_base, m_mappedSize);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+#endif
+    m_base = nullptr;
+    m_mappedSize = 0;
+}
+
+bool FrameRecorder::append(const SourceFrame &frame, uint32_t format, uint32_t colorspace, uint32_t range,
+                           uint64_t timestampNs, uint64_t arrivalNs)
+{
+    if (frame.format == SOURCE_FORMAT_UNKNOWN) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open.load(std::memory_order_relaxed) || m_full.load(std::memory_order_relaxed)) return false;
+
+    RecordedFrame record;
+    memset(&record, 0, sizeof(record));
+    record.timestampNs = timestampNs;
+    record.arrivalNs = arrivalNs;
+    record.width = frame.width;
+    record.height = frame.height;
+    record.format = format;
+    record.colorspace = colorspace;
+    record.range = range;
+    record.sourceFormat = frame.format;
+
+    uint64_t size = alignRecord(sizeof(RecordedFrame));
+    for (uint32_t plane = 0; plane < MAX_PLANES; plane++) {
+        const uint32_t rows = sourcePlaneRows(frame.format, plane, frame.height);
+        if (rows == 0 || !frame.data[plane]) continue;
+        record.linesize[plane] = frame.linesize[plane];
+        record.planeOffset[plane] = static_cast<uint32_t>(size);
+        record.planeSize[plane] = static_cast<uint64_t>(frame.linesize[plane]) * rows;
+        size = alignRecord(size + record.planeSize[plane]);
+    }
+    record.size = size;
+
+    if (m_used + size > m_mappedSize) {
+        m_full.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint8_t *dst = m_base + m_used;
+    memcpy(dst, &record, sizeof(record));
+    for (uint32_t plane = 0; plane < MAX_PLANES; plane++) {
+        if (record.planeOffset[plane] != 0) {
+            memcpy(dst + record.planeOffset[plane], frame.data[plane], record.planeSize[plane]);
+        }
+    }
+    m_used += size;
+
+    // Published after the planes: the header never counts a partial record
+    RecordingHeader *header = reinterpret_cast<RecordingHeader *>(m_base);
+    header->dataSize = m_used - sizeof(RecordingHeader);
+    header->frameCount++;
+    return true;
+}
+
+uint64_t FrameRecorder::frameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_base ? reinterpret_cast<const RecordingHeader *>(m_base)->frameCount : 0;
+}
+
+uint64_t FrameRecorder::bytesUsed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+// =============================================================================
+// FrameRecording
+// =============================================================================
+
+FrameRecording::FrameRecording()
+    : m_base(nullptr)
+    , m_size(0)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+#endif
+{
+}
+
+FrameRecording::~FrameRecording()
+{
+    close();
+}
+
+bool FrameRecording::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size)) {
+        std::cerr << "[FrameRecording] Failed to open " << path << ": error " << GetLastError() << std::endl;
+        close();
+        return false;
+    }
+    m_size = static_cast<uint64_t>(size.QuadPart);
+    if (m_size >= sizeof(RecordingHeader)) {
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping) {
+            m_base = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!m_base) {
+            std::cerr << "[FrameRecording] Failed to map " << path << ": error " << GetLastError() << std::endl;
+            close();
+            return false;
+        }
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cerr << "[FrameRecording] Failed to open " << path << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    m_size = static_cast<uint64_t>(st.st_size);
+    if (m_size >= sizeof(RecordingHeader)) {
+        void *base = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            std::cerr << "[FrameRecording] Failed to map " << path << ": " << strerror(errno) << std::endl;
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        m_base = static_cast<const uint8_t *>(base);
+    }
+    ::close(fd);
+#endif
+
+    const RecordingHeader *header = reinterpret_cast<const RecordingHeader *>(m_base);
+    if (!header || header->magic != SL_RECORDING_MAGIC || header->version != SL_RECORDING_VERSION) {
+        std::cerr << "[FrameRecording] " << path << " is not a StreamLumo recording" << std::endl;
+        close();
+        return false;
+    }
+
+    // Index the committed records; a file cut short still yields the frames before the cut
+    const uint64_t end = sizeof(RecordingHeader) + std::min(header->dataSize, m_size - sizeof(RecordingHeader));
+    uint64_t offset = sizeof(RecordingHeader);
+    m_frames.reserve(static_cast<size_t>(header->frameCount));
+    while (m_frames.size() < header->frameCount && offset + sizeof(RecordedFrame) <= end) {
+        const RecordedFrame *record = reinterpret_cast<const RecordedFrame *>(m_base + offset);
+        bool valid = record->size >= sizeof(RecordedFrame) && record->size <= end - offset &&
+                     record->sourceFormat != SOURCE_FORMAT_UNKNOWN;
+        // Each plane lies inside the record and holds every row replay will read
+        for (uint32_t plane = 0; valid && plane < MAX_PLANES; plane++) {
+            if (record->planeOffset[plane] == 0) continue;
+            const uint32_t rows = sourcePlaneRows(static_cast<SourceFormat>(record->sourceFormat), plane, record->height);
+            valid = record->planeOffset[plane] >= sizeof(RecordedFrame) &&
+                    record->planeOffset[plane] <= record->size &&
+                    record->planeSize[plane] <= record->size - record->planeOffset[plane] &&
+                    record->planeSize[plane] >= static_cast<uint64_t>(record->linesize[plane]) * rows;
+        }
+        if (!valid) {
+            std::cerr << "[FrameRecording] Damaged record " << m_frames.size() << " in " << path
+                      << " - replaying the frames before it" << std::endl;
+            break;
+        }
+        m_frames.push_back(record);
+        offset += record->size;
+    }
+    if (m_frames.size() < header->frameCount) {
+        std::cerr << "[FrameRecording] " << path << " holds " << m_frames.size() << " of "
+                  << header->frameCount << " recorded frame(s)" << std::endl;
+    }
+    return true;
+}
+
+void FrameRecording::close()
+{
+    m_frames.clear();
+#ifdef _WIN32
+    if (m_base) UnmapViewOfFile(m_base);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_base) munmap(const_cast<uint8_t *>(m_base), m_size);
+#endif
+    m_base = nullptr;
+    m_size = 0;
+}
+
+std::string FrameRecording::channel() const
+{
+    if (!m_base) return std::string();
+    const RecordingHeader *header = reinterpret_cast<const RecordingHeader *>(m_base);
+    return std::string(header->channel, strnlen(header->channel, sizeof(header->channel)));
+}
+
+void FrameRecording::planes(size_t index, const uint8_t *data[MAX_PLANES]) const
+{
+    const RecordedFrame *record = m_frames[index];
+    for (uint32_t plane = 0; plane < MAX_PLANES; plane++) {
+        data[plane] = record->planeOffset[plane] != 0
+            ? reinterpret_cast<const uint8_t *>(record) + record->planeOffset[plane]
+            : nullptr;
+    }
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,169 @@
+/**
+ * StreamLumo Frame Recording - Header
+ *
+ * The raw input of a FrameWriter on disk, for replaying a capture session
+ * without OBS (bench/frame_replay.cpp): every frame's planes as OBS handed
+ * them to processFrame(), with the OBS video format, colorspace, range and
+ * timestamps. FrameRecorder writes a recording through a memory mapping of
+ * fixed capacity and trims the file when closed; FrameRecording maps one
+ * read-only and indexes its frames.
+ *
+ * A recording is a RecordingHeader followed by frame records, each a
+ * RecordedFrame and its planes, all RECORDING_ALIGNMENT aligned. The header
+ * counts committed frames only, so a recording cut short by a crash still
+ * replays up to its last complete frame.
+ *
+ * Independent of libobs (formats are stored as OBS enum values).
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_FRAME_RECORDING_H
+#define STREAMLUMO_FRAME_RECORDING_H
+
+#include "frame_convert.h"
+#include "../include/shared_buffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace StreamLumo {
+
+#define SL_RECORDING_MAGIC 0x43455253      // "SREC"
+#define SL_RECORDING_VERSION 1
+
+// Records and planes start on a cache line, as they would in an OBS frame
+constexpr uint64_t RECORDING_ALIGNMENT = 64;
+
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frameCount;               // Complete frame records
+    uint64_t dataSize;                 // Bytes of frame records after the header
+    char channel[64];                  // Channel the frames were captured for
+    uint8_t reserved[40];              // Pads the header to two cache lines
+};
+
+struct RecordedFrame {
+    uint64_t size;                     // Whole record, planes included
+    uint64_t timestampNs;              // OBS video timestamp (os_gettime_ns clock)
+    uint64_t arrivalNs;                // processFrame() entry
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;                   // enum video_format
+    uint32_t colorspace;               // enum video_colorspace
+    uint32_t range;                    // enum video_range_type
+    uint32_t sourceFormat;             // SourceFormat the planes are laid out in
+    uint32_t linesize[MAX_PLANES];
+    uint32_t planeOffset[MAX_PLANES];  // From the start of the record, 0 = no plane
+    uint64_t planeSize[MAX_PLANES];
+};
+
+static_assert(sizeof(RecordingHeader) == 2 * RECORDING_ALIGNMENT, "RecordingHeader must keep records aligned");
+
+/**
+ * Rows of plane `plane` of a `height` row frame in `format` (0: no such plane)
+ */
+uint32_t sourcePlaneRows(SourceFormat format, uint32_t plane, uint32_t height);
+
+/**
+ * Writes frames to a recording
+ * append() may be called from any thread; it copies the planes under a mutex.
+ */
+class FrameRecorder {
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    /**
+     * Create (or truncate) `path`, reserve and map `capacity` bytes for frames
+     * Fails (and removes the file) if the disk cannot hold them.
+     */
+    bool open(const std::string &path, const std::string &channel, uint64_t capacity);
+
+    /**
+     * Unmap and trim the file to the frames recorded
+     */
+    void close();
+
+    /**
+     * Append one frame
+     * Returns false (frame not recorded) for an unknown layout or once the
+     * recording is full; isFull() tells the two apart.
+     */
+    bool append(const SourceFrame &frame, uint32_t format, uint32_t colorspace, uint32_t range,
+                uint64_t timestampNs, uint64_t arrivalNs);
+
+    bool isOpen() const { return m_open.load(std::memory_order_relaxed); }
+    bool isFull() const { return m_full.load(std::memory_order_relaxed); }
+    uint64_t frameCount() const;
+    uint64_t bytesUsed() const;
+    const std::string &path() const { return m_path; }
+
+private:
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    void unmap();
+
+    mutable std::mutex m_mutex;        // Mapping and header against close()
+    std::atomic<bool> m_open;
+    std::atomic<bool> m_full;
+    std::string m_path;
+    uint8_t *m_base;
+    uint64_t m_mappedSize;             // Header + capacity
+    uint64_t m_used;                   // Header + frame records written
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+/**
+ * A recording mapped read-only, for replay
+ */
+class FrameRecording {
+public:
+    FrameRecording();
+    ~FrameRecording();
+
+    /**
+     * Map `path` and index its frames; fails on a damaged header or record
+     */
+    bool open(const std::string &path);
+    void close();
+
+    size_t frameCount() const { return m_frames.size(); }
+    const RecordedFrame &frame(size_t index) const { return *m_frames[index]; }
+    std::string channel() const;
+
+    /**
+     * Planes of frame `index` as processFrame() takes them (null for absent planes)
+     */
+    void planes(size_t index, const uint8_t *data[MAX_PLANES]) const;
+
+private:
+    FrameRecording(const FrameRecording &) = delete;
+    FrameRecording &operator=(const FrameRecording &) = delete;
+
+    const uint8_t *m_base;
+    uint64_t m_size;
+    std::vector<const RecordedFrame *> m_frames;
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#endif
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_FRAME_RECORDING_H
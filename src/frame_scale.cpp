@@ -0,0 +1,221 @@
+/**
+ * StreamLumo Frame Scaling - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "frame_scale.h"
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace StreamLumo {
+
+namespace {
+
+/**
+ * Source footprint of one destination sample before it is fitted into the table
+ */
+struct Contribution {
+    uint32_t begin;
+    std::vector<int32_t> weights;
+};
+
+/**
+ * Quantize `weights` (source samples begin, begin + 1, ...) to Q14 summing to
+ * exactly SCALE_WEIGHT_ONE, dropping samples that round to nothing
+ */
+Contribution quantize(uint32_t begin, const std::vector<double> &weights)
+{
+    double total = 0.0;
+    for (double w : weights) total += w;
+
+    Contribution c;
+    c.begin = begin;
+    int32_t sum = 0;
+    size_t largest = 0;
+    for (size_t k = 0; k < weights.size(); k++) {
+        const int32_t q = static_cast<int32_t>(std::lround(weights[k] / total * SCALE_WEIGHT_ONE));
+        c.weights.push_back(q);
+        sum += q;
+        if (q > c.weights[largest]) largest = k;
+    }
+    c.weights[largest] += SCALE_WEIGHT_ONE - sum;
+
+    while (c.weights.size() > 1 && c.weights.back() == 0) c.weights.pop_back();
+    while (c.weights.size() > 1 && c.weights.front() == 0) {
+        c.weights.erase(c.weights.begin());
+        c.begin++;
+    }
+    return c;
+}
+
+Contribution contribution(uint32_t index, uint32_t srcSize, double scale, ScaleFilter filter)
+{
+    const uint32_t last = srcSize - 1;
+    switch (filter) {
+        case SCALE_FILTER_NEAREST:
+            {
+                const uint32_t nearest = static_cast<uint32_t>((index + 0.5) * scale);
+                return quantize(std::min(nearest, last), { 1.0 });
+            }
+
+        case SCALE_FILTER_BILINEAR:
+            {
+                // Sample at the destination pixel centre
+                const double center = std::max(0.0, (index + 0.5) * scale - 0.5);
+                const uint32_t left = static_cast<uint32_t>(center);
+                if (left >= last) return quantize(last, { 1.0 });
+                const double fraction = center - left;
+                return quantize(left, { 1.0 - fraction, fraction });
+            }
+
+        default:
+            {
+                // Every source sample weighted by how much of it the destination sample covers
+                const double begin = index * scale;
+                const double end = std::min((double)srcSize, (index + 1) * scale);
+                const uint32_t firstSample = std::min(static_cast<uint32_t>(begin), last);
+                std::vector<double> weights;
+                for (uint32_t i = firstSample; i <= last && i < end; i++) {
+                    weights.push_back(std::min(end, i + 1.0) - std::max(begin, (double)i));
+                }
+                return quantize(firstSample, weights);
+            }
+    }
+}
+
+} // namespace
+
+const char *scaleFilterName(ScaleFilter filter)
+{
+    switch (filter) {
+        case SCALE_FILTER_NEAREST: return "nearest";
+        case SCALE_FILTER_BILINEAR: return "bilinear";
+        default: return "area";
+    }
+}
+
+bool parseScaleFilter(const char *name, ScaleFilter &filter)
+{
+    static const ScaleFilter FILTERS[] = { SCALE_FILTER_NEAREST, SCALE_FILTER_BILINEAR, SCALE_FILTER_AREA };
+    for (ScaleFilter candidate : FILTERS) {
+        if (name && std::strcmp(name, scaleFilterName(candidate)) == 0) {
+            filter = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScaleAxis::build(uint32_t src, uint32_t dst, ScaleFilter filter)
+{
+    srcSize = src;
+    dstSize = dst;
+    halve = (filter != SCALE_FILTER_NEAREST && src == dst * 2);
+    taps = 0;
+    first.assign(dst, 0);
+    weights.clear();
+    if (src == 0 || dst == 0) return;
+
+    const double scale = (double)src / dst;
+    std::vector<Contribution> contributions;
+    contributions.reserve(dst);
+    for (uint32_t i = 0; i < dst; i++) {
+        contributions.push_back(contribution(i, src, scale, filter));
+        taps = std::max(taps, (uint32_t)contributions.back().weights.size());
+    }
+
+    // Fixed-size windows, moved left where they would run off the end
+    weights.assign((size_t)dst * taps, 0);
+    for (uint32_t i = 0; i < dst; i++) {
+        const Contribution &c = contributions[i];
+        first[i] = std::min(c.begin, src - taps);
+        for (size_t k = 0; k < c.weights.size(); k++) {
+            weights[(size_t)i * taps + (c.begin - first[i]) + k] = static_cast<int16_t>(c.weights[k]);
+        }
+    }
+}
+
+FrameScaler::FrameScaler()
+    : m_filter(SCALE_FILTER_AREA)
+{
+}
+
+void FrameScaler::configure(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter)
+{
+    if (filter == m_filter && matches(srcWidth, srcHeight, dstWidth, dstHeight)) return;
+    m_filter = filter;
+    m_horizontal.build(srcWidth, dstWidth, filter);
+    m_vertical.build(srcHeight, dstHeight, filter);
+}
+
+bool FrameScaler::matches(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight) const
+{
+    return m_horizontal.srcSize == srcWidth && m_horizontal.dstSize == dstWidth &&
+           m_vertical.srcSize == srcHeight && m_vertical.dstSize == dstHeight;
+}
+
+void FrameScaler::filterRow(uint32_t y, const uint8_t *const *rows, uint32_t channels, uint8_t *dst, ScaleScratch &scratch) const
+{
+    const ConvertKernels &kernels = GetConvertKernels();
+    const uint32_t srcWidth = m_horizontal.srcSize;
+    const uint32_t dstWidth = m_horizontal.dstSize;
+
+    if (m_horizontal.halve && m_vertical.halve) {
+        kernels.halveRows(rows[0], rows[1], dst, dstWidth, channels);
+        return;
+    }
+
+    // Vertical pass, straight into dst when the width is unchanged
+    const bool sameWidth = (srcWidth == dstWidth);
+    const uint8_t *row = rows[0];
+    if (m_vertical.taps > 1) {
+        uint8_t *blended = dst;
+        if (!sameWidth) {
+            scratch.blended.resize((size_t)srcWidth * channels);
+            blended = scratch.blended.data();
+        }
+        kernels.blendRows(rows, &m_vertical.weights[(size_t)y * m_vertical.taps], m_vertical.taps,
+                          blended, srcWidth * channels);
+        if (sameWidth) return;
+        row = blended;
+    } else if (sameWidth) {
+        std::memcpy(dst, row, (size_t)srcWidth * channels);
+        return;
+    }
+
+    // Horizontal pass
+    if (m_horizontal.halve) {
+        kernels.halveRows(row, row, dst, dstWidth, channels);
+        return;
+    }
+    const uint32_t taps = m_horizontal.taps;
+    if (taps == 1) {
+        // Nearest: a gather, nothing to weigh
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            std::memcpy(dst + x * channels, row + (size_t)m_horizontal.first[x] * channels, channels);
+        }
+        return;
+    }
+    if (channels == 4) {
+        kernels.resampleRgba(row, m_horizontal.first.data(), m_horizontal.weights.data(), taps, dst, dstWidth);
+        return;
+    }
+
+    for (uint32_t x = 0; x < dstWidth; x++) {
+        const uint8_t *px = row + (size_t)m_horizontal.first[x] * channels;
+        const int16_t *w = &m_horizontal.weights[(size_t)x * taps];
+        for (uint32_t c = 0; c < channels; c++) {
+            int32_t sum = SCALE_WEIGHT_ONE / 2;
+            for (uint32_t k = 0; k < taps; k++) {
+                sum += w[k] * px[k * channels + c];
+            }
+            dst[x * channels + c] = clampToByte(sum >> SCALE_WEIGHT_BITS);
+        }
+    }
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,102 @@
+/**
+ * StreamLumo Frame Scaling - Header
+ *
+ * Separable resampling with coefficient tables computed once per geometry
+ * change: for every destination column and row, the first source sample and
+ * Q14 weights for a fixed number of taps. A row is filtered vertically
+ * (blendRows) and then horizontally (resampleRgba, or a scalar loop for 1-
+ * and 2-channel planes). Exact 2:1 box scaling - 4K to 1080p - skips the
+ * tables and averages 2x2 blocks directly (halveRows).
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_FRAME_SCALE_H
+#define STREAMLUMO_FRAME_SCALE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace StreamLumo {
+
+enum ScaleFilter {
+    SCALE_FILTER_NEAREST,
+    SCALE_FILTER_BILINEAR,
+    SCALE_FILTER_AREA           // Box filter over the source footprint; no aliasing when downscaling
+};
+
+const char *scaleFilterName(ScaleFilter filter);
+
+/**
+ * Parse "nearest", "bilinear" or "area"; false for anything else
+ */
+bool parseScaleFilter(const char *name, ScaleFilter &filter);
+
+/**
+ * Coefficients for one axis
+ */
+struct ScaleAxis {
+    uint32_t srcSize = 0;
+    uint32_t dstSize = 0;
+    uint32_t taps = 0;              // Source samples per destination sample
+    bool halve = false;             // Exact 2:1 box: dst i averages src 2i and 2i + 1
+    std::vector<uint32_t> first;    // First source sample of each destination sample
+    std::vector<int16_t> weights;   // `taps` weights per destination sample, summing to SCALE_WEIGHT_ONE
+
+    void build(uint32_t srcSize, uint32_t dstSize, ScaleFilter filter);
+};
+
+/**
+ * Working memory of one thread filtering rows
+ */
+struct ScaleScratch {
+    std::vector<const uint8_t *> rows;  // Source rows of the destination row
+    std::vector<uint8_t> blended;       // Vertically filtered row
+    std::vector<uint8_t> converted;     // Source rows converted to RGBA (frame_convert.cpp)
+    std::vector<int64_t> convertedRow;  // Source row held by each converted slot, -1 if none
+    std::vector<uint8_t> output;        // Scaled rows before repacking
+};
+
+/**
+ * Scaling tables for one plane geometry
+ */
+class FrameScaler {
+public:
+    FrameScaler();
+
+    /**
+     * Rebuild the tables if the geometry or filter changed
+     */
+    void configure(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter);
+
+    bool matches(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight) const;
+
+    /**
+     * Filter destination row `y` from its source rows, `channels` (1, 2 or 4)
+     * bytes per pixel; `sourceRow(i)` returns source row i
+     */
+    template <typename SourceRow>
+    void scaleRow(uint32_t y, uint32_t channels, SourceRow &&sourceRow, uint8_t *dst, ScaleScratch &scratch) const
+    {
+        const uint32_t first = m_vertical.first[y];
+        scratch.rows.resize(m_vertical.taps);
+        for (uint32_t i = 0; i < m_vertical.taps; i++) {
+            scratch.rows[i] = sourceRow(first + i);
+        }
+        filterRow(y, scratch.rows.data(), channels, dst, scratch);
+    }
+
+    const ScaleAxis &horizontal() const { return m_horizontal; }
+    const ScaleAxis &vertical() const { return m_vertical; }
+
+private:
+    void filterRow(uint32_t y, const uint8_t *const *rows, uint32_t channels, uint8_t *dst, ScaleScratch &scratch) const;
+
+    ScaleFilter m_filter;
+    ScaleAxis m_horizontal;
+    ScaleAxis m_vertical;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_FRAME_SCALE_H
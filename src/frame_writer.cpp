@@ -7,23 +7,44 @@
  */
 
 #include "frame_writer.h"
+#include "pixel_convert.h"
+#include "frame_convert.h"
+#include "readback_ring.h"
+#include "gpu_convert.h"
+#include "band_pool.h"
+#include "change_detector.h"
+#include "source_renderer.h"
+#include "texture_share.h"
+#include "frame_recording.h"
 #include "../include/shared_buffer.h"
 
 #ifdef _WIN32
 #include "shm_win32.h"
-using ShmImpl = StreamLumo::ShmWin32;
 #else
 #include "shm_posix.h"
-using ShmImpl = StreamLumo::ShmPosix;
 #endif
 
 #include <obs.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <graphics/graphics.h>
 #include <cstring>
+#include <cstdio>
+#include <cmath>
 #include <algorithm>
 #include <mutex>
 #include <map>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace {
 
@@ -32,11 +53,81 @@ struct PreviewCaptureData {
     obs_source_t *source;
     StreamLumo::FrameWriter *writer;
     gs_texrender_t *texrender;
-    gs_stagesurf_t *stagesurf;
+    StreamLumo::ReadbackRing *readback;
+    StreamLumo::GpuConverter *converter;
+    bool gpuConversion;
     uint32_t width;
     uint32_t height;
 };
 
+// Filter settings keys
+const char *const SETTING_READBACK_DEPTH = "readback_depth";
+const char *const SETTING_GPU_CONVERSION = "gpu_conversion";
+
+// Smallest band worth handing to a conversion worker
+const uint32_t MIN_BAND_ROWS = 64;
+
+// Change detection still publishes a full frame this often (sampling can miss a change)
+const uint64_t CHANGE_REFRESH_INTERVAL_NS = 1000000000ULL;
+
+// Latency samples above this are clock-domain mismatches (e.g. async source timestamps)
+const uint64_t MAX_LATENCY_SAMPLE_NS = 10000000000ULL;
+
+// Format "p50/p95/p99/max" of one stage for the periodic stats log
+std::string latencyString(const StreamLumo::LatencySummary &s)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.2f/%.2f/%.2f/%.2f", s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    return buf;
+}
+
+/**
+ * Stage a rendered frame and pass the frame coming out of the readback ring
+ * to the writer
+ *
+ * With GPU conversion the texture is first scaled/converted to the channel's
+ * geometry and format, so the writer only copies the mapped bytes.
+ * Falls back to staging the RGBA texture when the channel can't take a GPU frame.
+ */
+void StageAndProcess(StreamLumo::FrameWriter *writer, StreamLumo::ReadbackRing *readback,
+                     StreamLumo::GpuConverter *converter, bool gpuConversion,
+                     gs_texture_t *tex, uint32_t width, uint32_t height)
+{
+    gs_texture_t *stageTex = tex;
+    uint32_t stageWidth = width;
+    uint32_t stageHeight = height;
+    uint32_t contentFormat = FORMAT_RGBA;
+    
+    StreamLumo::GpuConverter::Target target = {};
+    if (gpuConversion && converter &&
+        writer->gpuConversionTarget(width, height, target.width, target.height, target.format)) {
+        gs_texture_t *converted = converter->convert(tex, target, stageWidth, stageHeight);
+        if (converted) {
+            stageTex = converted;
+            contentFormat = target.format;
+        } else {
+            stageWidth = width;
+            stageHeight = height;
+        }
+    }
+    
+    // Stage this frame and map the one staged (depth - 1) renders ago,
+    // so the map does not wait on the GPU copy we just queued
+    StreamLumo::ReadbackRing::MappedFrame mapped;
+    if (!readback->stage(stageTex, stageWidth, stageHeight, mapped, contentFormat)) return;
+    writer->recordReadbackLatency(readback->depth(), os_gettime_ns() - mapped.stagedAtNs, mapped.mapStallNs);
+    
+    const uint8_t *data[MAX_PLANES] = {};
+    uint32_t linesize[MAX_PLANES] = {};
+    uint32_t frameWidth = 0;
+    uint32_t frameHeight = 0;
+    const enum video_format format = StreamLumo::GpuConverter::describeFrame(mapped, data, linesize, frameWidth, frameHeight);
+    
+    writer->processFrame(data, linesize, frameWidth, frameHeight, format, mapped.stagedAtNs);
+    
+    readback->unmap();
+}
+
 // Global map declaration
 std::mutex g_filter_map_mutex;
 std::map<obs_source_t*, PreviewCaptureData*> g_filter_map;
@@ -48,14 +139,44 @@ const char *PreviewCaptureGetName(void *type_data)
     return "StreamLumo Preview Capture";
 }
 
+void PreviewCaptureGetDefaults(obs_data_t *settings)
+{
+    obs_data_set_default_int(settings, SETTING_READBACK_DEPTH, StreamLumo::DEFAULT_READBACK_DEPTH);
+    obs_data_set_default_bool(settings, SETTING_GPU_CONVERSION, false);
+}
+
+obs_properties_t *PreviewCaptureGetProperties(void *data)
+{
+    UNUSED_PARAMETER(data);
+    obs_properties_t *props = obs_properties_create();
+    obs_properties_add_int(props, SETTING_READBACK_DEPTH, "GPU readback depth (frames)",
+                           1, StreamLumo::MAX_READBACK_DEPTH, 1);
+    obs_properties_add_bool(props, SETTING_GPU_CONVERSION, "Scale and convert on the GPU");
+    return props;
+}
+
+void PreviewCaptureUpdate(void *data, obs_data_t *settings)
+{
+    PreviewCaptureData *capture = static_cast<PreviewCaptureData*>(data);
+    const uint32_t depth = (uint32_t)obs_data_get_int(settings, SETTING_READBACK_DEPTH);
+    
+    // The ring is only touched from video_render, which runs in the graphics context
+    obs_enter_graphics();
+    capture->readback->setDepth(depth);
+    capture->gpuConversion = obs_data_get_bool(settings, SETTING_GPU_CONVERSION);
+    obs_leave_graphics();
+}
+
 void *PreviewCaptureCreate(obs_data_t *settings, obs_source_t *source)
 {
-    UNUSED_PARAMETER(settings);
     PreviewCaptureData *data = new PreviewCaptureData();
     data->source = source;
     data->writer = nullptr;
     data->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-    data->stagesurf = nullptr;
+    data->readback = new StreamLumo::ReadbackRing(
+        (uint32_t)obs_data_get_int(settings, SETTING_READBACK_DEPTH));
+    data->converter = new StreamLumo::GpuConverter();
+    data->gpuConversion = obs_data_get_bool(settings, SETTING_GPU_CONVERSION);
     data->width = 0;
     data->height = 0;
     
@@ -80,7 +201,8 @@ void PreviewCaptureDestroy(void *data)
         
         obs_enter_graphics();
         if (capture->texrender) gs_texrender_destroy(capture->texrender);
-        if (capture->stagesurf) gs_stagesurface_destroy(capture->stagesurf);
+        delete capture->readback;
+        delete capture->converter;
         obs_leave_graphics();
         delete capture;
     }
@@ -113,12 +235,14 @@ void PreviewCaptureVideoRender(void *data, gs_effect_t *effect)
     uint32_t height = obs_source_get_base_height(target);
     
     if (width == 0 || height == 0) return;
+    
+    // Only the pass-through render while no consumer is reading the channel
+    if (!capture->writer->checkConsumerDemand()) return;
 
-    if (capture->width != width || capture->height != height || !capture->stagesurf) {
+    if (capture->width != width || capture->height != height) {
+        // The readback ring recreates its surfaces on the next stage
         capture->width = width;
         capture->height = height;
-        if (capture->stagesurf) gs_stagesurface_destroy(capture->stagesurf);
-        capture->stagesurf = gs_stagesurface_create(width, height, GS_RGBA);
     }
 
     // Render to texture
@@ -134,31 +258,12 @@ void PreviewCaptureVideoRender(void *data, gs_effect_t *effect)
         gs_texrender_end(capture->texrender);
     }
 
-    // Copy to staging surface for CPU readback
+    // Copy to staging surface for CPU readback. The ring maps the frame
+    // staged (depth - 1) renders ago, so this never waits on the GPU.
     gs_texture_t *tex = gs_texrender_get_texture(capture->texrender);
     if (tex) {
-        gs_stage_texture(capture->stagesurf, tex);
-        
-        // Map and read (Blocking! In production use async staging chain)
-        uint8_t *ptr;
-        uint32_t linesize;
-        if (gs_stagesurface_map(capture->stagesurf, &ptr, &linesize)) {
-            // Pass to writer
-            // We construct a fake video_data/obs_source_frame or just call processFrame directly
-            // Since we have RGBA data, we can pass it directly
-            const uint8_t *data_arr[1] = { ptr };
-            const uint32_t linesize_arr[1] = { linesize };
-            
-            capture->writer->processFrame(
-                data_arr,
-                linesize_arr,
-                width,
-                height,
-                VIDEO_FORMAT_RGBA
-            );
-            
-            gs_stagesurface_unmap(capture->stagesurf);
-        }
+        StageAndProcess(capture->writer, capture->readback, capture->converter,
+                        capture->gpuConversion, tex, width, height);
     }
 }
 
@@ -176,6 +281,95 @@ void SetPreviewFilterWriter(obs_source_t *filter, StreamLumo::FrameWriter *write
     }
 }
 
+/**
+ * Conversion layout of an OBS video format (SOURCE_FORMAT_UNKNOWN if unsupported)
+ */
+StreamLumo::SourceFormat toSourceFormat(enum video_format format)
+{
+    switch (format) {
+        case VIDEO_FORMAT_I420: return StreamLumo::SOURCE_FORMAT_I420;
+        case VIDEO_FORMAT_NV12: return StreamLumo::SOURCE_FORMAT_NV12;
+        case VIDEO_FORMAT_YUY2: return StreamLumo::SOURCE_FORMAT_YUY2;
+        case VIDEO_FORMAT_UYVY: return StreamLumo::SOURCE_FORMAT_UYVY;
+        case VIDEO_FORMAT_Y800: return StreamLumo::SOURCE_FORMAT_Y800;
+        case VIDEO_FORMAT_RGBA: return StreamLumo::SOURCE_FORMAT_RGBA;
+        case VIDEO_FORMAT_BGRA: return StreamLumo::SOURCE_FORMAT_BGRA;
+        default: return StreamLumo::SOURCE_FORMAT_UNKNOWN;
+    }
+}
+
+/**
+ * Conversion layout of a packed channel pixel format (isPackedRgbaFormat())
+ */
+StreamLumo::PackedFormat toPackedFormat(uint32_t format)
+{
+    switch (format) {
+        case FORMAT_BGRA: return StreamLumo::PACKED_FORMAT_BGRA;
+        case FORMAT_RGBX: return StreamLumo::PACKED_FORMAT_RGBX;
+        case FORMAT_RGBA_PREMULTIPLIED: return StreamLumo::PACKED_FORMAT_RGBA_PREMULTIPLIED;
+        default: return StreamLumo::PACKED_FORMAT_RGBA;
+    }
+}
+
+const char *packedFormatName(StreamLumo::PackedFormat format)
+{
+    switch (format) {
+        case StreamLumo::PACKED_FORMAT_BGRA: return "BGRA";
+        case StreamLumo::PACKED_FORMAT_RGBX: return "RGBX";
+        case StreamLumo::PACKED_FORMAT_RGBA_PREMULTIPLIED: return "premultiplied RGBA";
+        default: return "RGBA";
+    }
+}
+
+/**
+ * YUV matrix and range of an OBS colorspace and range
+ * OBS decodes the default colorspace (and sRGB) with BT.709 and treats the
+ * default range as partial; BT.2100 frames come from formats we don't convert.
+ */
+StreamLumo::ColorMatrix toColorMatrix(enum video_colorspace colorspace)
+{
+    return (colorspace == VIDEO_CS_601) ? StreamLumo::COLOR_MATRIX_BT601 : StreamLumo::COLOR_MATRIX_BT709;
+}
+
+StreamLumo::ColorRange toColorRange(enum video_range_type range)
+{
+    return (range == VIDEO_RANGE_FULL) ? StreamLumo::COLOR_RANGE_FULL : StreamLumo::COLOR_RANGE_LIMITED;
+}
+
+const StreamLumo::YuvMatrix &toYuvMatrix(enum video_colorspace colorspace, enum video_range_type range)
+{
+    return StreamLumo::GetYuvMatrix(toColorMatrix(colorspace), toColorRange(range));
+}
+
+/**
+ * Colorspace of an async source frame
+ * The source only hands over its YUV -> RGB matrix; its Cr -> R coefficient
+ * tells BT.601 and BT.709 apart in either range.
+ */
+enum video_colorspace frameColorspace(const struct obs_source_frame *frame)
+{
+    const StreamLumo::ColorRange range = frame->full_range ? StreamLumo::COLOR_RANGE_FULL : StreamLumo::COLOR_RANGE_LIMITED;
+    const float rv = frame->color_matrix[2];
+    const float bt601 = StreamLumo::GetYuvMatrix(StreamLumo::COLOR_MATRIX_BT601, range).rv;
+    const float bt709 = StreamLumo::GetYuvMatrix(StreamLumo::COLOR_MATRIX_BT709, range).rv;
+    return std::fabs(rv - bt601) <= std::fabs(rv - bt709) ? VIDEO_CS_601 : VIDEO_CS_709;
+}
+
+/**
+ * Run the calling thread below everything OBS schedules (statistics reporter)
+ */
+void lowerThreadPriority()
+{
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+    struct sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
+
 } // namespace
 
 // Register the filter
@@ -187,51 +381,73 @@ void RegisterPreviewFilter()
     preview_capture_info.get_name = PreviewCaptureGetName;
     preview_capture_info.create = PreviewCaptureCreate;
     preview_capture_info.destroy = PreviewCaptureDestroy;
+    preview_capture_info.get_defaults = PreviewCaptureGetDefaults;
+    preview_capture_info.get_properties = PreviewCaptureGetProperties;
+    preview_capture_info.update = PreviewCaptureUpdate;
     preview_capture_info.video_render = PreviewCaptureVideoRender;
     
     obs_register_source(&preview_capture_info);
 }
 
-inline uint8_t clampToByte(int value)
-{
-    return static_cast<uint8_t>(std::clamp(value, 0, 255));
-}
-
-inline void writeRgbaFromYuv(int y, int u, int v, uint8_t *dst)
-{
-    // Standard BT.601 conversion works well for OBS preview feeds.
-    int r = static_cast<int>(y + 1.402f * v);
-    int g = static_cast<int>(y - 0.344136f * u - 0.714136f * v);
-    int b = static_cast<int>(y + 1.772f * u);
-
-    dst[0] = clampToByte(r);
-    dst[1] = clampToByte(g);
-    dst[2] = clampToByte(b);
-    dst[3] = 255;
-}
-
 namespace StreamLumo {
 
 FrameWriter::FrameWriter(const std::string& channelName, Mode mode)
     : m_running(false)
+    , m_suspended(false)
+    , m_resumedAtNs(0)
     , m_totalFrames(0)
     , m_droppedFrames(0)
     , m_writtenFrames(0)
+    , m_backpressureFrames(0)
+    , m_unchangedFrames(0)
+    , m_contendedFrames(0)
+    , m_idleFrames(0)
+    , m_comparedFrames(0)
+    , m_dirtyTiles(0)
+    , m_ringStallFrames(0)
+    , m_lastReadbackDepth(0)
+    , m_readbackLatencyNs(0)
+    , m_readbackSamples(0)
     , m_startTime(0)
-    , m_lastStatsTime(0)
+    , m_lastPickupFrame(0)
+    , m_reporterStop(false)
     , m_channelName(channelName)
     , m_shm(nullptr)
+    , m_metricsPage(nullptr)
+    , m_metrics(nullptr)
     , m_mode(mode)
     , m_currentSource(nullptr)
-    , m_texrender(nullptr)
-    , m_stagesurf(nullptr)
-    , m_captureWidth(0)
-    , m_captureHeight(0)
-    , m_tickAccumulator(0.0f)
+    , m_videoInfo()
+    , m_videoInfoStale(true)
+    , m_scaleFilter(SCALE_FILTER_AREA)
+    , m_readbackDepth(DEFAULT_READBACK_DEPTH)
+    , m_gpuConversion(false)
+    , m_textureShare(nullptr)
+    , m_publishedTextureGeneration(0)
+    , m_textureShareFailed(false)
+    , m_previewFps(DEFAULT_PREVIEW_FPS)
+    , m_captureDivisor(0)
+    , m_nextCaptureFrame(0)
+    , m_loggedFormatError(false)
+    , m_bandPool(nullptr)
+    , m_changeDetector(nullptr)
+    , m_changeDetection(false)
+    , m_lastPublishTime(0)
+    , m_recorder(nullptr)
 {
     m_shm = new ShmImpl(channelName);
-    // Allocate frame buffer for RGBA conversion
-    m_frameBuffer.resize(FRAME_SIZE);
+    m_metricsPage = new MetricsImpl(channelName);
+    if (m_metricsPage->open()) {
+        m_metricsPage->claim();
+        m_metrics = m_metricsPage->get();
+    } else {
+        blog(LOG_WARNING, "[FrameWriter] No metrics page for channel %s - counters stay in-process", channelName.c_str());
+        m_metrics = new ChannelMetrics();
+    }
+    m_bandPool = new BandPool();
+    m_changeDetector = new ChangeDetector();
+    m_recorder = new FrameRecorder();
+    m_plan.valid = false;
     
     blog(LOG_INFO, "[FrameWriter] Initialized for channel: %s (Mode: %s)", 
          channelName.c_str(), mode == MODE_GLOBAL_OUTPUT ? "Global Output" : "Source Capture");
@@ -241,60 +457,110 @@ FrameWriter::~FrameWriter()
 {
     stop();
     
-    // Clean up graphics resources
-    obs_enter_graphics();
-    if (m_texrender) {
-        gs_texrender_destroy(m_texrender);
-        m_texrender = nullptr;
-    }
-    if (m_stagesurf) {
-        gs_stagesurface_destroy(m_stagesurf);
-        m_stagesurf = nullptr;
+    if (m_textureShare) {
+        obs_enter_graphics();
+        delete m_textureShare;
+        m_textureShare = nullptr;
+        obs_leave_graphics();
     }
-    obs_leave_graphics();
+    
+    delete m_bandPool;
+    m_bandPool = nullptr;
+    delete m_changeDetector;
+    m_changeDetector = nullptr;
+    stopRecording();
+    delete m_recorder;
+    m_recorder = nullptr;
     
     if (m_shm) {
         delete m_shm;
         m_shm = nullptr;
     }
+    
+    // The channel is going away: so does its metrics page
+    if (m_metricsPage->isOpen()) {
+        m_metricsPage->destroy();
+    } else {
+        delete m_metrics;
+    }
+    m_metrics = nullptr;
+    delete m_metricsPage;
+    m_metricsPage = nullptr;
     blog(LOG_INFO, "[FrameWriter] Destroyed");
 }
 
 bool FrameWriter::connect() {
     if (!m_shm) return false;
-    return m_shm->connect();
-}
-
-bool FrameWriter::checkPauseRequested() const {
-    if (!m_shm || !m_shm->isConnected()) return false;
+    if (m_shm->isConnected()) {
+        // Replaced channel: map the current region afresh
+        m_shm->disconnect();
+    }
+    // Map as the producer: no reader registration of our own
+    if (!m_shm->connect(false)) return false;
     
-    // Read the pause_requested flag from shared memory
     SharedFrameBuffer* buffer = m_shm->getBuffer();
-    if (!buffer) return false;
-    
-    return buffer->pause_requested.load(std::memory_order_acquire) != 0;
+    blog(LOG_INFO, "[FrameWriter:%s] Channel geometry: %ux%u, format %u, %u x %u-byte slots (%s), %u KB %spages%s%s",
+         m_channelName.c_str(), buffer->width.load(), buffer->height.load(), buffer->format.load(),
+         buffer->slot_count, buffer->slot_size, isRingMode(buffer) ? "ring" : "latest frame",
+         m_shm->pageSize() / 1024, m_shm->pageSize() >= SL_HUGE_PAGE_SIZE ? "huge " : "",
+         (buffer->flags & SL_FLAG_ACCEPT_NATIVE_SIZE) ? ", native size allowed" : "",
+         (buffer->flags & SL_FLAG_SHARED_TEXTURE) ? ", shared texture requested" : "");
+    m_loggedFormatError = false;
+    m_publishedTextureGeneration = 0;
+    return true;
+}
+
+bool FrameWriter::isChannelReplaced() const
+{
+    return m_shm && m_shm->isConnected() && m_shm->isReplaced();
 }
 
-void FrameWriter::confirmPaused() {
-    if (!m_shm || !m_shm->isConnected()) return;
+void FrameWriter::invalidateVideoInfo()
+{
+    m_videoInfoStale.store(true, std::memory_order_release);
+}
+
+bool FrameWriter::checkPause()
+{
+    if (!m_shm->isConnected()) return false;
+    SharedFrameBuffer *buffer = m_shm->getBuffer();
     
-    SharedFrameBuffer* buffer = m_shm->getBuffer();
-    if (!buffer) return;
+    // producer_paused follows pause_requested; log each change once
+    const uint8_t requested = buffer->pause_requested.load(std::memory_order_acquire) != 0 ? 1 : 0;
+    if (buffer->producer_paused.load(std::memory_order_relaxed) != requested &&
+        buffer->producer_paused.exchange(requested, std::memory_order_acq_rel) != requested) {
+        blog(LOG_INFO, requested ? "[FrameWriter:%s] Paused by consumer (capture stays registered with OBS)"
+                                 : "[FrameWriter:%s] Pause withdrawn by consumer - resuming",
+             m_channelName.c_str());
+    }
     
-    // Set producer_paused to confirm we have stopped
-    buffer->producer_paused.store(1, std::memory_order_release);
-    blog(LOG_INFO, "[FrameWriter] Confirmed pause to consumer");
+    if (requested) {
+        m_idleFrames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(m_metrics->skipped_idle);
+    }
+    return requested != 0;
 }
 
-void FrameWriter::clearPauseState() {
-    if (!m_shm || !m_shm->isConnected()) return;
-    
-    SharedFrameBuffer* buffer = m_shm->getBuffer();
-    if (!buffer) return;
+void FrameWriter::applyReconfigure(SharedFrameBuffer *buffer)
+{
+    uint32_t generation = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t format = 0;
+    if (!pendingReconfigure(buffer, generation, width, height, format)) return;
     
-    // Clear both pause flags
-    buffer->pause_requested.store(0, std::memory_order_release);
-    buffer->producer_paused.store(0, std::memory_order_release);
+    // The previous frame is complete and the next one not started: switch here
+    if ((isPackedRgbaFormat(format) || isPlanarFormat(format)) && frameSizeFor(width, height, format) <= buffer->slot_size) {
+        setFrameGeometry(buffer, width, height, format);
+        countMetric(m_metrics->format_changes);
+        m_loggedFormatError = false;
+        blog(LOG_INFO, "[FrameWriter:%s] Reconfigured to %ux%u, format %u (request %u)",
+             m_channelName.c_str(), width, height, format, generation);
+    } else {
+        blog(LOG_WARNING, "[FrameWriter:%s] Ignoring reconfigure request %u: %ux%u format %u is not supported",
+             m_channelName.c_str(), generation, width, height, format);
+    }
+    buffer->applied_generation.store(generation, std::memory_order_release);
 }
 
 bool FrameWriter::start()
@@ -306,20 +572,44 @@ bool FrameWriter::start()
     
     blog(LOG_INFO, "[FrameWriter] Starting frame capture...");
     
-    // Get OBS video settings
-    struct obs_video_info ovi;
+    // Get OBS video settings (cached for the program callback)
+    struct obs_video_info ovi = {};
     obs_get_video_info(&ovi);
+    m_videoInfo = ovi;
+    m_videoInfoStale.store(false, std::memory_order_release);
     blog(LOG_INFO, "[FrameWriter] OBS Video Settings:");
     blog(LOG_INFO, "  Resolution: %dx%d", ovi.base_width, ovi.base_height);
     blog(LOG_INFO, "  FPS: %u/%u (%.2f Hz)", ovi.fps_num, ovi.fps_den, (double)ovi.fps_num / ovi.fps_den);
     blog(LOG_INFO, "  Format: %d (0=RGBA, 1=BGRA, 2=I420, 3=NV12, 4=Y800)", ovi.output_format);
+    blog(LOG_INFO, "  Conversion kernels: %s", GetConvertKernels().name);
     
     // Reset statistics
     m_totalFrames.store(0);
     m_droppedFrames.store(0);
     m_writtenFrames.store(0);
+    m_backpressureFrames.store(0);
+    m_unchangedFrames.store(0);
+    m_contendedFrames.store(0);
+    m_idleFrames.store(0);
+    m_suspended.store(false);
+    m_comparedFrames.store(0);
+    m_dirtyTiles.store(0);
+    m_ringStallFrames = 0;
+    m_readbackLatencyNs.store(0);
+    m_readbackSamples.store(0);
+    m_callbackLatency.reset();
+    m_conversionLatency.reset();
+    m_writeLatency.reset();
+    m_pickupLatency.reset();
+    m_totalLatency.reset();
+    m_bandLatency.reset();
+    m_lastPickupFrame = 0;
     m_startTime = os_gettime_ns();
-    m_lastStatsTime = m_startTime;
+    {
+        // Rebuilt from the first frame
+        std::lock_guard<ProducerToken> lock(m_producer);
+        m_plan.valid = false;
+    }
     
     if (m_mode == MODE_GLOBAL_OUTPUT) {
         // Register raw video callback on the main video output
@@ -331,13 +621,17 @@ bool FrameWriter::start()
         
         obs_add_raw_video_callback(nullptr, rawVideoCallback, this);
         blog(LOG_INFO, "[FrameWriter] Capturing from main video output (program)");
-    } else {
-        // Source capture mode - use tick callback to render source
-        obs_add_tick_callback(tickCallback, this);
-        blog(LOG_INFO, "[FrameWriter] Source capture mode - using tick callback");
     }
     
     m_running.store(true);
+    startReporter();
+    
+    if (m_mode == MODE_SOURCE_CAPTURE) {
+        // Rendered together with every other channel capturing the same source
+        m_nextCaptureFrame = 0;
+        SourceRenderer::instance().add(this);
+        blog(LOG_INFO, "[FrameWriter] Source capture mode - using the shared source renderer");
+    }
     
     blog(LOG_INFO, "[FrameWriter] Frame capture started successfully");
     
@@ -376,12 +670,20 @@ void FrameWriter::stop()
     blog(LOG_INFO, "[FrameWriter] Stopping frame capture...");
     
     m_running.store(false);
+    stopReporter();
     
     if (m_mode == MODE_GLOBAL_OUTPUT) {
         obs_remove_raw_video_callback(rawVideoCallback, this);
     } else {
-        // Remove tick callback
-        obs_remove_tick_callback(tickCallback, this);
+        // Waits for a capture in progress
+        SourceRenderer::instance().remove(this);
+        
+        // Consumers go back to the shm slots until we publish textures again
+        std::lock_guard<ProducerToken> producerLock(m_producer);
+        if (m_publishedTextureGeneration != 0 && m_shm->isConnected()) {
+            m_shm->setSharedTextures(SL_TEXTURE_API_NONE, 0, nullptr, 0, 0, 0, 0);
+        }
+        m_publishedTextureGeneration = 0;
         
         std::lock_guard<std::mutex> lock(m_sourceMutex);
         if (m_currentSource) {
@@ -396,7 +698,32 @@ void FrameWriter::stop()
     blog(LOG_INFO, "[FrameWriter]   Total frames: %llu", stats.totalFrames);
     blog(LOG_INFO, "[FrameWriter]   Written frames: %llu", stats.writtenFrames);
     blog(LOG_INFO, "[FrameWriter]   Dropped frames: %llu", stats.droppedFrames);
+    if (stats.backpressureFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter]   Ring backpressure: %llu frame(s) skipped", stats.backpressureFrames);
+    }
+    if (stats.contendedFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter]   Producer contention: %llu frame(s) skipped", stats.contendedFrames);
+    }
+    if (stats.idleFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter]   Idle (no consumer demand): %llu frame(s) not captured", stats.idleFrames);
+    }
+    if (m_changeDetection.load(std::memory_order_relaxed)) {
+        blog(LOG_INFO, "[FrameWriter]   Unchanged frames skipped: %llu, dirty tiles: %.1f%% of compared frames",
+             stats.unchangedFrames, stats.dirtyTileRatio * 100.0);
+    }
     blog(LOG_INFO, "[FrameWriter]   Average FPS: %.2f", stats.averageFps);
+    if (stats.readbackDepth > 0) {
+        blog(LOG_INFO, "[FrameWriter]   GPU readback: depth %u, %.2f ms added latency",
+             stats.readbackDepth, stats.readbackLatencyMs);
+    }
+    blog(LOG_INFO, "[FrameWriter]   Latency p50/p95/p99/max (ms): callback %s, convert %s, write %s, pickup %s, total %s",
+         latencyString(stats.callbackLatency).c_str(), latencyString(stats.conversionLatency).c_str(),
+         latencyString(stats.writeLatency).c_str(), latencyString(stats.pickupLatency).c_str(),
+         latencyString(stats.totalLatency).c_str());
+    if (stats.conversionThreads > 0) {
+        blog(LOG_INFO, "[FrameWriter]   Conversion bands (%u worker(s) + caller) p50/p95/p99/max (ms): %s",
+             stats.conversionThreads, latencyString(stats.bandLatency).c_str());
+    }
     
     blog(LOG_INFO, "[FrameWriter] Frame capture stopped");
 }
@@ -412,6 +739,14 @@ FrameStatistics FrameWriter::getStatistics() const
     stats.totalFrames = m_totalFrames.load();
     stats.droppedFrames = m_droppedFrames.load();
     stats.writtenFrames = m_writtenFrames.load();
+    stats.backpressureFrames = m_backpressureFrames.load(std::memory_order_relaxed);
+    stats.unchangedFrames = m_unchangedFrames.load(std::memory_order_relaxed);
+    stats.contendedFrames = m_contendedFrames.load(std::memory_order_relaxed);
+    stats.idleFrames = m_idleFrames.load(std::memory_order_relaxed);
+    const uint64_t compared = m_comparedFrames.load(std::memory_order_relaxed);
+    stats.dirtyTileRatio = compared > 0
+        ? m_dirtyTiles.load(std::memory_order_relaxed) / ((double)compared * ChangeDetector::TILE_COUNT)
+        : 0.0;
     
     // Calculate average FPS
     uint64_t elapsed_ns = os_gettime_ns() - m_startTime;
@@ -422,25 +757,141 @@ FrameStatistics FrameWriter::getStatistics() const
         stats.averageFps = 0.0;
     }
     
-    stats.averageLatencyMs = 0.0; // TODO: Implement latency tracking
+    stats.callbackLatency = m_callbackLatency.summary();
+    stats.conversionLatency = m_conversionLatency.summary();
+    stats.writeLatency = m_writeLatency.summary();
+    stats.pickupLatency = m_pickupLatency.summary();
+    stats.totalLatency = m_totalLatency.summary();
+    stats.averageLatencyMs = stats.totalLatency.meanMs;
+    stats.conversionThreads = m_bandPool->workerCount();
+    stats.bandLatency = m_bandLatency.summary();
+    
+    // GPU readback pipeline (source capture / preview filter only)
+    stats.readbackDepth = m_lastReadbackDepth.load(std::memory_order_relaxed);
+    uint64_t samples = m_readbackSamples.load(std::memory_order_relaxed);
+    stats.readbackLatencyMs = samples > 0
+        ? (m_readbackLatencyNs.load(std::memory_order_relaxed) / (double)samples) / 1000000.0
+        : 0.0;
     
     return stats;
 }
 
+void FrameWriter::setReadbackDepth(uint32_t depth)
+{
+    depth = std::clamp(depth, 1u, MAX_READBACK_DEPTH);
+    m_readbackDepth.store(depth, std::memory_order_relaxed);
+    blog(LOG_INFO, "[FrameWriter:%s] Readback depth: %u", m_channelName.c_str(), depth);
+}
+
+void FrameWriter::setConversionThreads(uint32_t workers, uint64_t affinityMask)
+{
+    // run() is only called with m_producer held, so the pool can be rebuilt here
+    std::lock_guard<ProducerToken> lock(m_producer);
+    m_bandPool->configure(workers, affinityMask);
+    m_bandLatency.reset();
+}
+
+void FrameWriter::setPreviewRate(uint32_t fps)
+{
+    m_previewFps.store(fps, std::memory_order_relaxed);
+    blog(LOG_INFO, "[FrameWriter:%s] Preview rate: %u FPS%s", m_channelName.c_str(), fps, fps == 0 ? " (canvas rate)" : "");
+}
+
+void FrameWriter::setGpuConversion(bool enabled)
+{
+    m_gpuConversion.store(enabled, std::memory_order_relaxed);
+    blog(LOG_INFO, "[FrameWriter:%s] GPU conversion: %s", m_channelName.c_str(), enabled ? "on" : "off");
+}
+
+void FrameWriter::setChangeDetection(bool enabled)
+{
+    std::lock_guard<ProducerToken> lock(m_producer);
+    m_changeDetector->reset();
+    m_changeDetection.store(enabled, std::memory_order_relaxed);
+    blog(LOG_INFO, "[FrameWriter:%s] Change detection: %s", m_channelName.c_str(), enabled ? "on" : "off");
+}
+
+void FrameWriter::setScaleFilter(ScaleFilter filter)
+{
+    std::lock_guard<ProducerToken> lock(m_producer);
+    m_scaleFilter = filter;
+    m_plan.valid = false;
+    blog(LOG_INFO, "[FrameWriter:%s] Scale filter: %s", m_channelName.c_str(), scaleFilterName(filter));
+}
+
+bool FrameWriter::startRecording(const std::string &path, uint64_t maxBytes)
+{
+    stopRecording();
+    if (!m_recorder->open(path, m_channelName, maxBytes)) {
+        blog(LOG_WARNING, "[FrameWriter:%s] Can't record to %s", m_channelName.c_str(), path.c_str());
+        return false;
+    }
+    blog(LOG_INFO, "[FrameWriter:%s] Recording incoming frames to %s (up to %llu MB)", m_channelName.c_str(), path.c_str(),
+         (unsigned long long)(maxBytes >> 20));
+    return true;
+}
+
+void FrameWriter::stopRecording()
+{
+    if (!m_recorder->isOpen()) return;
+    const uint64_t frames = m_recorder->frameCount();
+    const uint64_t bytes = m_recorder->bytesUsed();
+    m_recorder->close();
+    blog(LOG_INFO, "[FrameWriter:%s] Recorded %llu frame(s), %llu MB to %s", m_channelName.c_str(),
+         (unsigned long long)frames, (unsigned long long)(bytes >> 20), m_recorder->path().c_str());
+}
+
+void FrameWriter::recordFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format,
+                              uint64_t timestampNs, enum video_colorspace colorspace, enum video_range_type range, uint64_t arrivalNs)
+{
+    const SourceFrame frame = { data, linesize, width, height, toSourceFormat(format), nullptr };
+    if (m_recorder->append(frame, format, colorspace, range, timestampNs, arrivalNs) || !m_recorder->isFull()) return;
+    
+    // Full: close it now so the frames so far are on disk without a stopRecording()
+    blog(LOG_WARNING, "[FrameWriter:%s] Recording full - stopped", m_channelName.c_str());
+    stopRecording();
+}
+
+bool FrameWriter::gpuConversionTarget(uint32_t srcWidth, uint32_t srcHeight, uint32_t &dstWidth, uint32_t &dstHeight, uint32_t &format)
+{
+    // A busy channel gets the unconverted render; its frame is counted as contended anyway
+    std::unique_lock<ProducerToken> lock(m_producer, std::try_to_lock);
+    if (!lock.owns_lock()) return false;
+    if (!m_shm || !m_shm->isConnected()) return false;
+    if (!resolveOutputGeometry(srcWidth, srcHeight, dstWidth, dstHeight)) return false;
+    
+    format = m_shm->getBuffer()->format.load(std::memory_order_relaxed);
+    const GpuConverter::Target target = { dstWidth, dstHeight, format, nullptr };
+    return GpuConverter::supports(target);
+}
+
+void FrameWriter::recordReadbackLatency(uint32_t depth, uint64_t latencyNs, uint64_t stallNs)
+{
+    m_lastReadbackDepth.store(depth, std::memory_order_relaxed);
+    m_readbackLatencyNs.fetch_add(latencyNs, std::memory_order_relaxed);
+    m_readbackSamples.fetch_add(1, std::memory_order_relaxed);
+    recordMetric(m_metrics->readback_stall_ns, stallNs);
+}
+
 void FrameWriter::rawVideoCallback(void *param, struct video_data *frame)
 {
     FrameWriter *writer = static_cast<FrameWriter*>(param);
     if (writer && writer->isRunning()) {
-        // For global output, we need to get format info from OBS
-        struct obs_video_info ovi;
-        obs_get_video_info(&ovi);
+        // The frame carries no format info; use the cached OBS output settings
+        if (writer->m_videoInfoStale.exchange(false, std::memory_order_acq_rel)) {
+            obs_get_video_info(&writer->m_videoInfo);
+        }
+        const struct obs_video_info &ovi = writer->m_videoInfo;
         
         writer->processFrame(
             (const uint8_t *const *)frame->data, 
             frame->linesize, 
             ovi.output_width, 
             ovi.output_height, 
-            ovi.output_format
+            ovi.output_format,
+            frame->timestamp,
+            ovi.colorspace,
+            ovi.range
         );
     }
 }
@@ -455,488 +906,596 @@ void FrameWriter::sourceVideoCallback(void *param, obs_source_t *source, const s
             frame->linesize, 
             frame->width, 
             frame->height, 
-            frame->format
+            frame->format,
+            frame->timestamp,
+            frameColorspace(frame),
+            frame->full_range ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL
         );
     }
 }
 
-void FrameWriter::tickCallback(void *param, float seconds)
+bool FrameWriter::captureDue(const struct obs_video_info &ovi, uint64_t canvasFrame)
 {
-    FrameWriter *writer = static_cast<FrameWriter*>(param);
-    if (!writer || !writer->isRunning()) return;
+    const uint32_t divisor = resolveCaptureDivisor(ovi);
+    if (canvasFrame < m_nextCaptureFrame) return false;
     
-    // Accumulate time and capture at ~30 FPS
-    writer->m_tickAccumulator += seconds;
-    const float targetInterval = 1.0f / 30.0f; // 30 FPS
+    m_nextCaptureFrame = (canvasFrame / divisor + 1) * divisor;
     
-    if (writer->m_tickAccumulator >= targetInterval) {
-        writer->m_tickAccumulator -= targetInterval;
-        writer->captureSourceFrame();
-    }
+    // Idle and paused channels skip the render and readback entirely
+    return checkConsumerDemand() && !checkPause();
 }
 
-void FrameWriter::captureSourceFrame()
+bool FrameWriter::checkConsumerDemand()
 {
-    obs_source_t *source = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(m_sourceMutex);
-        source = m_currentSource;
-        if (source) {
-            obs_source_get_ref(source);
+    // Without a connection the write fails and is counted as before
+    const bool demand = !m_shm->isConnected() || m_shm->hasConsumerDemand();
+    if (!demand) {
+        m_idleFrames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(m_metrics->skipped_idle);
+    }
+    
+    // Log each transition once, whichever thread sees it first
+    bool expected = demand;
+    if (m_suspended.load(std::memory_order_relaxed) == demand &&
+        m_suspended.compare_exchange_strong(expected, !demand, std::memory_order_relaxed)) {
+        if (demand) {
+            m_resumedAtNs.store(os_gettime_ns(), std::memory_order_relaxed);
+            blog(LOG_INFO, "[FrameWriter:%s] Consumer demand - resuming capture", m_channelName.c_str());
+        } else {
+            blog(LOG_INFO, "[FrameWriter:%s] No consumer has asked for a frame in %.1f s - suspending capture (still connected)",
+                 m_channelName.c_str(), SL_DEMAND_TIMEOUT_NS / 1000000000.0);
         }
     }
+    return demand;
+}
+
+bool FrameWriter::publishTexture(gs_texture_t *texture, uint32_t width, uint32_t height, uint64_t captureTimeNs)
+{
+    std::unique_lock<ProducerToken> lock(m_producer, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // Dropped rather than waiting on the other producer
+        m_totalFrames.fetch_add(1);
+        countMetric(m_metrics->frames_in);
+        m_contendedFrames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(m_metrics->skipped_contended);
+        m_droppedFrames.fetch_add(1);
+        countMetric(m_metrics->frames_dropped);
+        return true;
+    }
+    if (m_textureShareFailed || !m_shm || !m_shm->isConnected()) return false;
+    SharedFrameBuffer *buffer = m_shm->getBuffer();
+    if (!(buffer->flags & SL_FLAG_SHARED_TEXTURE) || !TextureShare::isSupported()) return false;
     
-    if (!source) return;
+    // Acknowledged here too: texture frames skip resolveOutputGeometry()
+    applyReconfigure(buffer);
     
-    // Get source dimensions
-    uint32_t width = obs_source_get_width(source);
-    uint32_t height = obs_source_get_height(source);
+    if (!m_textureShare) {
+        m_textureShare = new TextureShare();
+    }
     
-    if (width == 0 || height == 0) {
-        obs_source_release(source);
-        return;
+    uint32_t index = 0;
+    const TextureShare::Result result = m_textureShare->copy(texture, width, height, m_shm->busySharedTextures(), index);
+    if (result == TextureShare::UNAVAILABLE) {
+        blog(LOG_WARNING, "[FrameWriter:%s] Shared textures unavailable - falling back to shm frames",
+             m_channelName.c_str());
+        m_shm->setSharedTextures(SL_TEXTURE_API_NONE, 0, nullptr, 0, 0, 0, 0);
+        m_publishedTextureGeneration = 0;
+        m_textureShareFailed = true;
+        return false;
     }
     
-    obs_enter_graphics();
+    m_totalFrames.fetch_add(1);
+    countMetric(m_metrics->frames_in);
+    m_metrics->updated_ns.store(os_gettime_ns(), std::memory_order_relaxed);
+    if (result == TextureShare::BUSY) {
+        m_droppedFrames.fetch_add(1);
+        countMetric(m_metrics->frames_dropped);
+        return true;
+    }
     
-    // Create or resize texrender and stagesurf if needed
-    if (!m_texrender) {
-        m_texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-        if (!m_texrender) {
-            blog(LOG_ERROR, "[FrameWriter] Failed to create texrender");
-            obs_leave_graphics();
-            obs_source_release(source);
-            return;
-        }
+    // New handles (first frame, resize) go out before the frame that uses them
+    if (m_textureShare->generation() != m_publishedTextureGeneration) {
+        m_shm->setSharedTextures(m_textureShare->api(), m_textureShare->count(), m_textureShare->handles(),
+                                 m_textureShare->width(), m_textureShare->height(), m_textureShare->format(),
+                                 TextureShare::SYNC_KEY);
+        m_publishedTextureGeneration = m_textureShare->generation();
+        blog(LOG_INFO, "[FrameWriter:%s] Publishing %u shared %ux%u texture(s)", m_channelName.c_str(),
+             m_textureShare->count(), m_textureShare->width(), m_textureShare->height());
     }
     
-    if (m_captureWidth != width || m_captureHeight != height || !m_stagesurf) {
-        if (m_stagesurf) {
-            gs_stagesurface_destroy(m_stagesurf);
-            m_stagesurf = nullptr;
-        }
-        m_stagesurf = gs_stagesurface_create(width, height, GS_RGBA);
-        if (!m_stagesurf) {
-            blog(LOG_ERROR, "[FrameWriter] Failed to create stagesurface %dx%d", width, height);
-            obs_leave_graphics();
-            obs_source_release(source);
-            return;
-        }
-        m_captureWidth = width;
-        m_captureHeight = height;
-        blog(LOG_INFO, "[FrameWriter] Preview capture resized to %dx%d", width, height);
+    m_shm->commitTexture(index, captureTimeNs);
+    m_writtenFrames.fetch_add(1);
+    countMetric(m_metrics->frames_written);
+    return true;
+}
+
+obs_source_t *FrameWriter::getSourceRef()
+{
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    return m_currentSource ? obs_source_get_ref(m_currentSource) : nullptr;
+}
+
+bool FrameWriter::hasSource()
+{
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    return m_currentSource && !obs_source_removed(m_currentSource);
+}
+
+uint32_t FrameWriter::resolveCaptureDivisor(const struct obs_video_info &ovi)
+{
+    SharedFrameBuffer *buffer = m_shm->isConnected() ? m_shm->getBuffer() : nullptr;
+    const uint32_t requested = buffer ? buffer->requested_capture_fps.load(std::memory_order_relaxed) : 0;
+    const uint32_t fps = requested != 0 ? requested : m_previewFps.load(std::memory_order_relaxed);
+    
+    // Nearest whole number of canvas frames per capture (30 on 59.94 -> 2)
+    uint32_t divisor = 1;
+    if (fps != 0) {
+        const uint64_t scaled = (uint64_t)fps * ovi.fps_den;
+        divisor = (uint32_t)std::max<uint64_t>(1, (ovi.fps_num + scaled / 2) / scaled);
     }
     
-    // Reset the texrender before each use
-    gs_texrender_reset(m_texrender);
+    if (divisor != m_captureDivisor) {
+        m_captureDivisor = divisor;
+        m_nextCaptureFrame = 0;
+        blog(LOG_INFO, "[FrameWriter:%s] Capture rate %.2f FPS (every %u canvas frame(s) at %.2f FPS%s)",
+             m_channelName.c_str(), (double)ovi.fps_num / ((double)ovi.fps_den * divisor), divisor,
+             (double)ovi.fps_num / ovi.fps_den, requested != 0 ? ", requested by consumer" : "");
+    }
     
-    // Render source to texture
-    if (gs_texrender_begin(m_texrender, width, height)) {
-        struct vec4 clear_color;
-        vec4_zero(&clear_color);
-        gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+    if (buffer) {
+        buffer->capture_fps_num.store(ovi.fps_num, std::memory_order_relaxed);
+        buffer->capture_fps_den.store(ovi.fps_den * divisor, std::memory_order_relaxed);
+    }
+    return divisor;
+}
+
+void FrameWriter::processFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint64_t timestampNs,
+                               enum video_colorspace colorspace, enum video_range_type range)
+{
+    m_totalFrames.fetch_add(1);
+    countMetric(m_metrics->frames_in);
+    
+    // Frames stamped on the os_gettime_ns() clock measure OBS -> callback delay
+    uint64_t now = os_gettime_ns();
+    m_metrics->updated_ns.store(now, std::memory_order_relaxed);
+    const bool validTimestamp = timestampNs != 0 && timestampNs <= now && now - timestampNs < MAX_LATENCY_SAMPLE_NS;
+    if (validTimestamp) {
+        m_callbackLatency.record(now - timestampNs);
+    }
+    
+    // Raw input for replay, ahead of everything that may drop the frame
+    if (m_recorder->isOpen()) {
+        recordFrame(data, linesize, width, height, format, timestampNs, colorspace, range, now);
+    }
+    
+    // Nobody is reading: stay connected, but skip the conversion and write
+    if (!checkConsumerDemand()) return;
+    
+    // A source capture that just resumed still has frames staged before it
+    // went idle in the readback pipeline; they are stale
+    if (m_mode == MODE_SOURCE_CAPTURE && timestampNs < m_resumedAtNs.load(std::memory_order_relaxed)) {
+        m_idleFrames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(m_metrics->skipped_idle);
+        return;
+    }
+    
+    // Frame conversion and write; if another producer (e.g. the preview filter on
+    // the graphics thread) is mid-frame on this channel, skip instead of waiting
+    {
+        std::unique_lock<ProducerToken> lock(m_producer, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            m_contendedFrames.fetch_add(1, std::memory_order_relaxed);
+            countMetric(m_metrics->skipped_contended);
+            m_droppedFrames.fetch_add(1);
+            countMetric(m_metrics->frames_dropped);
+            return;
+        }
         
-        gs_ortho(0.0f, (float)width, 0.0f, (float)height, -100.0f, 100.0f);
-        gs_blend_state_push();
-        gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+        // Confirmed while holding the token, so no write of ours is in flight
+        if (checkPause()) return;
         
-        obs_source_video_render(source);
+        sampleConsumerPickup();
         
-        gs_blend_state_pop();
-        gs_texrender_end(m_texrender);
+        // Output size comes from the shared header (native size if the consumer allows it)
+        uint32_t dstWidth = 0;
+        uint32_t dstHeight = 0;
+        if (!resolveOutputGeometry(width, height, dstWidth, dstHeight)) {
+            m_droppedFrames.fetch_add(1);
+            countMetric(m_metrics->frames_dropped);
+            return;
+        }
         
-        // Copy to staging surface
-        gs_texture_t *tex = gs_texrender_get_texture(m_texrender);
-        if (tex && m_stagesurf) {
-            gs_stage_texture(m_stagesurf, tex);
-            
-            // Map and read pixels
-            uint8_t *ptr;
-            uint32_t linesize;
-            if (gs_stagesurface_map(m_stagesurf, &ptr, &linesize)) {
-                // Pass to processFrame
-                const uint8_t *data_arr[1] = { ptr };
-                const uint32_t linesize_arr[1] = { linesize };
-                
-                processFrame(data_arr, linesize_arr, width, height, VIDEO_FORMAT_RGBA);
-                
-                gs_stagesurface_unmap(m_stagesurf);
-            } else {
-                blog(LOG_WARNING, "[FrameWriter] Failed to map stagesurface");
+        // Skip frames identical to the last one published (up to the refresh interval)
+        bool compared = false;
+        if (m_changeDetection.load(std::memory_order_relaxed)) {
+            const uint64_t outputKey = ((uint64_t)dstWidth << 32 | dstHeight) ^
+                                       ((uint64_t)m_shm->getBuffer()->format.load(std::memory_order_relaxed) << 60);
+            const bool refreshDue = now - m_lastPublishTime >= CHANGE_REFRESH_INTERVAL_NS;
+            if (m_changeDetector->analyze(data, linesize, width, height, format, outputKey)
+                && m_changeDetector->hasReference() && !refreshDue) {
+                if (m_changeDetector->dirtyCount() == 0) {
+                    m_unchangedFrames.fetch_add(1, std::memory_order_relaxed);
+                    countMetric(m_metrics->skipped_unchanged);
+                    return;
+                }
+                compared = true;
             }
+        }
+        
+        // Acquire the next shared memory slot and convert straight into it
+        const uint64_t writeStart = os_gettime_ns();
+        unsigned char *slot = m_shm->beginWrite();
+        if (!slot) {
+            m_droppedFrames.fetch_add(1);
+            countMetric(m_metrics->frames_dropped);
+            // Don't log every dropped frame - only in stats (and ring stalls once)
+            noteRingBackpressure(true);
+            return;
+        }
+        noteRingBackpressure(false);
+        if (compared) {
+            m_shm->setDirtyTiles(m_changeDetector->dirtyTiles());
+        }
+        
+        // Planar channels get the Y/UV planes as-is; everything else is expanded to packed pixels
+        const ConversionPlan &plan = conversionPlan(linesize, width, height, format, colorspace, range, dstWidth, dstHeight);
+        const uint64_t convertStart = os_gettime_ns();
+        if (plan.planar) {
+            if (!convertToPlanar(data, linesize, width, height, format, slot)) {
+                m_shm->abortWrite();
+                m_droppedFrames.fetch_add(1);
+                countMetric(m_metrics->frames_dropped);
+                return;
+            }
+            m_shm->setColorimetry(plan.slotMatrix, plan.slotRange);
         } else {
-            blog(LOG_WARNING, "[FrameWriter] tex=%p stagesurf=%p", (void*)tex, (void*)m_stagesurf);
+            convertToPacked(data, linesize, width, height, format, slot, dstWidth, dstHeight);
         }
-    } else {
-        blog(LOG_WARNING, "[FrameWriter] Failed to begin texrender (width=%u height=%u)", width, height);
+        const uint64_t convertEnd = os_gettime_ns();
+        
+        // Publish the slot to the consumer (timestamps go to its descriptor)
+        if (!m_shm->commitWrite(timestampNs, now)) {
+            m_droppedFrames.fetch_add(1);
+            countMetric(m_metrics->frames_dropped);
+            return;
+        }
+        m_writtenFrames.fetch_add(1);
+        countMetric(m_metrics->frames_written);
+        
+        if (m_changeDetection.load(std::memory_order_relaxed)) {
+            m_changeDetector->commit();
+            m_lastPublishTime = now;
+            if (compared) {
+                m_comparedFrames.fetch_add(1, std::memory_order_relaxed);
+                m_dirtyTiles.fetch_add(m_changeDetector->dirtyCount(), std::memory_order_relaxed);
+            }
+        }
+        
+        const uint64_t published = os_gettime_ns();
+        m_conversionLatency.record(convertEnd - convertStart);
+        recordMetric(m_metrics->conversion_ns, convertEnd - convertStart);
+        m_writeLatency.record((convertStart - writeStart) + (published - convertEnd));
+        m_totalLatency.record(published - (validTimestamp ? timestampNs : now));
+        recordMetric(m_metrics->frame_latency_ns, published - (validTimestamp ? timestampNs : now));
     }
+}
+
+/**
+ * Report ring-mode backpressure
+ * 
+ * A full ring means the slowest recording consumer is behind: log once when it
+ * fills and once when it drains, and count every skipped frame.
+ */
+void FrameWriter::noteRingBackpressure(bool full)
+{
+    SharedFrameBuffer *buffer = m_shm->getBuffer();
+    if (!buffer || !isRingMode(buffer)) return;
     
-    obs_leave_graphics();
-    obs_source_release(source);
+    if (full) {
+        m_backpressureFrames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(m_metrics->skipped_ring_full);
+        if (m_ringStallFrames++ == 0) {
+            blog(LOG_WARNING, "[FrameWriter:%s] Ring full (%u slots): slowest consumer is behind, skipping frames",
+                 m_channelName.c_str(), buffer->slot_count);
+        }
+    } else if (m_ringStallFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter:%s] Ring drained after %llu skipped frame(s)",
+             m_channelName.c_str(), (unsigned long long)m_ringStallFrames);
+        m_ringStallFrames = 0;
+    }
 }
 
-void FrameWriter::processFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format)
+/**
+ * Sample consumer pickup latency
+ * 
+ * Each registered consumer writes the frame number and time of its last
+ * read into its registration. The first pickup of a frame we have not
+ * sampled yet is matched against the slot descriptors; if that slot has
+ * not been reused, it still holds our capture time.
+ */
+void FrameWriter::sampleConsumerPickup()
 {
-    m_totalFrames.fetch_add(1);
+    SharedFrameBuffer *buffer = m_shm->getBuffer();
+    if (!buffer) return;
     
-    // Log statistics every 5 seconds
-    uint64_t now = os_gettime_ns();
-    if (now - m_lastStatsTime >= 5000000000ULL) { // 5 seconds
-        auto stats = getStatistics();
-        blog(LOG_INFO, "[FrameWriter:%s] Stats: %llu frames, %.2f FPS, %llu dropped",
-             m_channelName.c_str(), stats.totalFrames, stats.averageFps, stats.droppedFrames);
-        m_lastStatsTime = now;
+    uint64_t frame = 0;
+    uint64_t readNs = 0;
+    for (uint32_t i = 0; i < SL_MAX_CONSUMERS; i++) {
+        const ConsumerRegistration &consumer = buffer->consumers[i];
+        if (consumer.owner.load(std::memory_order_relaxed) == 0) continue;
+        const uint64_t read = consumer.read_frame.load(std::memory_order_acquire);
+        if (read > m_lastPickupFrame && (frame == 0 || read < frame)) {
+            frame = read;
+            readNs = consumer.read_timestamp_ns.load(std::memory_order_relaxed);
+        }
     }
+    if (frame == 0) return;
+    m_lastPickupFrame = frame;
     
-    // Thread-safe frame conversion and write
-    {
-        std::lock_guard<std::mutex> lock(m_frameMutex);
-        
-        // Convert frame to RGBA with proper stride handling
-        convertToRGBA(data, linesize, width, height, format, m_frameBuffer.data());
+    for (uint32_t i = 0; i < buffer->slot_count && i < SL_MAX_SLOTS; i++) {
+        uint32_t sequence = 0;
+        if (!beginSlotRead(buffer, i, sequence)) continue;
+        const uint64_t slotFrame = buffer->slots[i].frame_number;
+        const uint64_t captureNs = buffer->slots[i].capture_time_ns;
+        if (!endSlotRead(buffer, i, sequence) || slotFrame != frame) continue;
         
-        // Write to shared memory
-        if (!m_shm->writeFrame(m_frameBuffer.data(), m_frameBuffer.size())) {
-            m_droppedFrames.fetch_add(1);
-            // Don't log every dropped frame - only in stats
-        } else {
-            m_writtenFrames.fetch_add(1);
+        if (readNs >= captureNs && readNs - captureNs < MAX_LATENCY_SAMPLE_NS) {
+            m_pickupLatency.record(readNs - captureNs);
+            recordMetric(m_metrics->consumer_lag_ns, readNs - captureNs);
         }
+        return;
     }
 }
 
 /**
- * Convert video frame to RGBA format
+ * Resolve the geometry of the frame to publish
+ * 
+ * The header written by the consumer at create() is the source of truth,
+ * including the pixel format: RGBA/BGRA/RGBX/premultiplied RGBA, or
+ * NV12/I420 for planar passthrough.
+ * If it set SL_FLAG_ACCEPT_NATIVE_SIZE and the source frame fits a slot,
+ * the source size is published instead so no scaling is needed.
+ */
+bool FrameWriter::resolveOutputGeometry(uint32_t srcWidth, uint32_t srcHeight, uint32_t &dstWidth, uint32_t &dstHeight)
+{
+    SharedFrameBuffer *buffer = m_shm->getBuffer();
+    if (!buffer) return false;
+    
+    applyReconfigure(buffer);
+    
+    const uint32_t format = buffer->format.load(std::memory_order_relaxed);
+    if (!isPackedRgbaFormat(format) && !isPlanarFormat(format)) {
+        if (!m_loggedFormatError) {
+            blog(LOG_ERROR, "[FrameWriter:%s] Unsupported channel pixel format %u", m_channelName.c_str(), format);
+            m_loggedFormatError = true;
+        }
+        return false;
+    }
+    
+    dstWidth = buffer->width.load(std::memory_order_relaxed);
+    dstHeight = buffer->height.load(std::memory_order_relaxed);
+    
+    if ((buffer->flags & SL_FLAG_ACCEPT_NATIVE_SIZE) && (dstWidth != srcWidth || dstHeight != srcHeight)) {
+        const uint64_t nativeSize = frameSizeFor(srcWidth, srcHeight, format);
+        if (srcWidth > 0 && srcHeight > 0 && nativeSize <= buffer->slot_size) {
+            // Publish the new geometry (and plane layout) before the first frame that uses it
+            setFrameGeometry(buffer, srcWidth, srcHeight, format);
+            countMetric(m_metrics->format_changes);
+            blog(LOG_INFO, "[FrameWriter:%s] Publishing native size %ux%u (was %ux%u)",
+                 m_channelName.c_str(), srcWidth, srcHeight, dstWidth, dstHeight);
+            dstWidth = srcWidth;
+            dstHeight = srcHeight;
+        }
+    }
+    
+    return dstWidth > 0 && dstHeight > 0
+        && frameSizeFor(dstWidth, dstHeight, format) <= buffer->slot_size;
+}
+
+/**
+ * Convert video frame to the channel's packed format
  * 
  * OBS typically provides frames in NV12 or I420 format.
- * We need to convert to RGBA for WebGL rendering.
+ * We need to convert to RGBA (or BGRA/RGBX/premultiplied) for WebGL rendering.
  */
-void FrameWriter::convertToRGBA(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *rgbaBuffer)
+void FrameWriter::convertToPacked(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight)
 {
     // Safety check for invalid resolution
-    if (width == 0 || height == 0) {
+    if (width == 0 || height == 0 || dstWidth == 0 || dstHeight == 0) {
         return;
     }
     
-    // Validate linesize (detect stride/alignment issues)
-    const uint32_t expected_linesize_rgba = width * 4;
-    const uint32_t expected_linesize_yuv = width;
-    const uint32_t actual_linesize = linesize[0];
-    
-    // Debug logging for first few frames or if format changes
-    static uint32_t last_log_time = 0;
-    static int log_counter = 0;
-    uint32_t now = (uint32_t)(os_gettime_ns() / 1000000000ULL);
+    const SourceFrame source = { data, linesize, width, height, m_plan.sourceFormat, m_plan.matrix };
+    const PackedConverter convert = m_plan.convert;
+    std::atomic<bool> failed(false);
     
-    // Force log for the first 100 calls to ensure we catch it
-    if (log_counter < 100 || now != last_log_time) {
-        blog(LOG_INFO, "[FrameWriter] Frame Info: %dx%d, Format: %d, Linesize: %u, %u, %u", 
-             width, height, format, linesize[0], linesize[1], linesize[2]);
+    // Split into horizontal bands on the worker pool; the slot is only
+    // published by the caller after run() returns, i.e. once every band is done
+    const uint32_t rowsPerBand = m_plan.rowsPerBand;
+    m_bandPool->run(m_plan.bands, [&](uint32_t band) {
+        const uint32_t rowBegin = band * rowsPerBand;
+        const uint32_t rowEnd = std::min(dstHeight, rowBegin + rowsPerBand);
+        if (rowBegin >= rowEnd) return;
         
-        // Warn about stride mismatches
-        if (format == VIDEO_FORMAT_RGBA || format == VIDEO_FORMAT_BGRA) {
-            if (actual_linesize != expected_linesize_rgba) {
-                blog(LOG_WARNING, "[FrameWriter] STRIDE MISMATCH: Expected %u, got %u (padding: %u bytes)",
-                     expected_linesize_rgba, actual_linesize, actual_linesize - expected_linesize_rgba);
-            }
-        } else if (format == VIDEO_FORMAT_NV12 || format == VIDEO_FORMAT_I420) {
-             if (actual_linesize != expected_linesize_yuv) {
-                blog(LOG_WARNING, "[FrameWriter] YUV STRIDE MISMATCH: Expected %u, got %u (padding: %u bytes)",
-                     expected_linesize_yuv, actual_linesize, actual_linesize - expected_linesize_yuv);
-            }
+        const uint64_t bandStart = os_gettime_ns();
+        if (!convert(source, m_plan.scale, dst, dstWidth, dstHeight, rowBegin, rowEnd)) {
+            failed.store(true, std::memory_order_relaxed);
         }
-        
-        last_log_time = now;
-        log_counter++;
+        m_bandLatency.record(os_gettime_ns() - bandStart);
+    });
+    
+    if (failed.load(std::memory_order_relaxed) && !m_plan.reportedError) {
+        blog(LOG_ERROR, "[FrameWriter:%s] Cannot convert video format %d (missing planes or unsupported)",
+             m_channelName.c_str(), format);
+        m_plan.reportedError = true;
     }
+}
 
-    // Calculate scaling factors
-    // We always write to the full FRAME_WIDTH x FRAME_HEIGHT buffer
-    float scale_x = (float)width / FRAME_WIDTH;
-    float scale_y = (float)height / FRAME_HEIGHT;
+/**
+ * Write a frame into a planar (NV12/I420) channel
+ * 
+ * Plane offsets and strides come from the shared header so the consumer can
+ * upload the planes directly and do YUV->RGB in a shader.
+ * Returns false if the source format cannot be written to this channel.
+ */
+bool FrameWriter::convertToPlanar(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *dst)
+{
+    const SharedFrameBuffer *buffer = m_shm->getBuffer();
+    PlanarFrame planes;
+    planes.nv12 = (buffer->format.load(std::memory_order_relaxed) == FORMAT_NV12);
+    planes.width = buffer->width.load(std::memory_order_relaxed);
+    planes.height = buffer->height.load(std::memory_order_relaxed);
+    planes.y = dst + buffer->plane_offset[0];
+    planes.u = dst + buffer->plane_offset[1];
+    planes.v = planes.nv12 ? planes.u + 1 : dst + buffer->plane_offset[2];
+    planes.yStride = buffer->plane_stride[0];
+    planes.uvStride = buffer->plane_stride[1];
+    
+    const SourceFrame source = { data, linesize, width, height, m_plan.sourceFormat, m_plan.matrix };
+    if (convertFrameToPlanar(source, m_plan.scale, planes, m_planarScratch)) return true;
+    
+    if (!m_plan.reportedError) {
+        blog(LOG_ERROR, "[FrameWriter:%s] Video format %d cannot be written to a planar channel",
+             m_channelName.c_str(), format);
+        m_plan.reportedError = true;
+    }
+    return false;
+}
 
-    // Handle different video formats
-    switch (format) {
-        case VIDEO_FORMAT_I420:
-        case VIDEO_FORMAT_NV12:
-            {
-                const bool isNV12 = (format == VIDEO_FORMAT_NV12);
-                const uint8_t *y_plane = data[0];
-                const uint8_t *u_plane = data[1];
-                const uint8_t *v_plane = isNV12 ? nullptr : data[2];
-                const uint32_t y_linesize = linesize[0];
-                const uint32_t u_linesize = linesize[1];
-                const uint32_t v_linesize = isNV12 ? linesize[1] : linesize[2];
-
-                if (!y_plane || !u_plane || (!isNV12 && !v_plane)) {
-                    blog(LOG_WARNING, "[FrameWriter] Missing YUV planes for format %d", format);
-                    break;
-                }
-                
-                // Safety check for zero linesize
-                if (y_linesize == 0 || u_linesize == 0 || (!isNV12 && v_linesize == 0)) {
-                    blog(LOG_ERROR, "[FrameWriter] Invalid linesize for YUV format");
-                    break;
-                }
-                
-                for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                    uint32_t src_y = (uint32_t)(y * scale_y);
-                    if (src_y >= height) src_y = height - 1;
-
-                    const uint8_t *y_row = y_plane + (src_y * y_linesize);
-                    const uint8_t *u_row = u_plane + ((src_y / 2) * u_linesize);
-                    const uint8_t *v_row = isNV12 ? nullptr : (v_plane + ((src_y / 2) * v_linesize));
-                    uint8_t *dst_row = rgbaBuffer + (y * FRAME_WIDTH * 4);
-
-                    for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                        uint32_t src_x = (uint32_t)(x * scale_x);
-                        if (src_x >= width) src_x = width - 1;
-
-                        const uint8_t y_val = y_row[src_x];
-                        int u_val = 0;
-                        int v_val = 0;
-
-                        if (isNV12) {
-                            const uint8_t *uv_row = u_row;
-                            uint32_t chroma_offset = (src_x / 2) * 2;
-                            // Ensure we don't read past the end of the row
-                            if (chroma_offset + 1 >= u_linesize) {
-                                chroma_offset = (u_linesize >= 2) ? u_linesize - 2 : 0;
-                            }
-                            u_val = static_cast<int>(uv_row[chroma_offset]) - 128;
-                            v_val = static_cast<int>(uv_row[chroma_offset + 1]) - 128;
-                        } else {
-                            uint32_t chroma_x = src_x / 2;
-                            if (chroma_x >= u_linesize) {
-                                chroma_x = (u_linesize > 0) ? u_linesize - 1 : 0;
-                            }
-                            u_val = static_cast<int>(u_row[chroma_x]) - 128;
-
-                            if (chroma_x >= v_linesize) {
-                                chroma_x = (v_linesize > 0) ? v_linesize - 1 : 0;
-                            }
-                            v_val = static_cast<int>(v_row[chroma_x]) - 128;
-                        }
-
-                        writeRgbaFromYuv(y_val, u_val, v_val, dst_row + (x * 4));
-                    }
-                }
-            }
-            break;
-            
-        case VIDEO_FORMAT_UYVY:
-            // UYVY is 4:2:2 packed. 4 bytes = 2 pixels.
-            // Byte order: U0 Y0 V0 Y1
-            {
-                const uint8_t *src_data = data[0];
-                uint32_t src_linesize = linesize[0];
-                
-                for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                    // Top-Down (No Flip)
-                    uint32_t src_y = (uint32_t)(y * scale_y);
-                    if (src_y >= height) src_y = height - 1;
-                    
-                    uint8_t *dst_row = rgbaBuffer + (y * FRAME_WIDTH * 4);
-                    const uint8_t *src_row = src_data + (src_y * src_linesize);
-                    
-                    for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                        uint32_t src_x = (uint32_t)(x * scale_x);
-                        if (src_x >= width) src_x = width - 1;
-                        
-                        // Calculate block index (2 pixels per block)
-                        uint32_t block_idx = (src_x / 2) * 4;
-                        bool is_second_pixel = (src_x % 2) == 1;
-                        
-                        int u = src_row[block_idx + 0] - 128;
-                        int y_val = src_row[block_idx + 1 + (is_second_pixel ? 2 : 0)];
-                        int v = src_row[block_idx + 2] - 128;
-                        
-                        // Convert
-                        int r = y_val + 1.402 * v;
-                        int g = y_val - 0.344136 * u - 0.714136 * v;
-                        int b = y_val + 1.772 * u;
-                        
-                        dst_row[x * 4 + 0] = (uint8_t)std::clamp(r, 0, 255);
-                        dst_row[x * 4 + 1] = (uint8_t)std::clamp(g, 0, 255);
-                        dst_row[x * 4 + 2] = (uint8_t)std::clamp(b, 0, 255);
-                        dst_row[x * 4 + 3] = 255;
-                    }
-                }
-            }
-            break;
-
-        case VIDEO_FORMAT_YUY2:
-            // YUY2 is 4:2:2 packed. 4 bytes = 2 pixels.
-            // Byte order: Y0 U0 Y1 V0
-            {
-                const uint8_t *src_data = data[0];
-                uint32_t src_linesize = linesize[0];
-                
-                for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                    // Top-Down (No Flip)
-                    uint32_t src_y = (uint32_t)(y * scale_y);
-                    if (src_y >= height) src_y = height - 1;
-                    
-                    uint8_t *dst_row = rgbaBuffer + (y * FRAME_WIDTH * 4);
-                    const uint8_t *src_row = src_data + (src_y * src_linesize);
-                    
-                    for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                        uint32_t src_x = (uint32_t)(x * scale_x);
-                        if (src_x >= width) src_x = width - 1;
-                        
-                        // Calculate block index (2 pixels per block)
-                        uint32_t block_idx = (src_x / 2) * 4;
-                        bool is_second_pixel = (src_x % 2) == 1;
-                        
-                        int y_val = src_row[block_idx + (is_second_pixel ? 2 : 0)];
-                        int u = src_row[block_idx + 1] - 128;
-                        int v = src_row[block_idx + 3] - 128;
-                        
-                        // Convert
-                        int r = y_val + 1.402 * v;
-                        int g = y_val - 0.344136 * u - 0.714136 * v;
-                        int b = y_val + 1.772 * u;
-                        
-                        dst_row[x * 4 + 0] = (uint8_t)std::clamp(r, 0, 255);
-                        dst_row[x * 4 + 1] = (uint8_t)std::clamp(g, 0, 255);
-                        dst_row[x * 4 + 2] = (uint8_t)std::clamp(b, 0, 255);
-                        dst_row[x * 4 + 3] = 255;
-                    }
-                }
-            }
-            break;
-
-        case VIDEO_FORMAT_Y800:
-            // Grayscale 8-bit
-            {
-                const uint8_t *src_data = data[0];
-                uint32_t src_linesize = linesize[0];
-                
-                for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                    // Top-Down (No Flip)
-                    uint32_t src_y = (uint32_t)(y * scale_y);
-                    if (src_y >= height) src_y = height - 1;
-                    
-                    uint8_t *dst_row = rgbaBuffer + (y * FRAME_WIDTH * 4);
-                    const uint8_t *src_row = src_data + (src_y * src_linesize);
-                    
-                    for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                        uint32_t src_x = (uint32_t)(x * scale_x);
-                        if (src_x >= width) src_x = width - 1;
-                        
-                        uint8_t val = src_row[src_x];
-                        dst_row[x * 4 + 0] = val;
-                        dst_row[x * 4 + 1] = val;
-                        dst_row[x * 4 + 2] = val;
-                        dst_row[x * 4 + 3] = 255;
-                    }
-                }
-            }
-            break;
-
-        case VIDEO_FORMAT_RGBA:
-            // Already RGBA - use proper stride handling
-            {
-                const uint8_t *src_data = data[0];
-                const uint32_t src_linesize = linesize[0];
-                const uint32_t src_stride = src_linesize; // OBS stride (may include padding)
-                const uint32_t dst_stride = FRAME_WIDTH * 4; // Our buffer stride (no padding)
-                
-                // If resolutions match and no padding, use fast path
-                if (width == FRAME_WIDTH && height == FRAME_HEIGHT && src_linesize == dst_stride) {
-                    // Fast memcpy - no scaling, no stride conversion needed
-                    std::memcpy(rgbaBuffer, src_data, FRAME_SIZE);
-                } else {
-                    // Slow path with proper stride handling
-                    for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                        uint32_t src_y = (uint32_t)(y * scale_y);
-                        if (src_y >= height) src_y = height - 1;
-                        
-                        uint8_t *dst_row = rgbaBuffer + (y * dst_stride);
-                        const uint8_t *src_row = src_data + (src_y * src_stride); // Use stride, not width
-                        
-                        for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                            uint32_t src_x = (uint32_t)(x * scale_x);
-                            if (src_x >= width) src_x = width - 1;
-                            
-                            const uint8_t *src_pixel = src_row + (src_x * 4);
-                            dst_row[x * 4 + 0] = src_pixel[0];
-                            dst_row[x * 4 + 1] = src_pixel[1];
-                            dst_row[x * 4 + 2] = src_pixel[2];
-                            dst_row[x * 4 + 3] = src_pixel[3];
-                        }
-                    }
-                }
-            }
-            break;
-
-        case VIDEO_FORMAT_BGRA:
-            // BGRA to RGBA - use proper stride handling
-            {
-                const uint8_t *src_data = data[0];
-                const uint32_t src_linesize = linesize[0];
-                const uint32_t src_stride = src_linesize; // OBS stride (may include padding)
-                const uint32_t dst_stride = FRAME_WIDTH * 4; // Our buffer stride (no padding)
-                
-                // Optimized path for matching resolutions
-                if (width == FRAME_WIDTH && height == FRAME_HEIGHT) {
-                    // Row-by-row with stride handling and BGRA->RGBA swap
-                    for (uint32_t y = 0; y < height; y++) {
-                        uint8_t *dst_row = rgbaBuffer + (y * dst_stride);
-                        const uint8_t *src_row = src_data + (y * src_stride); // Use stride
-                        
-                        for (uint32_t x = 0; x < width; x++) {
-                            dst_row[x * 4 + 0] = src_row[x * 4 + 2]; // R = B
-                            dst_row[x * 4 + 1] = src_row[x * 4 + 1]; // G = G
-                            dst_row[x * 4 + 2] = src_row[x * 4 + 0]; // B = R
-                            dst_row[x * 4 + 3] = src_row[x * 4 + 3]; // A = A
-                        }
-                    }
-                } else {
-                    // Scaling path with stride handling
-                    for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                        uint32_t src_y = (uint32_t)(y * scale_y);
-                        if (src_y >= height) src_y = height - 1;
-                        
-                        uint8_t *dst_row = rgbaBuffer + (y * dst_stride);
-                        const uint8_t *src_row = src_data + (src_y * src_stride); // Use stride
-                        
-                        for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                            uint32_t src_x = (uint32_t)(x * scale_x);
-                            if (src_x >= width) src_x = width - 1;
-                            
-                            const uint8_t *src_pixel = src_row + (src_x * 4);
-                            dst_row[x * 4 + 0] = src_pixel[2]; // R = B
-                            dst_row[x * 4 + 1] = src_pixel[1]; // G = G
-                            dst_row[x * 4 + 2] = src_pixel[0]; // B = R
-                            dst_row[x * 4 + 3] = src_pixel[3]; // A = A
-                        }
-                    }
-                }
-            }
-            break;
-            
-        default:
-            // Unknown format - fill with Red to indicate error
-            static bool logged_error = false;
-            if (!logged_error) {
-                blog(LOG_ERROR, "[FrameWriter] Unsupported video format: %d", format);
-                logged_error = true;
-            }
-            
-            // Fill with Red
-            for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
-                uint8_t *dst_row = rgbaBuffer + (y * FRAME_WIDTH * 4);
-                for (uint32_t x = 0; x < FRAME_WIDTH; x++) {
-                    dst_row[x * 4 + 0] = 255; // R
-                    dst_row[x * 4 + 1] = 0;   // G
-                    dst_row[x * 4 + 2] = 0;   // B
-                    dst_row[x * 4 + 3] = 255; // A
-                }
-            }
-            break;
+/**
+ * Number of bands for a frame: one per worker plus the calling thread,
+ * but never fewer than MIN_BAND_ROWS rows each
+ */
+uint32_t FrameWriter::conversionBandCount(uint32_t dstHeight) const
+{
+    const uint32_t threads = m_bandPool->workerCount() + 1;
+    return std::max(1u, std::min(threads, dstHeight / MIN_BAND_ROWS));
+}
+
+const FrameWriter::ConversionPlan &FrameWriter::conversionPlan(const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format,
+                                                               enum video_colorspace colorspace, enum video_range_type range, uint32_t dstWidth, uint32_t dstHeight)
+{
+    const uint32_t dstFormat = m_shm->getBuffer()->format.load(std::memory_order_relaxed);
+    const uint32_t workers = m_bandPool->workerCount();
+    ConversionPlan &plan = m_plan;
+    if (plan.valid && plan.format == format && plan.width == width && plan.height == height &&
+        plan.linesize[0] == linesize[0] && plan.linesize[1] == linesize[1] && plan.linesize[2] == linesize[2] &&
+        plan.colorspace == colorspace && plan.range == range && plan.dstWidth == dstWidth && plan.dstHeight == dstHeight && plan.dstFormat == dstFormat &&
+        plan.workers == workers && plan.filter == m_scaleFilter) {
+        return plan;
+    }
+    
+    plan.valid = true;
+    plan.format = format;
+    plan.width = width;
+    plan.height = height;
+    for (uint32_t i = 0; i < 3; i++) plan.linesize[i] = linesize[i];
+    plan.colorspace = colorspace;
+    plan.range = range;
+    plan.dstWidth = dstWidth;
+    plan.dstHeight = dstHeight;
+    plan.dstFormat = dstFormat;
+    plan.workers = workers;
+    plan.filter = m_scaleFilter;
+    plan.sourceFormat = toSourceFormat(format);
+    plan.reportedError = false;
+    plan.planar = isPlanarFormat(dstFormat);
+    plan.bands = conversionBandCount(dstHeight);
+    plan.rowsPerBand = (dstHeight + plan.bands - 1) / plan.bands;
+    
+    
+    // One converter instantiation per geometry: no format branches per row or pixel
+    const bool scaled = (width != dstWidth || height != dstHeight);
+    plan.packedFormat = toPackedFormat(dstFormat);
+    plan.convert = selectPackedConverter(plan.sourceFormat, plan.packedFormat, scaled);
+    plan.matrix = &toYuvMatrix(colorspace, range);
+    plan.slotMatrix = (toColorMatrix(colorspace) == StreamLumo::COLOR_MATRIX_BT709) ? SL_COLOR_MATRIX_BT709 : SL_COLOR_MATRIX_BT601;
+    plan.slotRange = (toColorRange(range) == StreamLumo::COLOR_RANGE_LIMITED) ? SL_COLOR_RANGE_LIMITED : SL_COLOR_RANGE_FULL;
+    if (scaled) {
+        plan.scale.configure(width, height, dstWidth, dstHeight, plan.filter);
+    }
+    
+    blog(LOG_INFO, "[FrameWriter:%s] Frame layout: %ux%u, format %d (%s), linesize %u/%u/%u -> %ux%u %s (%u band(s))%s%s",
+         m_channelName.c_str(), width, height, format, plan.matrix->name, linesize[0], linesize[1], linesize[2],
+         dstWidth, dstHeight, plan.planar ? "planar" : packedFormatName(plan.packedFormat), plan.bands,
+         scaled ? ", scaled " : "", scaled ? scaleFilterName(plan.filter) : "");
+    
+    // Padded rows are handled, but cost an extra pass over the padding
+    const bool packed = format == VIDEO_FORMAT_RGBA || format == VIDEO_FORMAT_BGRA;
+    const bool yuv = format == VIDEO_FORMAT_NV12 || format == VIDEO_FORMAT_I420;
+    const uint32_t expected = packed ? width * 4 : width;
+    if ((packed || yuv) && linesize[0] != expected) {
+        blog(LOG_WARNING, "[FrameWriter:%s] Stride mismatch: expected %u, got %u (padding: %d bytes)",
+             m_channelName.c_str(), expected, linesize[0], (int)linesize[0] - (int)expected);
     }
+    return plan;
+}
+
+void FrameWriter::startReporter()
+{
+    std::lock_guard<std::mutex> lock(m_reporterMutex);
+    if (m_reporter.joinable()) return;
+    m_reporterStop = false;
+    m_reporter = std::thread(&FrameWriter::reporterMain, this);
+}
+
+void FrameWriter::stopReporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_reporterMutex);
+        m_reporterStop = true;
+    }
+    m_reporterWake.notify_all();
+    if (m_reporter.joinable()) {
+        m_reporter.join();
+    }
+}
+
+void FrameWriter::reporterMain()
+{
+    os_set_thread_name("sl-stats");
+    lowerThreadPriority();
+    
+    std::unique_lock<std::mutex> lock(m_reporterMutex);
+    while (!m_reporterWake.wait_for(lock, std::chrono::nanoseconds(STATS_INTERVAL_NS), [this] { return m_reporterStop; })) {
+        lock.unlock();
+        logStatistics();
+        lock.lock();
+    }
+}
 
+void FrameWriter::logStatistics()
+{
+    auto stats = getStatistics();
+    blog(LOG_INFO, "[FrameWriter:%s] Stats: %llu frames, %.2f FPS, %llu dropped",
+         m_channelName.c_str(), stats.totalFrames, stats.averageFps, stats.droppedFrames);
+    blog(LOG_INFO, "[FrameWriter:%s] Latency p50/p95/p99/max (ms): callback %s, convert %s, write %s, pickup %s, total %s",
+         m_channelName.c_str(),
+         latencyString(stats.callbackLatency).c_str(), latencyString(stats.conversionLatency).c_str(),
+         latencyString(stats.writeLatency).c_str(), latencyString(stats.pickupLatency).c_str(),
+         latencyString(stats.totalLatency).c_str());
+    if (stats.backpressureFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter:%s] Ring backpressure: %llu frame(s) skipped while the ring was full",
+             m_channelName.c_str(), stats.backpressureFrames);
+    }
+    if (stats.contendedFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter:%s] Producer contention: %llu frame(s) skipped while another producer held the channel",
+             m_channelName.c_str(), stats.contendedFrames);
+    }
+    if (stats.idleFrames > 0) {
+        blog(LOG_INFO, "[FrameWriter:%s] Idle: %llu frame(s) not captured without consumer demand%s",
+             m_channelName.c_str(), stats.idleFrames, m_suspended.load(std::memory_order_relaxed) ? " (suspended)" : "");
+    }
+    if (m_changeDetection.load(std::memory_order_relaxed)) {
+        blog(LOG_INFO, "[FrameWriter:%s] Unchanged: %llu frame(s) skipped (%.1f%%), dirty tiles %.1f%% of compared frames",
+             m_channelName.c_str(), stats.unchangedFrames,
+             stats.totalFrames > 0 ? stats.unchangedFrames * 100.0 / stats.totalFrames : 0.0,
+             stats.dirtyTileRatio * 100.0);
+    }
+    if (stats.conversionThreads > 0) {
+        blog(LOG_INFO, "[FrameWriter:%s] Conversion bands (%u worker(s) + caller) p50/p95/p99/max (ms): %s",
+             m_channelName.c_str(), stats.conversionThreads, latencyString(stats.bandLatency).c_str());
+    }
 }
 
 } // namespace StreamLumo
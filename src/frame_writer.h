@@ -10,29 +10,50 @@
 #define STREAMLUMO_FRAME_WRITER_H
 
 #include <obs.h>
+#include "latency_histogram.h"
+#include "producer_token.h"
+#include "frame_convert.h"
 #include <cstdint>
 #include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <mutex>
 #include <string>
+#include <thread>
 
 // Register the preview capture filter
 void RegisterPreviewFilter();
 
 // Forward declaration
+struct SharedFrameBuffer;
+struct ChannelMetrics;
 namespace StreamLumo {
     class ShmPosix;
     class ShmWin32;
+    class ShmPosixMetrics;
+    class ShmWin32Metrics;
+    class BandPool;
+    class ChangeDetector;
+    class FrameRecorder;
+    class TextureShare;
 }
 
 #ifdef _WIN32
 using ShmImpl = StreamLumo::ShmWin32;
+using MetricsImpl = StreamLumo::ShmWin32Metrics;
 #else
 using ShmImpl = StreamLumo::ShmPosix;
+using MetricsImpl = StreamLumo::ShmPosixMetrics;
 #endif
 
 namespace StreamLumo {
 
+// Source capture rate when neither the channel nor the consumer sets one
+static constexpr uint32_t DEFAULT_PREVIEW_FPS = 30;
+
+// Interval of the periodic statistics log (reporter thread)
+static constexpr uint64_t STATS_INTERVAL_NS = 5000000000ULL;
+
 /**
  * Frame statistics
  */
@@ -40,8 +61,26 @@ struct FrameStatistics {
     uint64_t totalFrames;
     uint64_t droppedFrames;
     uint64_t writtenFrames;
+    uint64_t backpressureFrames;    // Ring mode: frames skipped because the consumer's ring was full
+    uint64_t unchangedFrames;       // Change detection: frames skipped because nothing changed
+    uint64_t contendedFrames;       // Frames skipped because another producer held the channel
+    uint64_t idleFrames;            // Frames not captured: no consumer asked for them, or paused
+    double dirtyTileRatio;          // Change detection: mean fraction of tiles dirty in compared frames
     double averageFps;
-    double averageLatencyMs;
+    double averageLatencyMs;        // Mean OBS timestamp -> frame published
+    uint32_t readbackDepth;         // GPU readback pipeline depth (1 = synchronous)
+    double readbackLatencyMs;       // Average stage-to-map latency added by the readback ring
+    
+    // Per-stage latency distributions
+    LatencySummary callbackLatency;     // OBS timestamp -> processFrame() entry
+    LatencySummary conversionLatency;   // Conversion into the shared memory slot
+    LatencySummary writeLatency;        // Slot acquire + publish (excluding conversion)
+    LatencySummary pickupLatency;       // Capture -> consumer read (from the header feedback)
+    LatencySummary totalLatency;        // OBS timestamp -> frame published
+    
+    // Banded RGBA conversion
+    uint32_t conversionThreads;         // Worker threads (0 = video thread only)
+    LatencySummary bandLatency;         // Time to convert one band
 };
 
 /**
@@ -86,31 +125,144 @@ public:
     FrameStatistics getStatistics() const;
     
     /**
-     * Connect to shared memory
+     * Connect to shared memory (dropping any previous mapping; not while running)
      */
     bool connect();
+    
+    /**
+     * Whether the consumer destroyed and re-created the channel since we
+     * connected; the writer must then be stopped and connected again
+     */
+    bool isChannelReplaced() const;
+    
+    /**
+     * Re-read the OBS video settings before the next program frame
+     * (call after a video reset or profile change)
+     */
+    void invalidateVideoInfo();
 
     /**
      * Process a single frame
+     * `timestampNs` is the OBS video timestamp of the frame (os_gettime_ns()
+     * clock); it is published in the slot descriptor with the capture time.
+     * YUV frames are decoded, and RGB frames encoded to planar channels, with
+     * `colorspace` and `range`; planar slots are tagged with them. The defaults
+     * match the GPU readback path, whose frames are RGBA or already converted
+     * with GpuConverter's default BT.601 full.
      */
-    void processFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format);
+    void processFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint64_t timestampNs,
+                      enum video_colorspace colorspace = VIDEO_CS_601, enum video_range_type range = VIDEO_RANGE_FULL);
 
     /**
-     * Check if consumer has requested a pause (for settings changes)
+     * Set the GPU readback pipeline depth for source capture
+     * Frame N is staged while frame N-(depth-1) is mapped; 1 = synchronous.
+     */
+    void setReadbackDepth(uint32_t depth);
+    
+    /**
+     * Set the number of RGBA conversion worker threads (0 = convert on the
+     * calling thread only) and optionally the CPUs they are pinned to
+     */
+    void setConversionThreads(uint32_t workers, uint64_t affinityMask = 0);
+    
+    /**
+     * Set the source capture rate (0 = every canvas frame)
+     * The rate is rounded to an integer divisor of the OBS canvas rate; a
+     * non-zero requested_capture_fps in the shared header overrides it.
+     */
+    void setPreviewRate(uint32_t fps);
+    
+    /**
+     * Scale and convert source captures on the GPU before readback
+     */
+    void setGpuConversion(bool enabled);
+    
+    /**
+     * Skip conversion and the shm write for frames identical to the last one
+     * published, and publish a dirty tile bitmap with the frames that change
+     */
+    void setChangeDetection(bool enabled);
+    
+    /**
+     * Filter for frames scaled on the CPU to the channel size (default: area)
+     */
+    void setScaleFilter(ScaleFilter filter);
+    
+    /**
+     * Record every frame reaching processFrame() - raw planes, format and
+     * timestamps - to a memory-mapped file of up to maxBytes of frames, for
+     * bench/frame_replay.cpp. Recording stops by itself once the file is full.
+     */
+    bool startRecording(const std::string &path, uint64_t maxBytes);
+    
+    /**
+     * Stop recording and trim the recording to the frames it holds
+     */
+    void stopRecording();
+    
+    /**
+     * Output size and channel format a GPU converter should render for a
+     * srcWidth x srcHeight frame; false if the channel can't take a GPU frame
+     * (not connected, unsupported format, odd planar size)
+     */
+    bool gpuConversionTarget(uint32_t srcWidth, uint32_t srcHeight, uint32_t &dstWidth, uint32_t &dstHeight, uint32_t &format);
+    
+    /**
+     * Record the stage-to-map latency of one GPU readback and how long the
+     * map blocked (used by both source capture and the preview filter)
+     */
+    void recordReadbackLatency(uint32_t depth, uint64_t latencyNs, uint64_t stallNs);
+    
+    /**
+     * Whether source capture should render canvas frame `canvasFrame`
+     * (SourceRenderer tick only; advances the capture schedule when it returns true)
+     */
+    bool captureDue(const struct obs_video_info &ovi, uint64_t canvasFrame);
+    
+    /**
+     * Whether a consumer is asking for frames on this channel
+     * False once no reader has requested a frame for SL_DEMAND_TIMEOUT_NS;
+     * the caller then skips capture and conversion (the frame is counted as
+     * idle). Logs when the channel suspends and resumes.
+     */
+    bool checkConsumerDemand();
+    
+    /**
+     * Hand a rendered source frame to the channel as a shared GPU texture
+     * (SourceRenderer, inside the graphics context). Returns false if the
+     * channel needs a CPU readback instead: it did not ask for
+     * SL_FLAG_SHARED_TEXTURE, or textures can't be shared on this platform.
      */
-    bool checkPauseRequested() const;
+    bool publishTexture(gs_texture_t *texture, uint32_t width, uint32_t height, uint64_t captureTimeNs);
     
     /**
-     * Confirm to consumer that we have paused
+     * Current capture source with a new reference (release it), or nullptr
      */
-    void confirmPaused();
+    obs_source_t *getSourceRef();
     
     /**
-     * Clear the pause state (called after settings change complete)
+     * Whether a capture source is set and has not been removed from OBS
      */
-    void clearPauseState();
+    bool hasSource();
+    
+    uint32_t readbackDepth() const { return m_readbackDepth.load(std::memory_order_relaxed); }
+    bool gpuConversionEnabled() const { return m_gpuConversion.load(std::memory_order_relaxed); }
 
 private:
+    /**
+     * Honour a consumer pause at a frame boundary
+     * Confirms producer_paused while pause_requested is set and clears it
+     * once the consumer withdraws the request; the writer stays registered
+     * with OBS throughout. Returns true while paused (the frame is idle).
+     */
+    bool checkPause();
+    
+    /**
+     * Publish the geometry of a pending reconfigure request and acknowledge it
+     * (under m_producer, before the next frame is written)
+     */
+    void applyReconfigure(SharedFrameBuffer *buffer);
+
     /**
      * Raw video callback (called by OBS at 60 FPS)
      */
@@ -122,44 +274,157 @@ private:
     static void sourceVideoCallback(void *param, obs_source_t *source, const struct obs_source_frame *frame);
     
     /**
-     * Convert NV12/I420 to RGBA
+     * Convert a frame into a packed (RGBA/BGRA/RGBX/premultiplied) channel with
+     * the plan's converter, writing directly into the destination
+     * (normally the shared memory slot returned by beginWrite())
+     */
+    void convertToPacked(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight);
+    
+    uint32_t conversionBandCount(uint32_t dstHeight) const;
+    
+    /**
+     * How frames of one input layout are written to the channel
+     * Rebuilt only when the input frame or the channel geometry changes, so
+     * the per-frame cost is comparing the key fields.
      */
-    void convertToRGBA(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *dst);
+    struct ConversionPlan {
+        bool valid;
+        enum video_format format;       // Key: input frame
+        uint32_t width;
+        uint32_t height;
+        uint32_t linesize[3];
+        enum video_colorspace colorspace;
+        enum video_range_type range;
+        uint32_t dstWidth;              // Key: channel geometry and worker count
+        uint32_t dstHeight;
+        uint32_t dstFormat;
+        uint32_t workers;
+        ScaleFilter filter;
+        SourceFormat sourceFormat;      // Derived: conversion layout of `format`
+        bool planar;                    // Derived: planar copy instead of packed conversion
+        PackedFormat packedFormat;      // Derived: layout of a packed channel
+        PackedConverter convert;        // Derived: converter specialised for this plan
+        const YuvMatrix *matrix;        // Derived: decodes YUV input, encodes RGB input to planar channels
+        uint32_t slotMatrix;            // Derived: colorimetry of planar slots (ColorMatrixId / ColorRangeId)
+        uint32_t slotRange;
+        uint32_t bands;
+        uint32_t rowsPerBand;
+        ScalePlan scale;                // Coefficient tables for scaled frames
+        bool reportedError;             // Conversion failure already logged for this layout
+    };
     
     /**
-     * Tick callback for source capture mode
+     * Plan for the current frame; logs the frame layout (and stride padding) when it changes
      */
-    static void tickCallback(void *param, float seconds);
+    const ConversionPlan &conversionPlan(const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format,
+                                         enum video_colorspace colorspace, enum video_range_type range, uint32_t dstWidth, uint32_t dstHeight);
     
     /**
-     * Render and capture the current source
+     * Periodic statistics log, off the video thread
      */
-    void captureSourceFrame();
+    void startReporter();
+    void stopReporter();
+    void reporterMain();
+    void logStatistics();
+    
+    /**
+     * Copy NV12/I420 planes (or convert RGBA/BGRA) into a planar channel slot
+     * using the plane offsets and strides published in the shared header
+     */
+    bool convertToPlanar(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format, uint8_t *dst);
+    
+    /**
+     * Pick the published frame size from the shared header for a source frame
+     */
+    bool resolveOutputGeometry(uint32_t srcWidth, uint32_t srcHeight, uint32_t &dstWidth, uint32_t &dstHeight);
+    
+    /**
+     * Count and log frames skipped because the ring-mode consumer is behind
+     */
+    void noteRingBackpressure(bool full);
+    
+    /**
+     * Sample consumer pickup latency from the feedback fields in the shared header
+     */
+    void sampleConsumerPickup();
+    
+    /**
+     * Append one incoming frame to the recording; closes it once full
+     */
+    void recordFrame(const uint8_t *const data[], const uint32_t linesize[], uint32_t width, uint32_t height, enum video_format format,
+                     uint64_t timestampNs, enum video_colorspace colorspace, enum video_range_type range, uint64_t arrivalNs);
+    
+    /**
+     * Canvas frames per source capture for the current rate settings
+     * Publishes the effective rate in the shared header when it changes.
+     */
+    uint32_t resolveCaptureDivisor(const struct obs_video_info &ovi);
     
     // State
     std::atomic<bool> m_running;
+    std::atomic<bool> m_suspended;           // No consumer demand: frames are not captured
+    std::atomic<uint64_t> m_resumedAtNs;     // When the channel last resumed (os_gettime_ns)
     Mode m_mode;
     obs_source_t* m_currentSource;
-    std::vector<uint8_t> m_frameBuffer;
-    std::mutex m_frameMutex;
+    ProducerToken m_producer;                // Producer-side state; frame paths never wait for it
     std::mutex m_sourceMutex;
     
-    // Graphics resources for source capture
-    gs_texrender_t* m_texrender;
-    gs_stagesurf_t* m_stagesurf;
-    uint32_t m_captureWidth;
-    uint32_t m_captureHeight;
-    float m_tickAccumulator;
+    // Program capture: OBS output settings, refreshed only when invalidated
+    struct obs_video_info m_videoInfo;       // Video thread only
+    std::atomic<bool> m_videoInfoStale;
+    ConversionPlan m_plan;                   // Under m_producer
+    ScaleFilter m_scaleFilter;               // Under m_producer
+    
+    // Source capture (rendered and read back by SourceRenderer)
+    std::atomic<uint32_t> m_readbackDepth;
+    std::atomic<bool> m_gpuConversion;
+    TextureShare* m_textureShare;            // Shared GPU textures (graphics context only)
+    uint32_t m_publishedTextureGeneration;   // TextureShare generation last published in the header
+    bool m_textureShareFailed;               // Don't retry creating textures every frame
+    std::atomic<uint32_t> m_previewFps;      // Configured source capture rate (0 = canvas rate)
+    uint32_t m_captureDivisor;               // Canvas frames per capture (tick thread only)
+    uint64_t m_nextCaptureFrame;             // Canvas frame index of the next capture (tick thread only)
+    bool m_loggedFormatError;
+    ScaleScratch m_planarScratch;            // Scaled rows for planar output
+    BandPool* m_bandPool;                    // Workers for banded RGBA conversion
+    ChangeDetector* m_changeDetector;        // Tile hashes of the last published frame
+    std::atomic<bool> m_changeDetection;
+    uint64_t m_lastPublishTime;              // Unchanged frames are still published at least this often
+    FrameRecorder* m_recorder;               // Raw input recording for offline replay
     
     // Statistics
     std::atomic<uint64_t> m_totalFrames;
     std::atomic<uint64_t> m_droppedFrames;
     std::atomic<uint64_t> m_writtenFrames;
+    std::atomic<uint64_t> m_backpressureFrames;
+    std::atomic<uint64_t> m_unchangedFrames;
+    std::atomic<uint64_t> m_contendedFrames;
+    std::atomic<uint64_t> m_idleFrames;
+    std::atomic<uint64_t> m_comparedFrames;
+    std::atomic<uint64_t> m_dirtyTiles;      // Dirty tiles summed over compared frames
+    uint64_t m_ringStallFrames;              // Frames skipped in the current ring stall
+    std::atomic<uint32_t> m_lastReadbackDepth;
+    std::atomic<uint64_t> m_readbackLatencyNs;
+    std::atomic<uint64_t> m_readbackSamples;
     uint64_t m_startTime;
-    uint64_t m_lastStatsTime;
+    LatencyHistogram m_callbackLatency;
+    LatencyHistogram m_conversionLatency;
+    LatencyHistogram m_writeLatency;
+    LatencyHistogram m_pickupLatency;
+    LatencyHistogram m_totalLatency;
+    LatencyHistogram m_bandLatency;
+    uint64_t m_lastPickupFrame;
+    
+    // Statistics reporter
+    std::thread m_reporter;
+    std::mutex m_reporterMutex;
+    std::condition_variable m_reporterWake;
+    bool m_reporterStop;
     
     // Shared Memory
     ShmImpl* m_shm;
+    MetricsImpl* m_metricsPage;              // Live counters for external monitors (ChannelMetrics)
+    ChannelMetrics* m_metrics;               // The page, or a private copy if it could not be opened
     std::string m_channelName;
 };
 
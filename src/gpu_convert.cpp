@@ -0,0 +1,305 @@
+/**
+ * StreamLumo GPU Converter - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "gpu_convert.h"
+#include "pixel_convert.h"
+#include "../include/shared_buffer.h"
+
+#include <graphics/graphics.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+
+namespace StreamLumo {
+
+namespace {
+
+/**
+ * Scale / RGB -> YUV 4:2:0 effect
+ *
+ * Encodes with the target's matrix like the CPU path (pixel_convert.cpp):
+ * `to_y`/`to_u`/`to_v` weigh R, G, B and `yuv_offset` biases Y and U/V.
+ * Chroma is taken from a bilinear sample at the centre of each 2x2 block.
+ * `dst_size` is the luma size; planar techniques draw dst_size.y * 1.5 rows.
+ */
+const char *const CONVERT_EFFECT = R"EFFECT(
+uniform float4x4 ViewProj;
+uniform texture2d image;
+uniform float2 dst_size;
+uniform float3 to_y;
+uniform float3 to_u;
+uniform float3 to_v;
+uniform float2 yuv_offset;
+
+sampler_state linearSampler {
+    Filter   = Linear;
+    AddressU = Clamp;
+    AddressV = Clamp;
+};
+
+struct VertData {
+    float4 pos : POSITION;
+    float2 uv  : TEXCOORD0;
+};
+
+VertData VSDefault(VertData v_in)
+{
+    VertData v_out;
+    v_out.pos = mul(float4(v_in.pos.xyz, 1.0), ViewProj);
+    v_out.uv = v_in.uv;
+    return v_out;
+}
+
+float3 SampleRGB(float2 uv)
+{
+    return image.Sample(linearSampler, uv).rgb;
+}
+
+float LumaAt(float2 pos)
+{
+    return dot(SampleRGB(pos / dst_size), to_y) + yuv_offset.x;
+}
+
+// Chroma sample cx/cy of the half-resolution planes
+float3 ChromaRGB(float cx, float cy)
+{
+    return SampleRGB(float2((cx + 0.5) * 2.0 / dst_size.x, (cy + 0.5) * 2.0 / dst_size.y));
+}
+
+float ToU(float3 rgb)
+{
+    return dot(rgb, to_u) + yuv_offset.y;
+}
+
+float ToV(float3 rgb)
+{
+    return dot(rgb, to_v) + yuv_offset.y;
+}
+
+float4 PSScale(VertData v_in) : TARGET
+{
+    return image.Sample(linearSampler, v_in.uv);
+}
+
+float4 PSNV12(VertData v_in) : TARGET
+{
+    float2 pos = v_in.uv * float2(dst_size.x, dst_size.y * 1.5);
+    if (pos.y < dst_size.y)
+        return float4(LumaAt(pos), 0.0, 0.0, 1.0);
+
+    float px = floor(pos.x);
+    float3 rgb = ChromaRGB(floor(px * 0.5), floor(pos.y - dst_size.y));
+    float value = (frac(px * 0.5) < 0.25) ? ToU(rgb) : ToV(rgb);
+    return float4(value, 0.0, 0.0, 1.0);
+}
+
+float4 PSI420(VertData v_in) : TARGET
+{
+    float2 pos = v_in.uv * float2(dst_size.x, dst_size.y * 1.5);
+    if (pos.y < dst_size.y)
+        return float4(LumaAt(pos), 0.0, 0.0, 1.0);
+
+    float half_width = dst_size.x * 0.5;
+    float cy = floor(pos.y - dst_size.y);
+    float value;
+    if (pos.x < half_width)
+        value = ToU(ChromaRGB(floor(pos.x), cy));
+    else
+        value = ToV(ChromaRGB(floor(pos.x - half_width), cy));
+    return float4(value, 0.0, 0.0, 1.0);
+}
+
+technique Scale
+{
+    pass
+    {
+        vertex_shader = VSDefault(v_in);
+        pixel_shader  = PSScale(v_in);
+    }
+}
+
+technique NV12
+{
+    pass
+    {
+        vertex_shader = VSDefault(v_in);
+        pixel_shader  = PSNV12(v_in);
+    }
+}
+
+technique I420
+{
+    pass
+    {
+        vertex_shader = VSDefault(v_in);
+        pixel_shader  = PSI420(v_in);
+    }
+}
+)EFFECT";
+
+} // namespace
+
+GpuConverter::GpuConverter()
+    : m_effect(nullptr)
+    , m_imageParam(nullptr)
+    , m_sizeParam(nullptr)
+    , m_toYParam(nullptr)
+    , m_toUParam(nullptr)
+    , m_toVParam(nullptr)
+    , m_offsetParam(nullptr)
+    , m_texrender(nullptr)
+    , m_texrenderFormat(GS_UNKNOWN)
+    , m_effectFailed(false)
+{
+}
+
+GpuConverter::~GpuConverter()
+{
+    reset();
+}
+
+void GpuConverter::reset()
+{
+    if (m_texrender) {
+        gs_texrender_destroy(m_texrender);
+        m_texrender = nullptr;
+    }
+    if (m_effect) {
+        gs_effect_destroy(m_effect);
+        m_effect = nullptr;
+    }
+    m_imageParam = nullptr;
+    m_sizeParam = nullptr;
+    m_toYParam = m_toUParam = m_toVParam = m_offsetParam = nullptr;
+    m_texrenderFormat = GS_UNKNOWN;
+}
+
+bool GpuConverter::supports(const Target &target)
+{
+    if (target.width == 0 || target.height == 0) return false;
+    if (target.format == FORMAT_RGBA) return true;
+    return isPlanarFormat(target.format) && (target.width % 2) == 0 && (target.height % 2) == 0;
+}
+
+bool GpuConverter::ensureEffect()
+{
+    if (m_effect) return true;
+    if (m_effectFailed) return false;
+
+    char *errors = nullptr;
+    m_effect = gs_effect_create(CONVERT_EFFECT, "streamlumo_convert.effect", &errors);
+    if (!m_effect) {
+        blog(LOG_ERROR, "[GpuConverter] Failed to compile conversion effect: %s", errors ? errors : "(no log)");
+        bfree(errors);
+        m_effectFailed = true;
+        return false;
+    }
+    bfree(errors);
+
+    m_imageParam = gs_effect_get_param_by_name(m_effect, "image");
+    m_sizeParam = gs_effect_get_param_by_name(m_effect, "dst_size");
+    m_toYParam = gs_effect_get_param_by_name(m_effect, "to_y");
+    m_toUParam = gs_effect_get_param_by_name(m_effect, "to_u");
+    m_toVParam = gs_effect_get_param_by_name(m_effect, "to_v");
+    m_offsetParam = gs_effect_get_param_by_name(m_effect, "yuv_offset");
+    blog(LOG_INFO, "[GpuConverter] Conversion effect ready");
+    return true;
+}
+
+void GpuConverter::setMatrix(const YuvMatrix &matrix)
+{
+    struct vec3 toY, toU, toV;
+    vec3_set(&toY, matrix.toY[0], matrix.toY[1], matrix.toY[2]);
+    vec3_set(&toU, matrix.toU[0], matrix.toU[1], matrix.toU[2]);
+    vec3_set(&toV, matrix.toV[0], matrix.toV[1], matrix.toV[2]);
+    gs_effect_set_vec3(m_toYParam, &toY);
+    gs_effect_set_vec3(m_toUParam, &toU);
+    gs_effect_set_vec3(m_toVParam, &toV);
+
+    struct vec2 offset;
+    vec2_set(&offset, matrix.yOffset / 255.0f, 128.0f / 255.0f);
+    gs_effect_set_vec2(m_offsetParam, &offset);
+}
+
+bool GpuConverter::ensureTarget(enum gs_color_format format)
+{
+    if (m_texrender && m_texrenderFormat == format) return true;
+
+    if (m_texrender) gs_texrender_destroy(m_texrender);
+    m_texrender = gs_texrender_create(format, GS_ZS_NONE);
+    m_texrenderFormat = m_texrender ? format : GS_UNKNOWN;
+    if (!m_texrender) {
+        blog(LOG_ERROR, "[GpuConverter] Failed to create render target (format %d)", format);
+        return false;
+    }
+    return true;
+}
+
+gs_texture_t *GpuConverter::convert(gs_texture_t *source, const Target &target, uint32_t &texWidth, uint32_t &texHeight)
+{
+    if (!source || !supports(target) || !ensureEffect()) return nullptr;
+
+    const bool planar = isPlanarFormat(target.format);
+    const char *technique = !planar ? "Scale" : (target.format == FORMAT_NV12 ? "NV12" : "I420");
+    texWidth = target.width;
+    texHeight = planar ? target.height + target.height / 2 : target.height;
+
+    if (!ensureTarget(planar ? GS_R8 : GS_RGBA)) return nullptr;
+
+    gs_texrender_reset(m_texrender);
+    if (!gs_texrender_begin(m_texrender, texWidth, texHeight)) {
+        blog(LOG_WARNING, "[GpuConverter] Failed to begin render target %ux%u", texWidth, texHeight);
+        return nullptr;
+    }
+
+    gs_ortho(0.0f, (float)texWidth, 0.0f, (float)texHeight, -100.0f, 100.0f);
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+    struct vec2 size;
+    vec2_set(&size, (float)target.width, (float)target.height);
+    gs_effect_set_texture(m_imageParam, source);
+    gs_effect_set_vec2(m_sizeParam, &size);
+    if (planar) {
+        setMatrix(target.matrix ? *target.matrix : GetYuvMatrix(COLOR_MATRIX_BT601, COLOR_RANGE_FULL));
+    }
+
+    while (gs_effect_loop(m_effect, technique)) {
+        gs_draw_sprite(source, 0, texWidth, texHeight);
+    }
+
+    gs_blend_state_pop();
+    gs_texrender_end(m_texrender);
+
+    return gs_texrender_get_texture(m_texrender);
+}
+
+enum video_format GpuConverter::describeFrame(const ReadbackRing::MappedFrame &mapped,
+                                              const uint8_t *data[], uint32_t linesize[],
+                                              uint32_t &width, uint32_t &height)
+{
+    width = mapped.width;
+    height = mapped.height;
+    data[0] = mapped.data;
+    linesize[0] = mapped.linesize;
+
+    if (!isPlanarFormat(mapped.contentFormat)) {
+        return VIDEO_FORMAT_RGBA;
+    }
+
+    // Undo the packed layout: rows [0, h) are luma, the rest chroma
+    height = mapped.height * 2 / 3;
+    data[1] = mapped.data + (size_t)height * mapped.linesize;
+    linesize[1] = mapped.linesize;
+    if (mapped.contentFormat == FORMAT_NV12) {
+        return VIDEO_FORMAT_NV12;
+    }
+
+    data[2] = data[1] + width / 2;
+    linesize[2] = mapped.linesize;
+    return VIDEO_FORMAT_I420;
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,92 @@
+/**
+ * StreamLumo GPU Converter - Header
+ *
+ * Scales a rendered frame to the consumer's geometry and converts it to the
+ * channel's pixel format in a shader, so readback returns exactly the bytes
+ * that go into the shared-memory slot.
+ *
+ * Planar formats are rendered into a single GS_R8 texture of
+ * width x (height * 3 / 2): the Y plane on top, followed by
+ * - NV12: the interleaved UV plane, one chroma row per texture row
+ * - I420: the U plane in the left half and the V plane in the right half
+ * which keeps one staging surface per frame and a constant stride per plane.
+ *
+ * All methods must be called from inside the graphics context.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_GPU_CONVERT_H
+#define STREAMLUMO_GPU_CONVERT_H
+
+#include <obs.h>
+#include <cstdint>
+
+#include "readback_ring.h"
+
+namespace StreamLumo {
+
+struct YuvMatrix;
+
+class GpuConverter {
+public:
+    /**
+     * Output geometry and channel pixel format (FORMAT_*)
+     * Planar targets are encoded with `matrix` (null = BT.601 full range, the
+     * default FrameWriter::processFrame() tags rendered frames with).
+     */
+    struct Target {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        const YuvMatrix *matrix;
+    };
+
+    GpuConverter();
+    ~GpuConverter();
+
+    /**
+     * Whether a target can be produced on the GPU
+     * (RGBA at any size, NV12/I420 at even sizes)
+     */
+    static bool supports(const Target &target);
+
+    /**
+     * Render `source` scaled and converted for `target`
+     * Returns the texture to stage (texWidth x texHeight), or nullptr on failure.
+     */
+    gs_texture_t *convert(gs_texture_t *source, const Target &target, uint32_t &texWidth, uint32_t &texHeight);
+
+    /**
+     * Split a mapped GPU-converted frame into planes for FrameWriter::processFrame
+     * Returns the OBS format describing the planes; width/height are the frame size.
+     */
+    static enum video_format describeFrame(const ReadbackRing::MappedFrame &mapped,
+                                           const uint8_t *data[], uint32_t linesize[],
+                                           uint32_t &width, uint32_t &height);
+
+    /**
+     * Release the effect and render target
+     */
+    void reset();
+
+private:
+    bool ensureEffect();
+    bool ensureTarget(enum gs_color_format format);
+    void setMatrix(const YuvMatrix &matrix);
+
+    gs_effect_t *m_effect;
+    gs_eparam_t *m_imageParam;
+    gs_eparam_t *m_sizeParam;
+    gs_eparam_t *m_toYParam;
+    gs_eparam_t *m_toUParam;
+    gs_eparam_t *m_toVParam;
+    gs_eparam_t *m_offsetParam;
+    gs_texrender_t *m_texrender;
+    enum gs_color_format m_texrenderFormat;
+    bool m_effectFailed;        // Don't retry compiling a broken effect every frame
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_GPU_CONVERT_H
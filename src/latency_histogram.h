@@ -0,0 +1,144 @@
+/**
+ * StreamLumo Latency Histogram - Header
+ *
+ * Fixed-size, lock-free log-linear histogram for per-stage latencies.
+ * record() is a relaxed fetch_add plus a CAS on the maximum, so it can be
+ * called from the video thread while another thread reads a summary.
+ * Buckets cover ~1 us to ~70 min with 8 sub-buckets per power of two
+ * (at most 12.5% relative error).
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_LATENCY_HISTOGRAM_H
+#define STREAMLUMO_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace StreamLumo {
+
+/**
+ * Percentiles of one histogram in milliseconds
+ */
+struct LatencySummary {
+    uint64_t count;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+class LatencyHistogram {
+public:
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    /**
+     * Record one sample in nanoseconds
+     */
+    void record(uint64_t ns)
+    {
+        m_buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t max = m_maxNs.load(std::memory_order_relaxed);
+        while (ns > max && !m_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Compute p50/p95/p99/max (approximate while samples are being recorded)
+     */
+    LatencySummary summary() const
+    {
+        LatencySummary s = {};
+        uint64_t counts[NUM_BUCKETS];
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) return s;
+
+        s.count = total;
+        s.meanMs = (m_sumNs.load(std::memory_order_relaxed) / (double)m_count.load(std::memory_order_relaxed)) / 1000000.0;
+        s.p50Ms = percentile(counts, total, 0.50);
+        s.p95Ms = percentile(counts, total, 0.95);
+        s.p99Ms = percentile(counts, total, 0.99);
+        s.maxMs = m_maxNs.load(std::memory_order_relaxed) / 1000000.0;
+        return s;
+    }
+
+    /**
+     * Clear all samples (not synchronised with concurrent record() calls)
+     */
+    void reset()
+    {
+        for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sumNs.store(0, std::memory_order_relaxed);
+        m_maxNs.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t UNIT_SHIFT = 10;      // Bucket unit: 1024 ns
+    static constexpr uint32_t SUB_BITS = 3;         // 8 sub-buckets per power of two
+    static constexpr uint32_t SUB_COUNT = 1u << SUB_BITS;
+    static constexpr uint32_t MAX_EXPONENT = 32;    // 2^32 units ~ 73 minutes
+    static constexpr uint32_t NUM_BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUB_COUNT;
+
+    static uint32_t bucketFor(uint64_t ns)
+    {
+        const uint64_t units = ns >> UNIT_SHIFT;
+        if (units < SUB_COUNT) return static_cast<uint32_t>(units);
+
+        uint32_t exponent = 0;
+        while ((units >> (exponent + 1)) != 0) exponent++;
+        if (exponent > MAX_EXPONENT) return NUM_BUCKETS - 1;
+
+        const uint32_t sub = static_cast<uint32_t>(units >> (exponent - SUB_BITS)) & (SUB_COUNT - 1);
+        return (exponent - SUB_BITS + 1) * SUB_COUNT + sub;
+    }
+
+    // Midpoint of a bucket in milliseconds
+    static double bucketValueMs(uint32_t index)
+    {
+        double low;
+        double width;
+        if (index < SUB_COUNT) {
+            low = index;
+            width = 1.0;
+        } else {
+            const uint32_t exponent = index / SUB_COUNT + SUB_BITS - 1;
+            const uint32_t sub = index % SUB_COUNT;
+            width = (double)(1ull << (exponent - SUB_BITS));
+            low = (SUB_COUNT + sub) * width;
+        }
+        return ((low + width / 2.0) * (1u << UNIT_SHIFT)) / 1000000.0;
+    }
+
+    static double percentile(const uint64_t *counts, uint64_t total, double fraction)
+    {
+        const uint64_t rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return bucketValueMs(i);
+        }
+        return bucketValueMs(NUM_BUCKETS - 1);
+    }
+
+    std::atomic<uint64_t> m_buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sumNs;
+    std::atomic<uint64_t> m_maxNs;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_LATENCY_HISTOGRAM_H
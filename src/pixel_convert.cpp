@@ -0,0 +1,329 @@
+/**
+ * StreamLumo Pixel Conversion Kernels - Scalar reference and dispatch
+ *
+ * @license GPL-2.0
+ */
+
+#include "pixel_convert.h"
+
+#include <cmath>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+void scalarNv12ToRgba(const uint8_t *y, const uint8_t *uv, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        const uint32_t chroma = (x / 2) * 2;
+        writeRgbaFromYuv(y[x], uv[chroma] - 128, uv[chroma + 1] - 128, matrix, dst + x * 4);
+    }
+}
+
+void scalarI420ToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, uint32_t width,
+                      const YuvMatrix &matrix)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        writeRgbaFromYuv(y[x], u[x / 2] - 128, v[x / 2] - 128, matrix, dst + x * 4);
+    }
+}
+
+void scalarUyvyToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    // Byte order: U0 Y0 V0 Y1
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t *block = src + (x / 2) * 4;
+        writeRgbaFromYuv(block[1 + (x & 1) * 2], block[0] - 128, block[2] - 128, matrix, dst + x * 4);
+    }
+}
+
+void scalarYuy2ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    // Byte order: Y0 U0 Y1 V0
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t *block = src + (x / 2) * 4;
+        writeRgbaFromYuv(block[(x & 1) * 2], block[1] - 128, block[3] - 128, matrix, dst + x * 4);
+    }
+}
+
+void scalarY800ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t gray = clampToByte(static_cast<int>((src[x] - matrix.yOffset) * matrix.yScale + 0.5f));
+        dst[x * 4 + 0] = gray;
+        dst[x * 4 + 1] = gray;
+        dst[x * 4 + 2] = gray;
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+void scalarBgraToRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        // Swap bytes 0 and 2; both are read first so src may equal dst
+        const uint8_t b = src[x * 4 + 0];
+        const uint8_t r = src[x * 4 + 2];
+        dst[x * 4 + 0] = r;
+        dst[x * 4 + 1] = src[x * 4 + 1];
+        dst[x * 4 + 2] = b;
+        dst[x * 4 + 3] = src[x * 4 + 3];
+    }
+}
+
+void scalarPremultiplyRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        const uint32_t alpha = src[x * 4 + 3];
+        for (uint32_t c = 0; c < 3; c++) {
+            dst[x * 4 + c] = premultiplyChannel(src[x * 4 + c], alpha);
+        }
+        dst[x * 4 + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+void scalarOpaqueRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        dst[x * 4 + 0] = src[x * 4 + 0];
+        dst[x * 4 + 1] = src[x * 4 + 1];
+        dst[x * 4 + 2] = src[x * 4 + 2];
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+void scalarInterleaveUv(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        uv[x * 2 + 0] = u[x];
+        uv[x * 2 + 1] = v[x];
+    }
+}
+
+void scalarSplitUv(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        u[x] = uv[x * 2 + 0];
+        v[x] = uv[x * 2 + 1];
+    }
+}
+
+void scalarBlendRows(const uint8_t *const *rows, const int16_t *weights, uint32_t taps, uint8_t *dst, uint32_t bytes)
+{
+    blendRowRange(rows, weights, taps, dst, 0, bytes);
+}
+
+void scalarResampleRgba(const uint8_t *src, const uint32_t *first, const int16_t *weights, uint32_t taps,
+                        uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t *px = src + first[x] * 4;
+        const int16_t *w = weights + x * taps;
+        for (uint32_t c = 0; c < 4; c++) {
+            int32_t sum = SCALE_WEIGHT_ONE / 2;
+            for (uint32_t k = 0; k < taps; k++) {
+                sum += w[k] * px[k * 4 + c];
+            }
+            dst[x * 4 + c] = clampToByte(sum >> SCALE_WEIGHT_BITS);
+        }
+    }
+}
+
+void scalarHalveRows(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, uint32_t width, uint32_t channels)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t *a = row0 + x * 2 * channels;
+        const uint8_t *b = row1 + x * 2 * channels;
+        for (uint32_t c = 0; c < channels; c++) {
+            dst[x * channels + c] = static_cast<uint8_t>((a[c] + a[c + channels] + b[c] + b[c + channels] + 2) >> 2);
+        }
+    }
+}
+
+const ConvertKernels g_scalarKernels = {
+    "scalar",
+    scalarNv12ToRgba,
+    scalarI420ToRgba,
+    scalarUyvyToRgba,
+    scalarYuy2ToRgba,
+    scalarY800ToRgba,
+    scalarBgraToRgba,
+    scalarPremultiplyRgba,
+    scalarOpaqueRgba,
+    scalarInterleaveUv,
+    scalarSplitUv,
+    scalarBlendRows,
+    scalarResampleRgba,
+    scalarHalveRows,
+};
+
+// RGB -> YUV in Q8, the inverse of writeRgbaFromYuv()
+inline uint8_t rgbToY(int r, int g, int b, const YuvMatrix &matrix)
+{
+    const int16_t *w = matrix.toYQ8;
+    return clampToByte(((w[0] * r + w[1] * g + w[2] * b + 128) >> 8) + matrix.yOffset);
+}
+
+inline uint8_t rgbToU(int r, int g, int b, const YuvMatrix &matrix)
+{
+    const int16_t *w = matrix.toUQ8;
+    return clampToByte(((w[0] * r + w[1] * g + w[2] * b + 128) >> 8) + 128);
+}
+
+inline uint8_t rgbToV(int r, int g, int b, const YuvMatrix &matrix)
+{
+    const int16_t *w = matrix.toVQ8;
+    return clampToByte(((w[0] * r + w[1] * g + w[2] * b + 128) >> 8) + 128);
+}
+
+#if defined(STREAMLUMO_HAVE_SSE41_KERNELS) || defined(STREAMLUMO_HAVE_AVX2_KERNELS)
+
+enum CpuFeature {
+    CPU_SSE41,
+    CPU_AVX2
+};
+
+bool cpuSupports(CpuFeature feature)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+    // NEON is mandatory on AArch64; SIMDE lowers the SSE4.1 kernels to it
+    return feature == CPU_SSE41;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    if (feature == CPU_SSE41) return sse41;
+
+    // AVX2 needs both the CPUID bit and OS support for saving YMM state
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (feature == CPU_SSE41) return __builtin_cpu_supports("sse4.1");
+    return __builtin_cpu_supports("avx2");
+#else
+    (void)feature;
+    return false;
+#endif
+}
+
+#endif
+
+const ConvertKernels &selectKernels()
+{
+#if defined(STREAMLUMO_HAVE_AVX2_KERNELS)
+    if (cpuSupports(CPU_AVX2)) return GetAvx2Kernels();
+#endif
+#if defined(STREAMLUMO_HAVE_SSE41_KERNELS)
+    if (cpuSupports(CPU_SSE41)) return GetSse41Kernels();
+#endif
+    return g_scalarKernels;
+}
+
+/**
+ * Derive the coefficients from the luma weights Kr/Kb (Kg = 1 - Kr - Kb)
+ * Limited range maps Y 16-235 and U/V 16-240 onto the full 0-255 scale.
+ */
+YuvMatrix makeYuvMatrix(const char *name, double kr, double kb, bool limited)
+{
+    const double kg = 1.0 - kr - kb;
+    const double yScale = limited ? 255.0 / 219.0 : 1.0;
+    const double cScale = limited ? 255.0 / 224.0 : 1.0;
+    const double rv = 2.0 * (1.0 - kr) * cScale;
+    const double gu = 2.0 * kb * (1.0 - kb) / kg * cScale;
+    const double gv = 2.0 * kr * (1.0 - kr) / kg * cScale;
+    const double bu = 2.0 * (1.0 - kb) * cScale;
+    auto q12 = [](double value) { return static_cast<int16_t>(std::lround(value * 4096.0)); };
+    auto q8 = [](double value) { return static_cast<int16_t>(std::lround(value * 256.0)); };
+    
+    // Inverse: limited range compresses Y to 219 and U/V to 224 steps
+    const double toY[3] = { kr / yScale, kg / yScale, kb / yScale };
+    const double uDiv = 2.0 * (1.0 - kb) * cScale;
+    const double vDiv = 2.0 * (1.0 - kr) * cScale;
+    const double toU[3] = { -kr / uDiv, -kg / uDiv, (1.0 - kb) / uDiv };
+    const double toV[3] = { (1.0 - kr) / vDiv, -kg / vDiv, -kb / vDiv };
+
+    YuvMatrix matrix;
+    matrix.name = name;
+    matrix.yOffset = limited ? 16 : 0;
+    matrix.yScale = static_cast<float>(yScale);
+    matrix.rv = static_cast<float>(rv);
+    matrix.gu = static_cast<float>(gu);
+    matrix.gv = static_cast<float>(gv);
+    matrix.bu = static_cast<float>(bu);
+    matrix.yScaleQ12 = q12(yScale);
+    matrix.rvQ12 = q12(rv);
+    matrix.guQ12 = q12(gu);
+    matrix.gvQ12 = q12(gv);
+    matrix.buQ12 = q12(bu);
+    for (int i = 0; i < 3; i++) {
+        matrix.toY[i] = static_cast<float>(toY[i]);
+        matrix.toU[i] = static_cast<float>(toU[i]);
+        matrix.toV[i] = static_cast<float>(toV[i]);
+        matrix.toYQ8[i] = q8(toY[i]);
+        matrix.toUQ8[i] = q8(toU[i]);
+        matrix.toVQ8[i] = q8(toV[i]);
+    }
+    // Grey has no chroma: the U/V weights must cancel after rounding
+    matrix.toUQ8[2] = static_cast<int16_t>(-(matrix.toUQ8[0] + matrix.toUQ8[1]));
+    matrix.toVQ8[0] = static_cast<int16_t>(-(matrix.toVQ8[1] + matrix.toVQ8[2]));
+    return matrix;
+}
+
+} // namespace
+
+const YuvMatrix &GetYuvMatrix(ColorMatrix matrix, ColorRange range)
+{
+    static const YuvMatrix matrices[2][2] = {
+        { makeYuvMatrix("BT.601 full", 0.299, 0.114, false), makeYuvMatrix("BT.601 limited", 0.299, 0.114, true) },
+        { makeYuvMatrix("BT.709 full", 0.2126, 0.0722, false), makeYuvMatrix("BT.709 limited", 0.2126, 0.0722, true) },
+    };
+    return matrices[matrix == COLOR_MATRIX_BT709 ? 1 : 0][range == COLOR_RANGE_LIMITED ? 1 : 0];
+}
+
+void rgbaToYuv420Rows(const uint8_t *row0, const uint8_t *row1, bool bgra,
+                      uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                      uint32_t chromaStep, uint32_t width, const YuvMatrix &matrix)
+{
+    const int ri = bgra ? 2 : 0;
+    const int bi = bgra ? 0 : 2;
+    if (!row1) row1 = row0;
+
+    for (uint32_t x = 0; x < width; x += 2) {
+        const uint32_t pairs = (x + 1 < width) ? 2 : 1;
+        int rSum = 0, gSum = 0, bSum = 0;
+
+        for (uint32_t i = 0; i < pairs; i++) {
+            const uint8_t *p0 = row0 + (x + i) * 4;
+            const uint8_t *p1 = row1 + (x + i) * 4;
+            y0[x + i] = rgbToY(p0[ri], p0[1], p0[bi], matrix);
+            if (y1) y1[x + i] = rgbToY(p1[ri], p1[1], p1[bi], matrix);
+            rSum += p0[ri] + p1[ri];
+            gSum += p0[1] + p1[1];
+            bSum += p0[bi] + p1[bi];
+        }
+
+        const int n = static_cast<int>(pairs) * 2;
+        const int r = rSum / n, g = gSum / n, b = bSum / n;
+        u[(x / 2) * chromaStep] = rgbToU(r, g, b, matrix);
+        v[(x / 2) * chromaStep] = rgbToV(r, g, b, matrix);
+    }
+}
+
+const ConvertKernels &GetScalarKernels()
+{
+    return g_scalarKernels;
+}
+
+const ConvertKernels &GetConvertKernels()
+{
+    static const ConvertKernels &kernels = selectKernels();
+    return kernels;
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,180 @@
+/**
+ * StreamLumo Pixel Conversion Kernels - Header
+ *
+ * Row-level colour conversion kernels used by the frame converters (frame_convert.h).
+ * A scalar reference implementation is always available; SSE4.1/AVX2
+ * variants (NEON via SIMDE on ARM) are selected at runtime from CPU features.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_PIXEL_CONVERT_H
+#define STREAMLUMO_PIXEL_CONVERT_H
+
+#include <cstdint>
+#include <algorithm>
+
+namespace StreamLumo {
+
+/**
+ * YUV colour matrices and ranges of OBS video (obs_video_info colorspace/range)
+ */
+enum ColorMatrix {
+    COLOR_MATRIX_BT601,
+    COLOR_MATRIX_BT709
+};
+
+enum ColorRange {
+    COLOR_RANGE_FULL,
+    COLOR_RANGE_LIMITED
+};
+
+/**
+ * YUV <-> RGB coefficients of one matrix and range
+ *
+ * With U/V unbiased (value - 128) and Y' = (Y - yOffset) * yScale:
+ * R = Y' + rv * V, G = Y' - gu * U - gv * V, B = Y' + bu * U.
+ * The scalar kernels use the float values, the SIMD kernels the Q12 ones;
+ * both round each channel once, to nearest.
+ *
+ * Encoding weighs R, G, B by toY/toU/toV: Y = yOffset + toY . RGB and
+ * U/V = 128 + toU/toV . RGB (Q8 on the CPU, floats in the GPU shader).
+ */
+struct YuvMatrix {
+    const char *name;
+    int yOffset;
+    float yScale;
+    float rv;
+    float gu;
+    float gv;
+    float bu;
+    int16_t yScaleQ12;
+    int16_t rvQ12;
+    int16_t guQ12;
+    int16_t gvQ12;
+    int16_t buQ12;
+    float toY[3];
+    float toU[3];
+    float toV[3];
+    int16_t toYQ8[3];
+    int16_t toUQ8[3];
+    int16_t toVQ8[3];
+};
+
+/**
+ * Get the coefficients for a matrix and range (built once)
+ */
+const YuvMatrix &GetYuvMatrix(ColorMatrix matrix, ColorRange range);
+
+/**
+ * Set of row conversion kernels
+ *
+ * Every kernel converts exactly `width` pixels of one row into tightly
+ * packed RGBA. Chroma pointers address the (already subsampled) chroma row
+ * that belongs to the luma row; the YUV kernels decode with `matrix`.
+ */
+struct ConvertKernels {
+    const char *name;
+    void (*nv12ToRgba)(const uint8_t *y, const uint8_t *uv, uint8_t *dst, uint32_t width, const YuvMatrix &matrix);
+    void (*i420ToRgba)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, uint32_t width,
+                       const YuvMatrix &matrix);
+    void (*uyvyToRgba)(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix);
+    void (*yuy2ToRgba)(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix);
+    void (*y800ToRgba)(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix);
+    // Packed 4-byte pixels; both may run in place (src == dst)
+    void (*bgraToRgba)(const uint8_t *src, uint8_t *dst, uint32_t width);
+    void (*premultiplyRgba)(const uint8_t *src, uint8_t *dst, uint32_t width);
+    void (*opaqueRgba)(const uint8_t *src, uint8_t *dst, uint32_t width);       // Alpha = 255
+
+    // Planar passthrough helpers (`width` counts chroma samples)
+    void (*interleaveUv)(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t width);
+    void (*splitUv)(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t width);
+
+    // Scaling helpers (frame_scale.h); weights are Q14 and sum to SCALE_WEIGHT_ONE
+    // dst[i] = sum of weights[k] * rows[k][i], for `bytes` bytes
+    void (*blendRows)(const uint8_t *const *rows, const int16_t *weights, uint32_t taps, uint8_t *dst, uint32_t bytes);
+    // dst pixel x = sum of weights[x * taps + k] * src pixel (first[x] + k), RGBA
+    void (*resampleRgba)(const uint8_t *src, const uint32_t *first, const int16_t *weights, uint32_t taps,
+                         uint8_t *dst, uint32_t width);
+    // 2:1 box filter of two rows: `width` output pixels of `channels` (1, 2 or 4) bytes
+    void (*halveRows)(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, uint32_t width, uint32_t channels);
+};
+
+/**
+ * Get the fastest kernel set supported by this CPU (detected once)
+ */
+const ConvertKernels &GetConvertKernels();
+
+/**
+ * Get the scalar reference kernels
+ */
+const ConvertKernels &GetScalarKernels();
+
+#if defined(STREAMLUMO_HAVE_SSE41_KERNELS)
+const ConvertKernels &GetSse41Kernels();
+#endif
+
+#if defined(STREAMLUMO_HAVE_AVX2_KERNELS)
+const ConvertKernels &GetAvx2Kernels();
+#endif
+
+inline uint8_t clampToByte(int value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+const uint32_t SCALE_WEIGHT_BITS = 14;
+const int32_t SCALE_WEIGHT_ONE = 1 << SCALE_WEIGHT_BITS;
+
+/**
+ * Scalar blendRows() over bytes [begin, end), also used for the SIMD tails
+ */
+inline void blendRowRange(const uint8_t *const *rows, const int16_t *weights, uint32_t taps,
+                          uint8_t *dst, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++) {
+        int32_t sum = SCALE_WEIGHT_ONE / 2;
+        for (uint32_t k = 0; k < taps; k++) {
+            sum += weights[k] * rows[k][i];
+        }
+        dst[i] = clampToByte(sum >> SCALE_WEIGHT_BITS);
+    }
+}
+
+/**
+ * c * alpha / 255, rounded (exact for all 8-bit inputs)
+ */
+inline uint8_t premultiplyChannel(uint32_t c, uint32_t alpha)
+{
+    const uint32_t product = c * alpha + 128;
+    return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+}
+
+inline void writeRgbaFromYuv(int y, int u, int v, const YuvMatrix &matrix, uint8_t *dst)
+{
+    const float luma = (y - matrix.yOffset) * matrix.yScale;
+    int r = static_cast<int>(luma + matrix.rv * v + 0.5f);
+    int g = static_cast<int>(luma - matrix.gu * u - matrix.gv * v + 0.5f);
+    int b = static_cast<int>(luma + matrix.bu * u + 0.5f);
+
+    dst[0] = clampToByte(r);
+    dst[1] = clampToByte(g);
+    dst[2] = clampToByte(b);
+    dst[3] = 255;
+}
+
+/**
+ * Convert two rows of RGBA/BGRA into two Y rows and one row of 4:2:0 chroma
+ * encoded with `matrix`
+ *
+ * Chroma is the average of each 2x2 block, written to `u` and `v` every
+ * `chromaStep` bytes (2 with u = uv, v = uv + 1 for NV12; 1 for I420).
+ * `row1`/`y1` may be null for the last row of an odd-height frame.
+ */
+void rgbaToYuv420Rows(const uint8_t *row0, const uint8_t *row1, bool bgra,
+                      uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                      uint32_t chromaStep, uint32_t width, const YuvMatrix &matrix);
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_PIXEL_CONVERT_H
@@ -0,0 +1,456 @@
+/**
+ * StreamLumo Pixel Conversion Kernels - AVX2
+ *
+ * Compiled with -mavx2 (/arch:AVX2 on MSVC) and only selected at runtime
+ * when the CPU and OS support it. Uses the same Q12 fixed-point YuvMatrix math
+ * as the SSE4.1 kernels, widened to 16 pixels per 256-bit operation.
+ *
+ * @license GPL-2.0
+ */
+
+#include "pixel_convert.h"
+
+#include <cstring>
+
+#if defined(STREAMLUMO_HAVE_SIMDE)
+#define SIMDE_ENABLE_NATIVE_ALIASES
+#include <simde/x86/avx2.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+struct Coefficients {
+    __m256i bias;
+    __m256i yOffset;
+    __m256i yScale;
+    __m256i rv;
+    __m256i gu;
+    __m256i gv;
+    __m256i bu;
+    __m256i half;
+    __m256i zero;
+    __m256i max;
+    __m256i alpha;
+};
+
+inline Coefficients loadCoefficients(const YuvMatrix &m)
+{
+    Coefficients c;
+    c.bias = _mm256_set1_epi16(128);
+    c.yOffset = _mm256_set1_epi16(static_cast<short>(m.yOffset));
+    c.yScale = _mm256_set1_epi16(m.yScaleQ12);  // 4096 (identity) for full range
+    c.rv = _mm256_set1_epi16(m.rvQ12);
+    c.gu = _mm256_set1_epi16(m.guQ12);
+    c.gv = _mm256_set1_epi16(m.gvQ12);
+    c.bu = _mm256_set1_epi16(m.buQ12);
+    c.half = _mm256_set1_epi16(4);
+    c.zero = _mm256_setzero_si256();
+    c.max = _mm256_set1_epi16(255);
+    c.alpha = _mm256_set1_epi16(static_cast<short>(0xFF00));
+    return c;
+}
+
+inline __m256i saturate(const Coefficients &c, __m256i v)
+{
+    return _mm256_min_epi16(_mm256_max_epi16(v, c.zero), c.max);
+}
+
+/**
+ * Expand 16 pixels of 16-bit luma to the full range, in eighths
+ */
+inline __m256i scaleLuma(const Coefficients &c, __m256i y)
+{
+    return _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y, c.yOffset), 6), c.yScale);
+}
+
+/**
+ * Round 16 values in eighths to the nearest integer
+ */
+inline __m256i roundEighths(const Coefficients &c, __m256i v)
+{
+    return _mm256_srai_epi16(_mm256_add_epi16(v, c.half), 3);
+}
+
+/**
+ * Interleave 16 pixels of 16-bit R/G/B into RGBA and store 64 bytes
+ *
+ * Works in the 16-bit domain (RG and BA pairs) so the only lane fix-up
+ * needed is one permute per 32-byte store.
+ */
+inline void storeRgba16(const Coefficients &c, uint8_t *dst, __m256i r, __m256i g, __m256i b)
+{
+    const __m256i rg = _mm256_or_si256(saturate(c, r), _mm256_slli_epi16(saturate(c, g), 8));
+    const __m256i ba = _mm256_or_si256(saturate(c, b), c.alpha);
+
+    const __m256i lo = _mm256_unpacklo_epi16(rg, ba); // pixels 0-3 | 8-11
+    const __m256i hi = _mm256_unpackhi_epi16(rg, ba); // pixels 4-7 | 12-15
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/**
+ * Convert 16 pixels from 16 luma bytes and 16 per-pixel (duplicated) U/V bytes
+ */
+inline void convert16(const Coefficients &c, __m128i yBytes, __m128i uDup, __m128i vDup, uint8_t *dst)
+{
+    const __m256i y = scaleLuma(c, _mm256_cvtepu8_epi16(yBytes));
+    const __m256i u = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(uDup), c.bias), 6);
+    const __m256i v = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(vDup), c.bias), 6);
+
+    const __m256i r = roundEighths(c, _mm256_add_epi16(y, _mm256_mulhrs_epi16(v, c.rv)));
+    const __m256i g = roundEighths(c, _mm256_sub_epi16(_mm256_sub_epi16(y, _mm256_mulhrs_epi16(u, c.gu)),
+                                                       _mm256_mulhrs_epi16(v, c.gv)));
+    const __m256i b = roundEighths(c, _mm256_add_epi16(y, _mm256_mulhrs_epi16(u, c.bu)));
+
+    storeRgba16(c, dst, r, g, b);
+}
+
+void avx2Nv12ToRgba(const uint8_t *y, const uint8_t *uv, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+    const __m128i dupU = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i dupV = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i uvBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x));
+        convert16(c, yBytes, _mm_shuffle_epi8(uvBytes, dupU), _mm_shuffle_epi8(uvBytes, dupV), dst + x * 4);
+    }
+
+    if (x < width) {
+        GetScalarKernels().nv12ToRgba(y + x, uv + x, dst + x * 4, width - x, matrix);
+    }
+}
+
+void avx2I420ToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, uint32_t width,
+                    const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i uBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+        const __m128i vBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+        convert16(c, yBytes, _mm_unpacklo_epi8(uBytes, uBytes), _mm_unpacklo_epi8(vBytes, vBytes), dst + x * 4);
+    }
+
+    if (x < width) {
+        GetScalarKernels().i420ToRgba(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x, matrix);
+    }
+}
+
+/**
+ * Shared body for the packed 4:2:2 formats. `gather` collects, per 128-bit
+ * lane, 8 luma bytes followed by U0-U3 and V0-V3.
+ */
+inline void packed422ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix, __m256i gather,
+                            void (*tail)(const uint8_t *, uint8_t *, uint32_t, const YuvMatrix &))
+{
+    const Coefficients c = loadCoefficients(matrix);
+    const __m128i dupU = _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, 8, 8, 9, 9, 10, 10, 11, 11);
+    const __m128i dupV = _mm_setr_epi8(4, 4, 5, 5, 6, 6, 7, 7, 12, 12, 13, 13, 14, 14, 15, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2));
+        px = _mm256_shuffle_epi8(px, gather);
+        // [Y0-7 | UV0-7 | Y8-15 | UV8-15] -> [Y0-15 | UV0-7 UV8-15]
+        px = _mm256_permute4x64_epi64(px, 0xD8);
+
+        const __m128i yBytes = _mm256_castsi256_si128(px);
+        const __m128i chroma = _mm256_extracti128_si256(px, 1);
+        convert16(c, yBytes, _mm_shuffle_epi8(chroma, dupU), _mm_shuffle_epi8(chroma, dupV), dst + x * 4);
+    }
+
+    if (x < width) {
+        tail(src + x * 2, dst + x * 4, width - x, matrix);
+    }
+}
+
+void avx2UyvyToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const __m256i gather = _mm256_setr_epi8(
+        1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14,
+        1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14);
+    packed422ToRgba(src, dst, width, matrix, gather, GetScalarKernels().uyvyToRgba);
+}
+
+void avx2Yuy2ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const __m256i gather = _mm256_setr_epi8(
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15,
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15);
+    packed422ToRgba(src, dst, width, matrix, gather, GetScalarKernels().yuy2ToRgba);
+}
+
+void avx2Y800ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)));
+        const __m256i g = roundEighths(c, scaleLuma(c, luma));
+        storeRgba16(c, dst + x * 4, g, g, g);
+    }
+
+    if (x < width) {
+        GetScalarKernels().y800ToRgba(src + x, dst + x * 4, width - x, matrix);
+    }
+}
+
+void avx2BgraToRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i swap = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        for (uint32_t i = 0; i < 2; i++) {
+            const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + (x + i * 8) * 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + (x + i * 8) * 4), _mm256_shuffle_epi8(px, swap));
+        }
+    }
+
+    if (x < width) {
+        GetScalarKernels().bgraToRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+/**
+ * Premultiply 4 pixels of 16-bit RGBA lanes (see the SSE4.1 kernel)
+ */
+inline __m256i premultiply4(__m256i px, __m256i broadcast, __m256i round)
+{
+    const __m256i alpha = _mm256_blend_epi16(_mm256_shuffle_epi8(px, broadcast), _mm256_set1_epi16(255), 0x88);
+    const __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), round);
+    return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+void avx2PremultiplyRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i broadcast = _mm256_setr_epi8(
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    const __m256i round = _mm256_set1_epi16(128);
+
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+        const __m256i lo = premultiply4(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(px)), broadcast, round);
+        const __m256i hi = premultiply4(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(px, 1)), broadcast, round);
+        // packus works per 128-bit lane: pixels 0-1 4-5 | 2-3 6-7 -> 0-7
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+    }
+
+    if (x < width) {
+        GetScalarKernels().premultiplyRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+void avx2OpaqueRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4), _mm256_or_si256(px, alpha));
+    }
+
+    if (x < width) {
+        GetScalarKernels().opaqueRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+void avx2InterleaveUv(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t width)
+{
+    uint32_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i uBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(u + x));
+        const __m256i vBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + x));
+        const __m256i lo = _mm256_unpacklo_epi8(uBytes, vBytes); // 0-7 | 16-23
+        const __m256i hi = _mm256_unpackhi_epi8(uBytes, vBytes); // 8-15 | 24-31
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(uv + x * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(uv + x * 2 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    if (x < width) {
+        GetScalarKernels().interleaveUv(u + x, v + x, uv + x * 2, width - x);
+    }
+}
+
+void avx2SplitUv(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t width)
+{
+    const __m256i deinterleave = _mm256_setr_epi8(
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(uv + x * 2));
+        // [U0-7 V0-7 | U8-15 V8-15] -> [U0-15 | V0-15]
+        px = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(px, deinterleave), 0xD8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm256_castsi256_si128(px));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x), _mm256_extracti128_si256(px, 1));
+    }
+
+    if (x < width) {
+        GetScalarKernels().splitUv(uv + x * 2, u + x, v + x, width - x);
+    }
+}
+
+void avx2BlendRows(const uint8_t *const *rows, const int16_t *weights, uint32_t taps, uint8_t *dst, uint32_t bytes)
+{
+    const __m256i round = _mm256_set1_epi32(SCALE_WEIGHT_ONE / 2);
+    const __m128i zero = _mm_setzero_si128();
+
+    uint32_t x = 0;
+    for (; x + 32 <= bytes; x += 32) {
+        __m256i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+
+        for (uint32_t k = 0; k < taps; k += 2) {
+            const bool pair = (k + 1 < taps);
+            const __m256i w = _mm256_set1_epi32((uint16_t)weights[k] | ((pair ? (uint32_t)(uint16_t)weights[k + 1] : 0u) << 16));
+            const __m128i *a = reinterpret_cast<const __m128i *>(rows[k] + x);
+            const __m128i *b = pair ? reinterpret_cast<const __m128i *>(rows[k + 1] + x) : nullptr;
+
+            // 16 bytes at a time: unpacking within lanes keeps the pack below in order
+            const __m256i a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(a));
+            const __m256i a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(a + 1));
+            const __m256i b0 = _mm256_cvtepu8_epi16(b ? _mm_loadu_si128(b) : zero);
+            const __m256i b1 = _mm256_cvtepu8_epi16(b ? _mm_loadu_si128(b + 1) : zero);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a0, b0), w));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a0, b0), w));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi16(a1, b1), w));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi16(a1, b1), w));
+        }
+
+        const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(acc0, SCALE_WEIGHT_BITS), _mm256_srai_epi32(acc1, SCALE_WEIGHT_BITS));
+        const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(acc2, SCALE_WEIGHT_BITS), _mm256_srai_epi32(acc3, SCALE_WEIGHT_BITS));
+        // [0-7 16-23 | 8-15 24-31] -> [0-15 | 16-31]
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), packed);
+    }
+
+    blendRowRange(rows, weights, taps, dst, x, bytes);
+}
+
+void avx2ResampleRgba(const uint8_t *src, const uint32_t *first, const int16_t *weights, uint32_t taps,
+                      uint8_t *dst, uint32_t width)
+{
+    const __m256i round = _mm256_set1_epi32(SCALE_WEIGHT_ONE / 2);
+    // Two neighbouring pixels -> 16-bit (r0, r1, g0, g1, b0, b1, a0, a1) in each lane
+    const __m256i pairs = _mm256_setr_epi8(
+        0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1,
+        0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+
+    auto loadTaps = [](const uint8_t *px, bool pair) {
+        if (pair) return _mm_loadl_epi64(reinterpret_cast<const __m128i *>(px));
+        int32_t one;
+        std::memcpy(&one, px, sizeof(one));
+        return _mm_cvtsi32_si128(one);
+    };
+    auto weightPair = [](const int16_t *w, uint32_t k, bool pair) {
+        return _mm_set1_epi32((uint16_t)w[k] | ((pair ? (uint32_t)(uint16_t)w[k + 1] : 0u) << 16));
+    };
+
+    // Output pixels x and x + 1 in the two lanes
+    uint32_t x = 0;
+    for (; x + 2 <= width; x += 2) {
+        const uint8_t *px0 = src + first[x] * 4;
+        const uint8_t *px1 = src + first[x + 1] * 4;
+        const int16_t *w0 = weights + x * taps;
+        const int16_t *w1 = w0 + taps;
+        __m256i acc = round;
+
+        for (uint32_t k = 0; k < taps; k += 2) {
+            // An odd last tap loads only its own pixel (the pair's weight is 0),
+            // so the read never goes past the filter window
+            const bool pair = (k + 1 < taps);
+            const __m256i two = _mm256_shuffle_epi8(
+                _mm256_inserti128_si256(_mm256_castsi128_si256(loadTaps(px0 + k * 4, pair)), loadTaps(px1 + k * 4, pair), 1), pairs);
+            const __m256i w = _mm256_inserti128_si256(_mm256_castsi128_si256(weightPair(w0, k, pair)), weightPair(w1, k, pair), 1);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(two, w));
+        }
+
+        const __m256i shifted = _mm256_srai_epi32(acc, SCALE_WEIGHT_BITS);
+        const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(shifted, shifted), shifted);
+        const int32_t out0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+        const int32_t out1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+        std::memcpy(dst + x * 4, &out0, sizeof(out0));
+        std::memcpy(dst + x * 4 + 4, &out1, sizeof(out1));
+    }
+
+    if (x < width) {
+        GetScalarKernels().resampleRgba(src, first + x, weights + x * taps, taps, dst + x * 4, width - x);
+    }
+}
+
+void avx2HalveRows(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, uint32_t width, uint32_t channels)
+{
+    // Same pairing as the SSE4.1 kernel, 32 output bytes per iteration
+    const __m256i gather = channels == 4
+        ? _mm256_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15,
+                           0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15)
+        : channels == 2
+        ? _mm256_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15,
+                           0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15)
+        : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                           0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi16(2);
+    const uint32_t bytes = width * channels;
+
+    auto halve32 = [&](uint32_t offset) {
+        const __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + offset * 2)), gather);
+        const __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + offset * 2)), gather);
+        const __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(a, ones), _mm256_maddubs_epi16(b, ones));
+        return _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+    };
+
+    uint32_t x = 0;
+    for (; x + 32 <= bytes; x += 32) {
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(halve32(x), halve32(x + 16)), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), packed);
+    }
+
+    if (x < bytes) {
+        GetScalarKernels().halveRows(row0 + x * 2, row1 + x * 2, dst + x, (bytes - x) / channels, channels);
+    }
+}
+
+const ConvertKernels g_avx2Kernels = {
+    "avx2",
+    avx2Nv12ToRgba,
+    avx2I420ToRgba,
+    avx2UyvyToRgba,
+    avx2Yuy2ToRgba,
+    avx2Y800ToRgba,
+    avx2BgraToRgba,
+    avx2PremultiplyRgba,
+    avx2OpaqueRgba,
+    avx2InterleaveUv,
+    avx2SplitUv,
+    avx2BlendRows,
+    avx2ResampleRgba,
+    avx2HalveRows,
+};
+
+} // namespace
+
+const ConvertKernels &GetAvx2Kernels()
+{
+    return g_avx2Kernels;
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,450 @@
+/**
+ * StreamLumo Pixel Conversion Kernels - SSE4.1
+ *
+ * Compiled with -msse4.1 on x86. On ARM this file is built against SIMDE,
+ * which lowers the same intrinsics to NEON.
+ *
+ * YUV math runs in 16-bit fixed point: luma (less the range offset) and
+ * chroma are pre-shifted by 6 bits and multiplied with _mm_mulhrs_epi16 by
+ * the Q12 coefficients of the frame's YuvMatrix, which keeps 3 fraction
+ * bits per term. Each channel is rounded once at the end, like the scalar
+ * float reference; the two differ by at most 1, and only where the exact
+ * value lies within 1/4 of a rounding boundary.
+ *
+ * @license GPL-2.0
+ */
+
+#include "pixel_convert.h"
+
+#include <cstring>
+
+#if defined(STREAMLUMO_HAVE_SIMDE)
+#define SIMDE_ENABLE_NATIVE_ALIASES
+#include <simde/x86/sse4.1.h>
+#else
+#include <smmintrin.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+struct Coefficients {
+    __m128i bias;
+    __m128i yOffset;
+    __m128i yScale;
+    __m128i rv;
+    __m128i gu;
+    __m128i gv;
+    __m128i bu;
+    __m128i half;
+    __m128i alpha;
+};
+
+inline Coefficients loadCoefficients(const YuvMatrix &m)
+{
+    Coefficients c;
+    c.bias = _mm_set1_epi16(128);
+    c.yOffset = _mm_set1_epi16(static_cast<short>(m.yOffset));
+    c.yScale = _mm_set1_epi16(m.yScaleQ12);  // 4096 (identity) for full range
+    c.rv = _mm_set1_epi16(m.rvQ12);
+    c.gu = _mm_set1_epi16(m.guQ12);
+    c.gv = _mm_set1_epi16(m.gvQ12);
+    c.bu = _mm_set1_epi16(m.buQ12);
+    c.half = _mm_set1_epi16(4);
+    c.alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    return c;
+}
+
+/**
+ * Expand 8 pixels of 16-bit luma to the full range, in eighths
+ */
+inline __m128i scaleLuma(const Coefficients &c, __m128i y)
+{
+    return _mm_mulhrs_epi16(_mm_slli_epi16(_mm_sub_epi16(y, c.yOffset), 6), c.yScale);
+}
+
+/**
+ * Round 8 values in eighths to the nearest integer
+ */
+inline __m128i roundEighths(const Coefficients &c, __m128i v)
+{
+    return _mm_srai_epi16(_mm_add_epi16(v, c.half), 3);
+}
+
+/**
+ * Convert 8 pixels of 16-bit Y/U/V (U/V biased, one value per pixel)
+ * into saturated R/G/B 16-bit lanes
+ */
+inline void yuvToRgb8(const Coefficients &c, __m128i y, __m128i u, __m128i v,
+                      __m128i &r, __m128i &g, __m128i &b)
+{
+    y = scaleLuma(c, y);
+    u = _mm_slli_epi16(_mm_sub_epi16(u, c.bias), 6);
+    v = _mm_slli_epi16(_mm_sub_epi16(v, c.bias), 6);
+
+    r = roundEighths(c, _mm_add_epi16(y, _mm_mulhrs_epi16(v, c.rv)));
+    g = roundEighths(c, _mm_sub_epi16(_mm_sub_epi16(y, _mm_mulhrs_epi16(u, c.gu)), _mm_mulhrs_epi16(v, c.gv)));
+    b = roundEighths(c, _mm_add_epi16(y, _mm_mulhrs_epi16(u, c.bu)));
+}
+
+/**
+ * Pack 16 pixels of R/G/B (two groups of 8 x 16-bit) into 64 bytes of RGBA
+ */
+inline void storeRgba16(const Coefficients &c, uint8_t *dst,
+                        __m128i r0, __m128i r1, __m128i g0, __m128i g1, __m128i b0, __m128i b1)
+{
+    const __m128i r = _mm_packus_epi16(r0, r1);
+    const __m128i g = _mm_packus_epi16(g0, g1);
+    const __m128i b = _mm_packus_epi16(b0, b1);
+
+    const __m128i rgLo = _mm_unpacklo_epi8(r, g);
+    const __m128i rgHi = _mm_unpackhi_epi8(r, g);
+    const __m128i baLo = _mm_unpacklo_epi8(b, c.alpha);
+    const __m128i baHi = _mm_unpackhi_epi8(b, c.alpha);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 0), _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), _mm_unpackhi_epi16(rgHi, baHi));
+}
+
+/**
+ * Convert 16 pixels given 16 luma bytes and 8 U + 8 V bytes (one per pixel pair)
+ */
+inline void convert16(const Coefficients &c, __m128i yBytes, __m128i uBytes, __m128i vBytes, uint8_t *dst)
+{
+    const __m128i y0 = _mm_cvtepu8_epi16(yBytes);
+    const __m128i y1 = _mm_cvtepu8_epi16(_mm_srli_si128(yBytes, 8));
+
+    // Duplicate each chroma sample for the two pixels that share it
+    const __m128i u16 = _mm_cvtepu8_epi16(uBytes);
+    const __m128i v16 = _mm_cvtepu8_epi16(vBytes);
+    const __m128i u0 = _mm_unpacklo_epi16(u16, u16);
+    const __m128i u1 = _mm_unpackhi_epi16(u16, u16);
+    const __m128i v0 = _mm_unpacklo_epi16(v16, v16);
+    const __m128i v1 = _mm_unpackhi_epi16(v16, v16);
+
+    __m128i r0, g0, b0, r1, g1, b1;
+    yuvToRgb8(c, y0, u0, v0, r0, g0, b0);
+    yuvToRgb8(c, y1, u1, v1, r1, g1, b1);
+    storeRgba16(c, dst, r0, r1, g0, g1, b0, b1);
+}
+
+void sse41Nv12ToRgba(const uint8_t *y, const uint8_t *uv, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+    const __m128i deinterleave = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i uvBytes = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x)), deinterleave);
+        convert16(c, yBytes, uvBytes, _mm_srli_si128(uvBytes, 8), dst + x * 4);
+    }
+
+    if (x < width) {
+        GetScalarKernels().nv12ToRgba(y + x, uv + x, dst + x * 4, width - x, matrix);
+    }
+}
+
+void sse41I420ToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, uint32_t width,
+                     const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i uBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+        const __m128i vBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+        convert16(c, yBytes, uBytes, vBytes, dst + x * 4);
+    }
+
+    if (x < width) {
+        GetScalarKernels().i420ToRgba(y + x, u + x / 2, v + x / 2, dst + x * 4, width - x, matrix);
+    }
+}
+
+/**
+ * Shared body for the packed 4:2:2 formats. The shuffle gathers 8 luma bytes
+ * into the low half and U0-U3 / V0-V3 into the high half of each 8-pixel load.
+ */
+inline void packed422ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix, __m128i gather,
+                            void (*tail)(const uint8_t *, uint8_t *, uint32_t, const YuvMatrix &))
+{
+    const Coefficients c = loadCoefficients(matrix);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), gather);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2 + 16)), gather);
+
+        const __m128i yBytes = _mm_unpacklo_epi64(a, b);
+        const __m128i chromaA = _mm_srli_si128(a, 8);   // U0 U1 U2 U3 V0 V1 V2 V3
+        const __m128i chromaB = _mm_srli_si128(b, 8);   // U4 U5 U6 U7 V4 V5 V6 V7
+        const __m128i uBytes = _mm_unpacklo_epi32(chromaA, chromaB);
+        const __m128i vBytes = _mm_unpacklo_epi32(_mm_srli_si128(chromaA, 4), _mm_srli_si128(chromaB, 4));
+        convert16(c, yBytes, uBytes, vBytes, dst + x * 4);
+    }
+
+    if (x < width) {
+        tail(src + x * 2, dst + x * 4, width - x, matrix);
+    }
+}
+
+void sse41UyvyToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    // U0 Y0 V0 Y1 -> Y at odd bytes, U at 0/4/8/12, V at 2/6/10/14
+    const __m128i gather = _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14);
+    packed422ToRgba(src, dst, width, matrix, gather, GetScalarKernels().uyvyToRgba);
+}
+
+void sse41Yuy2ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    // Y0 U0 Y1 V0 -> Y at even bytes, U at 1/5/9/13, V at 3/7/11/15
+    const __m128i gather = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15);
+    packed422ToRgba(src, dst, width, matrix, gather, GetScalarKernels().yuy2ToRgba);
+}
+
+void sse41Y800ToRgba(const uint8_t *src, uint8_t *dst, uint32_t width, const YuvMatrix &matrix)
+{
+    const Coefficients c = loadCoefficients(matrix);
+    const __m128i alpha = c.alpha;
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i g = _mm_packus_epi16(roundEighths(c, scaleLuma(c, _mm_cvtepu8_epi16(luma))),
+                                           roundEighths(c, scaleLuma(c, _mm_cvtepu8_epi16(_mm_srli_si128(luma, 8)))));
+        const __m128i ggLo = _mm_unpacklo_epi8(g, g);
+        const __m128i ggHi = _mm_unpackhi_epi8(g, g);
+        const __m128i gaLo = _mm_unpacklo_epi8(g, alpha);
+        const __m128i gaHi = _mm_unpackhi_epi8(g, alpha);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 0), _mm_unpacklo_epi16(ggLo, gaLo));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 16), _mm_unpackhi_epi16(ggLo, gaLo));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 32), _mm_unpacklo_epi16(ggHi, gaHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 48), _mm_unpackhi_epi16(ggHi, gaHi));
+    }
+
+    if (x < width) {
+        GetScalarKernels().y800ToRgba(src + x, dst + x * 4, width - x, matrix);
+    }
+}
+
+void sse41BgraToRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        for (uint32_t i = 0; i < 4; i++) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + (x + i * 4) * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + (x + i * 4) * 4), _mm_shuffle_epi8(px, swap));
+        }
+    }
+
+    if (x < width) {
+        GetScalarKernels().bgraToRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+/**
+ * Premultiply 2 pixels of 16-bit RGBA lanes; the alpha lanes multiply by 255,
+ * which the rounding division leaves unchanged
+ */
+inline __m128i premultiply2(__m128i px, __m128i broadcast, __m128i round)
+{
+    const __m128i alpha = _mm_blend_epi16(_mm_shuffle_epi8(px, broadcast), _mm_set1_epi16(255), 0x88);
+    const __m128i product = _mm_add_epi16(_mm_mullo_epi16(px, alpha), round);
+    return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+void sse41PremultiplyRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i broadcast = _mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i zero = _mm_setzero_si128();
+
+    uint32_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+        const __m128i lo = premultiply2(_mm_unpacklo_epi8(px, zero), broadcast, round);
+        const __m128i hi = premultiply2(_mm_unpackhi_epi8(px, zero), broadcast, round);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    if (x < width) {
+        GetScalarKernels().premultiplyRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+void sse41OpaqueRgba(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    uint32_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_or_si128(px, alpha));
+    }
+
+    if (x < width) {
+        GetScalarKernels().opaqueRgba(src + x * 4, dst + x * 4, width - x);
+    }
+}
+
+void sse41InterleaveUv(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t width)
+{
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i uBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+        const __m128i vBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + x * 2), _mm_unpacklo_epi8(uBytes, vBytes));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + x * 2 + 16), _mm_unpackhi_epi8(uBytes, vBytes));
+    }
+
+    if (x < width) {
+        GetScalarKernels().interleaveUv(u + x, v + x, uv + x * 2, width - x);
+    }
+}
+
+void sse41SplitUv(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t width)
+{
+    const __m128i deinterleave = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x * 2)), deinterleave);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x * 2 + 16)), deinterleave);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm_unpacklo_epi64(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x), _mm_unpackhi_epi64(a, b));
+    }
+
+    if (x < width) {
+        GetScalarKernels().splitUv(uv + x * 2, u + x, v + x, width - x);
+    }
+}
+
+void sse41BlendRows(const uint8_t *const *rows, const int16_t *weights, uint32_t taps, uint8_t *dst, uint32_t bytes)
+{
+    const __m128i round = _mm_set1_epi32(SCALE_WEIGHT_ONE / 2);
+    const __m128i zero = _mm_setzero_si128();
+
+    uint32_t x = 0;
+    for (; x + 16 <= bytes; x += 16) {
+        __m128i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+
+        // Two rows per _mm_madd_epi16: (a0, b0, a1, b1, ...) x (wa, wb, wa, wb, ...)
+        for (uint32_t k = 0; k < taps; k += 2) {
+            const bool pair = (k + 1 < taps);
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + x));
+            const __m128i b = pair ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k + 1] + x)) : zero;
+            const __m128i w = _mm_set1_epi32((uint16_t)weights[k] | ((pair ? (uint32_t)(uint16_t)weights[k + 1] : 0u) << 16));
+
+            const __m128i aLo = _mm_unpacklo_epi8(a, zero), aHi = _mm_unpackhi_epi8(a, zero);
+            const __m128i bLo = _mm_unpacklo_epi8(b, zero), bHi = _mm_unpackhi_epi8(b, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), w));
+        }
+
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc0, SCALE_WEIGHT_BITS), _mm_srai_epi32(acc1, SCALE_WEIGHT_BITS));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc2, SCALE_WEIGHT_BITS), _mm_srai_epi32(acc3, SCALE_WEIGHT_BITS));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+
+    blendRowRange(rows, weights, taps, dst, x, bytes);
+}
+
+void sse41ResampleRgba(const uint8_t *src, const uint32_t *first, const int16_t *weights, uint32_t taps,
+                       uint8_t *dst, uint32_t width)
+{
+    const __m128i round = _mm_set1_epi32(SCALE_WEIGHT_ONE / 2);
+    // Two neighbouring pixels -> 16-bit (r0, r1, g0, g1, b0, b1, a0, a1)
+    const __m128i pairs = _mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+
+    for (uint32_t x = 0; x < width; x++) {
+        const uint8_t *px = src + first[x] * 4;
+        const int16_t *w = weights + x * taps;
+        __m128i acc = round;
+
+        uint32_t k = 0;
+        for (; k + 2 <= taps; k += 2) {
+            const __m128i two = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(px + k * 4)), pairs);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(two, _mm_set1_epi32((uint16_t)w[k] | ((uint32_t)(uint16_t)w[k + 1] << 16))));
+        }
+        if (k < taps) {
+            int32_t last;
+            std::memcpy(&last, px + k * 4, sizeof(last));
+            acc = _mm_add_epi32(acc, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(last)), _mm_set1_epi32(w[k])));
+        }
+
+        const __m128i packed = _mm_packs_epi32(_mm_srai_epi32(acc, SCALE_WEIGHT_BITS), acc);
+        const int32_t out = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+        std::memcpy(dst + x * 4, &out, sizeof(out));
+    }
+}
+
+void sse41HalveRows(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, uint32_t width, uint32_t channels)
+{
+    // Move the two samples of each output value next to each other, then
+    // _mm_maddubs_epi16 by 1 adds the pairs horizontally
+    const __m128i gather = channels == 4 ? _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15)
+                         : channels == 2 ? _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15)
+                         : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi16(2);
+    const uint32_t bytes = width * channels;
+
+    auto halve16 = [&](uint32_t offset) {
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + offset * 2)), gather);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + offset * 2)), gather);
+        const __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(a, ones), _mm_maddubs_epi16(b, ones));
+        return _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    };
+
+    uint32_t x = 0;
+    for (; x + 16 <= bytes; x += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(halve16(x), halve16(x + 8)));
+    }
+
+    if (x < bytes) {
+        GetScalarKernels().halveRows(row0 + x * 2, row1 + x * 2, dst + x, (bytes - x) / channels, channels);
+    }
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+const char *const kKernelName = "neon (simde)";
+#else
+const char *const kKernelName = "sse4.1";
+#endif
+
+const ConvertKernels g_sse41Kernels = {
+    kKernelName,
+    sse41Nv12ToRgba,
+    sse41I420ToRgba,
+    sse41UyvyToRgba,
+    sse41Yuy2ToRgba,
+    sse41Y800ToRgba,
+    sse41BgraToRgba,
+    sse41PremultiplyRgba,
+    sse41OpaqueRgba,
+    sse41InterleaveUv,
+    sse41SplitUv,
+    sse41BlendRows,
+    sse41ResampleRgba,
+    sse41HalveRows,
+};
+
+} // namespace
+
+const ConvertKernels &GetSse41Kernels()
+{
+    return g_sse41Kernels;
+}
+
+} // namespace StreamLumo
@@ -17,6 +17,10 @@
 #include <util/platform.h>
 #include <util/threading.h>
 #include "frame_writer.h"
+#include "channel_registry.h"
+#include "encoded_writer.h"
+#include <cstdlib>
+#include <string>
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("streamlumo-plugin", "en-US")
@@ -30,6 +34,82 @@ static StreamLumo::FrameWriter *g_program_writer = nullptr;
 static StreamLumo::FrameWriter *g_preview_writer = nullptr;
 static bool g_program_active = false;
 static bool g_preview_active = false;
+static StreamLumo::ChannelRegistry *g_channels = nullptr;
+static StreamLumo::EncodedWriter *g_encoded_writer = nullptr;
+static uint32_t g_channel_epoch = 0;
+
+/**
+ * Create a writer with the conversion pool taken from the environment
+ *
+ * STREAMLUMO_CONVERSION_THREADS sets the number of band workers (default 0:
+ * convert on the video thread) and STREAMLUMO_CONVERSION_AFFINITY an optional
+ * hex CPU mask for them, e.g. "0xF0" to keep them off the first four cores.
+ * STREAMLUMO_GPU_CONVERSION=1 scales and converts source captures on the GPU.
+ * STREAMLUMO_PREVIEW_FPS sets the source capture rate (default 30, 0 = canvas rate).
+ * STREAMLUMO_CHANGE_DETECTION=1 skips frames identical to the last one published.
+ * STREAMLUMO_SCALE_FILTER picks the CPU scaling filter: nearest, bilinear or area (default).
+ * STREAMLUMO_RECORD=<directory> records the frames reaching each writer to
+ * <directory>/streamlumo-<channel>.slrec for bench/frame_replay.cpp, up to
+ * STREAMLUMO_RECORD_MB megabytes per channel (default 2048, reserved on disk
+ * when recording starts; recording is skipped if the space is not free).
+ */
+static StreamLumo::FrameWriter *create_writer(const char *channel, StreamLumo::FrameWriter::Mode mode)
+{
+    StreamLumo::FrameWriter *writer = new StreamLumo::FrameWriter(channel, mode);
+
+    const char *threads = getenv("STREAMLUMO_CONVERSION_THREADS");
+    if (threads && *threads) {
+        const char *affinity = getenv("STREAMLUMO_CONVERSION_AFFINITY");
+        const uint64_t mask = (affinity && *affinity) ? strtoull(affinity, nullptr, 16) : 0;
+        writer->setConversionThreads(static_cast<uint32_t>(strtoul(threads, nullptr, 10)), mask);
+    }
+
+    const char *previewFps = getenv("STREAMLUMO_PREVIEW_FPS");
+    if (mode == StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE && previewFps && *previewFps) {
+        writer->setPreviewRate(static_cast<uint32_t>(strtoul(previewFps, nullptr, 10)));
+    }
+
+    const char *gpu = getenv("STREAMLUMO_GPU_CONVERSION");
+    if (mode == StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE && gpu && atoi(gpu) != 0) {
+        writer->setGpuConversion(true);
+    }
+
+    const char *changes = getenv("STREAMLUMO_CHANGE_DETECTION");
+    if (changes && atoi(changes) != 0) {
+        writer->setChangeDetection(true);
+    }
+
+    const char *filterName = getenv("STREAMLUMO_SCALE_FILTER");
+    StreamLumo::ScaleFilter filter;
+    if (filterName && *filterName) {
+        if (StreamLumo::parseScaleFilter(filterName, filter)) {
+            writer->setScaleFilter(filter);
+        } else {
+            blog(LOG_WARNING, "[StreamLumo] Unknown STREAMLUMO_SCALE_FILTER '%s' (nearest, bilinear or area)", filterName);
+        }
+    }
+
+    const char *recordDir = getenv("STREAMLUMO_RECORD");
+    if (recordDir && *recordDir) {
+        const char *recordMb = getenv("STREAMLUMO_RECORD_MB");
+        const uint64_t megabytes = (recordMb && *recordMb) ? strtoull(recordMb, nullptr, 10) : 2048;
+        const std::string path = std::string(recordDir) + "/streamlumo-" + channel + ".slrec";
+        writer->startRecording(path, megabytes << 20);
+    }
+    return writer;
+}
+
+/**
+ * Create the writer of the program's encoded packet channel
+ *
+ * STREAMLUMO_ENCODER forces an OBS encoder id (e.g. "obs_x264"); by default the
+ * first hardware encoder of the codec the consumer asked for is used.
+ */
+static StreamLumo::EncodedWriter *create_encoded_writer()
+{
+    const char *encoder = getenv("STREAMLUMO_ENCODER");
+    return new StreamLumo::EncodedWriter("program", encoder ? encoder : "");
+}
 
 /**
  * Update the source for the preview writer
@@ -52,6 +132,27 @@ static void update_preview_source()
     }
 }
 
+/**
+ * OBS output settings may have changed: the program writer re-reads them
+ * on its next frame instead of querying them for every frame
+ */
+static void invalidate_video_info()
+{
+    if (g_program_writer) {
+        g_program_writer->invalidateVideoInfo();
+    }
+}
+
+/**
+ * libobs "video_reset" signal (output resolution / format / FPS changed)
+ */
+static void video_reset_callback(void *data, calldata_t *params)
+{
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(params);
+    invalidate_video_info();
+}
+
 /**
  * Frontend event callback
  */
@@ -60,6 +161,9 @@ static void frontend_event_callback(enum obs_frontend_event event, void *param)
     UNUSED_PARAMETER(param);
     
     switch (event) {
+        case OBS_FRONTEND_EVENT_PROFILE_CHANGED:
+            invalidate_video_info();
+            break;
         case OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED:
         case OBS_FRONTEND_EVENT_SCENE_CHANGED:
         case OBS_FRONTEND_EVENT_STUDIO_MODE_ENABLED:
@@ -71,6 +175,18 @@ static void frontend_event_callback(enum obs_frontend_event event, void *param)
     }
 }
 
+/**
+ * Stop a running writer whose channel the consumer re-created (e.g. after a
+ * restart), so the reconnect below maps the new region
+ */
+static void stop_if_replaced(StreamLumo::FrameWriter *writer, bool &active, const char *name)
+{
+    if (!active || !writer || !writer->isChannelReplaced()) return;
+    blog(LOG_INFO, "[StreamLumo] %s channel was re-created by the consumer - reconnecting", name);
+    writer->stop();
+    active = false;
+}
+
 /**
  * Tick callback to check for shared memory connection and pause requests
  */
@@ -78,45 +194,50 @@ static void check_connection_tick(void *param, float seconds)
 {
     UNUSED_PARAMETER(param);
     
+    // Per-source channels requested through the channel directory
+    if (g_channels) {
+        g_channels->tick(seconds);
+    }
+    
+    // The encoder follows the packet channel's reader and keyframe requests
+    if (g_encoded_writer) {
+        g_encoded_writer->tick(seconds);
+    }
+    
     static float timer = 0.0f;
     timer += seconds;
     
-    // Check for pause requests more frequently (every tick)
-    // This allows the consumer to signal us to stop for settings changes
-    if (g_program_active && g_program_writer) {
-        if (g_program_writer->checkPauseRequested()) {
-            blog(LOG_INFO, "[StreamLumo] Pause requested - stopping frame capture for settings change");
-            g_program_writer->stop();
-            g_program_writer->confirmPaused();
-            g_program_active = false;
-        }
-    }
+    // Running writers stay connected; each suspends its own capture while no
+    // consumer asks for frames or the consumer paused the channel, and applies
+    // size/format changes between frames (consumer reconfigure())
     
-    if (g_preview_active && g_preview_writer) {
-        if (g_preview_writer->checkPauseRequested()) {
-            blog(LOG_INFO, "[StreamLumo] Pause requested for preview - stopping");
-            g_preview_writer->stop();
-            g_preview_writer->confirmPaused();
-            g_preview_active = false;
-        }
-    }
+    // A consumer announces every channel it creates in the channel directory:
+    // connect on this tick instead of waiting for the retry timer
+    const uint32_t epoch = g_channels ? g_channels->channelEpoch() : 0;
+    const bool announced = (epoch != g_channel_epoch);
+    g_channel_epoch = epoch;
     
-    // Check every 2 seconds if not active (for auto-reconnect)
-    if (timer < 2.0f) return;
+    // Otherwise check every 2 seconds if not active (for auto-reconnect)
+    if (!announced && timer < 2.0f) return;
     timer = 0.0f;
     
-    // Check Program - only restart if not paused by consumer
+    stop_if_replaced(g_program_writer, g_program_active, "Program");
+    stop_if_replaced(g_preview_writer, g_preview_active, "Preview");
+    
+    // Encoded program channel (only if a consumer created one)
+    if (g_encoded_writer) {
+        g_encoded_writer->connect();
+    }
+    
+    // Check Program
     if (!g_program_active) {
         if (!g_program_writer) {
-            g_program_writer = new StreamLumo::FrameWriter("program", StreamLumo::FrameWriter::MODE_GLOBAL_OUTPUT);
+            g_program_writer = create_writer("program", StreamLumo::FrameWriter::MODE_GLOBAL_OUTPUT);
         }
-        // Only reconnect if pause is not requested
-        if (!g_program_writer->checkPauseRequested()) {
-            if (g_program_writer->connect()) {
-                if (g_program_writer->start()) {
-                    g_program_active = true;
-                    blog(LOG_INFO, "[StreamLumo] Program writer started (retry)");
-                }
+        if (g_program_writer->connect()) {
+            if (g_program_writer->start()) {
+                g_program_active = true;
+                blog(LOG_INFO, "[StreamLumo] Program writer started (%s)", announced ? "announced" : "retry");
             }
         }
     }
@@ -124,15 +245,13 @@ static void check_connection_tick(void *param, float seconds)
     // Check Preview
     if (!g_preview_active) {
         if (!g_preview_writer) {
-            g_preview_writer = new StreamLumo::FrameWriter("preview", StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE);
+            g_preview_writer = create_writer("preview", StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE);
         }
-        if (!g_preview_writer->checkPauseRequested()) {
-            if (g_preview_writer->connect()) {
-                if (g_preview_writer->start()) {
-                    g_preview_active = true;
-                    update_preview_source();
-                    blog(LOG_INFO, "[StreamLumo] Preview writer started (retry)");
-                }
+        if (g_preview_writer->connect()) {
+            if (g_preview_writer->start()) {
+                g_preview_active = true;
+                update_preview_source();
+                blog(LOG_INFO, "[StreamLumo] Preview writer started (%s)", announced ? "announced" : "retry");
             }
         }
     }
@@ -148,15 +267,22 @@ bool obs_module_load(void)
     blog(LOG_INFO, "[StreamLumo] License: GPL-2.0");
     blog(LOG_INFO, "[StreamLumo] IPC Method: Shared Memory");
     
+    // Per-source channels share the writer configuration of program and preview
+    g_channels = new StreamLumo::ChannelRegistry(create_writer);
+    g_channels->reserve("program");
+    g_channels->reserve("preview");
+    
     // Register tick callback to handle connection retries
     obs_add_tick_callback(check_connection_tick, nullptr);
     
     // Register frontend event callback
     obs_frontend_add_event_callback(frontend_event_callback, nullptr);
+    signal_handler_connect(obs_get_signal_handler(), "video_reset", video_reset_callback, nullptr);
     
     // Create frame writers
-    g_program_writer = new StreamLumo::FrameWriter("program", StreamLumo::FrameWriter::MODE_GLOBAL_OUTPUT);
-    g_preview_writer = new StreamLumo::FrameWriter("preview", StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE);
+    g_program_writer = create_writer("program", StreamLumo::FrameWriter::MODE_GLOBAL_OUTPUT);
+    g_preview_writer = create_writer("preview", StreamLumo::FrameWriter::MODE_SOURCE_CAPTURE);
+    g_encoded_writer = create_encoded_writer();
     
     // Connect Program
     if (g_program_writer->connect()) {
@@ -165,7 +291,7 @@ bool obs_module_load(void)
             blog(LOG_INFO, "[StreamLumo] Program writer started");
         }
     } else {
-        blog(LOG_WARNING, "[StreamLumo] Failed to connect Program - waiting for Electron...");
+        blog(LOG_INFO, "[StreamLumo] Program channel not available yet - connecting when Electron announces it");
     }
 
     // Connect Preview
@@ -176,15 +302,16 @@ bool obs_module_load(void)
             blog(LOG_INFO, "[StreamLumo] Preview writer started");
         }
     } else {
-        blog(LOG_WARNING, "[StreamLumo] Failed to connect Preview - waiting for Electron...");
+        blog(LOG_INFO, "[StreamLumo] Preview channel not available yet - connecting when Electron announces it");
     }
     
-    // Register the preview capture filter
+    // Register the preview capture filter and the packet channel output
     RegisterPreviewFilter();
+    RegisterEncodedOutput();
+    g_encoded_writer->connect();
     
     blog(LOG_INFO, "[StreamLumo] Plugin loaded successfully - 60 FPS capture active");
-    blog(LOG_INFO, "[StreamLumo] Target resolution: 1920x1080 RGBA");
-    blog(LOG_INFO, "[StreamLumo] Throughput: ~474 MB/s");
+    blog(LOG_INFO, "[StreamLumo] Default resolution: 1920x1080 RGBA (negotiated per channel)");
     
     return true;
 }
@@ -198,10 +325,19 @@ void obs_module_unload(void)
     
     obs_remove_tick_callback(check_connection_tick, nullptr);
     obs_frontend_remove_event_callback(frontend_event_callback, nullptr);
+    signal_handler_disconnect(obs_get_signal_handler(), "video_reset", video_reset_callback, nullptr);
     
     g_program_active = false;
     g_preview_active = false;
     
+    // Stop and destroy the per-source channels
+    delete g_channels;
+    g_channels = nullptr;
+    
+    // Stop the encoder before the program writer
+    delete g_encoded_writer;
+    g_encoded_writer = nullptr;
+    
     // Stop Program
     if (g_program_writer) {
         g_program_writer->stop();
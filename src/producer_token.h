@@ -0,0 +1,64 @@
+/**
+ * StreamLumo Producer Token - Header
+ *
+ * Exclusive ownership of a channel's producer side (the shm write cursor,
+ * conversion scratch and change detector) without a kernel mutex. Frame
+ * paths take it with try_lock() and skip the frame if another producer -
+ * e.g. the video thread and a preview filter on the graphics thread - holds
+ * it, so neither thread ever blocks behind the other. Configuration calls
+ * use lock(), which yields until the current frame is done.
+ *
+ * Satisfies Lockable, so it works with std::lock_guard / std::unique_lock.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_PRODUCER_TOKEN_H
+#define STREAMLUMO_PRODUCER_TOKEN_H
+
+#include <atomic>
+#include <thread>
+
+namespace StreamLumo {
+
+class ProducerToken {
+public:
+    ProducerToken()
+        : m_held(false)
+    {
+    }
+
+    ProducerToken(const ProducerToken &) = delete;
+    ProducerToken &operator=(const ProducerToken &) = delete;
+
+    /**
+     * Take the token if it is free (one atomic exchange, never waits)
+     */
+    bool try_lock()
+    {
+        return !m_held.load(std::memory_order_relaxed) &&
+               !m_held.exchange(true, std::memory_order_acquire);
+    }
+
+    /**
+     * Take the token, yielding while a frame is in progress (not for frame paths)
+     */
+    void lock()
+    {
+        while (!try_lock()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock()
+    {
+        m_held.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> m_held;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_PRODUCER_TOKEN_H
@@ -0,0 +1,131 @@
+/**
+ * StreamLumo GPU Readback Ring - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "readback_ring.h"
+
+#include <util/platform.h>
+#include <graphics/graphics.h>
+#include <algorithm>
+
+namespace StreamLumo {
+
+ReadbackRing::ReadbackRing(uint32_t depth)
+    : m_depth(std::clamp(depth, 1u, MAX_READBACK_DEPTH))
+    , m_width(0)
+    , m_height(0)
+    , m_format(GS_RGBA)
+    , m_next(0)
+    , m_mapped(-1)
+{
+}
+
+ReadbackRing::~ReadbackRing()
+{
+    reset();
+}
+
+void ReadbackRing::setDepth(uint32_t depth)
+{
+    depth = std::clamp(depth, 1u, MAX_READBACK_DEPTH);
+    if (depth == m_depth) return;
+
+    reset();
+    m_depth = depth;
+    blog(LOG_INFO, "[ReadbackRing] Pipeline depth set to %u (%u frame(s) of latency)", depth, depth - 1);
+}
+
+void ReadbackRing::reset()
+{
+    unmap();
+    for (Slot &slot : m_slots) {
+        if (slot.surface) gs_stagesurface_destroy(slot.surface);
+    }
+    m_slots.clear();
+    m_width = 0;
+    m_height = 0;
+    m_next = 0;
+}
+
+bool ReadbackRing::ensureSurfaces(uint32_t width, uint32_t height, enum gs_color_format format)
+{
+    if (m_width == width && m_height == height && m_format == format && m_slots.size() == m_depth) {
+        return true;
+    }
+
+    reset();
+    m_slots.resize(m_depth);
+    for (Slot &slot : m_slots) {
+        slot.surface = gs_stagesurface_create(width, height, format);
+        slot.stagedAtNs = 0;
+        slot.contentFormat = 0;
+        slot.pending = false;
+        if (!slot.surface) {
+            blog(LOG_ERROR, "[ReadbackRing] Failed to create stagesurface %ux%u", width, height);
+            reset();
+            return false;
+        }
+    }
+
+    m_width = width;
+    m_height = height;
+    m_format = format;
+    return true;
+}
+
+bool ReadbackRing::stage(gs_texture_t *tex, uint32_t width, uint32_t height, MappedFrame &out, uint32_t contentFormat)
+{
+    if (!tex || width == 0 || height == 0) return false;
+
+    // A slot left mapped by the caller would be re-staged while mapped
+    unmap();
+
+    if (!ensureSurfaces(width, height, gs_texture_get_color_format(tex))) return false;
+
+    Slot &current = m_slots[m_next];
+    gs_stage_texture(current.surface, tex);
+    current.stagedAtNs = os_gettime_ns();
+    current.contentFormat = contentFormat;
+    current.pending = true;
+
+    // The slot after the one just staged is the oldest in flight
+    // (with depth 1 this is the slot we just staged: synchronous readback)
+    const uint32_t oldest = (m_next + 1) % m_depth;
+    m_next = oldest;
+
+    Slot &ready = m_slots[oldest];
+    if (!ready.pending) return false;
+    ready.pending = false;
+
+    uint8_t *data = nullptr;
+    uint32_t linesize = 0;
+    const uint64_t mapStart = os_gettime_ns();
+    if (!gs_stagesurface_map(ready.surface, &data, &linesize)) {
+        return false;
+    }
+    const uint64_t mapEnd = os_gettime_ns();
+
+    m_mapped = static_cast<int>(oldest);
+    out.data = data;
+    out.linesize = linesize;
+    out.width = m_width;
+    out.height = m_height;
+    out.contentFormat = ready.contentFormat;
+    out.stagedAtNs = ready.stagedAtNs;
+    out.mapStallNs = mapEnd - mapStart;
+    return true;
+}
+
+void ReadbackRing::unmap()
+{
+    if (m_mapped < 0) return;
+
+    if (static_cast<size_t>(m_mapped) < m_slots.size() && m_slots[m_mapped].surface) {
+        gs_stagesurface_unmap(m_slots[m_mapped].surface);
+    }
+    m_mapped = -1;
+}
+
+} // namespace StreamLumo
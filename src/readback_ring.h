@@ -0,0 +1,91 @@
+/**
+ * StreamLumo GPU Readback Ring - Header
+ *
+ * N-deep ring of staging surfaces for asynchronous GPU -> CPU readback.
+ * Each call to stage() copies the current texture into the next surface and
+ * maps the surface staged (depth - 1) frames earlier, by which time the GPU
+ * copy has normally completed and gs_stagesurface_map() no longer stalls.
+ *
+ * All methods must be called from inside the graphics context.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_READBACK_RING_H
+#define STREAMLUMO_READBACK_RING_H
+
+#include <obs.h>
+#include <cstdint>
+#include <vector>
+
+namespace StreamLumo {
+
+// Default pipeline depth: stage frame N, map frame N-2
+static constexpr uint32_t DEFAULT_READBACK_DEPTH = 3;
+static constexpr uint32_t MAX_READBACK_DEPTH = 8;
+
+class ReadbackRing {
+public:
+    /**
+     * Mapped frame handed out by stage()
+     */
+    struct MappedFrame {
+        uint8_t *data;
+        uint32_t linesize;
+        uint32_t width;
+        uint32_t height;
+        uint32_t contentFormat; // Value passed to stage() for this frame
+        uint64_t stagedAtNs;    // os_gettime_ns() when the frame was staged
+        uint64_t mapStallNs;    // Time gs_stagesurface_map() blocked waiting for the GPU copy
+    };
+
+    explicit ReadbackRing(uint32_t depth = DEFAULT_READBACK_DEPTH);
+    ~ReadbackRing();
+
+    /**
+     * Change the pipeline depth (1 = synchronous readback)
+     * In-flight frames are discarded.
+     */
+    void setDepth(uint32_t depth);
+    uint32_t depth() const { return m_depth; }
+
+    /**
+     * Stage a texture and map the oldest in-flight frame if one is ready
+     * Surfaces match the texture's colour format. `contentFormat` is carried
+     * through to the mapped frame (the FORMAT_* of a GPU-converted layout).
+     * Returns true if `out` was filled; the caller must call unmap() after use.
+     */
+    bool stage(gs_texture_t *tex, uint32_t width, uint32_t height, MappedFrame &out, uint32_t contentFormat = 0);
+
+    /**
+     * Unmap the frame returned by the last successful stage()
+     */
+    void unmap();
+
+    /**
+     * Destroy all staging surfaces and drop in-flight frames
+     */
+    void reset();
+
+private:
+    struct Slot {
+        gs_stagesurf_t *surface;
+        uint64_t stagedAtNs;
+        uint32_t contentFormat;
+        bool pending;
+    };
+
+    bool ensureSurfaces(uint32_t width, uint32_t height, enum gs_color_format format);
+
+    std::vector<Slot> m_slots;
+    uint32_t m_depth;
+    uint32_t m_width;
+    uint32_t m_height;
+    enum gs_color_format m_format;
+    uint32_t m_next;            // Slot that receives the next stage
+    int m_mapped;               // Currently mapped slot, -1 if none
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_READBACK_RING_H
@@ -8,26 +8,207 @@
  */
 
 #include "shm_posix.h"
-#include "../../native-shm/include/shared_buffer.h"
+#include "../include/shared_buffer.h"
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <semaphore.h>
 #include <cstring>
 #include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <iostream>
 #include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+// Darwin's address wait primitive (libc++ uses it for std::atomic::wait)
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value, uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#define ULF_WAKE_ALL 0x00000100
+#endif
 
 namespace StreamLumo {
 
+namespace {
+
+/**
+ * Fill metadata for one frame from its slot descriptor
+ */
+void fillFrameMetadata(const SharedFrameBuffer* buffer, const SlotDescriptor& slot, uint32_t sequence, FrameMetadata& metadata) {
+    metadata.width = slot.width;
+    metadata.height = slot.height;
+    metadata.frameSize = static_cast<uint32_t>(frameSizeFor(slot.width, slot.height, slot.format));
+    metadata.format = slot.format;
+    metadata.frameCounter = buffer->frame_counter.load(std::memory_order_relaxed);
+    metadata.droppedFrames = buffer->dropped_frames.load(std::memory_order_relaxed);
+    metadata.ringFullFrames = buffer->ring_full_frames.load(std::memory_order_relaxed);
+    metadata.slotBusyFrames = buffer->slot_busy_frames.load(std::memory_order_relaxed);
+    metadata.activeConsumers = 0;
+    metadata.appliedGeneration = buffer->applied_generation.load(std::memory_order_acquire);
+    metadata.lastWriteTimestampNs = buffer->last_write_timestamp_ns.load(std::memory_order_relaxed);
+    metadata.sequence = sequence;
+    for (uint32_t i = 0; i < MAX_PLANES; i++) {
+        metadata.stride[i] = slot.stride[i];
+    }
+    metadata.colorMatrix = slot.color_matrix;
+    metadata.colorRange = slot.color_range;
+    metadata.frameNumber = slot.frame_number;
+    metadata.obsTimestampNs = slot.obs_timestamp_ns;
+    metadata.captureTimeNs = slot.capture_time_ns;
+    metadata.dirtyBaseFrame = slot.dirty_base_frame;
+    for (uint32_t i = 0; i < SL_DIRTY_WORDS; i++) {
+        metadata.dirtyTiles[i] = slot.dirty_tiles[i];
+    }
+}
+
+/**
+ * Steady clock in nanoseconds (heartbeats and read timestamps)
+ */
+uint64_t steadyNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Token identifying one consumer registration (distinct per process and instance)
+ */
+uint32_t nextConsumerToken() {
+    static std::atomic<uint32_t> counter(0);
+    const uint32_t token = (static_cast<uint32_t>(getpid()) << 8) ^ counter.fetch_add(1, std::memory_order_relaxed);
+    return token != 0 ? token : 1;
+}
+
+#if defined(__linux__)
+/**
+ * Whether the mapping starting at `ptr` is mapped with huge pages
+ * (ShmemPmdMapped of its /proc/self/smaps entry; the pages must be faulted in)
+ */
+bool isHugePageMapped(const void* ptr) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps) return false;
+    
+    char line[256];
+    bool inMapping = false;
+    bool huge = false;
+    while (!huge && fgets(line, sizeof(line), smaps)) {
+        unsigned long start = 0;
+        unsigned long end = 0;
+        unsigned long kb = 0;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (inMapping) break;
+            inMapping = (start == reinterpret_cast<uintptr_t>(ptr));
+        } else if (inMapping && sscanf(line, "ShmemPmdMapped: %lu kB", &kb) == 1) {
+            huge = kb > 0;
+        }
+    }
+    fclose(smaps);
+    return huge;
+}
+#endif
+
+/**
+ * Prepare a new mapping for frame traffic: ask for huge pages if wanted,
+ * then prefault every page so the first frames don't take thousands of faults
+ * Returns the page size backing the mapping.
+ */
+uint32_t preparePages(void* ptr, size_t size, bool hugePages) {
+    const uint32_t systemPageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    bool advised = false;
+#if defined(MADV_HUGEPAGE)
+    // Transparent huge pages for shmem (shmem_enabled = advise / within_size);
+    // the advice only applies to later faults, so MAP_POPULATE can't be used
+    advised = hugePages && madvise(ptr, size, MADV_HUGEPAGE) == 0;
+#else
+    // No huge pages for named shared memory here (macOS superpages are anonymous-only)
+    (void)hugePages;
+#endif
+    
+    bool populated = false;
+#if defined(MADV_POPULATE_WRITE)
+    // Linux 5.14+: allocate and map every page writable in one call
+    populated = madvise(ptr, size, MADV_POPULATE_WRITE) == 0;
+#endif
+    if (!populated) {
+#if defined(MADV_WILLNEED)
+        madvise(ptr, size, MADV_WILLNEED);
+#endif
+        // Read one byte per page: maps it without touching the frame data
+        const volatile unsigned char* bytes = static_cast<const volatile unsigned char*>(ptr);
+        for (size_t offset = 0; offset < size; offset += systemPageSize) {
+            (void)bytes[offset];
+        }
+    }
+    
+#if defined(__linux__)
+    if (advised && isHugePageMapped(ptr)) return SL_HUGE_PAGE_SIZE;
+#endif
+    (void)advised;
+    return systemPageSize;
+}
+
+/**
+ * Describe a page size for the logs
+ */
+std::string pageBacking(uint32_t pageSize) {
+    return std::to_string(pageSize / 1024) + (pageSize >= SL_HUGE_PAGE_SIZE ? " KB huge pages" : " KB pages");
+}
+
+/**
+ * Block while `*word == expected`, for at most `timeoutNs` (< 0 = forever)
+ * The word lives in shared memory, so the process-shared variants are used.
+ * Returns on wake, timeout or signal; the caller re-checks the word.
+ */
+void waitOnWord(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeoutNs) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeoutNs / 1000000000LL);
+    ts.tv_nsec = static_cast<long>(timeoutNs % 1000000000LL);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+            timeoutNs < 0 ? nullptr : &ts, nullptr, 0);
+#elif defined(__APPLE__)
+    // 0 means no timeout for __ulock_wait; round short waits up to 1 us
+    uint32_t timeoutUs = 0;
+    if (timeoutNs >= 0) {
+        const int64_t us = (timeoutNs + 999) / 1000;
+        timeoutUs = us > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us > 0 ? us : 1);
+    }
+    __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, word, expected, timeoutUs);
+#else
+    // No shared address wait on this platform: sleep in 1 ms steps
+    (void)word;
+    (void)expected;
+    const int64_t step = 1000000;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(timeoutNs < 0 || timeoutNs > step ? step : timeoutNs));
+#endif
+}
+
+/**
+ * Wake every waiter blocked on `word`
+ */
+void wakeWord(std::atomic<uint32_t>* word) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+    __ulock_wake(UL_COMPARE_AND_WAIT_SHARED | ULF_WAKE_ALL, word, 0);
+#else
+    (void)word;
+#endif
+}
+
+} // namespace
+
 ShmPosix::ShmPosix(const std::string& channelName) 
-    : m_channelName(channelName), m_shm_fd(-1), m_shm_ptr(nullptr), m_sem(nullptr) {
+    : m_channelName(channelName), m_shm_fd(-1), m_shm_ptr(nullptr), m_mappedSize(0), m_pageSize(0), m_lastFrameSignal(0), m_pendingWriteIndex(-1),
+      m_consumerIndex(SL_MAX_CONSUMERS), m_consumerToken(0) {
     
     // Construct names based on channel
     // e.g. "/streamlumo_frames_program"
     m_shmName = std::string(SHM_NAME) + "_" + channelName;
-    m_semName = std::string(SEM_NAME) + "_" + channelName;
 }
 
 ShmPosix::~ShmPosix() {
@@ -35,10 +216,24 @@ ShmPosix::~ShmPosix() {
 }
 
 /**
- * Create or open shared memory region
+ * Create the shared memory region, replacing any object left under its name
  */
-bool ShmPosix::create() {
-    // Open/create shared memory object
+bool ShmPosix::create(uint32_t width, uint32_t height, uint32_t format, uint32_t flags, uint32_t slotCount) {
+    if (width == 0 || height == 0) {
+        std::cerr << "[ShmPosix] Invalid frame geometry " << width << "x" << height << std::endl;
+        return false;
+    }
+    
+    const uint64_t regionSize = regionSizeFor(slotSizeFor(frameSizeFor(width, height, format)),
+                                              slotCountFor(flags, slotCount));
+    
+    // Whole huge pages, so the tail of the region can use one too
+    const bool hugePages = (flags & SL_FLAG_HUGE_PAGES) != 0;
+    const uint64_t objectSize = hugePages ? alignUp(regionSize, SL_HUGE_PAGE_SIZE) : regionSize;
+    
+    // Start from an empty object: a producer may still have an old one mapped,
+    // and keeps it (valid) until isReplaced() sees the new inode
+    shm_unlink(m_shmName.c_str());
     m_shm_fd = shm_open(m_shmName.c_str(), O_CREAT | O_RDWR, 0666);
     if (m_shm_fd == -1) {
         std::cerr << "[ShmPosix] Failed to create shared memory (" << m_shmName << "): " << strerror(errno) << std::endl;
@@ -46,7 +241,7 @@ bool ShmPosix::create() {
     }
     
     // Set size of shared memory
-    if (ftruncate(m_shm_fd, SHARED_BUFFER_SIZE) == -1) {
+    if (ftruncate(m_shm_fd, objectSize) == -1) {
         std::cerr << "[ShmPosix] Failed to set shared memory size: " << strerror(errno) << std::endl;
         close(m_shm_fd);
         m_shm_fd = -1;
@@ -54,7 +249,7 @@ bool ShmPosix::create() {
     }
     
     // Map shared memory to process address space
-    void* ptr = mmap(nullptr, SHARED_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    void* ptr = mmap(nullptr, objectSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
     if (ptr == MAP_FAILED) {
         std::cerr << "[ShmPosix] Failed to map shared memory: " << strerror(errno) << std::endl;
         close(m_shm_fd);
@@ -63,36 +258,37 @@ bool ShmPosix::create() {
     }
     
     m_shm_ptr = static_cast<SharedFrameBuffer*>(ptr);
-    
-    // Initialize metadata (only if we're the first to create it)
-    // Use atomic flag to check if already initialized
-    uint64_t expected = 0;
-    if (m_shm_ptr->frame_counter.compare_exchange_strong(expected, 0)) {
-        // We're the first - initialize the structure
-        m_shm_ptr->write_index.store(0, std::memory_order_release);
-        m_shm_ptr->read_index.store(0, std::memory_order_release);
-        m_shm_ptr->width = FRAME_WIDTH;
-        m_shm_ptr->height = FRAME_HEIGHT;
-        m_shm_ptr->frame_size = FRAME_SIZE;
-        m_shm_ptr->format = FORMAT_RGBA;
-        m_shm_ptr->frame_counter.store(0, std::memory_order_release);
-        m_shm_ptr->dropped_frames.store(0, std::memory_order_release);
-        m_shm_ptr->last_write_timestamp_ns = 0;
-        std::memset(m_shm_ptr->reserved, 0, sizeof(m_shm_ptr->reserved));
-        
-        std::cout << "[ShmPosix] Initialized shared memory structure for " << m_channelName << std::endl;
+    m_mappedSize = objectSize;
+    m_pageSize = preparePages(ptr, m_mappedSize, hugePages);
+    if (hugePages && m_pageSize < SL_HUGE_PAGE_SIZE) {
+        std::cerr << "[ShmPosix] Huge pages unavailable for " << m_channelName
+                  << " (transparent huge pages for shmem disabled?) - using " << pageBacking(m_pageSize) << std::endl;
     }
     
-    // Open/create semaphore for signaling
-    m_sem = sem_open(m_semName.c_str(), O_CREAT, 0666, 0);
-    if (m_sem == SEM_FAILED) {
-        std::cerr << "[ShmPosix] Failed to create semaphore: " << strerror(errno) << std::endl;
-        // Continue anyway - semaphore is optional (can use polling)
-        m_sem = nullptr;
+    // The creator owns the geometry: always publish the negotiated values
+    initGeometry(m_shm_ptr, width, height, format, flags, slotCount);
+    m_shm_ptr->page_size = m_pageSize;
+    
+    // The object is new: initialize the rest of the structure
+    resetSlotState(m_shm_ptr);
+    m_shm_ptr->frame_counter.store(0, std::memory_order_release);
+    m_shm_ptr->dropped_frames.store(0, std::memory_order_release);
+    m_shm_ptr->last_write_timestamp_ns = 0;
+    resetFrameState(m_shm_ptr);
+    
+    std::cout << "[ShmPosix] Initialized shared memory structure for " << m_channelName << std::endl;
+    
+    m_lastFrameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
+    
+    // The header is complete: a waiting producer connects on its next tick
+    ShmPosixDirectory directory;
+    if (directory.open()) {
+        directory.announceChannel();
     }
     
     std::cout << "[ShmPosix] Shared memory created successfully (" 
-              << (SHARED_BUFFER_SIZE / 1024 / 1024) << " MB) for " << m_channelName << std::endl;
+              << (m_mappedSize / 1024 / 1024) << " MB, " << width << "x" << height
+              << ", " << pageBacking(m_pageSize) << ") for " << m_channelName << std::endl;
     
     return true;
 }
@@ -100,7 +296,7 @@ bool ShmPosix::create() {
 /**
  * Connect to existing shared memory region
  */
-bool ShmPosix::connect() {
+bool ShmPosix::connect(bool registerReader) {
     // Open existing shared memory object (don't create)
     m_shm_fd = shm_open(m_shmName.c_str(), O_RDWR, 0666);
     if (m_shm_fd == -1) {
@@ -108,8 +304,24 @@ bool ShmPosix::connect() {
         return false;
     }
     
-    // Map shared memory to process address space
-    void* ptr = mmap(nullptr, SHARED_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    // The region size is only known from the header the creator wrote
+    struct stat st;
+    if (fstat(m_shm_fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(SharedFrameBuffer)) {
+        // Creator has not sized the region yet
+        close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    // Huge-page advice must precede our first fault, so read the flags
+    // (after magic, layout_version and header_size) through the descriptor
+    uint32_t identity[4] = {};
+    const bool hugePages = pread(m_shm_fd, identity, sizeof(identity), 0) == static_cast<ssize_t>(sizeof(identity))
+        && (identity[3] & SL_FLAG_HUGE_PAGES) != 0;
+    
+    // Map the whole object, then check the header's geometry against it
+    const size_t objectSize = static_cast<size_t>(st.st_size);
+    void* ptr = mmap(nullptr, objectSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
     if (ptr == MAP_FAILED) {
         std::cerr << "[ShmPosix] Failed to map shared memory: " << strerror(errno) << std::endl;
         close(m_shm_fd);
@@ -118,35 +330,126 @@ bool ShmPosix::connect() {
     }
     
     m_shm_ptr = static_cast<SharedFrameBuffer*>(ptr);
+    m_mappedSize = objectSize;
+    m_pageSize = preparePages(ptr, m_mappedSize, hugePages);
+    
+    // Sized but the header is not written yet; the creator announces the channel when it is
+    if (m_shm_ptr->magic == 0) {
+        disconnect();
+        return false;
+    }
+    
+    if (!isLayoutCompatible(m_shm_ptr)) {
+        std::cerr << "[ShmPosix] Shared memory header for " << m_channelName
+                  << " has layout version " << m_shm_ptr->layout_version
+                  << " (expected " << SL_LAYOUT_VERSION << ")" << std::endl;
+        disconnect();
+        return false;
+    }
+    
+    if (!isGeometryValid(m_shm_ptr, m_mappedSize)) {
+        std::cerr << "[ShmPosix] Shared memory header for " << m_channelName
+                  << " has invalid geometry (size " << m_mappedSize << ")" << std::endl;
+        disconnect();
+        return false;
+    }
     
-    // Open existing semaphore
-    m_sem = sem_open(m_semName.c_str(), 0);
-    if (m_sem == SEM_FAILED) {
-        // Semaphore might not exist yet or permission denied
-        m_sem = nullptr;
+    if (registerReader && !registerConsumerSlot()) {
+        std::cerr << "[ShmPosix] All " << SL_MAX_CONSUMERS << " consumer registrations for "
+                  << m_channelName << " are in use" << std::endl;
+        disconnect();
+        return false;
     }
     
+    m_lastFrameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
+    
     return true;
 }
 
+/**
+ * Claim a consumer registration (consumer)
+ */
+bool ShmPosix::registerConsumerSlot() {
+    if (m_consumerToken == 0) m_consumerToken = nextConsumerToken();
+    m_consumerIndex = registerConsumer(m_shm_ptr, m_consumerToken, static_cast<uint32_t>(getpid()), steadyNowNs());
+    return m_consumerIndex < SL_MAX_CONSUMERS;
+}
+
+/**
+ * Refresh the heartbeat and frame demand, registering again if the entry
+ * was reclaimed (consumer; every caller is asking for a frame)
+ */
+bool ShmPosix::refreshConsumer(uint64_t nowNs) {
+    if (m_consumerIndex < SL_MAX_CONSUMERS && touchConsumer(m_shm_ptr, m_consumerIndex, m_consumerToken, nowNs)) {
+        setConsumerDemand(m_shm_ptr, m_consumerIndex, nowNs);
+        return true;
+    }
+    
+    const bool wasRegistered = m_consumerIndex < SL_MAX_CONSUMERS;
+    if (!registerConsumerSlot()) return false;
+    if (wasRegistered) {
+        std::cerr << "[ShmPosix] Consumer registration for " << m_channelName
+                  << " expired (no heartbeat), registered again as " << m_consumerIndex << std::endl;
+    }
+    return true;
+}
+
+/**
+ * Ask the producer to switch the channel's size or format (consumer)
+ */
+bool ShmPosix::reconfigure(uint32_t width, uint32_t height, uint32_t format, uint32_t* generation) {
+    if (!m_shm_ptr) return false;
+    
+    const uint32_t requested = requestReconfigure(m_shm_ptr, width, height, format);
+    if (requested == 0) {
+        std::cerr << "[ShmPosix] " << width << "x" << height << " format " << format << " does not fit the "
+                  << m_shm_ptr->slot_size << "-byte slots of " << m_channelName
+                  << " (create the channel for the largest geometry it may switch to)" << std::endl;
+        return false;
+    }
+    if (generation) *generation = requested;
+    return true;
+}
+
+/**
+ * Stop asking for frames until the next read or wait (consumer)
+ */
+void ShmPosix::setIdle() {
+    if (m_shm_ptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        setConsumerDemand(m_shm_ptr, m_consumerIndex, 0);
+    }
+}
+
+/**
+ * Whether a consumer is asking for frames (producer)
+ */
+bool ShmPosix::hasConsumerDemand() const {
+    return m_shm_ptr && StreamLumo::hasConsumerDemand(m_shm_ptr, steadyNowNs());
+}
+
 /**
  * Disconnect from shared memory
  */
 void ShmPosix::disconnect() {
+    m_pendingWriteIndex = -1;
+    
+    if (m_shm_ptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        unregisterConsumer(m_shm_ptr, m_consumerIndex, m_consumerToken);
+    }
+    m_consumerIndex = SL_MAX_CONSUMERS;
+    
     if (m_shm_ptr) {
-        munmap(m_shm_ptr, SHARED_BUFFER_SIZE);
+        munmap(m_shm_ptr, m_mappedSize);
         m_shm_ptr = nullptr;
+        m_mappedSize = 0;
+        m_pageSize = 0;
     }
     
     if (m_shm_fd != -1) {
         close(m_shm_fd);
         m_shm_fd = -1;
     }
-    
-    if (m_sem) {
-        sem_close(m_sem);
-        m_sem = nullptr;
-    }
+
 }
 
 /**
@@ -155,7 +458,6 @@ void ShmPosix::disconnect() {
 void ShmPosix::destroy() {
     disconnect();
     shm_unlink(m_shmName.c_str());
-    sem_unlink(m_semName.c_str());
 }
 
 /**
@@ -165,80 +467,306 @@ bool ShmPosix::isConnected() const {
     return m_shm_ptr != nullptr;
 }
 
+/**
+ * Compare the object behind the channel name with the one we mapped
+ */
+bool ShmPosix::isReplaced() const {
+    if (m_shm_fd == -1) return false;
+    
+    const int fd = shm_open(m_shmName.c_str(), O_RDONLY, 0);
+    if (fd == -1) return errno == ENOENT;
+    
+    struct stat current;
+    struct stat mapped;
+    const bool replaced = fstat(fd, &current) == 0 && fstat(m_shm_fd, &mapped) == 0
+        && (current.st_dev != mapped.st_dev || current.st_ino != mapped.st_ino);
+    close(fd);
+    return replaced;
+}
+
 /**
  * Write frame to shared memory (producer)
  */
 bool ShmPosix::writeFrame(const unsigned char* frameData, size_t dataSize) {
     if (!m_shm_ptr) return false;
-    if (dataSize > FRAME_SIZE) return false;
+    if (dataSize > m_shm_ptr->slot_size) return false;
+    
+    unsigned char* dest = beginWrite();
+    if (!dest) return false;
+    
+    // Copy data to shared buffer
+    std::memcpy(dest, frameData, dataSize);
+    
+    return commitWrite();
+}
+
+/**
+ * Acquire the next slot for in-place writing (producer)
+ */
+unsigned char* ShmPosix::beginWrite() {
+    if (!m_shm_ptr) return nullptr;
+    const uint64_t nowNs = steadyNowNs();
     
-    // Get next write index (triple buffering)
-    int currentWriteIndex = m_shm_ptr->write_index.load(std::memory_order_acquire);
-    int nextWriteIndex = (currentWriteIndex + 1) % NUM_BUFFERS;
+    // Ring mode: the next FIFO slot, unless the slowest consumer has not freed it yet
+    if (isRingMode(m_shm_ptr)) {
+        const uint32_t slot = ringWriteSlot(m_shm_ptr, nowNs);
+        if (slot >= m_shm_ptr->slot_count) {
+            m_shm_ptr->ring_full_frames.fetch_add(1, std::memory_order_relaxed);
+            m_pendingWriteIndex = -1;
+            return nullptr;
+        }
+        m_pendingWriteIndex = static_cast<int>(slot);
+        beginSlotWrite(m_shm_ptr, slot);
+        return frameSlot(m_shm_ptr, slot);
+    }
+    
+    // Any slot that is neither the latest frame nor being copied by a consumer
+    const uint32_t slot = latestWriteSlot(m_shm_ptr, nowNs);
+    if (slot >= m_shm_ptr->slot_count) {
+        m_shm_ptr->slot_busy_frames.fetch_add(1, std::memory_order_relaxed);
+        m_pendingWriteIndex = -1;
+        return nullptr;
+    }
+    
+    m_pendingWriteIndex = static_cast<int>(slot);
+    beginSlotWrite(m_shm_ptr, slot);
+    return frameSlot(m_shm_ptr, slot);
+}
+
+/**
+ * Publish the slot acquired by beginWrite() (producer)
+ */
+bool ShmPosix::commitWrite(uint64_t obsTimestampNs, uint64_t captureTimeNs) {
+    if (!m_shm_ptr || m_pendingWriteIndex < 0) return false;
+    
+    // Update timestamp
+    auto now = std::chrono::steady_clock::now();
+    const uint64_t nowNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    m_shm_ptr->last_write_timestamp_ns.store(nowNs, std::memory_order_release);
     
-    // If next write index is being read, we drop the frame (or wait, but dropping is better for latency)
-    int currentReadIndex = m_shm_ptr->read_index.load(std::memory_order_acquire);
-    if (nextWriteIndex == currentReadIndex) {
+    // Describe the frame and close the slot's seqlock before publishing it
+    const uint64_t frameNumber = m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    publishSlotDescriptor(m_shm_ptr, m_pendingWriteIndex, frameNumber,
+                          obsTimestampNs, captureTimeNs ? captureTimeNs : nowNs);
+    
+    // Make it the latest frame; a frame no consumer has read yet is superseded
+    if (isRingMode(m_shm_ptr)) {
+        publishRingSlot(m_shm_ptr);
+    } else if (publishLatestSlot(m_shm_ptr, static_cast<uint32_t>(m_pendingWriteIndex), frameNumber, nowNs)) {
         m_shm_ptr->dropped_frames.fetch_add(1, std::memory_order_relaxed);
-        return false;
     }
+    m_pendingWriteIndex = -1;
     
-    // Copy data to shared buffer
-    unsigned char* dest = m_shm_ptr->frames[nextWriteIndex];
-    std::memcpy(dest, frameData, dataSize);
+    // Wake blocked consumers (no syscall when nobody is waiting)
+    if (signalFrame(m_shm_ptr)) {
+        wakeWord(&m_shm_ptr->frame_signal);
+    }
     
-    // Update write index
-    m_shm_ptr->write_index.store(nextWriteIndex, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Describe the changed tiles of the slot acquired by beginWrite() (producer)
+ */
+void ShmPosix::setDirtyTiles(const uint64_t tiles[SL_DIRTY_WORDS]) {
+    if (!m_shm_ptr || m_pendingWriteIndex < 0) return;
     
-    // Update counters
-    m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed);
+    // This producer's previous frame is the one the next commit builds on
+    const uint64_t previousFrame = m_shm_ptr->frame_counter.load(std::memory_order_relaxed);
+    if (previousFrame != 0) {
+        setSlotDirtyTiles(m_shm_ptr, m_pendingWriteIndex, previousFrame, tiles);
+    }
+}
+
+/**
+ * Record the colorimetry of the slot acquired by beginWrite() (producer)
+ */
+void ShmPosix::setColorimetry(uint32_t matrix, uint32_t range) {
+    if (!m_shm_ptr || m_pendingWriteIndex < 0) return;
     
-    // Signal semaphore
-    if (m_sem) {
-        sem_post(m_sem);
+    setSlotColorimetry(m_shm_ptr, m_pendingWriteIndex, matrix, range);
+}
+
+/**
+ * Give up the slot acquired by beginWrite() without publishing it
+ */
+void ShmPosix::abortWrite() {
+    if (m_shm_ptr && m_pendingWriteIndex >= 0) {
+        endSlotWrite(m_shm_ptr, m_pendingWriteIndex);
     }
+    m_pendingWriteIndex = -1;
+}
+
+/**
+ * Publish (or withdraw) the shared GPU textures (producer)
+ */
+void ShmPosix::setSharedTextures(uint32_t api, uint32_t count, const uint64_t handles[],
+                                 uint32_t width, uint32_t height, uint32_t format, uint32_t syncKey) {
+    if (!m_shm_ptr) return;
+    setTextureDescriptor(m_shm_ptr, api, count, handles, width, height, format, syncKey);
+}
+
+/**
+ * Publish a frame rendered into shared texture `index` (producer)
+ */
+bool ShmPosix::commitTexture(uint32_t index, uint64_t captureTimeNs) {
+    if (!m_shm_ptr || index >= m_shm_ptr->texture.count) return false;
+    
+    const uint64_t nowNs = steadyNowNs();
+    m_shm_ptr->last_write_timestamp_ns.store(nowNs, std::memory_order_release);
+    
+    // Texture frames share the frame numbering of the slot frames
+    const uint64_t frameNumber = m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    publishLatestTexture(m_shm_ptr, index, frameNumber, captureTimeNs ? captureTimeNs : nowNs);
+    
+    // Wake blocked consumers (no syscall when nobody is waiting)
+    if (signalFrame(m_shm_ptr)) {
+        wakeWord(&m_shm_ptr->frame_signal);
+    }
+    
+    return true;
+}
+
+/**
+ * Shared textures held by readers or holding the latest frame (producer)
+ */
+uint32_t ShmPosix::busySharedTextures() {
+    return m_shm_ptr ? busyTextureMask(m_shm_ptr, steadyNowNs()) : 0;
+}
+
+/**
+ * Take the newest shared texture frame (consumer)
+ */
+bool ShmPosix::acquireSharedTexture(SharedTextureInfo& info) {
+    const uint64_t nowNs = steadyNowNs();
+    if (!m_shm_ptr || !refreshConsumer(nowNs)) return false;
+    const uint32_t frameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
     
+    // Hold the texture before using it; a frame published meanwhile replaces it
+    do {
+        if (!readTextureDescriptor(m_shm_ptr, info) || info.frameNumber == 0) return false;
+        if (info.frameNumber <= m_shm_ptr->consumers[m_consumerIndex].read_frame.load(std::memory_order_relaxed)) return false;
+    } while (!acquireLatestTexture(m_shm_ptr, m_consumerIndex, info));
+    
+    recordConsumerRead(m_shm_ptr, m_consumerIndex, info.frameNumber, nowNs);
+    m_lastFrameSignal = frameSignal;
     return true;
 }
 
+/**
+ * Drop the hazard on the last shared texture taken (consumer)
+ */
+void ShmPosix::releaseSharedTexture() {
+    if (m_shm_ptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        releaseTextureHazard(m_shm_ptr, m_consumerIndex);
+    }
+}
+
 /**
  * Read latest frame from shared memory (consumer)
  */
-bool ShmPosix::readFrame(unsigned char* buffer, size_t bufferSize) {
-    if (!m_shm_ptr) return false;
-    if (bufferSize < FRAME_SIZE) return false;
+bool ShmPosix::readFrame(unsigned char* buffer, size_t bufferSize, FrameMetadata* frame) {
+    if (!m_shm_ptr || !refreshConsumer(steadyNowNs())) return false;
+    const uint32_t frameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
     
-    // Get latest write index
-    int currentWriteIndex = m_shm_ptr->write_index.load(std::memory_order_acquire);
-    int currentReadIndex = m_shm_ptr->read_index.load(std::memory_order_relaxed);
+    // Latest-frame mode takes the newest frame and holds its slot during the
+    // copy; ring mode takes this consumer's oldest unread one
+    uint32_t slotIndex = 0;
+    uint64_t expectedFrame = 0;
+    const bool ring = isRingMode(m_shm_ptr);
+    if (ring ? !acquireRingSlot(m_shm_ptr, m_consumerIndex, slotIndex, expectedFrame)
+             : !acquireLatestSlot(m_shm_ptr, m_consumerIndex, slotIndex)) {
+        return false;
+    }
     
-    // If nothing new to read
-    if (currentWriteIndex == currentReadIndex) {
+    if (!copySlot(slotIndex, buffer, bufferSize, frame, expectedFrame)) {
+        releaseConsumerSlot(m_shm_ptr, m_consumerIndex);
         return false;
     }
+    m_lastFrameSignal = frameSignal;
+    
+    return true;
+}
+
+/**
+ * Copy one acquired slot and advance this consumer's read cursor
+ */
+bool ShmPosix::copySlot(uint32_t slotIndex, unsigned char* buffer, size_t bufferSize, FrameMetadata* frame,
+                        uint64_t expectedFrame) {
+    // The slot descriptor, not the header, gives the geometry of this frame
+    uint32_t sequence = 0;
+    if (!beginSlotRead(m_shm_ptr, slotIndex, sequence)) return false;
+    const SlotDescriptor& slot = m_shm_ptr->slots[slotIndex];
+    const uint64_t frameSize = frameSizeFor(slot.width, slot.height, slot.format);
+    if (frameSize > m_shm_ptr->slot_size || bufferSize < frameSize) return false;
     
     // Copy data from shared buffer
-    const unsigned char* src = m_shm_ptr->frames[currentWriteIndex];
-    std::memcpy(buffer, src, FRAME_SIZE);
+    const unsigned char* src = frameSlot(m_shm_ptr, slotIndex);
+    std::memcpy(buffer, src, frameSize);
     
-    // Update read index
-    m_shm_ptr->read_index.store(currentWriteIndex, std::memory_order_release);
+    if (frame) {
+        fillFrameMetadata(m_shm_ptr, slot, sequence, *frame);
+    }
+    const uint64_t frameNumber = slot.frame_number;
+    
+    // Cannot happen with a well-behaved producer; guards against a restarted one
+    if (!endSlotRead(m_shm_ptr, slotIndex, sequence)) {
+        return false;
+    }
     
+    // A ring consumer that went silent may have been lapped: continue from here
+    if (expectedFrame != 0 && frameNumber != expectedFrame) {
+        if (frameNumber < expectedFrame) return false;
+        std::cerr << "[ShmPosix] Consumer " << m_consumerIndex << " on " << m_channelName << " fell behind, lost "
+                  << (frameNumber - expectedFrame) << " ring frame(s)" << std::endl;
+    }
+    
+    // Advance the read cursor and tell the producer when this frame was picked up
+    recordConsumerRead(m_shm_ptr, m_consumerIndex, frameNumber, steadyNowNs());
     return true;
 }
 
 /**
- * Wait for new frame
+ * Wait for a new frame
+ * 
+ * Waits on the frame_signal word instead of a counting semaphore: a wake
+ * only means "something newer than what you last saw", so a slow consumer
+ * never collects stale wake-ups, and spurious returns are filtered here.
  */
 bool ShmPosix::waitForFrame(int timeoutMs) {
-    if (!m_sem) return false;
+    if (!m_shm_ptr) return false;
     
-    if (timeoutMs < 0) {
-        return sem_wait(m_sem) == 0;
-    } else {
-        // sem_timedwait not available on macOS, use polling or trywait
-        // For now, just trywait
-        return sem_trywait(m_sem) == 0;
+    std::atomic<uint32_t>* word = &m_shm_ptr->frame_signal;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+    
+    for (;;) {
+        const uint32_t signal = word->load(std::memory_order_acquire);
+        if (signal != m_lastFrameSignal) {
+            m_lastFrameSignal = signal;
+            return true;
+        }
+        
+        int64_t remainingNs = -1;
+        if (timeoutMs >= 0) {
+            remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remainingNs <= 0) return false;
+        }
+        
+        // Stay registered while blocked: wake up often enough to keep the heartbeat fresh
+        if (m_consumerIndex < SL_MAX_CONSUMERS) {
+            refreshConsumer(steadyNowNs());
+            const int64_t heartbeatNs = static_cast<int64_t>(SL_CONSUMER_TIMEOUT_NS / 4);
+            if (remainingNs < 0 || remainingNs > heartbeatNs) remainingNs = heartbeatNs;
+        }
+        
+        // Register before the final check so the producer cannot miss us
+        m_shm_ptr->wake_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (word->load(std::memory_order_seq_cst) == signal) {
+            waitOnWord(word, signal, remainingNs);
+        }
+        m_shm_ptr->wake_waiters.fetch_sub(1, std::memory_order_seq_cst);
     }
 }
 
@@ -254,9 +782,507 @@ bool ShmPosix::getMetadata(FrameMetadata& metadata) {
     metadata.format = m_shm_ptr->format;
     metadata.frameCounter = m_shm_ptr->frame_counter.load(std::memory_order_relaxed);
     metadata.droppedFrames = m_shm_ptr->dropped_frames.load(std::memory_order_relaxed);
+    metadata.ringFullFrames = m_shm_ptr->ring_full_frames.load(std::memory_order_relaxed);
+    metadata.slotBusyFrames = m_shm_ptr->slot_busy_frames.load(std::memory_order_relaxed);
+    metadata.activeConsumers = activeConsumerCount(m_shm_ptr, steadyNowNs());
+    metadata.appliedGeneration = m_shm_ptr->applied_generation.load(std::memory_order_acquire);
     metadata.lastWriteTimestampNs = m_shm_ptr->last_write_timestamp_ns;
     
+    // Per-frame fields are only known for a frame returned by readFrame()
+    metadata.sequence = 0;
+    for (uint32_t i = 0; i < MAX_PLANES; i++) metadata.stride[i] = 0;
+    metadata.colorMatrix = metadata.colorRange = 0;
+    metadata.frameNumber = metadata.obsTimestampNs = metadata.captureTimeNs = 0;
+    metadata.dirtyBaseFrame = 0;
+    for (uint32_t i = 0; i < SL_DIRTY_WORDS; i++) metadata.dirtyTiles[i] = 0;
+    
+    return true;
+}
+
+ShmPosixDirectory::ShmPosixDirectory()
+    : m_shmName(SHM_DIRECTORY_NAME), m_shm_fd(-1), m_directory(nullptr) {
+}
+
+ShmPosixDirectory::~ShmPosixDirectory() {
+    close();
+}
+
+/**
+ * Open (or create) the channel directory
+ */
+bool ShmPosixDirectory::open() {
+    if (m_directory) return true;
+    
+    m_shm_fd = shm_open(m_shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (m_shm_fd == -1) {
+        std::cerr << "[ShmPosixDirectory] Failed to open " << m_shmName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // Only ever grow the region: the other side may already have it mapped
+    struct stat st;
+    if (fstat(m_shm_fd, &st) == -1 ||
+        (static_cast<size_t>(st.st_size) < sizeof(ChannelDirectory) && ftruncate(m_shm_fd, sizeof(ChannelDirectory)) == -1)) {
+        std::cerr << "[ShmPosixDirectory] Failed to size " << m_shmName << ": " << strerror(errno) << std::endl;
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    void* ptr = mmap(nullptr, sizeof(ChannelDirectory), PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "[ShmPosixDirectory] Failed to map " << m_shmName << ": " << strerror(errno) << std::endl;
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    m_directory = static_cast<ChannelDirectory*>(ptr);
+    
+    if (!initDirectory(m_directory)) {
+        std::cerr << "[ShmPosixDirectory] Directory has version " << m_directory->version.load()
+                  << " (expected " << SL_DIRECTORY_VERSION << ")" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Withdraw our requests and unmap the directory
+ */
+void ShmPosixDirectory::close() {
+    if (m_directory) {
+        for (int index : m_ownedRequests) {
+            releaseChannelRequest(m_directory, static_cast<uint32_t>(index));
+        }
+        munmap(m_directory, sizeof(ChannelDirectory));
+        m_directory = nullptr;
+    }
+    m_ownedRequests.clear();
+    
+    if (m_shm_fd != -1) {
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+    }
+}
+
+int ShmPosixDirectory::requestChannel(const std::string& channel, const std::string& source) {
+    if (!m_directory || channel.empty() || channel.size() >= SL_CHANNEL_NAME_SIZE) return -1;
+    
+    const uint32_t index = claimChannelRequest(m_directory, channel.c_str(), source.c_str(),
+                                               static_cast<uint32_t>(getpid()), steadyNowNs());
+    if (index >= SL_MAX_CHANNEL_REQUESTS) {
+        std::cerr << "[ShmPosixDirectory] All " << SL_MAX_CHANNEL_REQUESTS << " channel requests are in use" << std::endl;
+        return -1;
+    }
+    m_ownedRequests.push_back(static_cast<int>(index));
+    return static_cast<int>(index);
+}
+
+void ShmPosixDirectory::releaseChannel(int index) {
+    for (size_t i = 0; i < m_ownedRequests.size(); i++) {
+        if (m_ownedRequests[i] != index) continue;
+        m_ownedRequests.erase(m_ownedRequests.begin() + i);
+        if (m_directory) releaseChannelRequest(m_directory, static_cast<uint32_t>(index));
+        return;
+    }
+}
+
+void ShmPosixDirectory::refresh() {
+    if (!m_directory) return;
+    const uint64_t now = steadyNowNs();
+    for (int index : m_ownedRequests) {
+        m_directory->requests[index].heartbeat_ns.store(now, std::memory_order_relaxed);
+    }
+}
+
+bool ShmPosixDirectory::readRequest(uint32_t index, uint32_t& serial, std::string& channel, std::string& source) const {
+    if (!m_directory || index >= SL_MAX_CHANNEL_REQUESTS) return false;
+    if (!isChannelRequestLive(m_directory, index, steadyNowNs())) return false;
+    
+    // The names only change after the entry was freed and claimed again
+    const ChannelRequest& request = m_directory->requests[index];
+    serial = request.serial.load(std::memory_order_acquire);
+    char channelName[SL_CHANNEL_NAME_SIZE];
+    char sourceName[SL_SOURCE_NAME_SIZE];
+    memcpy(channelName, request.channel, sizeof(channelName));
+    memcpy(sourceName, request.source, sizeof(sourceName));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (request.state.load(std::memory_order_relaxed) != SL_REQUEST_ACTIVE ||
+        request.serial.load(std::memory_order_relaxed) != serial) {
+        return false;
+    }
+    
+    channelName[SL_CHANNEL_NAME_SIZE - 1] = '\0';
+    sourceName[SL_SOURCE_NAME_SIZE - 1] = '\0';
+    channel = channelName;
+    source = sourceName;
+    return true;
+}
+
+uint32_t ShmPosixDirectory::expireStale() {
+    if (!m_directory) return 0;
+    const uint64_t now = steadyNowNs();
+    uint32_t expired = 0;
+    for (uint32_t i = 0; i < SL_MAX_CHANNEL_REQUESTS; i++) {
+        if (expireChannelRequest(m_directory, i, now)) expired++;
+    }
+    return expired;
+}
+
+uint32_t ShmPosixDirectory::generation() const {
+    return m_directory ? m_directory->generation.load(std::memory_order_acquire) : 0;
+}
+
+void ShmPosixDirectory::announceChannel() {
+    if (m_directory) m_directory->channel_epoch.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t ShmPosixDirectory::channelEpoch() const {
+    return m_directory ? m_directory->channel_epoch.load(std::memory_order_acquire) : 0;
+}
+
+ShmPosixMetrics::ShmPosixMetrics(const std::string& channelName)
+    : m_shmName(std::string(SHM_METRICS_NAME) + "_" + channelName), m_shm_fd(-1), m_metrics(nullptr) {
+}
+
+ShmPosixMetrics::~ShmPosixMetrics() {
+    close();
+}
+
+/**
+ * Open (or create) the metrics page
+ */
+bool ShmPosixMetrics::open() {
+    if (m_metrics) return true;
+    
+    m_shm_fd = shm_open(m_shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (m_shm_fd == -1) {
+        std::cerr << "[ShmPosixMetrics] Failed to open " << m_shmName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // Only ever grow the region: a monitor may already have it mapped
+    struct stat st;
+    if (fstat(m_shm_fd, &st) == -1 ||
+        (static_cast<size_t>(st.st_size) < sizeof(ChannelMetrics) && ftruncate(m_shm_fd, sizeof(ChannelMetrics)) == -1)) {
+        std::cerr << "[ShmPosixMetrics] Failed to size " << m_shmName << ": " << strerror(errno) << std::endl;
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    void* ptr = mmap(nullptr, sizeof(ChannelMetrics), PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "[ShmPosixMetrics] Failed to map " << m_shmName << ": " << strerror(errno) << std::endl;
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    m_metrics = static_cast<ChannelMetrics*>(ptr);
+    
+    if (!initMetrics(m_metrics)) {
+        std::cerr << "[ShmPosixMetrics] Metrics page has version " << m_metrics->version.load()
+                  << " (expected " << SL_METRICS_VERSION << ")" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Record the producer process
+ */
+void ShmPosixMetrics::claim() {
+    if (m_metrics) {
+        m_metrics->process_id.store(static_cast<uint32_t>(getpid()), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Unmap the metrics page
+ */
+void ShmPosixMetrics::close() {
+    if (m_metrics) {
+        munmap(m_metrics, sizeof(ChannelMetrics));
+        m_metrics = nullptr;
+    }
+    
+    if (m_shm_fd != -1) {
+        ::close(m_shm_fd);
+        m_shm_fd = -1;
+    }
+}
+
+/**
+ * Unmap and unlink the metrics page
+ */
+void ShmPosixMetrics::destroy() {
+    close();
+    shm_unlink(m_shmName.c_str());
+}
+
+ShmPosixPackets::ShmPosixPackets(const std::string& channelName)
+    : m_channelName(channelName), m_shmName(std::string(SHM_PACKET_NAME) + "_" + channelName), m_shm_fd(-1),
+      m_ring(nullptr), m_mappedSize(0), m_readCursor(0) {
+}
+
+ShmPosixPackets::~ShmPosixPackets() {
+    disconnect();
+}
+
+/**
+ * Create the packet channel and announce it
+ */
+bool ShmPosixPackets::create(uint32_t codec, uint32_t width, uint32_t height, uint32_t bitrateKbps,
+                             uint32_t keyintMs, uint32_t dataSize) {
+    if (dataSize == 0) {
+        std::cerr << "[ShmPosixPackets] Invalid packet ring size for " << m_channelName << std::endl;
+        return false;
+    }
+    
+    // Start from an empty object: a producer may still have an old one mapped
+    shm_unlink(m_shmName.c_str());
+    m_shm_fd = shm_open(m_shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (m_shm_fd == -1) {
+        std::cerr << "[ShmPosixPackets] Failed to create " << m_shmName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    const size_t objectSize = static_cast<size_t>(packetDataOffset()) + dataSize;
+    if (ftruncate(m_shm_fd, objectSize) == -1) {
+        std::cerr << "[ShmPosixPackets] Failed to size " << m_shmName << ": " << strerror(errno) << std::endl;
+        close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    void* ptr = mmap(nullptr, objectSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "[ShmPosixPackets] Failed to map " << m_shmName << ": " << strerror(errno) << std::endl;
+        close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    m_ring = static_cast<PacketRingBuffer*>(ptr);
+    m_mappedSize = objectSize;
+    m_readCursor = 0;
+    initPacketRing(m_ring, dataSize, codec, width, height, bitrateKbps, keyintMs);
+    
+    // Count as a live reader from the start, so the producer starts encoding
+    m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+    
+    ShmPosixDirectory directory;
+    if (directory.open()) {
+        directory.announceChannel();
+    }
+    
+    std::cout << "[ShmPosixPackets] Packet channel created (" << (dataSize / 1024 / 1024) << " MB) for "
+              << m_channelName << std::endl;
+    return true;
+}
+
+/**
+ * Map an existing packet channel
+ */
+bool ShmPosixPackets::connect() {
+    m_shm_fd = shm_open(m_shmName.c_str(), O_RDWR, 0666);
+    if (m_shm_fd == -1) {
+        // Silent fail is okay for connect - it might not exist yet
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(m_shm_fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(PacketRingBuffer)) {
+        close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    const size_t objectSize = static_cast<size_t>(st.st_size);
+    void* ptr = mmap(nullptr, objectSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_shm_fd, 0);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "[ShmPosixPackets] Failed to map " << m_shmName << ": " << strerror(errno) << std::endl;
+        close(m_shm_fd);
+        m_shm_fd = -1;
+        return false;
+    }
+    
+    m_ring = static_cast<PacketRingBuffer*>(ptr);
+    m_mappedSize = objectSize;
+    m_readCursor = 0;
+    
+    // Sized but not initialised yet; the creator announces the channel when it is
+    if (m_ring->magic == 0) {
+        disconnect();
+        return false;
+    }
+    
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!isPacketRingValid(m_ring, m_mappedSize)) {
+        std::cerr << "[ShmPosixPackets] Packet channel " << m_channelName << " has layout version "
+                  << m_ring->layout_version << " (expected " << SL_PACKET_LAYOUT_VERSION
+                  << ") or invalid geometry" << std::endl;
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Unmap the packet channel
+ */
+void ShmPosixPackets::disconnect() {
+    if (m_ring) {
+        munmap(m_ring, m_mappedSize);
+        m_ring = nullptr;
+        m_mappedSize = 0;
+    }
+    
+    if (m_shm_fd != -1) {
+        close(m_shm_fd);
+        m_shm_fd = -1;
+    }
+}
+
+/**
+ * Unmap and unlink the packet channel
+ */
+void ShmPosixPackets::destroy() {
+    disconnect();
+    shm_unlink(m_shmName.c_str());
+}
+
+/**
+ * Compare the object behind the channel name with the one we mapped
+ */
+bool ShmPosixPackets::isReplaced() const {
+    if (m_shm_fd == -1) return false;
+    
+    const int fd = shm_open(m_shmName.c_str(), O_RDONLY, 0);
+    if (fd == -1) return errno == ENOENT;
+    
+    struct stat current;
+    struct stat mapped;
+    const bool replaced = fstat(fd, &current) == 0 && fstat(m_shm_fd, &mapped) == 0
+        && (current.st_dev != mapped.st_dev || current.st_ino != mapped.st_ino);
+    close(fd);
+    return replaced;
+}
+
+/**
+ * Publish the stream info of a new encoder session
+ */
+void ShmPosixPackets::publishStreamInfo(uint32_t codec, uint32_t width, uint32_t height, uint32_t fpsNum,
+                                        uint32_t fpsDen, int32_t timebaseNum, int32_t timebaseDen,
+                                        const uint8_t* extraData, size_t extraDataSize) {
+    if (!m_ring) return;
+    if (extraDataSize > SL_PACKET_EXTRA_DATA_SIZE) {
+        std::cerr << "[ShmPosixPackets] " << extraDataSize << " bytes of codec headers truncated to "
+                  << SL_PACKET_EXTRA_DATA_SIZE << " for " << m_channelName << std::endl;
+    }
+    StreamLumo::publishStreamInfo(m_ring, codec, width, height, fpsNum, fpsDen, timebaseNum, timebaseDen,
+                                  extraData, extraDataSize);
+}
+
+/**
+ * Append a packet and wake consumers blocked in waitForPacket()
+ */
+bool ShmPosixPackets::writePacket(const uint8_t* data, size_t size, int64_t pts, int64_t dts, bool keyframe,
+                                  uint64_t captureTimeNs) {
+    if (!m_ring) return false;
+    if (size > UINT32_MAX ||
+        !appendPacket(m_ring, data, static_cast<uint32_t>(size), pts, dts, keyframe, captureTimeNs)) {
+        return false;
+    }
+    
+    // Skip the syscall while nobody waits (seq_cst pairs with waitForPacket())
+    if (m_ring->packet_waiters.load(std::memory_order_seq_cst) != 0) {
+        wakeWord(&m_ring->packet_signal);
+    }
     return true;
 }
 
+/**
+ * Whether a consumer is reading the channel
+ */
+bool ShmPosixPackets::hasConsumer() const {
+    return m_ring && hasPacketConsumer(m_ring, steadyNowNs());
+}
+
+/**
+ * Newest keyframe request not answered yet
+ */
+bool ShmPosixPackets::pendingKeyframeRequest(uint32_t& request) const {
+    return m_ring && StreamLumo::pendingKeyframeRequest(m_ring, request);
+}
+
+/**
+ * Mark keyframe requests up to `request` as answered
+ */
+void ShmPosixPackets::keyframeServed(uint32_t request) {
+    if (m_ring) m_ring->keyframes_served.store(request, std::memory_order_relaxed);
+}
+
+/**
+ * Copy the next packet and refresh the heartbeat
+ */
+PacketReadResult ShmPosixPackets::readPacket(uint8_t* buffer, size_t bufferSize, PacketInfo* info) {
+    if (!m_ring) return SL_PACKET_NONE;
+    m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+    return StreamLumo::readPacket(m_ring, m_readCursor, buffer, bufferSize, info);
+}
+
+/**
+ * Wait for a packet after the last one read
+ */
+bool ShmPosixPackets::waitForPacket(int timeoutMs) {
+    if (!m_ring) return false;
+    
+    std::atomic<uint32_t>* word = &m_ring->packet_signal;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs < 0 ? 0 : timeoutMs);
+    
+    for (;;) {
+        // A reader that has not read yet waits for the first keyframe
+        const uint32_t signal = word->load(std::memory_order_acquire);
+        const uint64_t newest = m_ring->write_sequence.load(std::memory_order_acquire);
+        const uint64_t available = m_readCursor != 0 ? newest : m_ring->keyframe_sequence.load(std::memory_order_acquire);
+        if (m_readCursor != 0 ? available > m_readCursor : available != 0) return true;
+        
+        int64_t remainingNs = -1;
+        if (timeoutMs >= 0) {
+            remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remainingNs <= 0) return false;
+        }
+        
+        // Stay alive while blocked: the producer stops encoding without a reader
+        m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+        const int64_t heartbeatNs = static_cast<int64_t>(SL_CONSUMER_TIMEOUT_NS / 4);
+        if (remainingNs < 0 || remainingNs > heartbeatNs) remainingNs = heartbeatNs;
+        
+        // Register before the final check so the producer cannot miss us
+        m_ring->packet_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (word->load(std::memory_order_seq_cst) == signal) {
+            waitOnWord(word, signal, remainingNs);
+        }
+        m_ring->packet_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+/**
+ * Snapshot the stream info
+ */
+bool ShmPosixPackets::getStreamInfo(PacketStreamInfo& info) const {
+    return m_ring && readStreamInfo(m_ring, info);
+}
+
+/**
+ * Ask for a keyframe
+ */
+void ShmPosixPackets::requestKeyframe() {
+    if (m_ring) m_ring->keyframe_requests.fetch_add(1, std::memory_order_release);
+}
+
 } // namespace StreamLumo
@@ -17,15 +17,111 @@
 
 namespace StreamLumo {
 
+namespace {
+
+/**
+ * Fill metadata for one frame from its slot descriptor
+ */
+void fillFrameMetadata(const SharedFrameBuffer* buffer, const SlotDescriptor& slot, uint32_t sequence, FrameMetadata& metadata) {
+    metadata.width = slot.width;
+    metadata.height = slot.height;
+    metadata.frameSize = static_cast<uint32_t>(frameSizeFor(slot.width, slot.height, slot.format));
+    metadata.format = slot.format;
+    metadata.frameCounter = buffer->frame_counter.load(std::memory_order_relaxed);
+    metadata.droppedFrames = buffer->dropped_frames.load(std::memory_order_relaxed);
+    metadata.ringFullFrames = buffer->ring_full_frames.load(std::memory_order_relaxed);
+    metadata.slotBusyFrames = buffer->slot_busy_frames.load(std::memory_order_relaxed);
+    metadata.activeConsumers = 0;
+    metadata.appliedGeneration = buffer->applied_generation.load(std::memory_order_acquire);
+    metadata.lastWriteTimestampNs = buffer->last_write_timestamp_ns.load(std::memory_order_relaxed);
+    metadata.sequence = sequence;
+    for (uint32_t i = 0; i < MAX_PLANES; i++) {
+        metadata.stride[i] = slot.stride[i];
+    }
+    metadata.colorMatrix = slot.color_matrix;
+    metadata.colorRange = slot.color_range;
+    metadata.frameNumber = slot.frame_number;
+    metadata.obsTimestampNs = slot.obs_timestamp_ns;
+    metadata.captureTimeNs = slot.capture_time_ns;
+    metadata.dirtyBaseFrame = slot.dirty_base_frame;
+    for (uint32_t i = 0; i < SL_DIRTY_WORDS; i++) {
+        metadata.dirtyTiles[i] = slot.dirty_tiles[i];
+    }
+}
+
+/**
+ * Steady clock in nanoseconds (heartbeats and read timestamps)
+ */
+uint64_t steadyNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Page size of normal (pageable) mappings
+ */
+uint32_t systemPageSize() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return static_cast<uint32_t>(info.dwPageSize);
+}
+
+/**
+ * Enable SeLockMemoryPrivilege for this process (needed for SEC_LARGE_PAGES)
+ * Fails unless the account was granted "Lock pages in memory".
+ */
+bool enableLockMemoryPrivilege() {
+    HANDLE token = NULL;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return false;
+    
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    // AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED when the right is missing
+    const bool enabled = LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+        && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+        && GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return enabled;
+}
+
+/**
+ * Fault in every page of a pageable view so the first frames don't
+ * (large-page sections are committed and locked when they are created)
+ */
+void prefaultView(const void* ptr, size_t size, uint32_t pageSize) {
+    const volatile unsigned char* bytes = static_cast<const volatile unsigned char*>(ptr);
+    for (size_t offset = 0; offset < size; offset += pageSize) {
+        (void)bytes[offset];
+    }
+}
+
+/**
+ * Token identifying one consumer registration (distinct per process and instance)
+ */
+uint32_t nextConsumerToken() {
+    static std::atomic<uint32_t> counter(0);
+    const uint32_t token = (static_cast<uint32_t>(GetCurrentProcessId()) << 8) ^ counter.fetch_add(1, std::memory_order_relaxed);
+    return token != 0 ? token : 1;
+}
+
+} // namespace
+
 ShmWin32::ShmWin32(const std::string& channelName)
     : m_channelName(channelName)
     , m_hMapFile(NULL)
     , m_shm_ptr(nullptr)
-    , m_hSemaphore(NULL)
+    , m_mappedSize(0)
+    , m_pageSize(0)
+    , m_hFrameEvent(NULL)
+    , m_lastFrameSignal(0)
+    , m_pendingWriteIndex(-1)
+    , m_consumerIndex(SL_MAX_CONSUMERS)
+    , m_consumerToken(0)
 {
     // Generate unique names based on channel
     m_shmName = std::string("Local\\StreamLumo_") + channelName;
-    m_semName = std::string("StreamLumoSem_") + channelName;
+    m_eventName = std::string("Local\\StreamLumoFrameEvent_") + channelName;
 }
 
 ShmWin32::~ShmWin32()
@@ -36,16 +132,46 @@ ShmWin32::~ShmWin32()
 /**
  * Create or open shared memory region
  */
-bool ShmWin32::create() {
+bool ShmWin32::create(uint32_t width, uint32_t height, uint32_t format, uint32_t flags, uint32_t slotCount) {
+    if (width == 0 || height == 0) {
+        std::cerr << "[ShmWin32] Invalid frame geometry " << width << "x" << height << std::endl;
+        return false;
+    }
+    
+    const uint64_t regionSize = regionSizeFor(slotSizeFor(frameSizeFor(width, height, format)),
+                                              slotCountFor(flags, slotCount));
+    
+    // Large pages: the section and every view are whole large pages, committed up front
+    uint64_t mappingSize = regionSize;
+    uint32_t pageSize = systemPageSize();
+    if (flags & SL_FLAG_HUGE_PAGES) {
+        const SIZE_T largePageSize = enableLockMemoryPrivilege() ? GetLargePageMinimum() : 0;
+        if (largePageSize > 0) {
+            const uint64_t largeSize = alignUp(regionSize, largePageSize);
+            m_hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                            static_cast<DWORD>(largeSize >> 32),
+                                            static_cast<DWORD>(largeSize & 0xFFFFFFFF), m_shmName.c_str());
+        }
+        if (m_hMapFile != NULL) {
+            mappingSize = alignUp(regionSize, largePageSize);
+            pageSize = static_cast<uint32_t>(largePageSize);
+        } else {
+            std::cerr << "[ShmWin32] Large pages unavailable (needs \"Lock pages in memory\", error "
+                      << GetLastError() << ") - using " << (pageSize / 1024) << " KB pages" << std::endl;
+        }
+    }
+    
     // Create file mapping object
-    m_hMapFile = CreateFileMappingA(
-        INVALID_HANDLE_VALUE,    // Use paging file
-        NULL,                     // Default security
-        PAGE_READWRITE,           // Read/write access
-        0,                        // High-order DWORD of size
-        static_cast<DWORD>(SHARED_BUFFER_SIZE),  // Low-order DWORD of size
-        m_shmName.c_str()         // Name of mapping object
-    );
+    if (m_hMapFile == NULL) {
+        m_hMapFile = CreateFileMappingA(
+            INVALID_HANDLE_VALUE,    // Use paging file
+            NULL,                     // Default security
+            PAGE_READWRITE,           // Read/write access
+            static_cast<DWORD>(regionSize >> 32),          // High-order DWORD of size
+            static_cast<DWORD>(regionSize & 0xFFFFFFFF),   // Low-order DWORD of size
+            m_shmName.c_str()         // Name of mapping object
+        );
+    }
     
     if (m_hMapFile == NULL) {
         std::cerr << "[ShmWin32] Failed to create file mapping: " << GetLastError() << std::endl;
@@ -60,7 +186,7 @@ bool ShmWin32::create() {
         FILE_MAP_ALL_ACCESS,      // Read/write access
         0,                        // High-order DWORD of offset
         0,                        // Low-order DWORD of offset
-        SHARED_BUFFER_SIZE        // Number of bytes to map
+        static_cast<SIZE_T>(mappingSize)  // Number of bytes to map
     );
     
     if (ptr == NULL) {
@@ -71,40 +197,43 @@ bool ShmWin32::create() {
     }
     
     m_shm_ptr = static_cast<SharedFrameBuffer*>(ptr);
+    m_mappedSize = static_cast<size_t>(mappingSize);
+    m_pageSize = pageSize;
+    if (m_pageSize <= systemPageSize()) {
+        prefaultView(m_shm_ptr, m_mappedSize, m_pageSize);
+    }
     
     // Initialize metadata if we're the first
     if (isFirstCreate) {
-        m_shm_ptr->write_index.store(0, std::memory_order_release);
-        m_shm_ptr->read_index.store(0, std::memory_order_release);
-        m_shm_ptr->width = FRAME_WIDTH;
-        m_shm_ptr->height = FRAME_HEIGHT;
-        m_shm_ptr->frame_size = FRAME_SIZE;
-        m_shm_ptr->format = FORMAT_RGBA;
+        initGeometry(m_shm_ptr, width, height, format, flags, slotCount);
+        m_shm_ptr->page_size = m_pageSize;
+        resetSlotState(m_shm_ptr);
         m_shm_ptr->frame_counter.store(0, std::memory_order_release);
         m_shm_ptr->dropped_frames.store(0, std::memory_order_release);
         m_shm_ptr->last_write_timestamp_ns.store(0, std::memory_order_release);
+        resetFrameState(m_shm_ptr);
         m_shm_ptr->pause_requested.store(0, std::memory_order_release);
         m_shm_ptr->producer_paused.store(0, std::memory_order_release);
-        std::memset(m_shm_ptr->reserved, 0, sizeof(m_shm_ptr->reserved));
         
         std::cout << "[ShmWin32] Initialized shared memory structure" << std::endl;
     }
     
-    // Create semaphore for signaling
-    m_hSemaphore = CreateSemaphoreA(
-        NULL,           // Default security
-        0,              // Initial count
-        LONG_MAX,       // Maximum count
-        m_semName.c_str()
-    );
+    if (!openFrameEvent()) {
+        std::cerr << "[ShmWin32] Failed to create frame event: " << GetLastError() << std::endl;
+        // Continue anyway - waitForFrame() falls back to polling
+    }
+    m_lastFrameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
     
-    if (m_hSemaphore == NULL) {
-        std::cerr << "[ShmWin32] Failed to create semaphore: " << GetLastError() << std::endl;
-        // Continue anyway - semaphore is optional
+    // The header is complete: a waiting producer connects on its next tick
+    ShmWin32Directory directory;
+    if (directory.open()) {
+        directory.announceChannel();
     }
     
     std::cout << "[ShmWin32] Shared memory created successfully (" 
-              << (SHARED_BUFFER_SIZE / 1024 / 1024) << " MB)" << std::endl;
+              << (m_mappedSize / 1024 / 1024) << " MB, " << m_shm_ptr->width << "x" << m_shm_ptr->height
+              << ", " << (m_pageSize / 1024) << (m_pageSize > systemPageSize() ? " KB large pages)" : " KB pages)")
+              << std::endl;
     
     return true;
 }
@@ -112,7 +241,7 @@ bool ShmWin32::create() {
 /**
  * Connect to existing shared memory region
  */
-bool ShmWin32::connect() {
+bool ShmWin32::connect(bool registerReader) {
     // Open existing file mapping object
     m_hMapFile = OpenFileMappingA(
         FILE_MAP_ALL_ACCESS,   // Read/write access
@@ -121,18 +250,29 @@ bool ShmWin32::connect() {
     );
     
     if (m_hMapFile == NULL) {
-        // Try to create if it doesn't exist (producer mode)
-        return create();
+        // Try to create if it doesn't exist (the consumer came up first)
+        if (!create()) {
+            return false;
+        }
+        if (registerReader && !registerConsumerSlot()) {
+            disconnect();
+            return false;
+        }
+        return true;
     }
     
-    // Map view of file
+    // Map the header first - the region size is only known from it
     void* ptr = MapViewOfFile(
         m_hMapFile,
         FILE_MAP_ALL_ACCESS,
         0,
         0,
-        SHARED_BUFFER_SIZE
+        sizeof(SharedFrameBuffer)
     );
+    if (ptr == NULL && GetLargePageMinimum() > 0) {
+        // Views of a large-page section must be whole large pages
+        ptr = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, GetLargePageMinimum());
+    }
     
     if (ptr == NULL) {
         std::cerr << "[ShmWin32] Failed to map view of file: " << GetLastError() << std::endl;
@@ -141,19 +281,65 @@ bool ShmWin32::connect() {
         return false;
     }
     
+    const SharedFrameBuffer* header = static_cast<SharedFrameBuffer*>(ptr);
+    const bool written = header->magic != 0;
+    const uint64_t regionSize = header->total_size;
+    const uint32_t pageSize = header->page_size > FRAME_SLOT_ALIGNMENT ? header->page_size : systemPageSize();
+    UnmapViewOfFile(ptr);
+    
+    // The creator has not written the header yet; it announces the channel when it has
+    if (!written) {
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    
+    // Remap with the full size advertised by the creator, in whole pages of its backing
+    const uint64_t mappingSize = alignUp(regionSize, pageSize);
+    ptr = (regionSize >= sizeof(SharedFrameBuffer))
+        ? MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(mappingSize))
+        : NULL;
+    
+    if (ptr == NULL) {
+        std::cerr << "[ShmWin32] Failed to map view of file (size " << regionSize << "): " << GetLastError() << std::endl;
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    
     m_shm_ptr = static_cast<SharedFrameBuffer*>(ptr);
+    m_mappedSize = static_cast<size_t>(mappingSize);
+    m_pageSize = pageSize;
     
-    // Open existing semaphore
-    m_hSemaphore = OpenSemaphoreA(
-        SEMAPHORE_ALL_ACCESS,
-        FALSE,
-        m_semName.c_str()
-    );
+    if (!isLayoutCompatible(m_shm_ptr)) {
+        std::cerr << "[ShmWin32] Shared memory header has layout version " << m_shm_ptr->layout_version
+                  << " (expected " << SL_LAYOUT_VERSION << ")" << std::endl;
+        disconnect();
+        return false;
+    }
+    
+    if (!isGeometryValid(m_shm_ptr, m_mappedSize)) {
+        std::cerr << "[ShmWin32] Shared memory header has invalid geometry" << std::endl;
+        disconnect();
+        return false;
+    }
+    
+    if (m_pageSize <= systemPageSize()) {
+        prefaultView(m_shm_ptr, m_mappedSize, m_pageSize);
+    }
     
-    if (m_hSemaphore == NULL) {
-        // Semaphore not required - can use polling
+    if (registerReader && !registerConsumerSlot()) {
+        std::cerr << "[ShmWin32] All " << SL_MAX_CONSUMERS << " consumer registrations are in use" << std::endl;
+        disconnect();
+        return false;
     }
     
+    // Either side may be first to open the event
+    if (!openFrameEvent()) {
+        // Not required - waitForFrame() falls back to polling
+    }
+    m_lastFrameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
+    
     std::cout << "[ShmWin32] Connected to shared memory successfully" << std::endl;
     std::cout << "[ShmWin32] Resolution: " << m_shm_ptr->width << "x" << m_shm_ptr->height << std::endl;
     std::cout << "[ShmWin32] Frame size: " << m_shm_ptr->frame_size << " bytes" << std::endl;
@@ -161,13 +347,87 @@ bool ShmWin32::connect() {
     return true;
 }
 
+/**
+ * Claim a consumer registration (consumer)
+ */
+bool ShmWin32::registerConsumerSlot() {
+    if (m_consumerToken == 0) {
+        m_consumerToken = nextConsumerToken();
+    }
+    m_consumerIndex = registerConsumer(m_shm_ptr, m_consumerToken, static_cast<uint32_t>(GetCurrentProcessId()), steadyNowNs());
+    return m_consumerIndex < SL_MAX_CONSUMERS;
+}
+
+/**
+ * Refresh the heartbeat and frame demand, registering again if the entry
+ * was reclaimed (consumer; every caller is asking for a frame)
+ */
+bool ShmWin32::refreshConsumer(uint64_t nowNs) {
+    if (m_consumerIndex < SL_MAX_CONSUMERS && touchConsumer(m_shm_ptr, m_consumerIndex, m_consumerToken, nowNs)) {
+        setConsumerDemand(m_shm_ptr, m_consumerIndex, nowNs);
+        return true;
+    }
+    
+    const bool wasRegistered = m_consumerIndex < SL_MAX_CONSUMERS;
+    if (!registerConsumerSlot()) {
+        return false;
+    }
+    if (wasRegistered) {
+        std::cerr << "[ShmWin32] Consumer registration expired (no heartbeat), registered again as "
+                  << m_consumerIndex << std::endl;
+    }
+    return true;
+}
+
+/**
+ * Ask the producer to switch the channel's size or format (consumer)
+ */
+bool ShmWin32::reconfigure(uint32_t width, uint32_t height, uint32_t format, uint32_t* generation) {
+    if (!m_shm_ptr) return false;
+    
+    const uint32_t requested = requestReconfigure(m_shm_ptr, width, height, format);
+    if (requested == 0) {
+        std::cerr << "[ShmWin32] " << width << "x" << height << " format " << format << " does not fit the "
+                  << m_shm_ptr->slot_size << "-byte slots of " << m_channelName
+                  << " (create the channel for the largest geometry it may switch to)" << std::endl;
+        return false;
+    }
+    if (generation) *generation = requested;
+    return true;
+}
+
+/**
+ * Stop asking for frames until the next read or wait (consumer)
+ */
+void ShmWin32::setIdle() {
+    if (m_shm_ptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        setConsumerDemand(m_shm_ptr, m_consumerIndex, 0);
+    }
+}
+
+/**
+ * Whether a consumer is asking for frames (producer)
+ */
+bool ShmWin32::hasConsumerDemand() const {
+    return m_shm_ptr && StreamLumo::hasConsumerDemand(m_shm_ptr, steadyNowNs());
+}
+
 /**
  * Disconnect from shared memory
  */
 void ShmWin32::disconnect() {
+    m_pendingWriteIndex = -1;
+    
+    if (m_shm_ptr != nullptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        unregisterConsumer(m_shm_ptr, m_consumerIndex, m_consumerToken);
+    }
+    m_consumerIndex = SL_MAX_CONSUMERS;
+    
     if (m_shm_ptr != nullptr) {
         UnmapViewOfFile(m_shm_ptr);
         m_shm_ptr = nullptr;
+        m_mappedSize = 0;
+        m_pageSize = 0;
     }
     
     if (m_hMapFile != NULL) {
@@ -175,9 +435,9 @@ void ShmWin32::disconnect() {
         m_hMapFile = NULL;
     }
     
-    if (m_hSemaphore != NULL) {
-        CloseHandle(m_hSemaphore);
-        m_hSemaphore = NULL;
+    if (m_hFrameEvent != NULL) {
+        CloseHandle(m_hFrameEvent);
+        m_hFrameEvent = NULL;
     }
     
     std::cout << "[ShmWin32] Disconnected from shared memory" << std::endl;
@@ -200,90 +460,328 @@ bool ShmWin32::writeFrame(const unsigned char* frameData, size_t dataSize) {
         return false;
     }
     
-    if (dataSize != FRAME_SIZE) {
-        std::cerr << "[ShmWin32] Invalid frame size: " << dataSize << " (expected " << FRAME_SIZE << ")" << std::endl;
+    if (dataSize != m_shm_ptr->frame_size) {
+        std::cerr << "[ShmWin32] Invalid frame size: " << dataSize << " (expected " << m_shm_ptr->frame_size << ")" << std::endl;
         return false;
     }
     
-    // Get current write index
-    uint64_t currentWrite = m_shm_ptr->write_index.load(std::memory_order_acquire);
-    uint64_t currentRead = m_shm_ptr->read_index.load(std::memory_order_acquire);
-    
-    // Check if we're overwriting unread frames
-    if (shouldDropFrames(currentWrite, currentRead)) {
-        m_shm_ptr->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+    unsigned char* dest = beginWrite();
+    if (dest == nullptr) {
+        return false;
     }
     
     // Copy frame data to current write buffer
-    std::memcpy(m_shm_ptr->frames[currentWrite], frameData, dataSize);
+    std::memcpy(dest, frameData, dataSize);
+    
+    return commitWrite();
+}
+
+/**
+ * Acquire the current write slot for in-place writing (producer)
+ */
+unsigned char* ShmWin32::beginWrite() {
+    if (m_shm_ptr == nullptr) {
+        return nullptr;
+    }
+    const uint64_t nowNs = steadyNowNs();
+    
+    // Ring mode: the next FIFO slot, unless the slowest consumer has not freed it yet
+    if (isRingMode(m_shm_ptr)) {
+        const uint32_t slot = ringWriteSlot(m_shm_ptr, nowNs);
+        if (slot >= m_shm_ptr->slot_count) {
+            m_shm_ptr->ring_full_frames.fetch_add(1, std::memory_order_relaxed);
+            m_pendingWriteIndex = -1;
+            return nullptr;
+        }
+        m_pendingWriteIndex = static_cast<int64_t>(slot);
+        beginSlotWrite(m_shm_ptr, slot);
+        return frameSlot(m_shm_ptr, slot);
+    }
+    
+    // Any slot that is neither the latest frame nor being copied by a consumer
+    const uint32_t slot = latestWriteSlot(m_shm_ptr, nowNs);
+    if (slot >= m_shm_ptr->slot_count) {
+        m_shm_ptr->slot_busy_frames.fetch_add(1, std::memory_order_relaxed);
+        m_pendingWriteIndex = -1;
+        return nullptr;
+    }
+    
+    m_pendingWriteIndex = static_cast<int64_t>(slot);
+    beginSlotWrite(m_shm_ptr, slot);
+    return frameSlot(m_shm_ptr, slot);
+}
+
+/**
+ * Publish the slot acquired by beginWrite() (producer)
+ */
+bool ShmWin32::commitWrite(uint64_t obsTimestampNs, uint64_t captureTimeNs) {
+    if (m_shm_ptr == nullptr || m_pendingWriteIndex < 0) {
+        return false;
+    }
     
     // Update timestamp
     auto now = std::chrono::high_resolution_clock::now();
     auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch());
     m_shm_ptr->last_write_timestamp_ns.store(static_cast<uint64_t>(ns.count()), std::memory_order_release);
     
-    // Advance write index
-    uint64_t nextWrite = nextBufferIndex(currentWrite);
-    m_shm_ptr->write_index.store(nextWrite, std::memory_order_release);
+    // Increment frame counter, then describe the frame and close the slot's seqlock
+    const uint64_t frameNumber = m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    publishSlotDescriptor(m_shm_ptr, static_cast<uint64_t>(m_pendingWriteIndex), frameNumber,
+                          obsTimestampNs, captureTimeNs ? captureTimeNs : static_cast<uint64_t>(ns.count()));
+    
+    // Make it the latest frame; a frame no consumer has read yet is superseded
+    if (isRingMode(m_shm_ptr)) {
+        publishRingSlot(m_shm_ptr);
+    } else if (publishLatestSlot(m_shm_ptr, static_cast<uint32_t>(m_pendingWriteIndex), frameNumber, steadyNowNs())) {
+        m_shm_ptr->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_pendingWriteIndex = -1;
+    
+    // Wake a blocked consumer (no syscall when nobody is waiting)
+    if (signalFrame(m_shm_ptr) && m_hFrameEvent != NULL) {
+        SetEvent(m_hFrameEvent);
+    }
+    
+    return true;
+}
+
+/**
+ * Describe the changed tiles of the slot acquired by beginWrite() (producer)
+ */
+void ShmWin32::setDirtyTiles(const uint64_t tiles[SL_DIRTY_WORDS]) {
+    if (m_shm_ptr == nullptr || m_pendingWriteIndex < 0) {
+        return;
+    }
+    
+    // This producer's previous frame is the one the next commit builds on
+    const uint64_t previousFrame = m_shm_ptr->frame_counter.load(std::memory_order_relaxed);
+    if (previousFrame != 0) {
+        setSlotDirtyTiles(m_shm_ptr, static_cast<uint64_t>(m_pendingWriteIndex), previousFrame, tiles);
+    }
+}
+
+/**
+ * Record the colorimetry of the slot acquired by beginWrite() (producer)
+ */
+void ShmWin32::setColorimetry(uint32_t matrix, uint32_t range) {
+    if (m_shm_ptr == nullptr || m_pendingWriteIndex < 0) {
+        return;
+    }
     
-    // Increment frame counter
-    m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed);
+    setSlotColorimetry(m_shm_ptr, static_cast<uint64_t>(m_pendingWriteIndex), matrix, range);
+}
+
+/**
+ * Give up the slot acquired by beginWrite() without publishing it
+ */
+void ShmWin32::abortWrite() {
+    if (m_shm_ptr != nullptr && m_pendingWriteIndex >= 0) {
+        endSlotWrite(m_shm_ptr, static_cast<uint64_t>(m_pendingWriteIndex));
+    }
+    m_pendingWriteIndex = -1;
+}
+
+/**
+ * Publish (or withdraw) the shared GPU textures (producer)
+ */
+void ShmWin32::setSharedTextures(uint32_t api, uint32_t count, const uint64_t handles[],
+                                 uint32_t width, uint32_t height, uint32_t format, uint32_t syncKey) {
+    if (!m_shm_ptr) return;
+    setTextureDescriptor(m_shm_ptr, api, count, handles, width, height, format, syncKey);
+}
+
+/**
+ * Publish a frame rendered into shared texture `index` (producer)
+ */
+bool ShmWin32::commitTexture(uint32_t index, uint64_t captureTimeNs) {
+    if (!m_shm_ptr || index >= m_shm_ptr->texture.count) return false;
+    
+    const uint64_t nowNs = steadyNowNs();
+    m_shm_ptr->last_write_timestamp_ns.store(nowNs, std::memory_order_release);
     
-    // Signal semaphore if available
-    if (m_hSemaphore != NULL) {
-        ReleaseSemaphore(m_hSemaphore, 1, NULL);
+    // Texture frames share the frame numbering of the slot frames
+    const uint64_t frameNumber = m_shm_ptr->frame_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    publishLatestTexture(m_shm_ptr, index, frameNumber, captureTimeNs ? captureTimeNs : nowNs);
+    
+    // Wake a blocked consumer (no syscall when nobody is waiting)
+    if (signalFrame(m_shm_ptr) && m_hFrameEvent != NULL) {
+        SetEvent(m_hFrameEvent);
     }
     
     return true;
 }
 
+/**
+ * Shared textures held by readers or holding the latest frame (producer)
+ */
+uint32_t ShmWin32::busySharedTextures() {
+    return m_shm_ptr ? busyTextureMask(m_shm_ptr, steadyNowNs()) : 0;
+}
+
+/**
+ * Take the newest shared texture frame (consumer)
+ */
+bool ShmWin32::acquireSharedTexture(SharedTextureInfo& info) {
+    const uint64_t nowNs = steadyNowNs();
+    if (!m_shm_ptr || !refreshConsumer(nowNs)) return false;
+    const uint32_t frameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
+    
+    // Hold the texture before using it; a frame published meanwhile replaces it
+    do {
+        if (!readTextureDescriptor(m_shm_ptr, info) || info.frameNumber == 0) return false;
+        if (info.frameNumber <= m_shm_ptr->consumers[m_consumerIndex].read_frame.load(std::memory_order_relaxed)) return false;
+    } while (!acquireLatestTexture(m_shm_ptr, m_consumerIndex, info));
+    
+    recordConsumerRead(m_shm_ptr, m_consumerIndex, info.frameNumber, nowNs);
+    m_lastFrameSignal = frameSignal;
+    return true;
+}
+
+/**
+ * Drop the hazard on the last shared texture taken (consumer)
+ */
+void ShmWin32::releaseSharedTexture() {
+    if (m_shm_ptr && m_consumerIndex < SL_MAX_CONSUMERS) {
+        releaseTextureHazard(m_shm_ptr, m_consumerIndex);
+    }
+}
+
 /**
  * Read latest frame from shared memory (consumer)
  */
-bool ShmWin32::readFrame(unsigned char* buffer, size_t bufferSize) {
+bool ShmWin32::readFrame(unsigned char* buffer, size_t bufferSize, FrameMetadata* frame) {
     if (m_shm_ptr == nullptr) {
         std::cerr << "[ShmWin32] Not connected to shared memory" << std::endl;
         return false;
     }
-    
-    if (bufferSize < FRAME_SIZE) {
-        std::cerr << "[ShmWin32] Buffer too small: " << bufferSize << " (need " << FRAME_SIZE << ")" << std::endl;
+    if (!refreshConsumer(steadyNowNs())) {
         return false;
     }
+    const uint32_t frameSignal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
     
-    // Get current indices
-    uint64_t currentWrite = m_shm_ptr->write_index.load(std::memory_order_acquire);
-    uint64_t currentRead = m_shm_ptr->read_index.load(std::memory_order_acquire);
+    // Latest-frame mode takes the newest frame and holds its slot during the
+    // copy; ring mode takes this consumer's oldest unread one
+    uint32_t readIdx = 0;
+    uint64_t expectedFrame = 0;
+    const bool ring = isRingMode(m_shm_ptr);
+    if (ring ? !acquireRingSlot(m_shm_ptr, m_consumerIndex, readIdx, expectedFrame)
+             : !acquireLatestSlot(m_shm_ptr, m_consumerIndex, readIdx)) {
+        return false;
+    }
     
-    // Check if there's a new frame available
-    if (currentWrite == currentRead) {
+    if (!copySlot(readIdx, buffer, bufferSize, frame, expectedFrame)) {
+        releaseConsumerSlot(m_shm_ptr, m_consumerIndex);
         return false;
     }
+    m_lastFrameSignal = frameSignal;
     
-    // Read latest frame
-    uint64_t readIdx = getLatestFrameIndex(currentWrite);
+    return true;
+}
+
+/**
+ * Copy one acquired slot and advance this consumer's read cursor
+ */
+bool ShmWin32::copySlot(uint32_t readIdx, unsigned char* buffer, size_t bufferSize, FrameMetadata* frame,
+                        uint64_t expectedFrame) {
+    // The slot descriptor, not the header, gives the geometry of this frame
+    uint32_t sequence = 0;
+    if (!beginSlotRead(m_shm_ptr, readIdx, sequence)) {
+        return false;
+    }
+    const SlotDescriptor& slot = m_shm_ptr->slots[readIdx];
+    const uint64_t frameSize = frameSizeFor(slot.width, slot.height, slot.format);
+    if (frameSize > m_shm_ptr->slot_size || bufferSize < frameSize) {
+        std::cerr << "[ShmWin32] Buffer too small: " << bufferSize << " (need " << frameSize << ")" << std::endl;
+        return false;
+    }
     
     // Copy frame data
-    std::memcpy(buffer, m_shm_ptr->frames[readIdx], FRAME_SIZE);
+    std::memcpy(buffer, frameSlot(m_shm_ptr, readIdx), static_cast<size_t>(frameSize));
+    
+    if (frame != nullptr) {
+        fillFrameMetadata(m_shm_ptr, slot, sequence, *frame);
+    }
+    const uint64_t frameNumber = slot.frame_number;
+    
+    // Cannot happen with a well-behaved producer; guards against a restarted one
+    if (!endSlotRead(m_shm_ptr, readIdx, sequence)) {
+        return false;
+    }
     
-    // Update read index
-    m_shm_ptr->read_index.store(currentWrite, std::memory_order_release);
+    // A ring consumer that went silent may have been lapped: continue from here
+    if (expectedFrame != 0 && frameNumber != expectedFrame) {
+        if (frameNumber < expectedFrame) {
+            return false;
+        }
+        std::cerr << "[ShmWin32] Consumer " << m_consumerIndex << " fell behind, lost "
+                  << (frameNumber - expectedFrame) << " ring frame(s)" << std::endl;
+    }
     
+    // Advance the read cursor and tell the producer when this frame was picked up
+    recordConsumerRead(m_shm_ptr, m_consumerIndex, frameNumber, steadyNowNs());
     return true;
 }
 
 /**
- * Wait for new frame with timeout
+ * Open (or create) the auto-reset frame event
+ */
+bool ShmWin32::openFrameEvent() {
+    if (m_hFrameEvent == NULL) {
+        m_hFrameEvent = CreateEventA(NULL, FALSE, FALSE, m_eventName.c_str());
+    }
+    return m_hFrameEvent != NULL;
+}
+
+/**
+ * Wait for a new frame
+ * 
+ * The event is auto-reset and the producer only sets it while a consumer is
+ * registered in wake_waiters, so wake-ups never pile up. A leftover set
+ * state is filtered by comparing frame_signal with the last frame seen.
  */
 bool ShmWin32::waitForFrame(int timeoutMs) {
-    if (m_hSemaphore == NULL) {
+    if (m_shm_ptr == nullptr) {
         return false;
     }
     
-    DWORD timeout = (timeoutMs < 0) ? INFINITE : static_cast<DWORD>(timeoutMs);
-    DWORD result = WaitForSingleObject(m_hSemaphore, timeout);
+    const ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeoutMs < 0 ? 0 : timeoutMs);
     
-    return (result == WAIT_OBJECT_0);
+    for (;;) {
+        const uint32_t signal = m_shm_ptr->frame_signal.load(std::memory_order_acquire);
+        if (signal != m_lastFrameSignal) {
+            m_lastFrameSignal = signal;
+            return true;
+        }
+        
+        DWORD waitMs = INFINITE;
+        if (timeoutMs >= 0) {
+            const ULONGLONG now = GetTickCount64();
+            if (now >= deadline) {
+                return false;
+            }
+            waitMs = static_cast<DWORD>(deadline - now);
+        }
+        
+        // Stay registered while blocked: wake up often enough to keep the heartbeat fresh
+        if (m_consumerIndex < SL_MAX_CONSUMERS) {
+            refreshConsumer(steadyNowNs());
+            const DWORD heartbeatMs = static_cast<DWORD>(SL_CONSUMER_TIMEOUT_NS / 4 / 1000000);
+            if (waitMs > heartbeatMs) {
+                waitMs = heartbeatMs;
+            }
+        }
+        
+        // Register before the final check so the producer cannot miss us
+        m_shm_ptr->wake_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (m_shm_ptr->frame_signal.load(std::memory_order_seq_cst) == signal) {
+            if (m_hFrameEvent != NULL) {
+                WaitForSingleObject(m_hFrameEvent, waitMs);
+            } else {
+                Sleep(waitMs < 1 ? waitMs : 1);
+            }
+        }
+        m_shm_ptr->wake_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
 }
 
 /**
@@ -300,8 +798,20 @@ bool ShmWin32::getMetadata(FrameMetadata& metadata) {
     metadata.format = m_shm_ptr->format;
     metadata.frameCounter = m_shm_ptr->frame_counter.load(std::memory_order_relaxed);
     metadata.droppedFrames = m_shm_ptr->dropped_frames.load(std::memory_order_relaxed);
+    metadata.ringFullFrames = m_shm_ptr->ring_full_frames.load(std::memory_order_relaxed);
+    metadata.slotBusyFrames = m_shm_ptr->slot_busy_frames.load(std::memory_order_relaxed);
+    metadata.activeConsumers = activeConsumerCount(m_shm_ptr, steadyNowNs());
+    metadata.appliedGeneration = m_shm_ptr->applied_generation.load(std::memory_order_acquire);
     metadata.lastWriteTimestampNs = m_shm_ptr->last_write_timestamp_ns.load(std::memory_order_relaxed);
     
+    // Per-frame fields are only known for a frame returned by readFrame()
+    metadata.sequence = 0;
+    for (uint32_t i = 0; i < MAX_PLANES; i++) metadata.stride[i] = 0;
+    metadata.colorMatrix = metadata.colorRange = 0;
+    metadata.frameNumber = metadata.obsTimestampNs = metadata.captureTimeNs = 0;
+    metadata.dirtyBaseFrame = 0;
+    for (uint32_t i = 0; i < SL_DIRTY_WORDS; i++) metadata.dirtyTiles[i] = 0;
+    
     return true;
 }
 
@@ -312,6 +822,493 @@ bool ShmWin32::isConnected() const {
     return m_shm_ptr != nullptr;
 }
 
+/**
+ * Named mappings live as long as any handle: ours keeps the region the name
+ * refers to, and a consumer's create() re-opens it rather than replacing it
+ */
+bool ShmWin32::isReplaced() const {
+    return false;
+}
+
+ShmWin32Directory::ShmWin32Directory()
+    : m_shmName(SHM_DIRECTORY_NAME_WIN32), m_hMapFile(NULL), m_directory(nullptr) {
+}
+
+ShmWin32Directory::~ShmWin32Directory() {
+    close();
+}
+
+/**
+ * Open (or create) the channel directory
+ */
+bool ShmWin32Directory::open() {
+    if (m_directory) return true;
+    
+    // A new mapping is zero-filled, which is a valid empty directory
+    m_hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                    static_cast<DWORD>(sizeof(ChannelDirectory)), m_shmName.c_str());
+    if (m_hMapFile == NULL) {
+        std::cerr << "[ShmWin32Directory] Failed to open " << m_shmName << ": " << GetLastError() << std::endl;
+        return false;
+    }
+    
+    void* ptr = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ChannelDirectory));
+    if (ptr == NULL) {
+        std::cerr << "[ShmWin32Directory] Failed to map " << m_shmName << ": " << GetLastError() << std::endl;
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    m_directory = static_cast<ChannelDirectory*>(ptr);
+    
+    if (!initDirectory(m_directory)) {
+        std::cerr << "[ShmWin32Directory] Directory has version " << m_directory->version.load()
+                  << " (expected " << SL_DIRECTORY_VERSION << ")" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Withdraw our requests and unmap the directory
+ */
+void ShmWin32Directory::close() {
+    if (m_directory) {
+        for (int index : m_ownedRequests) {
+            releaseChannelRequest(m_directory, static_cast<uint32_t>(index));
+        }
+        UnmapViewOfFile(m_directory);
+        m_directory = nullptr;
+    }
+    m_ownedRequests.clear();
+    
+    if (m_hMapFile != NULL) {
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+    }
+}
+
+int ShmWin32Directory::requestChannel(const std::string& channel, const std::string& source) {
+    if (!m_directory || channel.empty() || channel.size() >= SL_CHANNEL_NAME_SIZE) return -1;
+    
+    const uint32_t index = claimChannelRequest(m_directory, channel.c_str(), source.c_str(),
+                                               static_cast<uint32_t>(GetCurrentProcessId()), steadyNowNs());
+    if (index >= SL_MAX_CHANNEL_REQUESTS) {
+        std::cerr << "[ShmWin32Directory] All " << SL_MAX_CHANNEL_REQUESTS << " channel requests are in use" << std::endl;
+        return -1;
+    }
+    m_ownedRequests.push_back(static_cast<int>(index));
+    return static_cast<int>(index);
+}
+
+void ShmWin32Directory::releaseChannel(int index) {
+    for (size_t i = 0; i < m_ownedRequests.size(); i++) {
+        if (m_ownedRequests[i] != index) continue;
+        m_ownedRequests.erase(m_ownedRequests.begin() + i);
+        if (m_directory) releaseChannelRequest(m_directory, static_cast<uint32_t>(index));
+        return;
+    }
+}
+
+void ShmWin32Directory::refresh() {
+    if (!m_directory) return;
+    const uint64_t now = steadyNowNs();
+    for (int index : m_ownedRequests) {
+        m_directory->requests[index].heartbeat_ns.store(now, std::memory_order_relaxed);
+    }
+}
+
+bool ShmWin32Directory::readRequest(uint32_t index, uint32_t& serial, std::string& channel, std::string& source) const {
+    if (!m_directory || index >= SL_MAX_CHANNEL_REQUESTS) return false;
+    if (!isChannelRequestLive(m_directory, index, steadyNowNs())) return false;
+    
+    // The names only change after the entry was freed and claimed again
+    const ChannelRequest& request = m_directory->requests[index];
+    serial = request.serial.load(std::memory_order_acquire);
+    char channelName[SL_CHANNEL_NAME_SIZE];
+    char sourceName[SL_SOURCE_NAME_SIZE];
+    memcpy(channelName, request.channel, sizeof(channelName));
+    memcpy(sourceName, request.source, sizeof(sourceName));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (request.state.load(std::memory_order_relaxed) != SL_REQUEST_ACTIVE ||
+        request.serial.load(std::memory_order_relaxed) != serial) {
+        return false;
+    }
+    
+    channelName[SL_CHANNEL_NAME_SIZE - 1] = '\0';
+    sourceName[SL_SOURCE_NAME_SIZE - 1] = '\0';
+    channel = channelName;
+    source = sourceName;
+    return true;
+}
+
+uint32_t ShmWin32Directory::expireStale() {
+    if (!m_directory) return 0;
+    const uint64_t now = steadyNowNs();
+    uint32_t expired = 0;
+    for (uint32_t i = 0; i < SL_MAX_CHANNEL_REQUESTS; i++) {
+        if (expireChannelRequest(m_directory, i, now)) expired++;
+    }
+    return expired;
+}
+
+uint32_t ShmWin32Directory::generation() const {
+    return m_directory ? m_directory->generation.load(std::memory_order_acquire) : 0;
+}
+
+void ShmWin32Directory::announceChannel() {
+    if (m_directory) m_directory->channel_epoch.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t ShmWin32Directory::channelEpoch() const {
+    return m_directory ? m_directory->channel_epoch.load(std::memory_order_acquire) : 0;
+}
+
+ShmWin32Metrics::ShmWin32Metrics(const std::string& channelName)
+    : m_shmName(std::string(SHM_METRICS_NAME_WIN32) + "_" + channelName), m_hMapFile(NULL), m_metrics(nullptr) {
+}
+
+ShmWin32Metrics::~ShmWin32Metrics() {
+    close();
+}
+
+/**
+ * Open (or create) the metrics page
+ */
+bool ShmWin32Metrics::open() {
+    if (m_metrics) return true;
+    
+    // A new mapping is zero-filled, which is a valid empty page
+    m_hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                    static_cast<DWORD>(sizeof(ChannelMetrics)), m_shmName.c_str());
+    if (m_hMapFile == NULL) {
+        std::cerr << "[ShmWin32Metrics] Failed to open " << m_shmName << ": " << GetLastError() << std::endl;
+        return false;
+    }
+    
+    void* ptr = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ChannelMetrics));
+    if (ptr == NULL) {
+        std::cerr << "[ShmWin32Metrics] Failed to map " << m_shmName << ": " << GetLastError() << std::endl;
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    m_metrics = static_cast<ChannelMetrics*>(ptr);
+    
+    if (!initMetrics(m_metrics)) {
+        std::cerr << "[ShmWin32Metrics] Metrics page has version " << m_metrics->version.load()
+                  << " (expected " << SL_METRICS_VERSION << ")" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Record the producer process
+ */
+void ShmWin32Metrics::claim() {
+    if (m_metrics) {
+        m_metrics->process_id.store(static_cast<uint32_t>(GetCurrentProcessId()), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Unmap the metrics page
+ */
+void ShmWin32Metrics::close() {
+    if (m_metrics) {
+        UnmapViewOfFile(m_metrics);
+        m_metrics = nullptr;
+    }
+    
+    if (m_hMapFile != NULL) {
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+    }
+}
+
+/**
+ * Named mappings have no name to remove: closing is enough
+ */
+void ShmWin32Metrics::destroy() {
+    close();
+}
+
+ShmWin32Packets::ShmWin32Packets(const std::string& channelName)
+    : m_channelName(channelName)
+    , m_shmName(std::string(SHM_PACKET_NAME_WIN32) + "_" + channelName)
+    , m_eventName(std::string("Local\\StreamLumoPacketEvent_") + channelName)
+    , m_hMapFile(NULL)
+    , m_hPacketEvent(NULL)
+    , m_ring(nullptr)
+    , m_readCursor(0)
+    , m_streamPublished(false)
+{
+}
+
+ShmWin32Packets::~ShmWin32Packets() {
+    disconnect();
+}
+
+/**
+ * Map the packet channel and open its event
+ */
+bool ShmWin32Packets::mapView(size_t size) {
+    void* ptr = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (ptr == NULL) {
+        std::cerr << "[ShmWin32Packets] Failed to map " << m_shmName << ": " << GetLastError() << std::endl;
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    
+    m_ring = static_cast<PacketRingBuffer*>(ptr);
+    m_readCursor = 0;
+    m_streamPublished = false;
+    if (m_hPacketEvent == NULL) {
+        m_hPacketEvent = CreateEventA(NULL, FALSE, FALSE, m_eventName.c_str());
+    }
+    return true;
+}
+
+/**
+ * Create the packet channel and announce it
+ */
+bool ShmWin32Packets::create(uint32_t codec, uint32_t width, uint32_t height, uint32_t bitrateKbps,
+                             uint32_t keyintMs, uint32_t dataSize) {
+    if (dataSize == 0) {
+        std::cerr << "[ShmWin32Packets] Invalid packet ring size for " << m_channelName << std::endl;
+        return false;
+    }
+    
+    // An existing mapping (a producer still holds it) is re-initialised in place
+    const uint64_t regionSize = static_cast<uint64_t>(packetDataOffset()) + dataSize;
+    m_hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                    static_cast<DWORD>(regionSize >> 32), static_cast<DWORD>(regionSize),
+                                    m_shmName.c_str());
+    if (m_hMapFile == NULL) {
+        std::cerr << "[ShmWin32Packets] Failed to create " << m_shmName << ": " << GetLastError() << std::endl;
+        return false;
+    }
+    if (!mapView(static_cast<size_t>(regionSize))) return false;
+    
+    initPacketRing(m_ring, dataSize, codec, width, height, bitrateKbps, keyintMs);
+    
+    // Count as a live reader from the start, so the producer starts encoding
+    m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+    
+    ShmWin32Directory directory;
+    if (directory.open()) {
+        directory.announceChannel();
+    }
+    
+    std::cout << "[ShmWin32Packets] Packet channel created (" << (dataSize / 1024 / 1024) << " MB) for "
+              << m_channelName << std::endl;
+    return true;
+}
+
+/**
+ * Map an existing packet channel
+ */
+bool ShmWin32Packets::connect() {
+    m_hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_shmName.c_str());
+    if (m_hMapFile == NULL) {
+        // Silent fail is okay for connect - it might not exist yet
+        return false;
+    }
+    
+    // Map the header first - the region size is only known from it
+    const PacketRingBuffer* header = static_cast<const PacketRingBuffer*>(
+        MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(PacketRingBuffer)));
+    if (header == NULL) {
+        std::cerr << "[ShmWin32Packets] Failed to map " << m_shmName << ": " << GetLastError() << std::endl;
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    const bool written = header->magic != 0;
+    const uint64_t regionSize = header->total_size;
+    UnmapViewOfFile(header);
+    
+    // Not initialised yet; the creator announces the channel when it is
+    if (!written || regionSize < sizeof(PacketRingBuffer)) {
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+        return false;
+    }
+    if (!mapView(static_cast<size_t>(regionSize))) return false;
+    
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!isPacketRingValid(m_ring, regionSize)) {
+        std::cerr << "[ShmWin32Packets] Packet channel " << m_channelName << " has layout version "
+                  << m_ring->layout_version << " (expected " << SL_PACKET_LAYOUT_VERSION
+                  << ") or invalid geometry" << std::endl;
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Unmap the packet channel
+ */
+void ShmWin32Packets::disconnect() {
+    if (m_ring) {
+        UnmapViewOfFile(m_ring);
+        m_ring = nullptr;
+    }
+    
+    if (m_hMapFile != NULL) {
+        CloseHandle(m_hMapFile);
+        m_hMapFile = NULL;
+    }
+    
+    if (m_hPacketEvent != NULL) {
+        CloseHandle(m_hPacketEvent);
+        m_hPacketEvent = NULL;
+    }
+    m_streamPublished = false;
+}
+
+/**
+ * Named mappings have no name to remove: closing is enough
+ */
+void ShmWin32Packets::destroy() {
+    disconnect();
+}
+
+/**
+ * A re-created channel reuses the mapping we hold and comes back initialised,
+ * without the stream info we published
+ */
+bool ShmWin32Packets::isReplaced() const {
+    return m_ring && m_streamPublished && m_ring->stream_sequence.load(std::memory_order_acquire) == 0;
+}
+
+/**
+ * Publish the stream info of a new encoder session
+ */
+void ShmWin32Packets::publishStreamInfo(uint32_t codec, uint32_t width, uint32_t height, uint32_t fpsNum,
+                                        uint32_t fpsDen, int32_t timebaseNum, int32_t timebaseDen,
+                                        const uint8_t* extraData, size_t extraDataSize) {
+    if (!m_ring) return;
+    if (extraDataSize > SL_PACKET_EXTRA_DATA_SIZE) {
+        std::cerr << "[ShmWin32Packets] " << extraDataSize << " bytes of codec headers truncated to "
+                  << SL_PACKET_EXTRA_DATA_SIZE << " for " << m_channelName << std::endl;
+    }
+    StreamLumo::publishStreamInfo(m_ring, codec, width, height, fpsNum, fpsDen, timebaseNum, timebaseDen,
+                                  extraData, extraDataSize);
+    m_streamPublished = true;
+}
+
+/**
+ * Append a packet and wake a consumer blocked in waitForPacket()
+ */
+bool ShmWin32Packets::writePacket(const uint8_t* data, size_t size, int64_t pts, int64_t dts, bool keyframe,
+                                  uint64_t captureTimeNs) {
+    if (!m_ring) return false;
+    if (size > UINT32_MAX ||
+        !appendPacket(m_ring, data, static_cast<uint32_t>(size), pts, dts, keyframe, captureTimeNs)) {
+        return false;
+    }
+    
+    // No syscall when nobody is waiting (seq_cst pairs with waitForPacket())
+    if (m_ring->packet_waiters.load(std::memory_order_seq_cst) != 0 && m_hPacketEvent != NULL) {
+        SetEvent(m_hPacketEvent);
+    }
+    return true;
+}
+
+/**
+ * Whether a consumer is reading the channel
+ */
+bool ShmWin32Packets::hasConsumer() const {
+    return m_ring && hasPacketConsumer(m_ring, steadyNowNs());
+}
+
+/**
+ * Newest keyframe request not answered yet
+ */
+bool ShmWin32Packets::pendingKeyframeRequest(uint32_t& request) const {
+    return m_ring && StreamLumo::pendingKeyframeRequest(m_ring, request);
+}
+
+/**
+ * Mark keyframe requests up to `request` as answered
+ */
+void ShmWin32Packets::keyframeServed(uint32_t request) {
+    if (m_ring) m_ring->keyframes_served.store(request, std::memory_order_relaxed);
+}
+
+/**
+ * Copy the next packet and refresh the heartbeat
+ */
+PacketReadResult ShmWin32Packets::readPacket(uint8_t* buffer, size_t bufferSize, PacketInfo* info) {
+    if (!m_ring) return SL_PACKET_NONE;
+    m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+    return StreamLumo::readPacket(m_ring, m_readCursor, buffer, bufferSize, info);
+}
+
+/**
+ * Wait for a packet after the last one read
+ */
+bool ShmWin32Packets::waitForPacket(int timeoutMs) {
+    if (!m_ring) return false;
+    
+    const ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeoutMs < 0 ? 0 : timeoutMs);
+    
+    for (;;) {
+        // A reader that has not read yet waits for the first keyframe
+        const uint32_t signal = m_ring->packet_signal.load(std::memory_order_acquire);
+        const uint64_t newest = m_ring->write_sequence.load(std::memory_order_acquire);
+        const uint64_t available = m_readCursor != 0 ? newest : m_ring->keyframe_sequence.load(std::memory_order_acquire);
+        if (m_readCursor != 0 ? available > m_readCursor : available != 0) return true;
+        
+        DWORD waitMs = INFINITE;
+        if (timeoutMs >= 0) {
+            const ULONGLONG now = GetTickCount64();
+            if (now >= deadline) {
+                return false;
+            }
+            waitMs = static_cast<DWORD>(deadline - now);
+        }
+        
+        // Stay alive while blocked: the producer stops encoding without a reader
+        m_ring->consumer_heartbeat_ns.store(steadyNowNs(), std::memory_order_relaxed);
+        const DWORD heartbeatMs = static_cast<DWORD>(SL_CONSUMER_TIMEOUT_NS / 4 / 1000000);
+        if (waitMs > heartbeatMs) {
+            waitMs = heartbeatMs;
+        }
+        
+        // Register before the final check so the producer cannot miss us
+        m_ring->packet_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (m_ring->packet_signal.load(std::memory_order_seq_cst) == signal) {
+            if (m_hPacketEvent != NULL) {
+                WaitForSingleObject(m_hPacketEvent, waitMs);
+            } else {
+                Sleep(waitMs < 1 ? waitMs : 1);
+            }
+        }
+        m_ring->packet_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+/**
+ * Snapshot the stream info
+ */
+bool ShmWin32Packets::getStreamInfo(PacketStreamInfo& info) const {
+    return m_ring && readStreamInfo(m_ring, info);
+}
+
+/**
+ * Ask for a keyframe
+ */
+void ShmWin32Packets::requestKeyframe() {
+    if (m_ring) m_ring->keyframe_requests.fetch_add(1, std::memory_order_release);
+}
+
 } // namespace StreamLumo
 
 #endif // _WIN32
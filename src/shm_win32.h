@@ -12,10 +12,9 @@
 #include <cstdint>
 #include <cstddef>
 #include <string>
+#include <vector>
 #include <windows.h>
-
-// Forward declaration
-struct SharedFrameBuffer;
+#include "../include/shared_buffer.h"
 
 namespace StreamLumo {
 
@@ -29,7 +28,23 @@ struct FrameMetadata {
     uint32_t format;
     uint64_t frameCounter;
     uint64_t droppedFrames;
+    uint64_t ringFullFrames;        // Ring mode: frames the producer skipped while the ring was full
+    uint64_t slotBusyFrames;        // Latest-frame mode: frames skipped because every free slot was being read
+    uint32_t activeConsumers;       // Registered consumers with a fresh heartbeat (getMetadata() only)
+    uint32_t appliedGeneration;     // Newest reconfigure request the producer has answered
     uint64_t lastWriteTimestampNs;
+    
+    // Per-frame fields (slot descriptor); readFrame() also reports the
+    // geometry above for the frame it returned rather than the header's
+    uint32_t sequence;
+    uint32_t stride[MAX_PLANES];
+    uint32_t colorMatrix;           // Planar frames: YUV matrix (ColorMatrixId) and range (ColorRangeId)
+    uint32_t colorRange;
+    uint64_t frameNumber;
+    uint64_t obsTimestampNs;
+    uint64_t captureTimeNs;
+    uint64_t dirtyBaseFrame;        // Tiles not in dirtyTiles are unchanged since this frame (0 = all dirty)
+    uint64_t dirtyTiles[SL_DIRTY_WORDS];
 };
 
 /**
@@ -40,11 +55,19 @@ public:
     ShmWin32(const std::string& channelName);
     ~ShmWin32();
 
-    // Create shared memory (producer side - OBS plugin)
-    bool create();
+    // Create shared memory sized for the negotiated frame geometry
+    // slotCount only applies with SL_FLAG_RING_MODE (clamped to 2..SL_MAX_SLOTS)
+    // SL_FLAG_HUGE_PAGES asks for huge pages, falling back to normal ones (see pageSize())
+    bool create(uint32_t width = FRAME_WIDTH, uint32_t height = FRAME_HEIGHT,
+                uint32_t format = FORMAT_RGBA, uint32_t flags = 0,
+                uint32_t slotCount = NUM_BUFFERS);
     
-    // Connect to existing shared memory (consumer side - Electron)
-    bool connect();
+    // Connect to existing shared memory
+    // A consumer (Electron) claims one of SL_MAX_CONSUMERS registrations and
+    // fails if all are in use; a producer passes registerReader = false and maps
+    // the channel without one, so it neither holds back the ring nor counts as
+    // demand or as an active consumer
+    bool connect(bool registerReader = true);
     
     // Disconnect from shared memory
     void disconnect();
@@ -55,29 +78,264 @@ public:
     // Write frame to shared memory (producer)
     bool writeFrame(const unsigned char* frameData, size_t dataSize);
     
+    // Acquire the next slot for in-place writing (producer)
+    // Returns the producer-owned slot of the triple buffer, or the next ring slot
+    // (nullptr if not connected, or if the ring is full: counted in ring_full_frames)
+    unsigned char* beginWrite();
+    
+    // Publish the slot acquired by beginWrite() (producer)
+    // Timestamps go to the slot descriptor; captureTimeNs = 0 uses the commit time
+    bool commitWrite(uint64_t obsTimestampNs = 0, uint64_t captureTimeNs = 0);
+    
+    // Mark only `tiles` of the slot acquired by beginWrite() as changed since the
+    // previously published frame (without this call the whole frame counts as new)
+    void setDirtyTiles(const uint64_t tiles[SL_DIRTY_WORDS]);
+    
+    // Record the YUV matrix and range (ColorMatrixId / ColorRangeId) of the planar
+    // frame in the slot acquired by beginWrite() (without this call: BT.601 full)
+    void setColorimetry(uint32_t matrix, uint32_t range);
+    
+    // Give up the slot acquired by beginWrite() without publishing it
+    void abortWrite();
+    
+    // Publish the shared GPU textures frames are rendered into (producer)
+    // api = SL_TEXTURE_API_NONE withdraws them; consumers then read the slots again
+    void setSharedTextures(uint32_t api, uint32_t count, const uint64_t handles[],
+                           uint32_t width, uint32_t height, uint32_t format, uint32_t syncKey);
+    
+    // Make shared texture `index` the latest frame and wake consumers (producer)
+    bool commitTexture(uint32_t index, uint64_t captureTimeNs = 0);
+    
+    // Shared textures not to render the next frame into (producer, see busyTextureMask())
+    uint32_t busySharedTextures();
+    
+    // Newest shared texture frame this consumer has not taken yet (consumer)
+    // Advances the read cursor like readFrame(); open info.handles[info.index].
+    // The producer leaves that texture alone until releaseSharedTexture() or
+    // the next successful acquire.
+    bool acquireSharedTexture(SharedTextureInfo& info);
+    
+    // Done with the texture of the last acquireSharedTexture() (consumer)
+    void releaseSharedTexture();
+    
     // Read latest frame from shared memory (consumer)
-    bool readFrame(unsigned char* buffer, size_t bufferSize);
+    // Each connected consumer has its own read cursor: every one of them gets
+    // each latest frame (or, in ring mode, every frame) once.
+    // Fails if the copy was torn by a concurrent write; `frame` receives the slot descriptor
+    bool readFrame(unsigned char* buffer, size_t bufferSize, FrameMetadata* frame = nullptr);
     
-    // Wait for new frame (optional, uses semaphore)
+    // Wait until a frame newer than the last one waited for or read is published
+    // (auto-reset event). timeoutMs < 0 waits forever, 0 polls.
     bool waitForFrame(int timeoutMs = -1);
     
+    // Switch a live channel to a new size and/or format (consumer)
+    // The producer changes over at its next frame, without pausing; frames of
+    // the new geometry follow once getMetadata().appliedGeneration reaches
+    // *generation (each frame's slot descriptor carries its own geometry).
+    // Fails if such frames would not fit the slots the channel was created with.
+    bool reconfigure(uint32_t width, uint32_t height, uint32_t format, uint32_t* generation = nullptr);
+    
+    // Stop asking for frames, e.g. while the consumer's view is hidden (consumer)
+    // The producer suspends capture once no reader wants frames; the next
+    // readFrame(), waitForFrame() or acquireSharedTexture() resumes it.
+    void setIdle();
+    
+    // Whether any live reader asked for a frame within SL_DEMAND_TIMEOUT_NS (producer)
+    bool hasConsumerDemand() const;
+    
     // Get frame metadata
     bool getMetadata(FrameMetadata& metadata);
     
     // Check if connected
     bool isConnected() const;
     
+    // Whether the channel name now refers to a different region than the one
+    // we mapped, i.e. the creator destroyed and re-created it (producer)
+    bool isReplaced() const;
+    
     // Get direct access to shared buffer (for control flags)
     SharedFrameBuffer* getBuffer() const { return m_shm_ptr; }
+    
+    // Page size backing our view (large pages only with SL_FLAG_HUGE_PAGES), 0 if not mapped
+    uint32_t pageSize() const { return m_pageSize; }
 
 private:
+    // Consumer registration (see ConsumerRegistration in shared_buffer.h)
+    bool registerConsumerSlot();
+    bool refreshConsumer(uint64_t nowNs);
+    
+    // Copy an acquired slot and advance the read cursor
+    bool copySlot(uint32_t slotIndex, unsigned char* buffer, size_t bufferSize, FrameMetadata* frame,
+                  uint64_t expectedFrame);
+    
+    // Open (or create) the named frame event shared with the other side
+    bool openFrameEvent();
+    
     std::string m_channelName;
     std::string m_shmName;
-    std::string m_semName;
+    std::string m_eventName;
     
     HANDLE m_hMapFile;
     SharedFrameBuffer* m_shm_ptr;
-    HANDLE m_hSemaphore;
+    size_t m_mappedSize;
+    uint32_t m_pageSize;                    // Page size backing the view
+    HANDLE m_hFrameEvent;                   // Auto-reset: only set while a consumer waits
+    uint32_t m_lastFrameSignal;             // frame_signal value of the last frame waited for or read
+    int64_t m_pendingWriteIndex;            // Slot acquired by beginWrite(), -1 if none
+    uint32_t m_consumerIndex;               // Our consumer registration, SL_MAX_CONSUMERS if none
+    uint32_t m_consumerToken;               // Owner token of that registration
+};
+
+/**
+ * Win32 Channel Directory (see ChannelDirectory in shared_buffer.h)
+ */
+class ShmWin32Directory {
+public:
+    ShmWin32Directory();
+    ~ShmWin32Directory();
+    
+    // Open the directory region, creating it if neither side has yet
+    bool open();
+    
+    // Withdraw our requests and unmap the region
+    void close();
+    
+    bool isOpen() const { return m_directory != nullptr; }
+    
+    // Request frames of OBS source `source` on frame channel `channel` (consumer)
+    // The frame channel should already exist. Returns the request index, -1 if
+    // the directory is full.
+    int requestChannel(const std::string& channel, const std::string& source);
+    
+    // Withdraw a request made through this instance (consumer)
+    void releaseChannel(int index);
+    
+    // Keep our requests alive; call more often than SL_CONSUMER_TIMEOUT_NS (consumer)
+    void refresh();
+    
+    // Snapshot of active request `index` (producer)
+    // Returns false if the entry is not active or changed while being read.
+    bool readRequest(uint32_t index, uint32_t& serial, std::string& channel, std::string& source) const;
+    
+    // Free requests whose consumer stopped sending heartbeats; returns how many (producer)
+    uint32_t expireStale();
+    
+    // Changes whenever a request is claimed, released or expired
+    uint32_t generation() const;
+    
+    // Tell producers a frame channel was just created (called by create())
+    void announceChannel();
+    
+    // Changes whenever a frame channel is created; producers (re)connect on a change
+    uint32_t channelEpoch() const;
+
+private:
+    std::string m_shmName;
+    HANDLE m_hMapFile;
+    ChannelDirectory* m_directory;
+    std::vector<int> m_ownedRequests;       // Requests claimed through this instance
+};
+
+/**
+ * Win32 Channel Metrics Page (see ChannelMetrics in shared_buffer.h)
+ */
+class ShmWin32Metrics {
+public:
+    explicit ShmWin32Metrics(const std::string& channelName);
+    ~ShmWin32Metrics();
+    
+    // Open the channel's metrics page, creating it if no one has yet (any process)
+    bool open();
+    
+    // Unmap the page
+    void close();
+    
+    // Record this process as the page's producer (process_id)
+    void claim();
+    
+    // Unmap the page (the mapping goes away with its last handle)
+    void destroy();
+    
+    bool isOpen() const { return m_metrics != nullptr; }
+    ChannelMetrics* get() const { return m_metrics; }
+
+private:
+    std::string m_shmName;
+    HANDLE m_hMapFile;
+    ChannelMetrics* m_metrics;
+};
+
+/**
+ * Win32 Encoded Packet Channel (see PacketRingBuffer in shared_buffer.h)
+ */
+class ShmWin32Packets {
+public:
+    explicit ShmWin32Packets(const std::string& channelName);
+    ~ShmWin32Packets();
+    
+    // Create the channel asking for an encoded stream (consumer)
+    // 0 / SL_CODEC_ANY leave the choice to the producer; dataSize bytes hold the packets
+    bool create(uint32_t codec = SL_CODEC_ANY, uint32_t width = 0, uint32_t height = 0,
+                uint32_t bitrateKbps = 0, uint32_t keyintMs = 0,
+                uint32_t dataSize = SL_PACKET_DEFAULT_DATA_SIZE);
+    
+    // Map a channel the consumer created (producer); fails silently until it exists
+    bool connect();
+    
+    // Unmap the channel
+    void disconnect();
+    
+    // Unmap the channel (the mapping goes away with its last handle)
+    void destroy();
+    
+    bool isConnected() const { return m_ring != nullptr; }
+    
+    // Whether the consumer re-created the channel since we published our stream (producer)
+    bool isReplaced() const;
+    
+    // Describe the stream of a new encoder session, before its first packet (producer)
+    void publishStreamInfo(uint32_t codec, uint32_t width, uint32_t height, uint32_t fpsNum, uint32_t fpsDen,
+                           int32_t timebaseNum, int32_t timebaseDen, const uint8_t* extraData, size_t extraDataSize);
+    
+    // Append one packet and wake waiting consumers (producer)
+    bool writePacket(const uint8_t* data, size_t size, int64_t pts, int64_t dts, bool keyframe,
+                     uint64_t captureTimeNs);
+    
+    // Whether a consumer read within SL_CONSUMER_TIMEOUT_NS (producer)
+    bool hasConsumer() const;
+    
+    // Newest unanswered keyframe request (producer); answer it with keyframeServed()
+    bool pendingKeyframeRequest(uint32_t& request) const;
+    void keyframeServed(uint32_t request);
+    
+    // Copy the next packet (consumer); see readPacket() in shared_buffer.h
+    // The first read starts at the newest keyframe.
+    PacketReadResult readPacket(uint8_t* buffer, size_t bufferSize, PacketInfo* info = nullptr);
+    
+    // Wait until a packet newer than the last one read is published
+    // timeoutMs < 0 waits forever, 0 polls.
+    bool waitForPacket(int timeoutMs = -1);
+    
+    // Stream info of the current encoder session (consumer); false before the first one
+    bool getStreamInfo(PacketStreamInfo& info) const;
+    
+    // Ask the producer for a keyframe, e.g. after SL_PACKET_SKIPPED (consumer)
+    void requestKeyframe();
+    
+    PacketRingBuffer* getBuffer() const { return m_ring; }
+
+private:
+    // Map `size` bytes of m_hMapFile
+    bool mapView(size_t size);
+    
+    std::string m_channelName;
+    std::string m_shmName;
+    std::string m_eventName;
+    HANDLE m_hMapFile;
+    HANDLE m_hPacketEvent;                  // Auto-reset: only set while a consumer waits
+    PacketRingBuffer* m_ring;
+    uint64_t m_readCursor;                  // Number of the last packet read (0 = none yet)
+    bool m_streamPublished;                 // publishStreamInfo() was called on this mapping
 };
 
 } // namespace StreamLumo
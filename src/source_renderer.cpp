@@ -0,0 +1,318 @@
+/**
+ * StreamLumo Source Renderer - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "source_renderer.h"
+#include "frame_writer.h"
+#include "readback_ring.h"
+#include "../include/shared_buffer.h"
+
+#include <util/platform.h>
+#include <util/util_uint64.h>
+#include <graphics/graphics.h>
+#include <graphics/vec4.h>
+#include <algorithm>
+#include <utility>
+
+namespace StreamLumo {
+
+SourceRenderer &SourceRenderer::instance()
+{
+    // Holds no graphics resources once the last writer is removed, so
+    // destroying it at exit after libobs has shut down is harmless
+    static SourceRenderer renderer;
+    return renderer;
+}
+
+SourceRenderer::SourceRenderer()
+    : m_tick(0)
+    , m_tickRegistered(false)
+{
+}
+
+SourceRenderer::~SourceRenderer()
+{
+}
+
+void SourceRenderer::add(FrameWriter *writer)
+{
+    bool registerTick = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (std::find(m_writers.begin(), m_writers.end(), writer) == m_writers.end()) {
+            m_writers.push_back(writer);
+        }
+        if (!m_tickRegistered) {
+            m_tickRegistered = true;
+            registerTick = true;
+        }
+    }
+
+    // Outside m_mutex: OBS holds its own lock while calling tick callbacks
+    if (registerTick) {
+        obs_add_tick_callback(tickCallback, this);
+        blog(LOG_INFO, "[SourceRenderer] Shared source rendering started");
+    }
+}
+
+void SourceRenderer::remove(FrameWriter *writer)
+{
+    bool unregisterTick = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writers.erase(std::remove(m_writers.begin(), m_writers.end(), writer), m_writers.end());
+        if (m_writers.empty()) {
+            if (!m_renders.empty() || !m_stages.empty()) {
+                obs_enter_graphics();
+                releaseIdle(0, true);
+                obs_leave_graphics();
+            }
+            unregisterTick = m_tickRegistered;
+            m_tickRegistered = false;
+        }
+    }
+
+    if (unregisterTick) {
+        obs_remove_tick_callback(tickCallback, this);
+        blog(LOG_INFO, "[SourceRenderer] Shared source rendering stopped");
+    }
+}
+
+void SourceRenderer::tickCallback(void *param, float seconds)
+{
+    UNUSED_PARAMETER(seconds);
+    static_cast<SourceRenderer *>(param)->tick();
+}
+
+void SourceRenderer::tick()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_writers.empty()) return;
+
+    struct obs_video_info ovi;
+    if (!obs_get_video_info(&ovi) || ovi.fps_num == 0 || ovi.fps_den == 0) return;
+
+    // Index of the current canvas frame from OBS's own frame clock, so a
+    // late tick still lands on the right frame and the cadence never drifts
+    const uint64_t frame = util_mul_div64(obs_get_video_frame_time() + (uint64_t)ovi.fps_den * 500000000ULL / ovi.fps_num,
+                                          ovi.fps_num, (uint64_t)ovi.fps_den * 1000000000ULL);
+
+    // Writers due this tick, each with a reference to its current source
+    std::vector<std::pair<FrameWriter *, obs_source_t *>> due;
+    for (FrameWriter *writer : m_writers) {
+        if (!writer->isRunning() || !writer->captureDue(ovi, frame)) continue;
+        obs_source_t *source = writer->getSourceRef();
+        if (source) due.emplace_back(writer, source);
+    }
+
+    const uint64_t now = os_gettime_ns();
+    m_tick++;
+
+    obs_enter_graphics();
+
+    // Group the due writers by render and staged output
+    for (const auto &entry : due) {
+        FrameWriter *writer = entry.first;
+        const uint32_t width = obs_source_get_width(entry.second);
+        const uint32_t height = obs_source_get_height(entry.second);
+        if (width == 0 || height == 0) continue;
+
+        RenderTarget *rendered = renderTarget(entry.second, width, height, now);
+        if (!rendered) continue;
+
+        // Channels that take the render as a shared GPU texture skip the readback
+        if (render(rendered) && writer->publishTexture(rendered->texture, width, height, now)) continue;
+
+        GpuConverter::Target target = { width, height, FORMAT_RGBA, nullptr };
+        const bool converted = writer->gpuConversionEnabled() &&
+            writer->gpuConversionTarget(width, height, target.width, target.height, target.format);
+        if (!converted) {
+            target = { width, height, FORMAT_RGBA, nullptr };
+        }
+
+        StageTarget *output = stageTarget(rendered, target, converted, writer->readbackDepth(), now);
+        output->writers.push_back(writer);
+    }
+
+    for (StageTarget *target : m_stages) {
+        if (target->writers.empty()) continue;
+        stage(target);
+        target->writers.clear();
+    }
+
+    releaseIdle(now, false);
+    obs_leave_graphics();
+
+    for (const auto &entry : due) {
+        obs_source_release(entry.second);
+    }
+}
+
+SourceRenderer::RenderTarget *SourceRenderer::renderTarget(obs_source_t *source, uint32_t width, uint32_t height, uint64_t nowNs)
+{
+    for (RenderTarget *target : m_renders) {
+        if (target->source == source && target->width == width && target->height == height) {
+            target->lastUsedNs = nowNs;
+            return target;
+        }
+    }
+
+    gs_texrender_t *texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+    if (!texrender) {
+        blog(LOG_ERROR, "[SourceRenderer] Failed to create texrender");
+        return nullptr;
+    }
+
+    // The target keeps the source alive, so its pointer stays a valid key
+    RenderTarget *target = new RenderTarget();
+    target->source = obs_source_get_ref(source);
+    target->width = width;
+    target->height = height;
+    target->texrender = texrender;
+    target->texture = nullptr;
+    target->renderedTick = 0;
+    target->lastUsedNs = nowNs;
+    m_renders.push_back(target);
+
+    blog(LOG_INFO, "[SourceRenderer] Rendering %s at %ux%u (%zu render target(s))",
+         obs_source_get_name(source), width, height, m_renders.size());
+    return target;
+}
+
+SourceRenderer::StageTarget *SourceRenderer::stageTarget(RenderTarget *render, const GpuConverter::Target &target,
+                                                         bool converted, uint32_t depth, uint64_t nowNs)
+{
+    for (StageTarget *stage : m_stages) {
+        if (stage->render == render && stage->converted == converted && stage->depth == depth &&
+            stage->target.width == target.width && stage->target.height == target.height &&
+            stage->target.format == target.format) {
+            stage->lastUsedNs = nowNs;
+            return stage;
+        }
+    }
+
+    StageTarget *stage = new StageTarget();
+    stage->render = render;
+    stage->target = target;
+    stage->converted = converted;
+    stage->depth = depth;
+    stage->converter = converted ? new GpuConverter() : nullptr;
+    stage->readback = new ReadbackRing(depth);
+    stage->lastUsedNs = nowNs;
+    m_stages.push_back(stage);
+    return stage;
+}
+
+bool SourceRenderer::render(RenderTarget *target)
+{
+    // Once per tick, however many stage targets read it
+    if (target->renderedTick == m_tick) return target->texture != nullptr;
+    target->renderedTick = m_tick;
+    target->texture = nullptr;
+
+    gs_texrender_reset(target->texrender);
+    if (!gs_texrender_begin(target->texrender, target->width, target->height)) {
+        blog(LOG_WARNING, "[SourceRenderer] Failed to begin texrender (width=%u height=%u)", target->width, target->height);
+        return false;
+    }
+
+    struct vec4 clear_color;
+    vec4_zero(&clear_color);
+    gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+
+    gs_ortho(0.0f, (float)target->width, 0.0f, (float)target->height, -100.0f, 100.0f);
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+    obs_source_video_render(target->source);
+
+    gs_blend_state_pop();
+    gs_texrender_end(target->texrender);
+
+    target->texture = gs_texrender_get_texture(target->texrender);
+    if (!target->texture) {
+        blog(LOG_WARNING, "[SourceRenderer] Failed to get texrender texture");
+    }
+    return target->texture != nullptr;
+}
+
+void SourceRenderer::stage(StageTarget *target)
+{
+    RenderTarget *source = target->render;
+    if (!render(source)) return;
+
+    gs_texture_t *stageTex = source->texture;
+    uint32_t stageWidth = source->width;
+    uint32_t stageHeight = source->height;
+    uint32_t contentFormat = FORMAT_RGBA;
+
+    // Falls back to staging the RGBA render when the conversion fails
+    if (target->converted) {
+        gs_texture_t *converted = target->converter->convert(source->texture, target->target, stageWidth, stageHeight);
+        if (converted) {
+            stageTex = converted;
+            contentFormat = target->target.format;
+        } else {
+            stageWidth = source->width;
+            stageHeight = source->height;
+        }
+    }
+
+    // Stage this frame and map the one staged (depth - 1) captures ago,
+    // so the map does not wait on the GPU copy we just queued
+    ReadbackRing::MappedFrame mapped;
+    if (!target->readback->stage(stageTex, stageWidth, stageHeight, mapped, contentFormat)) return;
+    const uint64_t latencyNs = os_gettime_ns() - mapped.stagedAtNs;
+
+    const uint8_t *data[MAX_PLANES] = {};
+    uint32_t linesize[MAX_PLANES] = {};
+    uint32_t frameWidth = 0;
+    uint32_t frameHeight = 0;
+    const enum video_format format = GpuConverter::describeFrame(mapped, data, linesize, frameWidth, frameHeight);
+
+    // One readback, every writer that asked for this output
+    for (FrameWriter *writer : target->writers) {
+        writer->recordReadbackLatency(target->readback->depth(), latencyNs, mapped.mapStallNs);
+        writer->processFrame(data, linesize, frameWidth, frameHeight, format, mapped.stagedAtNs);
+    }
+
+    target->readback->unmap();
+}
+
+void SourceRenderer::releaseIdle(uint64_t nowNs, bool all)
+{
+    auto idle = [&](uint64_t lastUsedNs) {
+        return all || nowNs - lastUsedNs >= RENDER_IDLE_TIMEOUT_NS;
+    };
+
+    // Stage targets go with their render target
+    for (size_t i = 0; i < m_stages.size();) {
+        StageTarget *stage = m_stages[i];
+        if (!idle(stage->lastUsedNs) && !idle(stage->render->lastUsedNs)) {
+            i++;
+            continue;
+        }
+        delete stage->converter;
+        delete stage->readback;
+        delete stage;
+        m_stages.erase(m_stages.begin() + i);
+    }
+
+    for (size_t i = 0; i < m_renders.size();) {
+        RenderTarget *render = m_renders[i];
+        if (!idle(render->lastUsedNs)) {
+            i++;
+            continue;
+        }
+        blog(LOG_INFO, "[SourceRenderer] Released render of %s at %ux%u",
+             obs_source_get_name(render->source), render->width, render->height);
+        gs_texrender_destroy(render->texrender);
+        obs_source_release(render->source);
+        delete render;
+        m_renders.erase(m_renders.begin() + i);
+    }
+}
+
+} // namespace StreamLumo
@@ -0,0 +1,109 @@
+/**
+ * StreamLumo Source Renderer - Header
+ *
+ * Renders the sources of all running source-capture FrameWriters from one
+ * tick callback, entering the graphics context once per tick:
+ * - writers capturing the same source at the same size share one render
+ * - writers that also want the same staged output (GPU-converted size and
+ *   format, or the plain RGBA render, at the same readback depth) share one
+ *   staging copy, and the mapped frame is handed to each of them
+ * Render and staging targets not used for RENDER_IDLE_TIMEOUT_NS are freed.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_SOURCE_RENDERER_H
+#define STREAMLUMO_SOURCE_RENDERER_H
+
+#include <obs.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "gpu_convert.h"
+
+namespace StreamLumo {
+
+class FrameWriter;
+class ReadbackRing;
+
+class SourceRenderer {
+public:
+    // Targets unused for this long are released (survive capture divisors and short source gaps)
+    static constexpr uint64_t RENDER_IDLE_TIMEOUT_NS = 1000000000ULL;
+
+    /**
+     * The renderer shared by every source-capture writer
+     */
+    static SourceRenderer &instance();
+
+    /**
+     * Capture a running writer's source from now on (FrameWriter::start())
+     */
+    void add(FrameWriter *writer);
+
+    /**
+     * Stop capturing for a writer; waits for a tick in progress (FrameWriter::stop())
+     * Graphics resources are released with the last writer.
+     */
+    void remove(FrameWriter *writer);
+
+private:
+    SourceRenderer();
+    ~SourceRenderer();
+    SourceRenderer(const SourceRenderer &) = delete;
+    SourceRenderer &operator=(const SourceRenderer &) = delete;
+
+    /**
+     * One source rendered at one size (holds a reference to the source)
+     */
+    struct RenderTarget {
+        obs_source_t *source;
+        uint32_t width;
+        uint32_t height;
+        gs_texrender_t *texrender;
+        gs_texture_t *texture;      // This tick's render, nullptr if not rendered (yet)
+        uint64_t renderedTick;
+        uint64_t lastUsedNs;
+    };
+
+    /**
+     * One staged output of a render target and the writers it goes to this tick
+     */
+    struct StageTarget {
+        RenderTarget *render;
+        GpuConverter::Target target;
+        bool converted;             // target is produced by the GPU converter
+        uint32_t depth;
+        GpuConverter *converter;
+        ReadbackRing *readback;
+        uint64_t lastUsedNs;
+        std::vector<FrameWriter *> writers;
+    };
+
+    static void tickCallback(void *param, float seconds);
+    void tick();
+
+    RenderTarget *renderTarget(obs_source_t *source, uint32_t width, uint32_t height, uint64_t nowNs);
+    StageTarget *stageTarget(RenderTarget *render, const GpuConverter::Target &target, bool converted,
+                             uint32_t depth, uint64_t nowNs);
+    bool render(RenderTarget *target);
+    void stage(StageTarget *target);
+
+    /**
+     * Free targets unused since `nowNs - RENDER_IDLE_TIMEOUT_NS` (all if `all`)
+     * Must be called inside the graphics context.
+     */
+    void releaseIdle(uint64_t nowNs, bool all);
+
+    std::mutex m_mutex;             // Held for the whole tick
+    std::vector<FrameWriter *> m_writers;
+    std::vector<RenderTarget *> m_renders;
+    std::vector<StageTarget *> m_stages;
+    uint64_t m_tick;
+    bool m_tickRegistered;
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_SOURCE_RENDERER_H
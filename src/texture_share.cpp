@@ -0,0 +1,243 @@
+/**
+ * StreamLumo Texture Share - Implementation
+ *
+ * @license GPL-2.0
+ */
+
+#include "texture_share.h"
+
+#include <graphics/graphics.h>
+
+#ifdef __APPLE__
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOSurface/IOSurface.h>
+#endif
+
+namespace StreamLumo {
+
+namespace {
+
+#ifdef __APPLE__
+void setDictionaryInt(CFMutableDictionaryRef dict, CFStringRef key, int32_t value)
+{
+    CFNumberRef number = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &value);
+    CFDictionarySetValue(dict, key, number);
+    CFRelease(number);
+}
+
+/**
+ * BGRA IOSurface that other processes can open by ID
+ * kIOSurfaceIsGlobal is deprecated but remains the only way to share a
+ * surface without a Mach port channel between the processes.
+ */
+IOSurfaceRef createGlobalSurface(uint32_t width, uint32_t height)
+{
+    CFMutableDictionaryRef props = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    setDictionaryInt(props, kIOSurfaceWidth, (int32_t)width);
+    setDictionaryInt(props, kIOSurfaceHeight, (int32_t)height);
+    setDictionaryInt(props, kIOSurfaceBytesPerElement, 4);
+    setDictionaryInt(props, kIOSurfacePixelFormat, (int32_t)'BGRA');
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    CFDictionarySetValue(props, kIOSurfaceIsGlobal, kCFBooleanTrue);
+#pragma clang diagnostic pop
+
+    IOSurfaceRef surface = IOSurfaceCreate(props);
+    CFRelease(props);
+    return surface;
+}
+#endif
+
+} // namespace
+
+TextureShare::TextureShare()
+    : m_texrender(nullptr)
+    , m_api(SL_TEXTURE_API_NONE)
+    , m_count(0)
+    , m_width(0)
+    , m_height(0)
+    , m_next(0)
+    , m_generation(0)
+{
+    for (uint32_t i = 0; i < SL_MAX_SHARED_TEXTURES; i++) {
+        m_textures[i] = nullptr;
+        m_surfaces[i] = nullptr;
+        m_handles[i] = 0;
+    }
+}
+
+TextureShare::~TextureShare()
+{
+    reset();
+    if (m_texrender) {
+        gs_texrender_destroy(m_texrender);
+        m_texrender = nullptr;
+    }
+}
+
+bool TextureShare::isSupported()
+{
+#if defined(_WIN32)
+    return gs_get_device_type() == GS_DEVICE_DIRECT3D_11;
+#elif defined(__APPLE__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TextureShare::reset()
+{
+    for (uint32_t i = 0; i < SL_MAX_SHARED_TEXTURES; i++) {
+        if (m_textures[i]) {
+            gs_texture_destroy(m_textures[i]);
+            m_textures[i] = nullptr;
+        }
+#ifdef __APPLE__
+        if (m_surfaces[i]) {
+            CFRelease(static_cast<IOSurfaceRef>(m_surfaces[i]));
+        }
+#endif
+        m_surfaces[i] = nullptr;
+        m_handles[i] = 0;
+    }
+    m_api = SL_TEXTURE_API_NONE;
+    m_count = 0;
+    m_width = 0;
+    m_height = 0;
+    m_next = 0;
+}
+
+bool TextureShare::ensureTextures(uint32_t width, uint32_t height)
+{
+    if (m_count > 0 && m_width == width && m_height == height) return true;
+    reset();
+
+#if defined(_WIN32)
+    gs_texture_t *texture = gs_texture_create(width, height, GS_BGRA, 1, nullptr, GS_SHARED_KM_TEX | GS_RENDER_TARGET);
+    const uint32_t handle = texture ? gs_texture_get_shared_handle(texture) : GS_INVALID_HANDLE;
+    if (handle == GS_INVALID_HANDLE) {
+        blog(LOG_WARNING, "[TextureShare] Failed to create a %ux%u shared texture", width, height);
+        if (texture) gs_texture_destroy(texture);
+        return false;
+    }
+    m_textures[0] = texture;
+    m_handles[0] = handle;
+    m_api = SL_TEXTURE_API_DXGI;
+    m_count = 1;
+#elif defined(__APPLE__)
+    for (uint32_t i = 0; i < SL_MAX_SHARED_TEXTURES; i++) {
+        IOSurfaceRef surface = createGlobalSurface(width, height);
+        gs_texture_t *texture = surface ? gs_texture_create_from_iosurface(surface) : nullptr;
+        if (!texture) {
+            blog(LOG_WARNING, "[TextureShare] Failed to create a %ux%u IOSurface texture", width, height);
+            if (surface) CFRelease(surface);
+            reset();
+            return false;
+        }
+        m_surfaces[i] = surface;
+        m_textures[i] = texture;
+        m_handles[i] = IOSurfaceGetID(surface);
+    }
+    m_api = SL_TEXTURE_API_IOSURFACE;
+    m_count = SL_MAX_SHARED_TEXTURES;
+#else
+    return false;
+#endif
+
+    m_width = width;
+    m_height = height;
+    m_generation++;
+    blog(LOG_INFO, "[TextureShare] %u shared %ux%u texture(s) ready", m_count, width, height);
+    return true;
+}
+
+void TextureShare::drawSource(gs_texture_t *source, uint32_t width, uint32_t height)
+{
+    gs_ortho(0.0f, (float)width, 0.0f, (float)height, -100.0f, 100.0f);
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+    gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), source);
+    while (gs_effect_loop(effect, "Draw")) {
+        gs_draw_sprite(source, 0, width, height);
+    }
+
+    gs_blend_state_pop();
+}
+
+#ifdef _WIN32
+void TextureShare::renderInto(gs_texture_t *target, gs_texture_t *source, uint32_t width, uint32_t height)
+{
+    gs_texture_t *previousTarget = gs_get_render_target();
+    gs_zstencil_t *previousZs = gs_get_zstencil_target();
+    gs_viewport_push();
+    gs_projection_push();
+    gs_matrix_push();
+    gs_matrix_identity();
+
+    gs_set_render_target(target, nullptr);
+    gs_set_viewport(0, 0, (int)width, (int)height);
+    drawSource(source, width, height);
+
+    gs_set_render_target(previousTarget, previousZs);
+    gs_matrix_pop();
+    gs_projection_pop();
+    gs_viewport_pop();
+}
+#endif
+
+TextureShare::Result TextureShare::copy(gs_texture_t *source, uint32_t width, uint32_t height, uint32_t busy, uint32_t &index)
+{
+    const uint32_t generation = m_generation;
+    if (!source || !isSupported() || !ensureTextures(width, height)) return UNAVAILABLE;
+
+    // Readers' hazards name the textures before a resize, not these
+    if (m_generation != generation) busy = 0;
+
+#ifdef _WIN32
+    // One texture behind the keyed mutex: never wait for the consumer, skip
+    // the frame while it holds the texture, and draw straight into it
+    UNUSED_PARAMETER(busy);
+    index = 0;
+    gs_texture_t *target = m_textures[0];
+    if (gs_texture_acquire_sync(target, SYNC_KEY, 0) != 0) return BUSY;
+    renderInto(target, source, width, height);
+    gs_texture_release_sync(target, SYNC_KEY);
+#else
+    // Next texture that holds neither the latest frame nor one a reader is using
+    index = m_count;
+    for (uint32_t i = 0; i < m_count; i++) {
+        const uint32_t candidate = (m_next + i) % m_count;
+        if ((busy & (1u << candidate)) == 0) {
+            index = candidate;
+            break;
+        }
+    }
+    if (index == m_count) return BUSY;
+
+    // IOSurface textures are not render targets in libobs: draw the RGBA
+    // render into a BGRA one and copy that into the surface
+    if (!m_texrender) {
+        m_texrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+        if (!m_texrender) return UNAVAILABLE;
+    }
+    gs_texrender_reset(m_texrender);
+    if (!gs_texrender_begin(m_texrender, width, height)) return UNAVAILABLE;
+    drawSource(source, width, height);
+    gs_texrender_end(m_texrender);
+
+    gs_texture_t *bgra = gs_texrender_get_texture(m_texrender);
+    if (!bgra) return UNAVAILABLE;
+    gs_copy_texture(m_textures[index], bgra);
+#endif
+
+    // Submit now so the consumer can use the texture once it is published
+    gs_flush();
+    m_next = (index + 1) % m_count;
+    return COPIED;
+}
+
+} // namespace StreamLumo
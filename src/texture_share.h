@@ -0,0 +1,93 @@
+/**
+ * StreamLumo Texture Share - Header
+ *
+ * Cross-process GPU textures for local consumers, so a rendered source frame
+ * reaches the consumer without a readback:
+ * - Windows (D3D11): one BGRA render target with a legacy shared handle and
+ *   an IDXGIKeyedMutex (GS_SHARED_KM_TEX), drawn into directly
+ * - macOS: three global IOSurfaces; a frame goes to one that neither holds
+ *   the latest frame nor is held by a reader (see TextureDescriptor)
+ * - Linux: not supported; libobs can import DMA-BUFs but not export its
+ *   textures, so channels there keep the shm readback path
+ * The handles are published through the channel's TextureDescriptor.
+ *
+ * All methods except isSupported() must be called from inside the graphics context.
+ *
+ * @license GPL-2.0
+ */
+
+#ifndef STREAMLUMO_TEXTURE_SHARE_H
+#define STREAMLUMO_TEXTURE_SHARE_H
+
+#include <obs.h>
+#include <cstdint>
+
+#include "../include/shared_buffer.h"
+
+namespace StreamLumo {
+
+class TextureShare {
+public:
+    enum Result {
+        COPIED,         // Frame is in texture `index`
+        BUSY,           // Readers hold every texture we could use; frame skipped
+        UNAVAILABLE     // Textures can't be shared here; use the shm path
+    };
+
+    // Keyed mutex key used by both sides (published as sync_key)
+    static constexpr uint32_t SYNC_KEY = 0;
+
+    TextureShare();
+    ~TextureShare();
+
+    /**
+     * Whether this platform's graphics backend can export textures
+     */
+    static bool isSupported();
+
+    /**
+     * Render `source` (width x height) into the next shared texture
+     * Textures whose bit is set in `busy` (ShmPosix::busySharedTextures())
+     * are skipped; the keyed mutex guards the DXGI texture instead.
+     * Recreates the textures (and bumps generation()) when the size changes.
+     */
+    Result copy(gs_texture_t *source, uint32_t width, uint32_t height, uint32_t busy, uint32_t &index);
+
+    /**
+     * Current textures, valid after the first COPIED frame
+     */
+    uint32_t api() const { return m_api; }
+    uint32_t count() const { return m_count; }
+    const uint64_t *handles() const { return m_handles; }
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+    uint32_t format() const { return FORMAT_BGRA; }
+    uint32_t generation() const { return m_generation; }
+
+    /**
+     * Release the shared textures
+     */
+    void reset();
+
+private:
+    bool ensureTextures(uint32_t width, uint32_t height);
+    void drawSource(gs_texture_t *source, uint32_t width, uint32_t height);
+#ifdef _WIN32
+    void renderInto(gs_texture_t *target, gs_texture_t *source, uint32_t width, uint32_t height);
+#endif
+
+    gs_texrender_t *m_texrender;    // macOS: BGRA render of the source, copied into the IOSurface
+    gs_texture_t *m_textures[SL_MAX_SHARED_TEXTURES];
+    void *m_surfaces[SL_MAX_SHARED_TEXTURES];   // macOS: IOSurfaceRef backing each texture
+    uint64_t m_handles[SL_MAX_SHARED_TEXTURES];
+    uint32_t m_api;
+    uint32_t m_count;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_next;                // Texture the next frame goes to
+    uint32_t m_generation;          // Bumped whenever the textures are recreated
+};
+
+} // namespace StreamLumo
+
+#endif // STREAMLUMO_TEXTURE_SHARE_H